@@ -17,6 +17,7 @@
 #include "base/workqueue.hpp"
 #include "base/context.hpp"
 #include "base/application.hpp"
+#include "base/utility.hpp"
 #include <fstream>
 #include <boost/exception/errinfo_api_function.hpp>
 #include <boost/exception/errinfo_errno.hpp>
@@ -28,6 +29,23 @@ REGISTER_TYPE_WITH_PROTOTYPE(ConfigObject, ConfigObject::GetPrototype());
 
 boost::signals2::signal<void (const ConfigObject::Ptr&)> ConfigObject::OnStateChanged;
 
+/* Starts at the current time in microseconds, so the versions keep increasing across restarts. */
+static std::atomic<uint_fast64_t> l_ChangeVersion (static_cast<uint_fast64_t>(Utility::GetTime() * 1000 * 1000));
+static const uint_fast64_t l_InitialChangeVersion = l_ChangeVersion.load();
+
+INITIALIZE_ONCE([]() {
+	/* A check result or a modified attribute is a single change, no matter how many attributes it updates. */
+	ConfigObject::OnStateChanged.connect([](const ConfigObject::Ptr& object) {
+		if (object->IsActive())
+			object->UpdateChangeVersion();
+	});
+
+	ConfigObject::OnVersionChanged.connect([](const ConfigObject::Ptr& object, const Value&) {
+		if (object->IsActive())
+			object->UpdateChangeVersion();
+	});
+});
+
 bool ConfigObject::IsActive() const
 {
 	return GetActive();
@@ -373,6 +391,8 @@ void ConfigObject::Activate(bool runtimeCreated, const Value& cookie)
 			SetAuthority(true);
 	}
 
+	UpdateChangeVersion();
+
 	NotifyActive(cookie);
 }
 
@@ -697,5 +717,50 @@ Dictionary::Ptr ConfigObject::GetSourceLocation() const
 	});
 }
 
+/**
+ * @returns The version of the object's last change, see UpdateChangeVersion().
+ */
+uint_fast64_t ConfigObject::GetChangeVersion() const
+{
+	return m_ChangeVersion.load();
+}
+
+/**
+ * Assigns a new change version to the object, e.g. for conditional API
+ * object queries. Called once per change of the active object rather than
+ * for every attribute it updates, see ConfigObject::OnStateChanged.
+ */
+void ConfigObject::UpdateChangeVersion()
+{
+	uint_fast64_t version = NewChangeVersion();
+	uint_fast64_t current = m_ChangeVersion.load();
+
+	/* Concurrent updates must not move the version backwards. */
+	while (current < version && !m_ChangeVersion.compare_exchange_weak(current, version))
+		;
+}
+
+/**
+ * @returns The most recently assigned change version of all objects.
+ */
+uint_fast64_t ConfigObject::GetCurrentChangeVersion()
+{
+	return l_ChangeVersion.load();
+}
+
+/**
+ * @returns The change version this process started with. Changes before
+ * it (e.g. before a restart) aren't known.
+ */
+uint_fast64_t ConfigObject::GetInitialChangeVersion()
+{
+	return l_InitialChangeVersion;
+}
+
+uint_fast64_t ConfigObject::NewChangeVersion()
+{
+	return l_ChangeVersion.fetch_add(1) + 1;
+}
+
 NameComposer::~NameComposer()
 { }
@@ -9,6 +9,8 @@
 #include "base/type.hpp"
 #include "base/dictionary.hpp"
 #include <boost/signals2.hpp>
+#include <atomic>
+#include <cstdint>
 
 namespace icinga
 {
@@ -61,6 +63,13 @@ public:
 
 	Dictionary::Ptr GetSourceLocation() const override;
 
+	uint_fast64_t GetChangeVersion() const;
+	void UpdateChangeVersion();
+
+	static uint_fast64_t GetCurrentChangeVersion();
+	static uint_fast64_t GetInitialChangeVersion();
+	static uint_fast64_t NewChangeVersion();
+
 	template<typename T>
 	static intrusive_ptr<T> GetObject(const String& name)
 	{
@@ -81,6 +90,7 @@ public:
 
 private:
 	ConfigObject::Ptr m_Zone;
+	std::atomic<uint_fast64_t> m_ChangeVersion {0};
 
 	static void RestoreObject(const String& message, int attributeTypes);
 };
@@ -3,9 +3,13 @@
 #include "base/configobject.hpp"
 #include "base/convert.hpp"
 #include "base/exception.hpp"
+#include <algorithm>
 
 using namespace icinga;
 
+/* Removals older than the last ones per type can't be reported to the API anymore. */
+static const size_t l_MaxRemovedObjects = 10000;
+
 ConfigType::~ConfigType()
 { }
 
@@ -55,6 +59,13 @@ void ConfigType::UnregisterObject(const ConfigObject::Ptr& object)
 
 		m_ObjectMap.erase(name);
 		m_ObjectVector.erase(std::remove(m_ObjectVector.begin(), m_ObjectVector.end(), object), m_ObjectVector.end());
+
+		m_RemovedObjects.emplace_back(ConfigObject::NewChangeVersion(), name);
+
+		if (m_RemovedObjects.size() > l_MaxRemovedObjects) {
+			m_RemovedObjectsSince = m_RemovedObjects.front().first;
+			m_RemovedObjects.pop_front();
+		}
 	}
 }
 
@@ -74,3 +85,24 @@ int ConfigType::GetObjectCount() const
 	std::unique_lock<std::mutex> lock(m_Mutex);
 	return m_ObjectVector.size();
 }
+
+/**
+ * Gets the names of the objects which were removed after the specified
+ * change version.
+ *
+ * @param since The change version.
+ * @param names Receives the names.
+ * @returns Whether all removals since this version are known.
+ */
+bool ConfigType::GetRemovedObjects(uint_fast64_t since, std::vector<String>& names) const
+{
+	std::unique_lock<std::mutex> lock(m_Mutex);
+
+	if (since < std::max(m_RemovedObjectsSince, ConfigObject::GetInitialChangeVersion()))
+		return false;
+
+	for (auto it (m_RemovedObjects.rbegin()); it != m_RemovedObjects.rend() && it->first > since; it++)
+		names.push_back(it->second);
+
+	return true;
+}
@@ -7,6 +7,8 @@
 #include "base/object.hpp"
 #include "base/type.hpp"
 #include "base/dictionary.hpp"
+#include <cstdint>
+#include <deque>
 #include <mutex>
 
 namespace icinga
@@ -47,6 +49,8 @@ for (const auto& object : objects) {
 
 	int GetObjectCount() const;
 
+	bool GetRemovedObjects(uint_fast64_t since, std::vector<String>& names) const;
+
 private:
 	typedef std::map<String, intrusive_ptr<ConfigObject> > ObjectMap;
 	typedef std::vector<intrusive_ptr<ConfigObject> > ObjectVector;
@@ -55,6 +59,10 @@ private:
 	ObjectMap m_ObjectMap;
 	ObjectVector m_ObjectVector;
 
+	/* The change versions and names of recently removed objects, oldest first. */
+	std::deque<std::pair<uint_fast64_t, String> > m_RemovedObjects;
+	uint_fast64_t m_RemovedObjectsSince{0};
+
 	static std::vector<intrusive_ptr<ConfigObject> > GetObjectsHelper(Type *type);
 };
 
@@ -0,0 +1,191 @@
+/* Icinga 2 | (c) 2012 Icinga GmbH | GPLv2+ */
+
+#include "base/deadlinescheduler.hpp"
+#include "base/perfdatavalue.hpp"
+#include "base/statsfunction.hpp"
+#include "base/exception.hpp"
+#include "base/logger.hpp"
+#include "base/utility.hpp"
+#include <algorithm>
+#include <set>
+#include <vector>
+
+using namespace icinga;
+
+static std::mutex l_DeadlineSchedulersMutex;
+static std::set<DeadlineScheduler *> l_DeadlineSchedulers;
+
+REGISTER_STATSFUNCTION(DeadlineScheduler, &DeadlineScheduler::StatsFunc);
+
+DeadlineScheduler::DeadlineScheduler(String name, Callback callback)
+	: m_Name(std::move(name)), m_Callback(std::move(callback))
+{
+	{
+		std::unique_lock<std::mutex> lock(l_DeadlineSchedulersMutex);
+		l_DeadlineSchedulers.insert(this);
+	}
+
+	/* The timer has no interval, it is only ever armed for the next deadline. */
+	m_Timer = new Timer();
+	m_Timer->OnTimerExpired.connect([this](const Timer * const&) { TimerHandler(); });
+	m_Timer->Start();
+}
+
+DeadlineScheduler::~DeadlineScheduler()
+{
+	m_Timer->Stop(true);
+
+	std::unique_lock<std::mutex> lock(l_DeadlineSchedulersMutex);
+	l_DeadlineSchedulers.erase(this);
+}
+
+/**
+ * Schedules the callback for the specified object. An already pending
+ * deadline for the same object is replaced.
+ *
+ * @param object The object which is passed to the callback.
+ * @param deadline The timestamp at which the callback should be invoked.
+ */
+void DeadlineScheduler::Schedule(const Object::Ptr& object, double deadline)
+{
+	std::unique_lock<std::mutex> lock(m_Mutex);
+
+	auto& idx = boost::get<0>(m_Entries);
+	auto it = idx.find(object.get());
+
+	if (it == idx.end())
+		m_Entries.insert(Entry{object.get(), object, deadline});
+	else
+		idx.modify(it, [deadline](Entry& entry) { entry.Deadline = deadline; });
+
+	ArmUnlocked(deadline);
+}
+
+/**
+ * Removes the pending deadline (if any) for the specified object.
+ *
+ * @param object The object.
+ */
+void DeadlineScheduler::Cancel(const Object::Ptr& object)
+{
+	std::unique_lock<std::mutex> lock(m_Mutex);
+
+	/* The timer stays armed, it is cheaper to let it fire for nothing. */
+	boost::get<0>(m_Entries).erase(object.get());
+}
+
+String DeadlineScheduler::GetName() const
+{
+	return m_Name;
+}
+
+size_t DeadlineScheduler::GetPending() const
+{
+	std::unique_lock<std::mutex> lock(m_Mutex);
+	return m_Entries.size();
+}
+
+/**
+ * Returns the delay between the deadline and the actual dispatch of the
+ * most recently handled entry.
+ *
+ * @returns The lag in seconds.
+ */
+double DeadlineScheduler::GetLastLag() const
+{
+	std::unique_lock<std::mutex> lock(m_Mutex);
+	return m_LastLag;
+}
+
+double DeadlineScheduler::GetMaxLag() const
+{
+	std::unique_lock<std::mutex> lock(m_Mutex);
+	return m_MaxLag;
+}
+
+double DeadlineScheduler::GetAvgLag() const
+{
+	std::unique_lock<std::mutex> lock(m_Mutex);
+
+	if (m_Dispatched == 0)
+		return 0;
+
+	return m_TotalLag / m_Dispatched;
+}
+
+/**
+ * Makes sure the timer fires no later than the specified deadline.
+ * The caller must hold m_Mutex.
+ */
+void DeadlineScheduler::ArmUnlocked(double deadline)
+{
+	deadline = std::max(deadline, 0.0);
+
+	if (m_Armed < 0 || deadline < m_Armed) {
+		m_Armed = deadline;
+		m_Timer->Reschedule(deadline);
+	}
+}
+
+void DeadlineScheduler::TimerHandler()
+{
+	std::vector<Object::Ptr> due;
+
+	{
+		std::unique_lock<std::mutex> lock(m_Mutex);
+
+		double now = Utility::GetTime();
+		auto& idx = boost::get<1>(m_Entries);
+
+		m_Armed = -1;
+
+		while (!idx.empty() && idx.begin()->Deadline <= now) {
+			auto it (idx.begin());
+			double lag = now - it->Deadline;
+
+			m_LastLag = lag;
+			m_MaxLag = std::max(m_MaxLag, lag);
+			m_TotalLag += lag;
+			m_Dispatched++;
+
+			due.push_back(it->Target);
+			idx.erase(it);
+		}
+
+		if (!idx.empty())
+			ArmUnlocked(idx.begin()->Deadline);
+	}
+
+	for (const Object::Ptr& object : due) {
+		try {
+			m_Callback(object);
+		} catch (const std::exception& ex) {
+			Log(LogCritical, "DeadlineScheduler")
+				<< "Exception in deadline handler of '" << m_Name << "': " << DiagnosticInformation(ex, false);
+		}
+	}
+}
+
+void DeadlineScheduler::StatsFunc(const Dictionary::Ptr& status, const Array::Ptr& perfdata)
+{
+	DictionaryData nodes;
+
+	std::unique_lock<std::mutex> lock(l_DeadlineSchedulersMutex);
+
+	for (DeadlineScheduler *scheduler : l_DeadlineSchedulers) {
+		String name = scheduler->GetName();
+		double lastLag = scheduler->GetLastLag();
+
+		nodes.emplace_back(name, new Dictionary({
+			{ "pending", scheduler->GetPending() },
+			{ "last_lag", lastLag },
+			{ "max_lag", scheduler->GetMaxLag() },
+			{ "avg_lag", scheduler->GetAvgLag() }
+		}));
+
+		perfdata->Add(new PerfdataValue("deadlinescheduler_" + name + "_pending", scheduler->GetPending()));
+		perfdata->Add(new PerfdataValue("deadlinescheduler_" + name + "_lag", lastLag));
+	}
+
+	status->Set("deadlinescheduler", new Dictionary(std::move(nodes)));
+}
@@ -0,0 +1,85 @@
+/* Icinga 2 | (c) 2012 Icinga GmbH | GPLv2+ */
+
+#ifndef DEADLINESCHEDULER_H
+#define DEADLINESCHEDULER_H
+
+#include "base/i2-base.hpp"
+#include "base/object.hpp"
+#include "base/timer.hpp"
+#include "base/dictionary.hpp"
+#include "base/array.hpp"
+#include <boost/multi_index_container.hpp>
+#include <boost/multi_index/ordered_index.hpp>
+#include <boost/multi_index/member.hpp>
+#include <functional>
+#include <mutex>
+
+namespace icinga
+{
+
+/**
+ * Calls a handler for objects exactly when their individual deadline is due.
+ *
+ * Each object has at most one pending deadline per scheduler. Instead of
+ * periodically scanning all objects, a single one-shot timer is armed for
+ * the earliest pending deadline.
+ *
+ * @ingroup base
+ */
+class DeadlineScheduler final : public Object
+{
+public:
+	DECLARE_PTR_TYPEDEFS(DeadlineScheduler);
+
+	typedef std::function<void (const Object::Ptr&)> Callback;
+
+	DeadlineScheduler(String name, Callback callback);
+	~DeadlineScheduler() override;
+
+	void Schedule(const Object::Ptr& object, double deadline);
+	void Cancel(const Object::Ptr& object);
+
+	String GetName() const;
+	size_t GetPending() const;
+	double GetLastLag() const;
+	double GetMaxLag() const;
+	double GetAvgLag() const;
+
+	static void StatsFunc(const Dictionary::Ptr& status, const Array::Ptr& perfdata);
+
+private:
+	struct Entry
+	{
+		Object *Key;
+		Object::Ptr Target;
+		double Deadline;
+	};
+
+	typedef boost::multi_index_container<
+		Entry,
+		boost::multi_index::indexed_by<
+			boost::multi_index::ordered_unique<boost::multi_index::member<Entry, Object *, &Entry::Key> >,
+			boost::multi_index::ordered_non_unique<boost::multi_index::member<Entry, double, &Entry::Deadline> >
+		>
+	> EntrySet;
+
+	String m_Name;
+	Callback m_Callback;
+	Timer::Ptr m_Timer;
+
+	mutable std::mutex m_Mutex;
+	EntrySet m_Entries;
+	double m_Armed{-1};
+
+	uint_fast64_t m_Dispatched{0};
+	double m_LastLag{0};
+	double m_MaxLag{0};
+	double m_TotalLag{0};
+
+	void ArmUnlocked(double deadline);
+	void TimerHandler();
+};
+
+}
+
+#endif /* DEADLINESCHEDULER_H */
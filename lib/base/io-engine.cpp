@@ -84,10 +84,27 @@ boost::asio::io_context& IoEngine::GetIoContext()
 	return m_IoContext;
 }
 
+/**
+ * @returns The total number of slots for CPU-bound work.
+ */
+uint_fast32_t IoEngine::GetCpuBoundSlots() const
+{
+	return m_CpuBoundSlots;
+}
+
+/**
+ * @returns The number of currently unused slots for CPU-bound work, may be briefly negative.
+ */
+int_fast32_t IoEngine::GetFreeCpuBoundSlots() const
+{
+	return m_CpuBoundSemaphore.load();
+}
+
 IoEngine::IoEngine() : m_IoContext(), m_KeepAlive(boost::asio::make_work_guard(m_IoContext)), m_Threads(decltype(m_Threads)::size_type(std::thread::hardware_concurrency() * 2u)), m_AlreadyExpiredTimer(m_IoContext)
 {
 	m_AlreadyExpiredTimer.expires_at(boost::posix_time::neg_infin);
-	m_CpuBoundSemaphore.store(std::thread::hardware_concurrency() * 3u / 2u);
+	m_CpuBoundSlots = std::thread::hardware_concurrency() * 3u / 2u;
+	m_CpuBoundSemaphore.store(m_CpuBoundSlots);
 
 	for (auto& thread : m_Threads) {
 		thread = std::thread(&IoEngine::RunEventLoop, this);
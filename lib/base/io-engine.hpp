@@ -83,6 +83,9 @@ public:
 
 	boost::asio::io_context& GetIoContext();
 
+	uint_fast32_t GetCpuBoundSlots() const;
+	int_fast32_t GetFreeCpuBoundSlots() const;
+
 	static inline size_t GetCoroutineStackSize() {
 #ifdef _WIN32
 		// Increase the stack size for Windows coroutines to prevent exception corruption.
@@ -136,6 +139,7 @@ private:
 	boost::asio::executor_work_guard<boost::asio::io_context::executor_type> m_KeepAlive;
 	std::vector<std::thread> m_Threads;
 	boost::asio::deadline_timer m_AlreadyExpiredTimer;
+	uint_fast32_t m_CpuBoundSlots;
 	std::atomic_int_fast32_t m_CpuBoundSemaphore;
 };
 
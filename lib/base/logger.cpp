@@ -13,7 +13,9 @@
 #include "base/windowseventloglogger.hpp"
 #endif /* _WIN32 */
 #include <algorithm>
+#include <atomic>
 #include <iostream>
+#include <mutex>
 #include <utility>
 
 using namespace icinga;
@@ -39,6 +41,11 @@ LogSeverity Logger::m_ConsoleLogSeverity = LogInformation;
 std::mutex Logger::m_UpdateMinLogSeverityMutex;
 Atomic<LogSeverity> Logger::m_MinLogSeverity (LogDebug);
 
+/* In the order they were created. */
+static std::mutex l_LogRecordersMutex;
+static std::vector<LogRecorder *> l_LogRecorders;
+static std::atomic<bool> l_HasLogRecorders (false);
+
 INITIALIZE_ONCE([]() {
 	ScriptGlobal::Set("System.LogDebug", LogDebug, true);
 	ScriptGlobal::Set("System.LogNotice", LogNotice, true);
@@ -286,6 +293,40 @@ Log::~Log()
 		}
 	}
 
+	Write(entry);
+}
+
+/**
+ * Writes a log entry to all active loggers and the console, unless the
+ * current thread holds back its log entries in a LogRecorder.
+ *
+ * @param entry The log entry.
+ */
+void Log::Write(const LogEntry& entry)
+{
+	if (l_HasLogRecorders.load()) {
+		std::unique_lock<std::mutex> lock(l_LogRecordersMutex);
+		auto thread (std::this_thread::get_id());
+
+		/* Only the innermost recorder holding back the entries of this thread gets them.
+		 * Whoever created it writes them later, that's when the others get them. */
+		for (auto it (l_LogRecorders.rbegin()); it != l_LogRecorders.rend(); it++) {
+			LogRecorder *recorder = *it;
+
+			if (recorder->m_Scope == LogHoldBackCurrentThread && recorder->m_Thread == thread) {
+				if (entry.Severity >= recorder->m_MinSeverity)
+					recorder->m_Entries.push_back(entry);
+
+				return;
+			}
+		}
+
+		for (LogRecorder *recorder : l_LogRecorders) {
+			if (recorder->m_Scope == LogRecordAllThreads && entry.Severity >= recorder->m_MinSeverity)
+				recorder->m_Entries.push_back(entry);
+		}
+	}
+
 	for (const Logger::Ptr& logger : Logger::GetLoggers()) {
 		ObjectLock llock(logger);
 
@@ -316,6 +357,46 @@ Log::~Log()
 #endif /* _WIN32 */
 }
 
+LogRecorder::LogRecorder(LogSeverity minSeverity, LogRecorderScope scope)
+	: m_MinSeverity(minSeverity), m_Scope(scope), m_Thread(std::this_thread::get_id())
+{
+	std::unique_lock<std::mutex> lock(l_LogRecordersMutex);
+
+	l_LogRecorders.push_back(this);
+	l_HasLogRecorders.store(true);
+}
+
+LogRecorder::~LogRecorder()
+{
+	std::unique_lock<std::mutex> lock(l_LogRecordersMutex);
+
+	l_LogRecorders.erase(std::find(l_LogRecorders.begin(), l_LogRecorders.end(), this));
+	l_HasLogRecorders.store(!l_LogRecorders.empty());
+}
+
+/**
+ * @returns Copies of the log entries recorded so far, in the order they were written.
+ */
+std::vector<LogEntry> LogRecorder::GetEntries() const
+{
+	std::unique_lock<std::mutex> lock(l_LogRecordersMutex);
+
+	return m_Entries;
+}
+
+/**
+ * Returns the log entries recorded so far and forgets them. Held back entries
+ * aren't written anywhere unless the caller passes them to Log::Write().
+ *
+ * @returns The log entries, in the order they were created.
+ */
+std::vector<LogEntry> LogRecorder::TakeEntries()
+{
+	std::unique_lock<std::mutex> lock(l_LogRecordersMutex);
+
+	return std::move(m_Entries);
+}
+
 Log& Log::operator<<(const char *val)
 {
 	if (!m_IsNoOp) {
@@ -8,6 +8,8 @@
 #include "base/logger-ti.hpp"
 #include <set>
 #include <sstream>
+#include <thread>
+#include <vector>
 
 namespace icinga
 {
@@ -127,6 +129,8 @@ public:
 
 	Log& operator<<(const char *val);
 
+	static void Write(const LogEntry& entry);
+
 private:
 	LogSeverity m_Severity;
 	String m_Facility;
@@ -134,6 +138,47 @@ private:
 	bool m_IsNoOp;
 };
 
+/**
+ * Which log entries a LogRecorder records.
+ *
+ * @ingroup base
+ */
+enum LogRecorderScope
+{
+	/* Copies of the entries of all threads, they're written as usual. */
+	LogRecordAllThreads,
+	/* The entries of the current thread, they're held back instead of being written,
+	 * so that the messages of concurrently running tasks can be written in a fixed order. */
+	LogHoldBackCurrentThread
+};
+
+/**
+ * Records log entries with at least the specified severity while it exists,
+ * e.g. to report them again later.
+ *
+ * @ingroup base
+ */
+class LogRecorder
+{
+public:
+	LogRecorder(LogSeverity minSeverity, LogRecorderScope scope = LogRecordAllThreads);
+	~LogRecorder();
+
+	LogRecorder(const LogRecorder&) = delete;
+	LogRecorder& operator=(const LogRecorder&) = delete;
+
+	std::vector<LogEntry> GetEntries() const;
+	std::vector<LogEntry> TakeEntries();
+
+private:
+	LogSeverity m_MinSeverity;
+	LogRecorderScope m_Scope;
+	std::thread::id m_Thread;
+	std::vector<LogEntry> m_Entries;
+
+	friend class Log;
+};
+
 extern template Log& Log::operator<<(const Value&);
 extern template Log& Log::operator<<(const String&);
 extern template Log& Log::operator<<(const std::string&);
@@ -203,9 +203,16 @@ void Timer::InternalReschedule(bool completed, double next)
 {
 	std::unique_lock<std::mutex> lock(l_TimerMutex);
 
-	if (completed)
+	if (completed) {
 		m_Running = false;
 
+		/* Honor a Reschedule() call which happened while the timer proc was running. */
+		if (next < 0 && m_Rescheduled)
+			next = m_Next;
+
+		m_Rescheduled = false;
+	}
+
 	if (next < 0) {
 		/* Don't schedule the next call if this is not a periodic timer. */
 		if (m_Interval <= 0)
@@ -216,6 +223,9 @@ void Timer::InternalReschedule(bool completed, double next)
 
 	m_Next = next;
 
+	if (m_Running)
+		m_Rescheduled = true;
+
 	if (m_Started && !m_Running) {
 		/* Remove and re-add the timer to update the index. */
 		l_Timers.erase(this);
@@ -46,6 +46,7 @@ private:
 	double m_Next{0}; /**< When the next event should happen. */
 	bool m_Started{false}; /**< Whether the timer is enabled. */
 	bool m_Running{false}; /**< Whether the timer proc is currently running. */
+	bool m_Rescheduled{false}; /**< Whether the timer was rescheduled while its proc was running. */
 
 	void Call();
 	void InternalReschedule(bool completed, double next = -1);
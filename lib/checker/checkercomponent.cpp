@@ -14,7 +14,12 @@
 #include "base/exception.hpp"
 #include "base/convert.hpp"
 #include "base/statsfunction.hpp"
+#include "base/io-engine.hpp"
+#include <algorithm>
 #include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <iterator>
 
 using namespace icinga;
 
@@ -22,6 +27,13 @@ REGISTER_TYPE(CheckerComponent);
 
 REGISTER_STATSFUNCTION(CheckerComponent, &CheckerComponent::StatsFunc);
 
+/* Above these the node is considered to be overloaded: the load average per CPU
+ * and the average scheduling latency of the local checks in seconds. */
+static const double l_OverloadLoadPerCpu = 2.0;
+static const double l_OverloadLatency = 5.0;
+
+static const char * const l_CheckPriorityNames[] = { "high", "normal", "low" };
+
 void CheckerComponent::StatsFunc(const Dictionary::Ptr& status, const Array::Ptr& perfdata)
 {
 	DictionaryData nodes;
@@ -29,15 +41,43 @@ void CheckerComponent::StatsFunc(const Dictionary::Ptr& status, const Array::Ptr
 	for (const CheckerComponent::Ptr& checker : ConfigType::GetObjectsByType<CheckerComponent>()) {
 		unsigned long idle = checker->GetIdleCheckables();
 		unsigned long pending = checker->GetPendingCheckables();
+		CheckerControllerState state = checker->GetControllerState();
+
+		String perfdata_prefix = "checkercomponent_" + checker->GetName() + "_";
+		DictionaryData priorities;
+
+		for (int priority = CheckPriorityHigh; priority <= CheckPriorityLow; priority++) {
+			String name = l_CheckPriorityNames[priority];
+
+			priorities.emplace_back(name, new Dictionary({
+				{ "latency", state.PriorityLatency[priority] },
+				{ "dispatched", state.PriorityDispatched[priority] },
+				{ "deferred", state.PriorityDeferred[priority] }
+			}));
+
+			perfdata->Add(new PerfdataValue(perfdata_prefix + name + "_latency", state.PriorityLatency[priority]));
+			perfdata->Add(new PerfdataValue(perfdata_prefix + name + "_deferred", Convert::ToDouble(state.PriorityDeferred[priority]), true));
+		}
 
 		nodes.emplace_back(checker->GetName(), new Dictionary({
 			{ "idle", idle },
-			{ "pending", pending }
+			{ "pending", pending },
+			{ "overloaded", state.Overloaded },
+			{ "overdue", state.OverdueCheckables },
+			{ "concurrency_limit", state.ConcurrencyLimit },
+			{ "dispatch_rate", state.DispatchRate },
+			{ "load", state.Load },
+			{ "latency", state.Latency },
+			{ "cpu_bound_pressure", state.CpuBoundPressure },
+			{ "priorities", new Dictionary(std::move(priorities)) }
 		}));
 
-		String perfdata_prefix = "checkercomponent_" + checker->GetName() + "_";
 		perfdata->Add(new PerfdataValue(perfdata_prefix + "idle", Convert::ToDouble(idle)));
 		perfdata->Add(new PerfdataValue(perfdata_prefix + "pending", Convert::ToDouble(pending)));
+		perfdata->Add(new PerfdataValue(perfdata_prefix + "overdue", Convert::ToDouble(state.OverdueCheckables)));
+		perfdata->Add(new PerfdataValue(perfdata_prefix + "concurrency_limit", state.ConcurrencyLimit));
+		perfdata->Add(new PerfdataValue(perfdata_prefix + "dispatch_rate", state.DispatchRate));
+		perfdata->Add(new PerfdataValue(perfdata_prefix + "latency", state.Latency));
 	}
 
 	status->Set("checkercomponent", new Dictionary(std::move(nodes)));
@@ -55,6 +95,22 @@ void CheckerComponent::OnConfigLoaded()
 	Checkable::OnNextCheckChanged.connect([this](const Checkable::Ptr& checkable, const Value&) {
 		NextCheckChangedHandler(checkable);
 	});
+
+	Checkable::OnCheckPriorityChanged.connect([this](const Checkable::Ptr& checkable, const Value&) {
+		NextCheckChangedHandler(checkable);
+	});
+
+	Checkable::OnNewCheckResult.connect([this](const Checkable::Ptr&, const CheckResult::Ptr& cr, const MessageOrigin::Ptr&) {
+		CheckResultHandler(cr);
+	});
+}
+
+void CheckerComponent::ValidateRampWindow(const Lazy<double>& lvalue, const ValidationUtils& utils)
+{
+	ObjectImpl<CheckerComponent>::ValidateRampWindow(lvalue, utils);
+
+	if (lvalue() < 0)
+		BOOST_THROW_EXCEPTION(ValidationError(this, { "ramp_window" }, "Ramp window must not be negative."));
 }
 
 void CheckerComponent::Start(bool runtimeCreated)
@@ -64,6 +120,8 @@ void CheckerComponent::Start(bool runtimeCreated)
 	Log(LogInformation, "CheckerComponent")
 		<< "'" << GetName() << "' started.";
 
+	/* Initialize the concurrency limit before the first check is dispatched. */
+	ControllerTimerHandler();
 
 	m_Thread = std::thread([this]() { CheckThreadProc(); });
 
@@ -71,6 +129,11 @@ void CheckerComponent::Start(bool runtimeCreated)
 	m_ResultTimer->SetInterval(5);
 	m_ResultTimer->OnTimerExpired.connect([this](const Timer * const&) { ResultTimerHandler(); });
 	m_ResultTimer->Start();
+
+	m_ControllerTimer = new Timer();
+	m_ControllerTimer->SetInterval(1);
+	m_ControllerTimer->OnTimerExpired.connect([this](const Timer * const&) { ControllerTimerHandler(); });
+	m_ControllerTimer->Start();
 }
 
 void CheckerComponent::Stop(bool runtimeRemoved)
@@ -82,6 +145,7 @@ void CheckerComponent::Stop(bool runtimeRemoved)
 	}
 
 	m_ResultTimer->Stop();
+	m_ControllerTimer->Stop();
 	m_Thread.join();
 
 	Log(LogInformation, "CheckerComponent")
@@ -107,19 +171,37 @@ void CheckerComponent::CheckThreadProc()
 		if (m_Stopped)
 			break;
 
-		auto it = idx.begin();
-		CheckableScheduleInfo csi = *it;
+		CheckableScheduleInfo csi = *idx.begin();
+
+		double now = Utility::GetTime();
 
-		double wait = csi.NextCheck - Utility::GetTime();
+		/* While overloaded, serve the overdue checkables of the highest priority class first. */
+		if (m_Overloaded) {
+			typedef boost::multi_index::nth_index<CheckableSet, 2>::type CheckPriorityView;
+			CheckPriorityView& pidx = boost::get<2>(m_IdleCheckables);
+
+			for (int priority = CheckPriorityHigh; priority <= CheckPriorityLow; priority++) {
+				auto it = pidx.lower_bound(boost::make_tuple(static_cast<CheckPriority>(priority)));
+
+				if (it != pidx.end() && it->Priority == priority && it->NextCheck <= now) {
+					csi = *it;
+					break;
+				}
+			}
+		}
+
+		double wait = csi.NextCheck - now;
 
 //#ifdef I2_DEBUG
 //		Log(LogDebug, "CheckerComponent")
 //			<< "Pending checks " << Checkable::GetPendingChecks()
-//			<< " vs. max concurrent checks " << icingaApp->GetMaxConcurrentChecks() << ".";
+//			<< " vs. concurrency limit " << m_ConcurrencyLimit << ".";
 //#endif /* I2_DEBUG */
 
-		if (Checkable::GetPendingChecks() >= icingaApp->GetMaxConcurrentChecks())
+		if (Checkable::GetPendingChecks() >= m_ConcurrencyLimit)
 			wait = 0.5;
+		else if (wait <= 0)
+			wait = GetDispatchDelay(now);
 
 		if (wait > 0) {
 			/* Wait for the next check. */
@@ -130,7 +212,7 @@ void CheckerComponent::CheckThreadProc()
 
 		Checkable::Ptr checkable = csi.Object;
 
-		m_IdleCheckables.erase(checkable);
+		RemoveIdleCheckable(checkable);
 
 		bool forced = checkable->GetForceNextCheck();
 		bool check = true;
@@ -165,11 +247,19 @@ void CheckerComponent::CheckThreadProc()
 					<< "': not in check period '" << tp->GetName() << "'";
 				check = false;
 			}
+
+			/* Shed load by merging missed runs of low priority checks into their next regular one. */
+			if (check && m_Overloaded && csi.Priority == CheckPriorityLow && now - csi.NextCheck > checkable->GetCheckInterval()) {
+				Log(LogNotice, "CheckerComponent")
+					<< "Deferring check for object '" << checkable->GetName() << "': low priority and overloaded";
+				m_PriorityDeferred[csi.Priority]++;
+				check = false;
+			}
 		}
 
 		/* reschedule the checkable if checks are disabled */
 		if (!check) {
-			m_IdleCheckables.insert(GetCheckableScheduleInfo(checkable));
+			AddIdleCheckable(GetCheckableScheduleInfo(checkable));
 			lock.unlock();
 
 			Log(LogDebug, "CheckerComponent")
@@ -183,6 +273,9 @@ void CheckerComponent::CheckThreadProc()
 		}
 
 
+		m_PriorityLatency[csi.Priority] += (std::max(0.0, now - csi.NextCheck) - m_PriorityLatency[csi.Priority]) * 0.05;
+		m_PriorityDispatched[csi.Priority]++;
+
 		csi = GetCheckableScheduleInfo(checkable);
 
 		Log(LogDebug, "CheckerComponent")
@@ -193,6 +286,9 @@ void CheckerComponent::CheckThreadProc()
 
 		m_PendingCheckables.insert(csi);
 
+		if (m_DispatchRate > 0)
+			m_DispatchTokens--;
+
 		lock.unlock();
 
 		if (forced) {
@@ -253,7 +349,7 @@ void CheckerComponent::ExecuteCheckHelper(const Checkable::Ptr& checkable)
 			m_PendingCheckables.erase(it);
 
 			if (checkable->IsActive())
-				m_IdleCheckables.insert(GetCheckableScheduleInfo(checkable));
+				AddIdleCheckable(GetCheckableScheduleInfo(checkable));
 
 			m_CV.notify_all();
 		}
@@ -271,12 +367,176 @@ void CheckerComponent::ResultTimerHandler()
 		std::unique_lock<std::mutex> lock(m_Mutex);
 
 		msgbuf << "Pending checkables: " << m_PendingCheckables.size() << "; Idle checkables: " << m_IdleCheckables.size() << "; Checks/s: "
-			<< (CIB::GetActiveHostChecksStatistics(60) + CIB::GetActiveServiceChecksStatistics(60)) / 60.0;
+			<< (CIB::GetActiveHostChecksStatistics(60) + CIB::GetActiveServiceChecksStatistics(60)) / 60.0
+			<< "; Concurrency limit: " << m_ConcurrencyLimit;
+
+		if (m_DispatchRate > 0)
+			msgbuf << "; Ramping up " << m_OverdueCheckables << " overdue checkables at " << m_DispatchRate << " checks/s";
 	}
 
 	Log(LogNotice, "CheckerComponent", msgbuf.str());
 }
 
+/**
+ * Sizes the number of concurrent checks from the load of this node and
+ * spreads a backlog of overdue checks over the ramp window.
+ */
+void CheckerComponent::ControllerTimerHandler()
+{
+	double now = Utility::GetTime();
+	double maxChecks = std::max(1, IcingaApplication::GetInstance()->GetMaxConcurrentChecks());
+
+	double load = 0;
+
+#ifndef _WIN32
+	double loadavg;
+
+	if (getloadavg(&loadavg, 1) == 1)
+		load = loadavg / std::max(1u, std::thread::hardware_concurrency());
+#endif /* _WIN32 */
+
+	double cpuBoundPressure = 0;
+
+	/* The CPU-bound slots are only used by the API, don't start the I/O engine just for this. */
+	if (ApiListener::GetInstance()) {
+		auto& ioEngine (IoEngine::Get());
+		double freeSlots = std::max<int_fast32_t>(0, ioEngine.GetFreeCpuBoundSlots());
+
+		cpuBoundPressure = 1.0 - freeSlots / std::max<uint_fast32_t>(1, ioEngine.GetCpuBoundSlots());
+	}
+
+	double latency;
+
+	{
+		std::unique_lock<std::mutex> lock(m_LatencyMutex);
+		latency = m_Latency;
+	}
+
+	bool overloaded = load > l_OverloadLoadPerCpu || latency > l_OverloadLatency || cpuBoundPressure >= 1;
+
+	/* The rate checks were executed at recently, the overdue backlog is dispatched in addition to it. */
+	double checkRate = (CIB::GetActiveHostChecksStatistics(60) + CIB::GetActiveServiceChecksStatistics(60)) / 60.0;
+	double rampWindow = GetRampWindow();
+
+	bool adaptive = GetAdaptiveConcurrency();
+
+	std::unique_lock<std::mutex> lock(m_Mutex);
+
+	if (adaptive)
+		m_ConcurrencyLimit = UpdateConcurrencyLimit(m_ConcurrencyLimit, maxChecks, overloaded);
+	else
+		m_ConcurrencyLimit = maxChecks;
+
+	m_Load = load;
+	m_CpuBoundPressure = cpuBoundPressure;
+
+	UpdateOverdueCheckables(now);
+
+	/* Overload mode reorders and defers checks, so it's part of the adaptive_concurrency opt-in. */
+	m_Overloaded = adaptive && (overloaded || m_OverdueCheckables > m_ConcurrencyLimit);
+
+	/* Only throttle if there are more overdue checks than can run at once. The rate is kept
+	 * until the backlog is gone, so it's dispatched within the ramp window. */
+	if (adaptive && rampWindow > 0 && m_OverdueCheckables > m_ConcurrencyLimit)
+		m_DispatchRate = std::max(m_DispatchRate, checkRate + m_OverdueCheckables / rampWindow);
+	else
+		m_DispatchRate = 0;
+
+	m_CV.notify_all();
+}
+
+/**
+ * Computes the next concurrency limit. It starts low, is lowered
+ * multiplicatively while the node is overloaded and raised additively
+ * otherwise. It stays between 1/16 of the maximum and the maximum.
+ *
+ * @param limit The current limit, 0 before the first check was dispatched.
+ * @param maxChecks The maximum number of concurrent checks.
+ * @param overloaded Whether the node is overloaded.
+ * @returns The new limit.
+ */
+double CheckerComponent::UpdateConcurrencyLimit(double limit, double maxChecks, bool overloaded)
+{
+	double minChecks = std::max(1.0, std::ceil(maxChecks / 16));
+
+	if (limit <= 0)
+		limit = minChecks; /* slow start */
+	else if (overloaded)
+		limit *= 0.75;
+	else
+		limit += std::max(1.0, maxChecks / 50);
+
+	return std::min(maxChecks, std::max(minChecks, limit));
+}
+
+/**
+ * Counts the idle checkables which became due (or not anymore, if the clock
+ * went backwards) since the last call, so only those are iterated.
+ */
+void CheckerComponent::UpdateOverdueCheckables(double now)
+{
+	typedef boost::multi_index::nth_index<CheckableSet, 1>::type CheckTimeView;
+	CheckTimeView& idx = boost::get<1>(m_IdleCheckables);
+
+	if (now >= m_OverdueUntil)
+		m_OverdueCheckables += std::distance(idx.upper_bound(m_OverdueUntil), idx.upper_bound(now));
+	else
+		m_OverdueCheckables -= std::distance(idx.upper_bound(now), idx.upper_bound(m_OverdueUntil));
+
+	m_OverdueUntil = now;
+}
+
+void CheckerComponent::AddIdleCheckable(const CheckableScheduleInfo& csi)
+{
+	if (m_IdleCheckables.insert(csi).second && csi.NextCheck <= m_OverdueUntil)
+		m_OverdueCheckables++;
+}
+
+void CheckerComponent::RemoveIdleCheckable(const Checkable::Ptr& checkable)
+{
+	auto it (m_IdleCheckables.find(checkable));
+
+	if (it == m_IdleCheckables.end())
+		return;
+
+	if (it->NextCheck <= m_OverdueUntil)
+		m_OverdueCheckables--;
+
+	m_IdleCheckables.erase(it);
+}
+
+/**
+ * Refills the token bucket for dispatching checks.
+ *
+ * @returns How long to wait until the next check may be dispatched.
+ */
+double CheckerComponent::GetDispatchDelay(double now)
+{
+	if (m_DispatchRate <= 0)
+		return 0;
+
+	m_DispatchTokens = std::min(std::max(1.0, m_DispatchRate), m_DispatchTokens + (now - m_DispatchRefill) * m_DispatchRate);
+	m_DispatchRefill = now;
+
+	if (m_DispatchTokens >= 1)
+		return 0;
+
+	return (1 - m_DispatchTokens) / m_DispatchRate;
+}
+
+void CheckerComponent::CheckResultHandler(const CheckResult::Ptr& cr)
+{
+	/* Only checks executed by this node tell something about its load. */
+	if (!cr->GetActive() || cr->GetCheckSource() != IcingaApplication::GetInstance()->GetNodeName())
+		return;
+
+	double latency = cr->CalculateLatency();
+
+	std::unique_lock<std::mutex> lock(m_LatencyMutex);
+
+	m_Latency += (latency - m_Latency) * 0.05;
+}
+
 void CheckerComponent::ObjectHandler(const ConfigObject::Ptr& object)
 {
 	Checkable::Ptr checkable = dynamic_pointer_cast<Checkable>(object);
@@ -294,9 +554,9 @@ void CheckerComponent::ObjectHandler(const ConfigObject::Ptr& object)
 			if (m_PendingCheckables.find(checkable) != m_PendingCheckables.end())
 				return;
 
-			m_IdleCheckables.insert(GetCheckableScheduleInfo(checkable));
+			AddIdleCheckable(GetCheckableScheduleInfo(checkable));
 		} else {
-			m_IdleCheckables.erase(checkable);
+			RemoveIdleCheckable(checkable);
 			m_PendingCheckables.erase(checkable);
 		}
 
@@ -309,6 +569,7 @@ CheckableScheduleInfo CheckerComponent::GetCheckableScheduleInfo(const Checkable
 	CheckableScheduleInfo csi;
 	csi.Object = checkable;
 	csi.NextCheck = checkable->GetNextCheck();
+	csi.Priority = checkable->GetCheckPriorityClass();
 	return csi;
 }
 
@@ -317,18 +578,11 @@ void CheckerComponent::NextCheckChangedHandler(const Checkable::Ptr& checkable)
 	std::unique_lock<std::mutex> lock(m_Mutex);
 
 	/* remove and re-insert the object from the set in order to force an index update */
-	typedef boost::multi_index::nth_index<CheckableSet, 0>::type CheckableView;
-	CheckableView& idx = boost::get<0>(m_IdleCheckables);
-
-	auto it = idx.find(checkable);
-
-	if (it == idx.end())
+	if (m_IdleCheckables.find(checkable) == m_IdleCheckables.end())
 		return;
 
-	idx.erase(checkable);
-
-	CheckableScheduleInfo csi = GetCheckableScheduleInfo(checkable);
-	idx.insert(csi);
+	RemoveIdleCheckable(checkable);
+	AddIdleCheckable(GetCheckableScheduleInfo(checkable));
 
 	m_CV.notify_all();
 }
@@ -346,3 +600,28 @@ unsigned long CheckerComponent::GetPendingCheckables()
 
 	return m_PendingCheckables.size();
 }
+
+CheckerControllerState CheckerComponent::GetControllerState()
+{
+	CheckerControllerState state;
+
+	{
+		std::unique_lock<std::mutex> lock(m_LatencyMutex);
+		state.Latency = m_Latency;
+	}
+
+	std::unique_lock<std::mutex> lock(m_Mutex);
+
+	state.Overloaded = m_Overloaded;
+	state.ConcurrencyLimit = m_ConcurrencyLimit;
+	state.Load = m_Load;
+	state.CpuBoundPressure = m_CpuBoundPressure;
+	state.OverdueCheckables = m_OverdueCheckables;
+	state.DispatchRate = m_DispatchRate;
+
+	std::copy(std::begin(m_PriorityLatency), std::end(m_PriorityLatency), state.PriorityLatency);
+	std::copy(std::begin(m_PriorityDispatched), std::end(m_PriorityDispatched), state.PriorityDispatched);
+	std::copy(std::begin(m_PriorityDeferred), std::end(m_PriorityDeferred), state.PriorityDeferred);
+
+	return state;
+}
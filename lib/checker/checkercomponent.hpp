@@ -11,6 +11,7 @@
 #include <boost/multi_index_container.hpp>
 #include <boost/multi_index/ordered_index.hpp>
 #include <boost/multi_index/key_extractors.hpp>
+#include <boost/multi_index/composite_key.hpp>
 #include <condition_variable>
 #include <mutex>
 #include <thread>
@@ -25,6 +26,7 @@ struct CheckableScheduleInfo
 {
 	Checkable::Ptr Object;
 	double NextCheck;
+	CheckPriority Priority;
 };
 
 /**
@@ -37,12 +39,33 @@ struct CheckableNextCheckExtractor
 	/**
 	 * @threadsafety Always.
 	 */
-	double operator()(const CheckableScheduleInfo& csi)
+	double operator()(const CheckableScheduleInfo& csi) const
 	{
 		return csi.NextCheck;
 	}
 };
 
+/**
+ * Snapshot of the adaptive concurrency controller.
+ *
+ * @ingroup checker
+ */
+struct CheckerControllerState
+{
+	bool Overloaded;
+	double ConcurrencyLimit;
+	double Load;
+	double Latency;
+	double CpuBoundPressure;
+	unsigned long OverdueCheckables;
+	double DispatchRate;
+
+	/* Indexed by CheckPriority */
+	double PriorityLatency[CheckPriorityLow + 1];
+	uint_fast64_t PriorityDispatched[CheckPriorityLow + 1];
+	uint_fast64_t PriorityDeferred[CheckPriorityLow + 1];
+};
+
 /**
  * @ingroup checker
  */
@@ -56,7 +79,14 @@ public:
 		CheckableScheduleInfo,
 		boost::multi_index::indexed_by<
 			boost::multi_index::ordered_unique<boost::multi_index::member<CheckableScheduleInfo, Checkable::Ptr, &CheckableScheduleInfo::Object> >,
-			boost::multi_index::ordered_non_unique<CheckableNextCheckExtractor>
+			boost::multi_index::ordered_non_unique<CheckableNextCheckExtractor>,
+			boost::multi_index::ordered_non_unique<
+				boost::multi_index::composite_key<
+					CheckableScheduleInfo,
+					boost::multi_index::member<CheckableScheduleInfo, CheckPriority, &CheckableScheduleInfo::Priority>,
+					CheckableNextCheckExtractor
+				>
+			>
 		>
 	> CheckableSet;
 
@@ -67,6 +97,11 @@ public:
 	static void StatsFunc(const Dictionary::Ptr& status, const Array::Ptr& perfdata);
 	unsigned long GetIdleCheckables();
 	unsigned long GetPendingCheckables();
+	CheckerControllerState GetControllerState();
+
+	static double UpdateConcurrencyLimit(double limit, double maxChecks, bool overloaded);
+
+	void ValidateRampWindow(const Lazy<double>& lvalue, const ValidationUtils& utils) override;
 
 private:
 	std::mutex m_Mutex;
@@ -78,12 +113,43 @@ private:
 	CheckableSet m_PendingCheckables;
 
 	Timer::Ptr m_ResultTimer;
+	Timer::Ptr m_ControllerTimer;
+
+	/* Adaptive concurrency controller, protected by m_Mutex. */
+	double m_ConcurrencyLimit{0};
+	double m_Load{0};
+	double m_CpuBoundPressure{0};
+	bool m_Overloaded{false};
+
+	/* Number of idle checkables due at m_OverdueUntil, kept up to date on changes of m_IdleCheckables. */
+	unsigned long m_OverdueCheckables{0};
+	double m_OverdueUntil{0};
+
+	/* Scheduling latency, dispatched and deferred checks per priority class. */
+	double m_PriorityLatency[CheckPriorityLow + 1] = {};
+	uint_fast64_t m_PriorityDispatched[CheckPriorityLow + 1] = {};
+	uint_fast64_t m_PriorityDeferred[CheckPriorityLow + 1] = {};
+
+	std::mutex m_LatencyMutex;
+	double m_Latency{0};
+
+	/* Token bucket which spreads a backlog of overdue checks over the ramp window. */
+	double m_DispatchRate{0};
+	double m_DispatchTokens{0};
+	double m_DispatchRefill{0};
 
 	void CheckThreadProc();
 	void ResultTimerHandler();
+	void ControllerTimerHandler();
+	void CheckResultHandler(const CheckResult::Ptr& cr);
+	double GetDispatchDelay(double now);
 
 	void ExecuteCheckHelper(const Checkable::Ptr& checkable);
 
+	void AddIdleCheckable(const CheckableScheduleInfo& csi);
+	void RemoveIdleCheckable(const Checkable::Ptr& checkable);
+	void UpdateOverdueCheckables(double now);
+
 	void AdjustCheckTimer();
 
 	void ObjectHandler(const ConfigObject::Ptr& object);
@@ -0,0 +1,383 @@
+/* Icinga 2 | (c) 2012 Icinga GmbH | GPLv2+ */
+
+#include "cli/configcache.hpp"
+#include "base/application.hpp"
+#include "base/array.hpp"
+#include "base/configuration.hpp"
+#include "base/exception.hpp"
+#include "base/logger.hpp"
+#include "base/objectlock.hpp"
+#include "base/scriptglobal.hpp"
+#include "base/tlsutility.hpp"
+#include "base/utility.hpp"
+#include <algorithm>
+#include <fstream>
+#include <iterator>
+#include <set>
+
+using namespace icinga;
+
+/* Number of validated configurations to remember, e.g. the active config and a few package stages. */
+static const size_t l_MaxEntries = 8;
+
+String ConfigCache::GetCachePath()
+{
+	return Configuration::CacheDir + "/config-cache.json";
+}
+
+/**
+ * @returns The path prefix for the copies of the objects and vars files written by a cached validation.
+ */
+String ConfigCache::GetOutputPath(const String& key)
+{
+	return Configuration::CacheDir + "/config-cache/" + key;
+}
+
+/**
+ * @returns The directories whose content makes up the configuration.
+ */
+std::vector<String> ConfigCache::GetInputDirs()
+{
+	String zonesVarDir = Configuration::DataDir + "/api/zones";
+
+	Namespace::Ptr systemNS = ScriptGlobal::Get("System");
+
+	if (systemNS && systemNS->Contains("ZonesStageVarDir"))
+		zonesVarDir = systemNS->Get("ZonesStageVarDir");
+
+	return {
+		Configuration::ConfigDir,
+		Configuration::ZonesDir,
+		Configuration::DataDir + "/api/packages",
+		zonesVarDir
+	};
+}
+
+String ConfigCache::HashFile(const String& path)
+{
+	std::ifstream fp(path.CStr(), std::ifstream::in | std::ifstream::binary);
+
+	if (!fp)
+		return "unreadable";
+
+	String content { std::string(std::istreambuf_iterator<char>(fp), std::istreambuf_iterator<char>()) };
+
+	return SHA256(content);
+}
+
+/**
+ * Hashes the names of all entries below a directory, which catches files and
+ * subdirectories being added to it (e.g. for an include_recursive).
+ */
+String ConfigCache::HashDirectory(const String& path)
+{
+	std::vector<String> entries;
+
+	Utility::GlobRecursive(path, "*", [&entries](const String& entry) { entries.push_back(entry); }, GlobFile | GlobDirectory);
+
+	std::sort(entries.begin(), entries.end());
+
+	String listing;
+
+	for (const String& entry : entries)
+		listing += entry + "\n";
+
+	return SHA256(listing);
+}
+
+bool ConfigCache::IsInputFile(const String& path, const std::vector<String>& inputDirs)
+{
+	for (const String& dir : inputDirs) {
+		if (path.GetLength() > dir.GetLength() && path.SubStr(0, dir.GetLength() + 1) == dir + "/")
+			return true;
+	}
+
+	return false;
+}
+
+/**
+ * Computes the cache key for a validation of the specified config files.
+ *
+ * The key covers the content of all config directories, the command line
+ * (including its --define overrides) and the application version.
+ *
+ * @param configs The config files passed to the daemon.
+ * @returns The cache key.
+ */
+String ConfigCache::ComputeKey(const std::vector<std::string>& configs)
+{
+	String fingerprint = "version=" + Application::GetAppVersion() + "\n";
+
+	for (int i = 1; i < Application::GetArgC(); i++)
+		fingerprint += "arg=" + String(Application::GetArgV()[i]) + "\n";
+
+	for (const String& config : configs)
+		fingerprint += "config=" + config + "\n";
+
+	fingerprint += "objects=" + Configuration::ObjectsPath + "\n";
+	fingerprint += "vars=" + Configuration::VarsPath + "\n";
+	fingerprint += "includeconf=" + Configuration::IncludeConfDir + "\n";
+
+	for (const String& dir : GetInputDirs()) {
+		std::vector<String> files;
+
+		if (Utility::PathExists(dir))
+			Utility::GlobRecursive(dir, "*", [&files](const String& file) { files.push_back(file); }, GlobFile);
+
+		std::sort(files.begin(), files.end());
+
+		fingerprint += "dir=" + dir + "\n";
+
+		for (const String& file : files)
+			fingerprint += file + "=" + HashFile(file) + "\n";
+	}
+
+	return SHA256(fingerprint);
+}
+
+Dictionary::Ptr ConfigCache::LoadCache()
+{
+	String path = GetCachePath();
+
+	if (Utility::PathExists(path)) {
+		try {
+			Dictionary::Ptr cache = Utility::LoadJsonFile(path);
+
+			if (cache && cache->Get("entries").IsObjectType<Dictionary>())
+				return cache;
+		} catch (const std::exception& ex) {
+			Log(LogWarning, "ConfigCache")
+				<< "Ignoring invalid config cache '" << path << "': " << DiagnosticInformation(ex, false);
+		}
+	}
+
+	return new Dictionary({
+		{ "entries", new Dictionary() },
+		{ "lookups", 0 },
+		{ "hits", 0 },
+		{ "saved", 0 }
+	});
+}
+
+void ConfigCache::SaveCache(const Dictionary::Ptr& cache)
+{
+	try {
+		Utility::SaveJsonFile(GetCachePath(), 0600, cache);
+	} catch (const std::exception& ex) {
+		Log(LogWarning, "ConfigCache")
+			<< "Could not save config cache '" << GetCachePath() << "': " << DiagnosticInformation(ex, false);
+	}
+}
+
+/**
+ * Checks whether a configuration was already validated successfully.
+ *
+ * Besides the key, the config files compiled from outside of the config
+ * directories (e.g. the ITL) must still be unchanged for a hit. On a hit the
+ * objects and vars files of the validation are restored and its warnings are
+ * logged again.
+ *
+ * @param key The cache key as returned by ComputeKey().
+ * @returns Whether the validation can be skipped.
+ */
+bool ConfigCache::Lookup(const String& key)
+{
+	double start = Utility::GetTime();
+
+	Dictionary::Ptr cache = LoadCache();
+	Dictionary::Ptr entries = cache->Get("entries");
+	Dictionary::Ptr entry = entries->Get(key);
+
+	String outputPath = GetOutputPath(key);
+	bool hit = entry && Utility::PathExists(outputPath + ".debug") && Utility::PathExists(outputPath + ".vars");
+
+	if (hit) {
+		Dictionary::Ptr files = entry->Get("files");
+		Dictionary::Ptr dirs = entry->Get("dirs");
+
+		if (files) {
+			ObjectLock olock(files);
+
+			for (const Dictionary::Pair& kv : files) {
+				if (HashFile(kv.first) != kv.second) {
+					hit = false;
+					break;
+				}
+			}
+		}
+
+		if (hit && dirs) {
+			ObjectLock olock(dirs);
+
+			for (const Dictionary::Pair& kv : dirs) {
+				if (HashDirectory(kv.first) != kv.second) {
+					hit = false;
+					break;
+				}
+			}
+		}
+	}
+
+	/* Other commands (e.g. 'object list') read the files written by the validation. */
+	if (hit) {
+		try {
+			RestoreFile(outputPath + ".debug", Configuration::ObjectsPath);
+			RestoreFile(outputPath + ".vars", Configuration::VarsPath);
+		} catch (const std::exception& ex) {
+			Log(LogWarning, "ConfigCache")
+				<< "Could not restore the output of the cached validation: " << DiagnosticInformation(ex, false);
+			hit = false;
+		}
+	}
+
+	double lookups = cache->Get("lookups");
+	double hits = cache->Get("hits");
+	double saved = cache->Get("saved");
+
+	lookups++;
+
+	if (hit) {
+		double now = Utility::GetTime();
+
+		hits++;
+		saved += std::max(0.0, static_cast<double>(entry->Get("duration")) - (now - start));
+
+		entry->Set("used", now);
+	}
+
+	cache->Set("lookups", lookups);
+	cache->Set("hits", hits);
+	cache->Set("saved", saved);
+
+	SaveCache(cache);
+
+	if (hit) {
+		Array::Ptr warnings = entry->Get("warnings");
+
+		if (warnings) {
+			ObjectLock olock(warnings);
+
+			for (const Dictionary::Ptr& warning : warnings) {
+				LogEntry logEntry;
+				logEntry.Timestamp = Utility::GetTime();
+				logEntry.Severity = static_cast<LogSeverity>(static_cast<int>(warning->Get("severity")));
+				logEntry.Facility = warning->Get("facility");
+				logEntry.Message = warning->Get("message");
+
+				Log::Write(logEntry);
+			}
+		}
+
+		Log(LogInformation, "cli")
+			<< "Configuration is unchanged since its successful validation at "
+			<< Utility::FormatDateTime("%Y-%m-%d %H:%M:%S %z", entry->Get("validated"))
+			<< ", skipping validation (config cache hit ratio: " << hits << "/" << lookups
+			<< ", saved " << Utility::FormatDuration(saved) << " in total).";
+	} else {
+		Log(LogNotice, "cli")
+			<< "No cached validation result for this configuration (config cache hit ratio: "
+			<< hits << "/" << lookups << ").";
+	}
+
+	return hit;
+}
+
+void ConfigCache::RestoreFile(const String& source, const String& target)
+{
+	String tempTarget = target + ".tmp";
+
+	Utility::CopyFile(source, tempTarget);
+	Utility::RenameFile(tempTarget, target);
+}
+
+/**
+ * Remembers a successful validation together with the objects and vars
+ * files it wrote and the warnings it logged.
+ *
+ * @param key The cache key as returned by ComputeKey() before the validation.
+ * @param duration How long the validation took.
+ * @param warnings The warnings logged by the validation.
+ * @param compiledPaths The config files compiled by the validation.
+ */
+void ConfigCache::Store(const String& key, double duration, const std::vector<LogEntry>& warnings, const std::set<String>& compiledPaths)
+{
+	String outputPath = GetOutputPath(key);
+
+	try {
+		Utility::MkDirP(Utility::DirName(outputPath), 0750);
+		Utility::CopyFile(Configuration::ObjectsPath, outputPath + ".debug");
+		Utility::CopyFile(Configuration::VarsPath, outputPath + ".vars");
+	} catch (const std::exception& ex) {
+		Log(LogWarning, "ConfigCache")
+			<< "Not caching the validation, could not copy its output: " << DiagnosticInformation(ex, false);
+		return;
+	}
+
+	ArrayData warningsData;
+
+	for (const LogEntry& warning : warnings) {
+		warningsData.emplace_back(new Dictionary({
+			{ "severity", warning.Severity },
+			{ "facility", warning.Facility },
+			{ "message", warning.Message }
+		}));
+	}
+
+	std::vector<String> inputDirs = GetInputDirs();
+	Dictionary::Ptr files = new Dictionary();
+	Dictionary::Ptr dirs = new Dictionary();
+
+	for (const String& path : compiledPaths) {
+		if (IsInputFile(path, inputDirs))
+			continue;
+
+		files->Set(path, HashFile(path));
+
+		String dir = Utility::DirName(path);
+
+		if (!dirs->Contains(dir))
+			dirs->Set(dir, HashDirectory(dir));
+	}
+
+	double now = Utility::GetTime();
+
+	Dictionary::Ptr cache = LoadCache();
+	Dictionary::Ptr entries = cache->Get("entries");
+
+	entries->Set(key, new Dictionary({
+		{ "files", files },
+		{ "dirs", dirs },
+		{ "duration", duration },
+		{ "warnings", new Array(std::move(warningsData)) },
+		{ "validated", now },
+		{ "used", now }
+	}));
+
+	while (entries->GetLength() > l_MaxEntries) {
+		String oldestKey;
+		double oldest = now;
+
+		{
+			ObjectLock olock(entries);
+
+			for (const Dictionary::Pair& kv : entries) {
+				Dictionary::Ptr candidate = kv.second;
+				double used = candidate ? static_cast<double>(candidate->Get("used")) : 0;
+
+				if (oldestKey.IsEmpty() || used < oldest) {
+					oldestKey = kv.first;
+					oldest = used;
+				}
+			}
+		}
+
+		entries->Remove(oldestKey);
+
+		String oldestPath = GetOutputPath(oldestKey);
+
+		Utility::Remove(oldestPath + ".debug");
+		Utility::Remove(oldestPath + ".vars");
+	}
+
+	SaveCache(cache);
+}
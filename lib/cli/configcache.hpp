@@ -0,0 +1,50 @@
+/* Icinga 2 | (c) 2012 Icinga GmbH | GPLv2+ */
+
+#ifndef CONFIGCACHE_H
+#define CONFIGCACHE_H
+
+#include "cli/i2-cli.hpp"
+#include "base/dictionary.hpp"
+#include "base/logger.hpp"
+#include "base/string.hpp"
+#include <set>
+#include <vector>
+
+namespace icinga
+{
+
+/**
+ * Remembers successful config validations keyed by a content hash of all
+ * config inputs, so repeated validations of unchanged config (e.g. by safe
+ * reload scripts) can be skipped with `daemon --validate --config-cache`.
+ *
+ * @ingroup cli
+ */
+class ConfigCache
+{
+public:
+	static String ComputeKey(const std::vector<std::string>& configs);
+
+	static bool Lookup(const String& key);
+	static void Store(const String& key, double duration, const std::vector<LogEntry>& warnings, const std::set<String>& compiledPaths);
+
+	static std::vector<String> GetInputDirs();
+	static String HashFile(const String& path);
+	static String HashDirectory(const String& path);
+	static bool IsInputFile(const String& path, const std::vector<String>& inputDirs);
+
+private:
+	ConfigCache();
+
+	static String GetCachePath();
+	static String GetOutputPath(const String& key);
+
+	static void RestoreFile(const String& source, const String& target);
+
+	static Dictionary::Ptr LoadCache();
+	static void SaveCache(const Dictionary::Ptr& cache);
+};
+
+}
+
+#endif /* CONFIGCACHE_H */
@@ -0,0 +1,320 @@
+/* Icinga 2 | (c) 2012 Icinga GmbH | GPLv2+ */
+
+#include "cli/configmanifest.hpp"
+#include "cli/configcache.hpp"
+#include "config/configitem.hpp"
+#include "base/configtype.hpp"
+#include "base/configuration.hpp"
+#include "base/exception.hpp"
+#include "base/json.hpp"
+#include "base/logger.hpp"
+#include "base/objectlock.hpp"
+#include "base/serializer.hpp"
+#include "base/tlsutility.hpp"
+#include "base/utility.hpp"
+#include <ostream>
+
+using namespace icinga;
+
+static void PrintObject(std::ostream& fp, const String& action, const String& type, const String& name, const String& path)
+{
+	fp << "  " << action << " " << type << " '" << name << "'";
+
+	if (!path.IsEmpty())
+		fp << " (" << path << ")";
+
+	fp << "\n";
+}
+
+String ConfigManifest::GetRunningPath()
+{
+	return Configuration::CacheDir + "/config-manifest.json";
+}
+
+/**
+ * Computes the manifest of the loaded (committed) configuration.
+ *
+ * @param key The config cache key computed before loading the configuration.
+ * @param compiledPaths The config files compiled while loading the configuration.
+ * @returns The manifest.
+ */
+Dictionary::Ptr ConfigManifest::Compute(const String& key, const std::set<String>& compiledPaths)
+{
+	std::vector<String> inputDirs = ConfigCache::GetInputDirs();
+	Dictionary::Ptr files = new Dictionary();
+	Dictionary::Ptr dirs = new Dictionary();
+
+	for (const String& path : compiledPaths) {
+		files->Set(path, ConfigCache::HashFile(path));
+
+		/* Files added next to the ones outside of the config directories aren't covered by the key. */
+		if (!ConfigCache::IsInputFile(path, inputDirs)) {
+			String dir = Utility::DirName(path);
+
+			if (!dirs->Contains(dir))
+				dirs->Set(dir, ConfigCache::HashDirectory(dir));
+		}
+	}
+
+	Dictionary::Ptr objects = new Dictionary();
+
+	for (const Type::Ptr& type : Type::GetAllTypes()) {
+		auto *ctype = dynamic_cast<ConfigType *>(type.get());
+
+		if (!ctype)
+			continue;
+
+		Dictionary::Ptr typeObjects = new Dictionary();
+
+		for (const ConfigObject::Ptr& object : ctype->GetObjects()) {
+			Dictionary::Ptr attrs = Serialize(object, FAConfig);
+
+			/* Moving an object within its file doesn't change it. */
+			attrs->Remove("source_location");
+
+			ConfigItem::Ptr item = ConfigItem::GetByTypeAndName(type, object->GetName());
+
+			typeObjects->Set(object->GetName(), new Array({
+				SHA256(JsonEncode(attrs)),
+				item ? item->GetDebugInfo().Path : ""
+			}));
+		}
+
+		if (typeObjects->GetLength() > 0)
+			objects->Set(type->GetName(), typeObjects);
+	}
+
+	return new Dictionary({
+		{ "key", key },
+		{ "files", files },
+		{ "dirs", dirs },
+		{ "objects", objects }
+	});
+}
+
+/**
+ * @returns The manifest of the running instance's configuration or nullptr.
+ */
+Dictionary::Ptr ConfigManifest::LoadRunning()
+{
+	String path = GetRunningPath();
+
+	if (!Utility::PathExists(path))
+		return nullptr;
+
+	try {
+		Dictionary::Ptr manifest = Utility::LoadJsonFile(path);
+
+		if (manifest && manifest->Get("files").IsObjectType<Dictionary>() && manifest->Get("objects").IsObjectType<Dictionary>())
+			return manifest;
+	} catch (const std::exception& ex) {
+		Log(LogWarning, "ConfigManifest")
+			<< "Ignoring invalid config manifest '" << path << "': " << DiagnosticInformation(ex, false);
+	}
+
+	return nullptr;
+}
+
+void ConfigManifest::SaveRunning(const Dictionary::Ptr& manifest)
+{
+	try {
+		Utility::SaveJsonFile(GetRunningPath(), 0600, manifest);
+	} catch (const std::exception& ex) {
+		Log(LogWarning, "ConfigManifest")
+			<< "Could not save config manifest '" << GetRunningPath() << "': " << DiagnosticInformation(ex, false);
+	}
+}
+
+/**
+ * Checks whether the running instance was started with the configuration
+ * which is on disk now.
+ *
+ * @param key The config cache key of the configuration on disk.
+ * @returns Whether the configuration is unchanged.
+ */
+bool ConfigManifest::IsRunning(const String& key)
+{
+	Dictionary::Ptr manifest = LoadRunning();
+
+	if (!manifest || manifest->Get("key") != key)
+		return false;
+
+	for (auto& kind : { "files", "dirs" }) {
+		Dictionary::Ptr hashes = manifest->Get(kind);
+
+		if (!hashes)
+			continue;
+
+		ObjectLock olock(hashes);
+
+		for (const Dictionary::Pair& kv : hashes) {
+			String hash = kind == String("files") ? ConfigCache::HashFile(kv.first) : ConfigCache::HashDirectory(kv.first);
+
+			if (hash != kv.second)
+				return false;
+		}
+	}
+
+	return true;
+}
+
+/**
+ * Compares two manifests.
+ *
+ * @param running The running instance's manifest (may be nullptr).
+ * @param planned The manifest of the configuration on disk.
+ * @returns The added, modified and removed files as well as the objects
+ *          to create, modify and delete (each as [ type, name, path ]).
+ */
+Dictionary::Ptr ConfigManifest::Diff(const Dictionary::Ptr& running, const Dictionary::Ptr& planned)
+{
+	Dictionary::Ptr runningFiles = new Dictionary();
+	Dictionary::Ptr runningObjects = new Dictionary();
+
+	if (running) {
+		runningFiles = running->Get("files");
+		runningObjects = running->Get("objects");
+	}
+
+	Dictionary::Ptr plannedFiles = planned->Get("files");
+	Dictionary::Ptr plannedObjects = planned->Get("objects");
+
+	ArrayData addedFiles, modifiedFiles, removedFiles;
+
+	{
+		ObjectLock olock(plannedFiles);
+
+		for (const Dictionary::Pair& kv : plannedFiles) {
+			Value hash;
+
+			if (!runningFiles->Get(kv.first, &hash))
+				addedFiles.emplace_back(kv.first);
+			else if (hash != kv.second)
+				modifiedFiles.emplace_back(kv.first);
+		}
+	}
+
+	{
+		ObjectLock olock(runningFiles);
+
+		for (const Dictionary::Pair& kv : runningFiles) {
+			if (!plannedFiles->Contains(kv.first))
+				removedFiles.emplace_back(kv.first);
+		}
+	}
+
+	ArrayData created, modified, deleted;
+	double unchanged = 0;
+
+	{
+		ObjectLock olock(plannedObjects);
+
+		for (const Dictionary::Pair& typeKv : plannedObjects) {
+			Dictionary::Ptr objects = typeKv.second;
+			Dictionary::Ptr previous = runningObjects->Get(typeKv.first);
+
+			ObjectLock ilock(objects);
+
+			for (const Dictionary::Pair& kv : objects) {
+				Array::Ptr entry = kv.second;
+				Array::Ptr prevEntry = previous ? previous->Get(kv.first) : Empty;
+
+				if (!prevEntry)
+					created.emplace_back(new Array({ typeKv.first, kv.first, entry->Get(1) }));
+				else if (prevEntry->Get(0) != entry->Get(0))
+					modified.emplace_back(new Array({ typeKv.first, kv.first, entry->Get(1) }));
+				else
+					unchanged++;
+			}
+		}
+	}
+
+	{
+		ObjectLock olock(runningObjects);
+
+		for (const Dictionary::Pair& typeKv : runningObjects) {
+			Dictionary::Ptr objects = typeKv.second;
+			Dictionary::Ptr current = plannedObjects->Get(typeKv.first);
+
+			ObjectLock ilock(objects);
+
+			for (const Dictionary::Pair& kv : objects) {
+				Array::Ptr entry = kv.second;
+
+				if (!current || !current->Contains(kv.first))
+					deleted.emplace_back(new Array({ typeKv.first, kv.first, entry->Get(1) }));
+			}
+		}
+	}
+
+	return new Dictionary({
+		{ "files", new Dictionary({
+			{ "added", new Array(std::move(addedFiles)) },
+			{ "modified", new Array(std::move(modifiedFiles)) },
+			{ "removed", new Array(std::move(removedFiles)) }
+		}) },
+		{ "objects", new Dictionary({
+			{ "create", new Array(std::move(created)) },
+			{ "modify", new Array(std::move(modified)) },
+			{ "delete", new Array(std::move(deleted)) },
+			{ "unchanged", unchanged }
+		}) }
+	});
+}
+
+/**
+ * Prints which files changed and which objects a reload would create,
+ * modify and delete.
+ *
+ * @param fp The output stream.
+ * @param running The running instance's manifest (may be nullptr).
+ * @param planned The manifest of the configuration on disk.
+ */
+void ConfigManifest::PrintPlan(std::ostream& fp, const Dictionary::Ptr& running, const Dictionary::Ptr& planned)
+{
+	if (!running) {
+		fp << "No manifest of the running configuration found in '" << GetRunningPath()
+			<< "', all objects are reported as new.\n\n";
+	}
+
+	Dictionary::Ptr diff = Diff(running, planned);
+	Dictionary::Ptr files = diff->Get("files");
+	Dictionary::Ptr objects = diff->Get("objects");
+
+	fp << "Config files:\n";
+
+	size_t changedFiles = 0;
+
+	for (auto& change : { "added", "modified", "removed" }) {
+		Array::Ptr paths = files->Get(change);
+		String label = change;
+
+		label += String(9 - label.GetLength(), ' ');
+
+		ObjectLock olock(paths);
+
+		for (const String& path : paths) {
+			fp << "  " << label << path << "\n";
+			changedFiles++;
+		}
+	}
+
+	if (changedFiles == 0)
+		fp << "  (unchanged)\n";
+
+	fp << "\nObjects:\n";
+
+	for (auto& action : { "create", "modify", "delete" }) {
+		Array::Ptr entries = objects->Get(action);
+
+		ObjectLock olock(entries);
+
+		for (const Array::Ptr& entry : entries)
+			PrintObject(fp, action, entry->Get(0), entry->Get(1), entry->Get(2));
+	}
+
+	fp << "\nObjects to create: " << Array::Ptr(objects->Get("create"))->GetLength()
+		<< ", modify: " << Array::Ptr(objects->Get("modify"))->GetLength()
+		<< ", delete: " << Array::Ptr(objects->Get("delete"))->GetLength()
+		<< ", unchanged: " << objects->Get("unchanged") << "\n";
+}
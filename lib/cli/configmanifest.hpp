@@ -0,0 +1,45 @@
+/* Icinga 2 | (c) 2012 Icinga GmbH | GPLv2+ */
+
+#ifndef CONFIGMANIFEST_H
+#define CONFIGMANIFEST_H
+
+#include "cli/i2-cli.hpp"
+#include "base/dictionary.hpp"
+#include "base/string.hpp"
+#include <iosfwd>
+#include <set>
+
+namespace icinga
+{
+
+/**
+ * Describes the configuration the running instance was started with:
+ * the cache key of its inputs, content hashes of the compiled files and
+ * a hash of every object's config attributes.
+ *
+ * Reloads compare against it to skip an unchanged configuration and to
+ * report the objects which a reload would create, modify and delete.
+ *
+ * @ingroup cli
+ */
+class ConfigManifest
+{
+public:
+	static Dictionary::Ptr Compute(const String& key, const std::set<String>& compiledPaths);
+
+	static Dictionary::Ptr LoadRunning();
+	static void SaveRunning(const Dictionary::Ptr& manifest);
+	static bool IsRunning(const String& key);
+
+	static Dictionary::Ptr Diff(const Dictionary::Ptr& running, const Dictionary::Ptr& planned);
+	static void PrintPlan(std::ostream& fp, const Dictionary::Ptr& running, const Dictionary::Ptr& planned);
+
+private:
+	ConfigManifest();
+
+	static String GetRunningPath();
+};
+
+}
+
+#endif /* CONFIGMANIFEST_H */
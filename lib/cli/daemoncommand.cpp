@@ -2,10 +2,13 @@
 
 #include "cli/daemoncommand.hpp"
 #include "cli/daemonutility.hpp"
+#include "cli/configcache.hpp"
+#include "cli/configmanifest.hpp"
 #include "remote/apilistener.hpp"
 #include "remote/configobjectutility.hpp"
 #include "config/configcompiler.hpp"
 #include "config/configcompilercontext.hpp"
+#include "config/configprofiler.hpp"
 #include "config/configitembuilder.hpp"
 #include "base/atomic.hpp"
 #include "base/defer.hpp"
@@ -19,11 +22,19 @@
 #include "base/scriptglobal.hpp"
 #include "base/context.hpp"
 #include "config.h"
+#include <chrono>
 #include <cstdint>
 #include <cstring>
 #include <boost/program_options.hpp>
+#include <future>
 #include <iostream>
 #include <fstream>
+#include <thread>
+#include <utility>
+
+#ifdef __GLIBC__
+#include <malloc.h>
+#endif /* __GLIBC__ */
 
 #ifdef _WIN32
 #include <windows.h>
@@ -176,6 +187,11 @@ void DaemonCommand::InitParameters(boost::program_options::options_description&
 		("config,c", po::value<std::vector<std::string> >(), "parse a configuration file")
 		("no-config,z", "start without a configuration file")
 		("validate,C", "exit after validating the configuration")
+		("config-cache", "with --validate: skip the validation if the configuration is unchanged since its last successful validation")
+		("skip-unchanged-reloads", "keep the running instance on reloads if the configuration is unchanged")
+		("reload-plan", "with --validate: print the objects a reload would create, modify and delete")
+		("profile", po::value<std::string>(), "with --validate: write a config evaluation profile to the specified file (and folded stacks to <file>.folded)")
+		("compact-config", "release the compiled configuration of objects after activation")
 		("errorlog,e", po::value<std::string>(), "log fatal errors to the specified log file (only works in combination with --daemonize or --close-stdio)")
 #ifndef _WIN32
 		("daemonize,d", "detach from the controlling terminal")
@@ -192,6 +208,15 @@ std::vector<String> DaemonCommand::GetArgumentSuggestions(const String& argument
 		return CLICommand::GetArgumentSuggestions(argument, word);
 }
 
+// Whether the worker maintains the config manifest and unchanged reloads are skipped
+static bool l_SkipUnchangedReloads = false;
+
+// The config cache key of the configuration the current worker was started with
+static String l_ConfigKey;
+
+// Whether the worker releases the compiled configuration after activation
+static bool l_CompactConfig = false;
+
 #ifndef _WIN32
 // The PID of the Icinga umbrella process
 pid_t l_UmbrellaPid = 0;
@@ -218,6 +243,71 @@ static double GetDebugWorkerDelay()
 }
 #endif /* I2_DEBUG */
 
+/**
+ * Determine the resident set size of this process.
+ *
+ * @return RSS in bytes, 0 if unknown
+ */
+static uint_fast64_t GetResidentMemory()
+{
+#ifdef __linux__
+	std::ifstream fp ("/proc/self/statm");
+	uint_fast64_t size = 0, resident = 0;
+
+	if (fp >> size >> resident)
+		return resident * sysconf(_SC_PAGESIZE);
+#endif /* __linux__ */
+
+	return 0;
+}
+
+/**
+ * Release the compiled configuration which isn't needed anymore once all objects are active.
+ */
+static void CompactConfig()
+{
+	uint_fast64_t before = GetResidentMemory();
+	size_t released = ConfigItem::ReleaseCommittedItems();
+
+#ifdef __GLIBC__
+	malloc_trim(0);
+#endif /* __GLIBC__ */
+
+	uint_fast64_t after = GetResidentMemory();
+
+	Log(LogInformation, "cli")
+		<< "Released the compiled configuration of " << released << " objects, resident memory: "
+		<< before / (1024 * 1024) << " MiB before, " << after / (1024 * 1024) << " MiB after.";
+}
+
+/**
+ * Write the config evaluation profile and its folded stacks.
+ *
+ * @param path The report's path
+ */
+static void WriteProfile(const String& path)
+{
+	for (auto folded : { false, true }) {
+		String file = folded ? path + ".folded" : path;
+		std::ofstream fp (file.CStr(), std::ofstream::out | std::ofstream::trunc);
+
+		if (folded)
+			ConfigProfiler::WriteFoldedStacks(fp);
+		else
+			ConfigProfiler::WriteReport(fp);
+
+		fp.close();
+
+		if (fp.fail()) {
+			Log(LogWarning, "cli")
+				<< "Could not write config profile '" << file << "'.";
+		}
+	}
+
+	Log(LogInformation, "cli")
+		<< "Wrote the config evaluation profile to '" << path << "' and '" << path << ".folded'.";
+}
+
 /**
  * Do the actual work (config loading, ...)
  *
@@ -245,10 +335,20 @@ int RunWorker(const std::vector<std::string>& configs, bool closeConsoleLog = fa
 	Log(LogInformation, "cli", "Loading configuration file(s).");
 	NotifyStatus("Loading configuration file(s)...");
 
+	std::set<String> compiledPaths;
+
 	{
 		std::vector<ConfigItem::Ptr> newItems;
+		bool loaded;
 
-		if (!DaemonUtility::LoadConfigFiles(configs, newItems, Configuration::ObjectsPath, Configuration::VarsPath)) {
+		/* Only while loading, objects created over the API later on are compiled, too. */
+		{
+			ConfigPathRecorder recorder;
+			loaded = DaemonUtility::LoadConfigFiles(configs, newItems, Configuration::ObjectsPath, Configuration::VarsPath);
+			compiledPaths = recorder.GetPaths();
+		}
+
+		if (!loaded) {
 			Log(LogCritical, "cli", "Config validation failed. Re-run with 'icinga2 daemon -C' after fixing the config.");
 			NotifyStatus("Config validation failed.");
 			return EXIT_FAILURE;
@@ -304,6 +404,9 @@ int RunWorker(const std::vector<std::string>& configs, bool closeConsoleLog = fa
 		}
 	}
 
+	if (l_CompactConfig)
+		CompactConfig();
+
 	/* Create the internal API object storage. Do this here too with setups without API. */
 	ConfigObjectUtility::CreateStorage();
 
@@ -318,6 +421,13 @@ int RunWorker(const std::vector<std::string>& configs, bool closeConsoleLog = fa
 
 	ApiListener::UpdateObjectAuthority();
 
+	/* Hashing all objects takes a while with large configs, it mustn't delay the takeover. */
+	if (!l_ConfigKey.IsEmpty()) {
+		std::thread([compiledPaths]() {
+			ConfigManifest::SaveRunning(ConfigManifest::Compute(l_ConfigKey, compiledPaths));
+		}).detach();
+	}
+
 	NotifyStatus("Startup finished.");
 
 	return Application::GetInstance()->Run();
@@ -626,16 +736,45 @@ int DaemonCommand::Run(const po::variables_map& vm, const std::vector<std::strin
 		configs.push_back(configDir + "/icinga2.conf");
 	}
 
+	l_SkipUnchangedReloads = vm.count("skip-unchanged-reloads");
+	l_CompactConfig = vm.count("compact-config");
+
 	if (vm.count("validate")) {
+		String cacheKey;
+
+		/* A cached validation wouldn't evaluate anything to profile. */
+		if (vm.count("profile"))
+			ConfigProfiler::Enable();
+
+		bool useCache = vm.count("config-cache") && !vm.count("profile");
+
+		if (useCache || vm.count("reload-plan"))
+			cacheKey = ConfigCache::ComputeKey(configs);
+
+		if (useCache && !vm.count("reload-plan") && ConfigCache::Lookup(cacheKey))
+			return EXIT_SUCCESS;
+
 		Log(LogInformation, "cli", "Loading configuration file(s).");
 
 		std::vector<ConfigItem::Ptr> newItems;
+		double start = Utility::GetTime();
+		LogRecorder warnings (LogWarning);
+		ConfigPathRecorder compiledPaths;
 
 		if (!DaemonUtility::LoadConfigFiles(configs, newItems, Configuration::ObjectsPath, Configuration::VarsPath)) {
 			Log(LogCritical, "cli", "Config validation failed. Re-run with 'icinga2 daemon -C' after fixing the config.");
 			return EXIT_FAILURE;
 		}
 
+		if (useCache)
+			ConfigCache::Store(cacheKey, Utility::GetTime() - start, warnings.GetEntries(), compiledPaths.GetPaths());
+
+		if (vm.count("reload-plan"))
+			ConfigManifest::PrintPlan(std::cout, ConfigManifest::LoadRunning(), ConfigManifest::Compute(cacheKey, compiledPaths.GetPaths()));
+
+		if (vm.count("profile"))
+			WriteProfile(vm["profile"].as<std::string>());
+
 		Log(LogInformation, "cli", "Finished validating the configuration file(s).");
 		return EXIT_SUCCESS;
 	}
@@ -721,6 +860,9 @@ int DaemonCommand::Run(const po::variables_map& vm, const std::vector<std::strin
 	if (vm.count("errorlog"))
 		errorLog = vm["errorlog"].as<std::string>();
 
+	if (l_SkipUnchangedReloads)
+		l_ConfigKey = ConfigCache::ComputeKey(configs);
+
 	// The PID of the current seamless worker
 	pid_t currentWorker = StartUnixWorker(configs, closeConsoleLog, errorLog);
 
@@ -750,6 +892,10 @@ int DaemonCommand::Run(const po::variables_map& vm, const std::vector<std::strin
 	// Whether we already notified systemd about our termination
 	bool notifiedTermination = false;
 
+	// The config cache key of the configuration on disk and whether it's the running one,
+	// computed in the background after a reload request with --skip-unchanged-reloads
+	std::future<std::pair<String, bool>> pendingKey;
+
 	for (;;) {
 #ifdef HAVE_SYSTEMD
 		NotifyWatchdog();
@@ -773,7 +919,45 @@ int DaemonCommand::Run(const po::variables_map& vm, const std::vector<std::strin
 			}
 		}
 
-		if (l_RequestedReload.exchange(false)) {
+		bool requestedReload = l_RequestedReload.exchange(false);
+		String nextKey;
+
+		if (requestedReload && l_SkipUnchangedReloads) {
+			requestedReload = false;
+
+			if (!pendingKey.valid()) {
+				Log(LogInformation, "Application", "Got reload command: Checking whether the configuration changed.");
+
+				String runningKey = l_ConfigKey;
+
+				pendingKey = std::async(std::launch::async, [&configs, runningKey]() -> std::pair<String, bool> {
+					try {
+						String key = ConfigCache::ComputeKey(configs);
+
+						return { key, key == runningKey && ConfigManifest::IsRunning(key) };
+					} catch (const std::exception& ex) {
+						Log(LogWarning, "Application")
+							<< "Could not check whether the configuration changed: " << DiagnosticInformation(ex, false);
+
+						return { String(), false };
+					}
+				});
+			}
+		}
+
+		if (pendingKey.valid() && pendingKey.wait_for(std::chrono::seconds(0)) == std::future_status::ready) {
+			auto result (pendingKey.get());
+
+			if (result.second) {
+				Log(LogInformation, "Application")
+					<< "Configuration is unchanged, keeping the running instance (PID " << currentWorker << ").";
+			} else {
+				requestedReload = true;
+				nextKey = std::move(result.first);
+			}
+		}
+
+		if (requestedReload) {
 			Log(LogInformation, "Application")
 				<< "Got reload command: Starting new instance.";
 
@@ -781,13 +965,20 @@ int DaemonCommand::Run(const po::variables_map& vm, const std::vector<std::strin
 			sd_notify(0, "RELOADING=1");
 #endif /* HAVE_SYSTEMD */
 
+			String currentKey = l_ConfigKey;
+
+			/* The new worker inherits the key of the configuration it loads. */
+			l_ConfigKey = nextKey;
+
 			pid_t nextWorker = StartUnixWorker(configs);
 
 			switch (nextWorker) {
 				case -1:
+					l_ConfigKey = currentKey;
 					break;
 				case -2:
 					Log(LogCritical, "Application", "Found error in config: reloading aborted");
+					l_ConfigKey = currentKey;
 					break;
 				default:
 					Log(LogInformation, "Application")
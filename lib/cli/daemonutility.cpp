@@ -42,11 +42,14 @@ static bool IncludeZoneDirRecursive(const String& path, const String& package, b
 	/* register this zone path for cluster config sync */
 	ConfigCompiler::RegisterZoneDir("_etc", path, zoneName);
 
-	std::vector<std::unique_ptr<Expression> > expressions;
-	Utility::GlobRecursive(path, "*.conf", [&expressions, zoneName, package](const String& file) {
-		ConfigCompiler::CollectIncludes(expressions, file, zoneName, package);
+	std::vector<IncludedFile> files;
+	Utility::GlobRecursive(path, "*.conf", [&files, zoneName](const String& file) {
+		files.push_back({ file, zoneName });
 	}, GlobFile);
 
+	std::vector<std::unique_ptr<Expression> > expressions;
+	ConfigCompiler::CollectIncludes(expressions, files, package);
+
 	DictExpression expr(std::move(expressions));
 	if (!ExecuteExpression(&expr))
 		success = false;
@@ -77,11 +80,14 @@ static bool IncludeNonLocalZone(const String& zonePath, const String& package, b
 		return true;
 	}
 
-	std::vector<std::unique_ptr<Expression> > expressions;
-	Utility::GlobRecursive(zonePath, "*.conf", [&expressions, zoneName, package](const String& file) {
-		ConfigCompiler::CollectIncludes(expressions, file, zoneName, package);
+	std::vector<IncludedFile> files;
+	Utility::GlobRecursive(zonePath, "*.conf", [&files, zoneName](const String& file) {
+		files.push_back({ file, zoneName });
 	}, GlobFile);
 
+	std::vector<std::unique_ptr<Expression> > expressions;
+	ConfigCompiler::CollectIncludes(expressions, files, package);
+
 	DictExpression expr(std::move(expressions));
 	if (!ExecuteExpression(&expr))
 		success = false;
@@ -236,11 +242,20 @@ bool DaemonUtility::LoadConfigFiles(const std::vector<std::string>& configs,
 {
 	ActivationScope ascope;
 
+	double start = Utility::GetTime();
+	double compileTime = ConfigCompiler::GetCompileTime();
+	size_t compiledFiles = ConfigCompiler::GetCompiledFiles();
+
 	if (!DaemonUtility::ValidateConfigFiles(configs, objectsFile)) {
 		ConfigCompilerContext::GetInstance()->CancelObjectsFile();
 		return false;
 	}
 
+	double evaluated = Utility::GetTime();
+
+	compileTime = ConfigCompiler::GetCompileTime() - compileTime;
+	compiledFiles = ConfigCompiler::GetCompiledFiles() - compiledFiles;
+
 	WorkQueue upq(25000, Configuration::Concurrency);
 	upq.SetName("DaemonUtility::LoadConfigFiles");
 	bool result = ConfigItem::CommitItems(ascope.GetContext(), upq, newItems);
@@ -250,6 +265,11 @@ bool DaemonUtility::LoadConfigFiles(const std::vector<std::string>& configs,
 		return false;
 	}
 
+	Log(LogInformation, "cli")
+		<< "Parsed " << compiledFiles << " config files in " << Utility::FormatDuration(compileTime)
+		<< ", evaluated them in " << Utility::FormatDuration(evaluated - start - compileTime)
+		<< " and committed the config items in " << Utility::FormatDuration(Utility::GetTime() - evaluated) << ".";
+
 	ConfigCompilerContext::GetInstance()->FinishObjectsFile();
 
 	try {
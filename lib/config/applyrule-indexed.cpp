@@ -0,0 +1,357 @@
+/* Icinga 2 | (c) 2012 Icinga GmbH | GPLv2+ */
+
+#include "base/json.hpp"
+#include "base/objectlock.hpp"
+#include "base/scriptframe.hpp"
+#include "base/scriptglobal.hpp"
+#include "base/string.hpp"
+#include "config/applyrule.hpp"
+#include "config/expression.hpp"
+#include <algorithm>
+#include <utility>
+#include <vector>
+
+using namespace icinga;
+
+/**
+ * @returns All ApplyRules of the given types whose assign filter may match the object described by the
+ * given locals (host and, for services, service), in the order of GetRules(). (See AddIndexedRule().)
+ */
+std::vector<ApplyRule::Ptr> ApplyRule::GetRules(const Type::Ptr& sourceType, const Type::Ptr& targetType, const Dictionary::Ptr& locals)
+{
+	auto& rules (GetRules(sourceType, targetType));
+	auto perSourceType (m_Rules.find(sourceType.get()));
+
+	if (perSourceType == m_Rules.end()) {
+		return rules;
+	}
+
+	auto index (perSourceType->second.Indexed.find(targetType.get()));
+
+	if (index == perSourceType->second.Indexed.end() || index->second.Paths.empty()) {
+		return rules;
+	}
+
+	std::vector<size_t> candidates (index->second.Unindexed);
+
+	{
+		ScriptFrame frame (true);
+		locals->CopyTo(frame.Locals);
+
+		for (auto& path : index->second.Paths) {
+			Value value;
+
+			try {
+				value = path.second.Path->Evaluate(frame).GetValue();
+			} catch (const std::exception&) {
+				/* Let the filters raise the error. */
+				for (auto& kv : path.second.Equal) {
+					candidates.insert(candidates.end(), kv.second.begin(), kv.second.end());
+				}
+
+				candidates.insert(candidates.end(), path.second.AllContains.begin(), path.second.AllContains.end());
+				candidates.insert(candidates.end(), path.second.AllPrefix.begin(), path.second.AllPrefix.end());
+				continue;
+			}
+
+			AddCandidates(path.second, value, candidates);
+		}
+	}
+
+	/* A global variable named "match" shadows the match() function. */
+	if (ScriptGlobal::GetGlobals()->Contains("match")) {
+		for (auto& path : index->second.Paths) {
+			candidates.insert(candidates.end(), path.second.AllPrefix.begin(), path.second.AllPrefix.end());
+		}
+	}
+
+	std::sort(candidates.begin(), candidates.end());
+	candidates.erase(std::unique(candidates.begin(), candidates.end()), candidates.end());
+
+	m_IndexedLookups.fetch_add(1);
+	m_IndexSkippedRules.fetch_add(rules.size() - candidates.size());
+
+	std::vector<ApplyRule::Ptr> result;
+	result.reserve(candidates.size());
+
+	for (auto position : candidates) {
+		result.emplace_back(rules[position]);
+	}
+
+	return result;
+}
+
+/**
+ * Add the rules whose condition on the given path can be true for the given path value to the candidates.
+ */
+void ApplyRule::AddCandidates(const IndexedPath& path, const Value& value, std::vector<size_t>& candidates)
+{
+	auto lookup ([&candidates](const std::unordered_map<String, std::vector<size_t>>& rules, const String& key) {
+		auto positions (rules.find(key));
+
+		if (positions != rules.end()) {
+			candidates.insert(candidates.end(), positions->second.begin(), positions->second.end());
+		}
+	});
+
+	auto lookupPrefixes ([&path, &lookup](const String& text) {
+		if (path.PrefixLengths.empty()) {
+			return;
+		}
+
+		String lcText = text.ToLower();
+
+		for (auto length : path.PrefixLengths) {
+			if (length > lcText.GetLength()) {
+				break;
+			}
+
+			lookup(path.Prefix, lcText.SubStr(0, length));
+		}
+	});
+
+	if (value.IsObjectType<Array>()) {
+		Array::Ptr arr = value;
+		ObjectLock olock (arr);
+
+		for (const Value& item : arr) {
+			String text = item;
+
+			lookup(path.Contains, text);
+			lookupPrefixes(text);
+		}
+	} else if (value.IsObject()) {
+		/* Neither equals a string, 'in' and match() raise an error. */
+		candidates.insert(candidates.end(), path.AllContains.begin(), path.AllContains.end());
+		candidates.insert(candidates.end(), path.AllPrefix.begin(), path.AllPrefix.end());
+	} else {
+		String text = value;
+
+		lookup(path.Equal, text);
+		lookupPrefixes(text);
+
+		if (!value.IsEmpty()) {
+			/* 'in' raises an error. */
+			candidates.insert(candidates.end(), path.AllContains.begin(), path.AllContains.end());
+		}
+	}
+}
+
+/**
+ * Add the given rule to the predicate index, under the host/service attribute values its assign filter requires.
+ *
+ * - For apply T "N" to Host that's e.g.: assign where host.vars.os == "Linux"
+ * - For apply T "N" to Service that's e.g.: assign where "db" in service.groups && host.vars.os == "Linux"
+ *
+ * Rules whose assign filter doesn't require such values are evaluated for all objects.
+ *
+ * @param position The rule's position in PerSourceType#Regular.
+ */
+void ApplyRule::AddIndexedRule(const ApplyRule::Ptr& rule, const String& targetType, size_t position, ApplyRule::PredicateIndex& index)
+{
+	std::vector<IndexKey> keys;
+	bool indexable = rule->m_Filter && GetIndexKeys(rule->m_Filter.get(), targetType, keys);
+
+	/* The filter's variables resolve to locals first. */
+	for (auto var : {"host", "service", "match"}) {
+		if (rule->m_FKVar == var || rule->m_FVVar == var || (rule->m_Scope && rule->m_Scope->Contains(var))) {
+			indexable = false;
+		}
+	}
+
+	if (!indexable) {
+		index.Unindexed.emplace_back(position);
+		return;
+	}
+
+	for (auto& key : keys) {
+		auto& path (index.Paths[key.PathName]);
+
+		if (!path.Path) {
+			path.Path = key.Path;
+		}
+
+		switch (key.Kind) {
+			case IndexKind::Equal:
+				path.Equal[key.Value].emplace_back(position);
+				break;
+			case IndexKind::Contains:
+				path.Contains[key.Value].emplace_back(position);
+				path.AllContains.emplace_back(position);
+				break;
+			case IndexKind::Prefix:
+				path.Prefix[key.Value].emplace_back(position);
+				path.PrefixLengths.emplace(key.Value.GetLength());
+				path.AllPrefix.emplace_back(position);
+				break;
+		}
+	}
+}
+
+/**
+ * If the given assign filter can only be true if one of the keys is satisfied, add those keys to the vector:
+ *
+ * - $path$ == "V" adds {$path$, Equal, "V"}
+ * - $path$ in [ "V", "v" ... ] adds {$path$, Equal, "V"}, {$path$, Equal, "v"} ...
+ * - "V" in $path$ adds {$path$, Contains, "V"}
+ * - match("V*", $path$) adds {$path$, Prefix, "v"}
+ * - A && B adds the keys of A or, if A has none, of B
+ * - A || B adds the keys of A and B, both must have some
+ *
+ * $path$ is like host.vars.os, or service.vars.os for apply rules targeting services.
+ * The order of operands of || && == doesn't matter.
+ *
+ * @returns Whether the given assign filter requires any keys.
+ */
+bool ApplyRule::GetIndexKeys(Expression* assignFilter, const String& targetType, std::vector<IndexKey>& keys)
+{
+	auto lor (dynamic_cast<LogicalOrExpression*>(assignFilter));
+
+	if (lor) {
+		return GetIndexKeys(lor->GetOperand1().get(), targetType, keys)
+			&& GetIndexKeys(lor->GetOperand2().get(), targetType, keys);
+	}
+
+	auto land (dynamic_cast<LogicalAndExpression*>(assignFilter));
+
+	if (land) {
+		auto size (keys.size());
+
+		if (GetIndexKeys(land->GetOperand1().get(), targetType, keys)) {
+			return true;
+		}
+
+		keys.resize(size);
+
+		return GetIndexKeys(land->GetOperand2().get(), targetType, keys);
+	}
+
+	String pathName;
+
+	auto eq (dynamic_cast<EqualExpression*>(assignFilter));
+
+	if (eq) {
+		auto op1 (eq->GetOperand1().get());
+		auto op2 (eq->GetOperand2().get());
+
+		if (!GetAttributePath(op1, targetType, pathName)) {
+			std::swap(op1, op2);
+
+			if (!GetAttributePath(op1, targetType, pathName)) {
+				return false;
+			}
+		}
+
+		auto val (GetLiteralStringValue(op2));
+
+		if (!val) {
+			return false;
+		}
+
+		keys.emplace_back(IndexKey{pathName, op1, IndexKind::Equal, *val});
+		return true;
+	}
+
+	auto in (dynamic_cast<InExpression*>(assignFilter));
+
+	if (in) {
+		auto op1 (in->GetOperand1().get());
+		auto op2 (in->GetOperand2().get());
+
+		if (GetAttributePath(op2, targetType, pathName)) {
+			auto val (GetLiteralStringValue(op1));
+
+			if (!val) {
+				return false;
+			}
+
+			keys.emplace_back(IndexKey{pathName, op2, IndexKind::Contains, *val});
+			return true;
+		}
+
+		auto arr (dynamic_cast<ArrayExpression*>(op2));
+
+		if (!arr || !GetAttributePath(op1, targetType, pathName)) {
+			return false;
+		}
+
+		for (auto& item : arr->GetExpressions()) {
+			if (!GetLiteralStringValue(item.get())) {
+				return false;
+			}
+		}
+
+		for (auto& item : arr->GetExpressions()) {
+			keys.emplace_back(IndexKey{pathName, op1, IndexKind::Equal, *GetLiteralStringValue(item.get())});
+		}
+
+		return true;
+	}
+
+	auto call (dynamic_cast<FunctionCallExpression*>(assignFilter));
+
+	if (call) {
+		auto fname (dynamic_cast<VariableExpression*>(call->m_FName.get()));
+
+		if (!fname || fname->GetVariable() != "match" || call->m_Args.size() != 2u) {
+			return false;
+		}
+
+		auto pattern (GetLiteralStringValue(call->m_Args[0].get()));
+
+		if (!pattern || !GetAttributePath(call->m_Args[1].get(), targetType, pathName)) {
+			return false;
+		}
+
+		/* match() is case-insensitive and these start a wildcard or an escape sequence. */
+		String prefix = pattern->SubStr(0, pattern->FindFirstOf("*?\\")).ToLower();
+
+		if (prefix.IsEmpty()) {
+			return false;
+		}
+
+		keys.emplace_back(IndexKey{pathName, call->m_Args[1].get(), IndexKind::Prefix, prefix});
+		return true;
+	}
+
+	return false;
+}
+
+/**
+ * If the given expression is like host.vars.os (or service.vars.os for apply rules targeting services),
+ * set pathName to a unique representation of it.
+ *
+ * @returns Whether the given expression is like above.
+ */
+bool ApplyRule::GetAttributePath(Expression* exp, const String& targetType, String& pathName)
+{
+	std::vector<String> indices;
+
+	for (;;) {
+		auto ixr (dynamic_cast<IndexerExpression*>(exp));
+
+		if (!ixr) {
+			break;
+		}
+
+		auto index (GetLiteralStringValue(ixr->GetOperand2().get()));
+
+		if (!index) {
+			return false;
+		}
+
+		indices.emplace_back(*index);
+		exp = ixr->GetOperand1().get();
+	}
+
+	auto var (dynamic_cast<VariableExpression*>(exp));
+
+	if (indices.empty() || !var || !(var->GetVariable() == "host" || (var->GetVariable() == "service" && targetType == "Service"))) {
+		return false;
+	}
+
+	std::reverse(indices.begin(), indices.end());
+
+	pathName = var->GetVariable() + JsonEncode(Array::FromVector(indices));
+	return true;
+}
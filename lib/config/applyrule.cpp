@@ -1,21 +1,29 @@
 /* Icinga 2 | (c) 2012 Icinga GmbH | GPLv2+ */
 
 #include "config/applyrule.hpp"
+#include "config/bytecode.hpp"
+#include "config/configprofiler.hpp"
 #include "base/logger.hpp"
+#include <algorithm>
 #include <set>
+#include <sstream>
 #include <unordered_set>
 
 using namespace icinga;
 
 ApplyRule::RuleMap ApplyRule::m_Rules;
 ApplyRule::TypeMap ApplyRule::m_Types;
+std::atomic<uint_fast64_t> ApplyRule::m_IndexedLookups (0);
+std::atomic<uint_fast64_t> ApplyRule::m_IndexSkippedRules (0);
 
 ApplyRule::ApplyRule(String name, Expression::Ptr expression,
 	Expression::Ptr filter, String package, String fkvar, String fvvar, Expression::Ptr fterm,
 	bool ignoreOnError, DebugInfo di, Dictionary::Ptr scope)
 	: m_Name(std::move(name)), m_Expression(std::move(expression)), m_Filter(std::move(filter)), m_Package(std::move(package)), m_FKVar(std::move(fkvar)),
-	m_FVVar(std::move(fvvar)), m_FTerm(std::move(fterm)), m_IgnoreOnError(ignoreOnError), m_DebugInfo(std::move(di)), m_Scope(std::move(scope)), m_HasMatches(false)
-{ }
+	m_FVVar(std::move(fvvar)), m_FTerm(std::move(fterm)), m_IgnoreOnError(ignoreOnError), m_DebugInfo(std::move(di)), m_Scope(std::move(scope))
+{
+	m_CompiledFilter = BytecodeExpression::Compile(m_Filter);
+}
 
 String ApplyRule::GetName() const
 {
@@ -82,16 +90,36 @@ void ApplyRule::AddRule(const String& sourceType, const String& targetType, cons
 	}
 
 	ApplyRule::Ptr rule = new ApplyRule(name, expression, filter, package, fkvar, fvvar, fterm, ignoreOnError, di, scope);
+
+	if (ConfigProfiler::IsEnabled()) {
+		auto makeLabel ([&sourceType, &name, &di](const char *part) {
+			std::ostringstream msgbuf;
+			msgbuf << "apply " << sourceType << " '" << name << "' " << part << " " << di;
+			return String(msgbuf.str());
+		});
+
+		/* The rule's body is evaluated by the objects it creates, after the filter matched. */
+		rule->m_Expression = new ProfiledExpression(makeLabel("body"), rule->m_Expression);
+
+		if (rule->m_CompiledFilter)
+			rule->m_CompiledFilter = new ProfiledExpression(makeLabel("filter"), rule->m_CompiledFilter);
+	}
 	auto& rules (m_Rules[Type::GetByName(sourceType).get()]);
 
 	if (!AddTargetedRule(rule, *actualTargetType, rules)) {
-		rules.Regular[Type::GetByName(*actualTargetType).get()].emplace_back(std::move(rule));
+		auto type (Type::GetByName(*actualTargetType).get());
+		auto& regular (rules.Regular[type]);
+
+		AddIndexedRule(rule, *actualTargetType, regular.size(), rules.Indexed[type]);
+		regular.emplace_back(std::move(rule));
 	}
 }
 
 bool ApplyRule::EvaluateFilter(ScriptFrame& frame) const
 {
-	return Convert::ToBool(m_Filter->Evaluate(frame));
+	m_FilterEvaluations.fetch_add(1);
+
+	return Convert::ToBool(m_CompiledFilter->Evaluate(frame));
 }
 
 void ApplyRule::RegisterType(const String& sourceType, const std::vector<String>& targetTypes)
@@ -136,12 +164,28 @@ const std::vector<String>& ApplyRule::GetTargetTypes(const String& sourceType)
 
 void ApplyRule::AddMatch()
 {
-	m_HasMatches = true;
+	m_Matches.fetch_add(1);
 }
 
 bool ApplyRule::HasMatches() const
 {
-	return m_HasMatches;
+	return m_Matches.load();
+}
+
+/**
+ * @returns The number of objects this rule has been applied to.
+ */
+uint_fast64_t ApplyRule::GetMatches() const
+{
+	return m_Matches.load();
+}
+
+/**
+ * @returns How often the assign/ignore filter of this rule has been evaluated.
+ */
+uint_fast64_t ApplyRule::GetFilterEvaluations() const
+{
+	return m_FilterEvaluations.load();
 }
 
 const std::vector<ApplyRule::Ptr>& ApplyRule::GetRules(const Type::Ptr& sourceType, const Type::Ptr& targetType)
@@ -162,10 +206,13 @@ const std::vector<ApplyRule::Ptr>& ApplyRule::GetRules(const Type::Ptr& sourceTy
 
 void ApplyRule::CheckMatches(bool silent)
 {
+	std::vector<std::pair<ApplyRule*, Type*>> regular;
+
 	for (auto& perSourceType : m_Rules) {
 		for (auto& perTargetType : perSourceType.second.Regular) {
 			for (auto& rule : perTargetType.second) {
 				CheckMatches(rule, perSourceType.first, silent);
+				regular.emplace_back(rule.get(), perSourceType.first);
 			}
 		}
 
@@ -187,6 +234,34 @@ void ApplyRule::CheckMatches(bool silent)
 			CheckMatches(rule, perSourceType.first, silent);
 		}
 	}
+
+	if (silent || regular.empty())
+		return;
+
+	uint_fast64_t evaluations = 0;
+
+	for (auto& rule : regular) {
+		evaluations += rule.first->GetFilterEvaluations();
+	}
+
+	Log(LogNotice, "ApplyRule")
+		<< "Evaluated " << evaluations << " apply rule filters, the predicate index skipped "
+		<< m_IndexSkippedRules.load() << " more in " << m_IndexedLookups.load() << " lookups.";
+
+	std::sort(regular.begin(), regular.end(), [](const std::pair<ApplyRule*, Type*>& a, const std::pair<ApplyRule*, Type*>& b) {
+		return a.first->GetFilterEvaluations() > b.first->GetFilterEvaluations();
+	});
+
+	if (regular.size() > 10u) {
+		regular.resize(10u);
+	}
+
+	for (auto& rule : regular) {
+		Log(LogNotice, "ApplyRule")
+			<< "Apply rule '" << rule.first->GetName() << "' (" << rule.first->GetDebugInfo() << ") for type '"
+			<< rule.second->GetName() << "': " << rule.first->GetFilterEvaluations() << " filter evaluations, "
+			<< rule.first->GetMatches() << " matches";
+	}
 }
 
 void ApplyRule::CheckMatches(const ApplyRule::Ptr& rule, Type* sourceType, bool silent)
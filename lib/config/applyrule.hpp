@@ -8,6 +8,10 @@
 #include "base/debuginfo.hpp"
 #include "base/shared-object.hpp"
 #include "base/type.hpp"
+#include <atomic>
+#include <cstdint>
+#include <map>
+#include <set>
 #include <unordered_map>
 
 namespace icinga
@@ -27,9 +31,29 @@ public:
 		std::unordered_map<String /* service */, std::set<ApplyRule::Ptr>> ForServices;
 	};
 
+	/* Rules, by their position in PerSourceType#Regular, whose filter can only be true
+	 * if the value of one specific host or service attribute fits a literal. */
+	struct IndexedPath
+	{
+		Expression *Path; // e.g. host.vars.os, owned by the filter of one of the rules
+		std::unordered_map<String /* value */, std::vector<size_t>> Equal; // host.vars.os == "Linux"
+		std::unordered_map<String /* value */, std::vector<size_t>> Contains; // "linux-servers" in host.groups
+		std::unordered_map<String /* lower case prefix */, std::vector<size_t>> Prefix; // match("db-*", host.name)
+		std::set<size_t> PrefixLengths;
+		std::vector<size_t> AllContains;
+		std::vector<size_t> AllPrefix;
+	};
+
+	struct PredicateIndex
+	{
+		std::vector<size_t> Unindexed;
+		std::map<String /* path */, IndexedPath> Paths;
+	};
+
 	struct PerSourceType
 	{
 		std::unordered_map<Type* /* target type */, std::vector<ApplyRule::Ptr>> Regular;
+		std::unordered_map<Type* /* target type */, PredicateIndex> Indexed;
 		std::unordered_map<String /* host */, PerHost> Targeted;
 	};
 
@@ -46,6 +70,10 @@ public:
 	 *
 	 * m_Rules[T::TypeInstance.get()].Regular[C::TypeInstance.get()]
 	 * contains all other apply rules like apply T "x" to C { ... }.
+	 *
+	 * m_Rules[T::TypeInstance.get()].Indexed[C::TypeInstance.get()]
+	 * indexes those by the host/service attribute values their
+	 * assign filter requires, e.g. assign where host.vars.os == "Linux".
 	 */
 	typedef std::unordered_map<Type* /* source type */, PerSourceType> RuleMap;
 
@@ -63,6 +91,8 @@ public:
 	Dictionary::Ptr GetScope() const;
 	void AddMatch();
 	bool HasMatches() const;
+	uint_fast64_t GetMatches() const;
+	uint_fast64_t GetFilterEvaluations() const;
 
 	bool EvaluateFilter(ScriptFrame& frame) const;
 
@@ -70,6 +100,7 @@ public:
 		const Expression::Ptr& filter, const String& package, const String& fkvar, const String& fvvar, const Expression::Ptr& fterm,
 		bool ignoreOnError, const DebugInfo& di, const Dictionary::Ptr& scope);
 	static const std::vector<ApplyRule::Ptr>& GetRules(const Type::Ptr& sourceType, const Type::Ptr& targetType);
+	static std::vector<ApplyRule::Ptr> GetRules(const Type::Ptr& sourceType, const Type::Ptr& targetType, const Dictionary::Ptr& locals);
 	static const std::set<ApplyRule::Ptr>& GetTargetedHostRules(const Type::Ptr& sourceType, const String& host);
 	static const std::set<ApplyRule::Ptr>& GetTargetedServiceRules(const Type::Ptr& sourceType, const String& host, const String& service);
 
@@ -85,6 +116,7 @@ private:
 	String m_Name;
 	Expression::Ptr m_Expression;
 	Expression::Ptr m_Filter;
+	Expression::Ptr m_CompiledFilter;
 	String m_Package;
 	String m_FKVar;
 	String m_FVVar;
@@ -92,11 +124,15 @@ private:
 	bool m_IgnoreOnError;
 	DebugInfo m_DebugInfo;
 	Dictionary::Ptr m_Scope;
-	bool m_HasMatches;
+	std::atomic<uint_fast64_t> m_Matches{0};
+	mutable std::atomic<uint_fast64_t> m_FilterEvaluations{0};
 
 	static TypeMap m_Types;
 	static RuleMap m_Rules;
 
+	static std::atomic<uint_fast64_t> m_IndexedLookups;
+	static std::atomic<uint_fast64_t> m_IndexSkippedRules;
+
 	static bool AddTargetedRule(const ApplyRule::Ptr& rule, const String& targetType, PerSourceType& rules);
 	static bool GetTargetHosts(Expression* assignFilter, std::vector<const String *>& hosts);
 	static bool GetTargetServices(Expression* assignFilter, std::vector<std::pair<const String *, const String *>>& services);
@@ -105,6 +141,26 @@ private:
 	static bool IsNameIndexer(Expression* exp, const char * lcType);
 	static const String * GetLiteralStringValue(Expression* exp);
 
+	enum class IndexKind
+	{
+		Equal,
+		Contains,
+		Prefix
+	};
+
+	struct IndexKey
+	{
+		String PathName;
+		Expression *Path;
+		IndexKind Kind;
+		String Value;
+	};
+
+	static void AddIndexedRule(const ApplyRule::Ptr& rule, const String& targetType, size_t position, PredicateIndex& index);
+	static bool GetIndexKeys(Expression* assignFilter, const String& targetType, std::vector<IndexKey>& keys);
+	static bool GetAttributePath(Expression* exp, const String& targetType, String& pathName);
+	static void AddCandidates(const IndexedPath& path, const Value& value, std::vector<size_t>& candidates);
+
 	ApplyRule(String name, Expression::Ptr expression,
 		Expression::Ptr filter, String package, String fkvar, String fvvar, Expression::Ptr fterm,
 		bool ignoreOnError, DebugInfo di, Dictionary::Ptr scope);
@@ -0,0 +1,393 @@
+/* Icinga 2 | (c) 2012 Icinga GmbH | GPLv2+ */
+
+#include "config/bytecode.hpp"
+#include "config/vmops.hpp"
+#include "base/array.hpp"
+#include "base/exception.hpp"
+#include "base/json.hpp"
+#include <boost/exception_ptr.hpp>
+#include <boost/exception/errinfo_nested_exception.hpp>
+#include <algorithm>
+
+using namespace icinga;
+
+/* Evaluations whose stack fits don't allocate it on the heap. */
+static const size_t l_InlineStackSize = 16;
+
+BytecodeExpression::BytecodeExpression(Expression::Ptr expression)
+	: m_Expression(std::move(expression))
+{
+	CompileNode(m_Expression.get());
+
+	ASSERT(m_StackSize == 1u);
+}
+
+/**
+ * Compiles the given expression tree. The tree must not be modified afterwards.
+ *
+ * @param expression The expression tree.
+ * @returns The compiled expression, or nullptr for nullptr.
+ */
+Expression::Ptr BytecodeExpression::Compile(const Expression::Ptr& expression)
+{
+	if (!expression)
+		return nullptr;
+
+	return new BytecodeExpression(expression);
+}
+
+std::unique_ptr<Expression> BytecodeExpression::Compile(std::unique_ptr<Expression> expression)
+{
+	if (!expression)
+		return nullptr;
+
+	return std::unique_ptr<Expression>(new BytecodeExpression(Expression::Ptr(expression.release())));
+}
+
+const DebugInfo& BytecodeExpression::GetDebugInfo() const
+{
+	return m_Expression->GetDebugInfo();
+}
+
+/**
+ * @returns The number of instructions, for testing.
+ */
+size_t BytecodeExpression::GetInstructionCount() const
+{
+	return m_Instructions.size();
+}
+
+void BytecodeExpression::Emit(Opcode op, Expression *node, size_t arg)
+{
+	m_Instructions.emplace_back(Instruction{op, arg, node});
+
+	switch (op) {
+		case Opcode::Push:
+		case Opcode::Eval:
+			m_StackSize++;
+			break;
+		case Opcode::GetFieldConst:
+		case Opcode::EqualConst:
+		case Opcode::NotEqualConst:
+		case Opcode::LogicalNegate:
+		case Opcode::JumpIfFalse:
+		case Opcode::JumpIfTrue:
+		case Opcode::InPrepare:
+		case Opcode::NotInPrepare:
+			break;
+		default:
+			m_StackSize--;
+	}
+
+	m_MaxStackSize = std::max(m_MaxStackSize, m_StackSize);
+}
+
+size_t BytecodeExpression::AddConstant(const Value& value)
+{
+	m_Constants.emplace_back(value);
+	return m_Constants.size() - 1u;
+}
+
+/**
+ * Emits the instructions which push the value of the given expression.
+ */
+void BytecodeExpression::CompileNode(Expression *node)
+{
+	auto lit (dynamic_cast<LiteralExpression*>(node));
+
+	if (lit) {
+		Emit(Opcode::Push, node, AddConstant(lit->GetValue()));
+		return;
+	}
+
+	auto dict (dynamic_cast<DictExpression*>(node));
+
+	if (dict && dict->IsInline()) {
+		auto& exprs (dict->GetExpressions());
+
+		if (exprs.empty()) {
+			Emit(Opcode::Push, node, AddConstant(Empty));
+			return;
+		}
+
+		for (auto& expr : exprs) {
+			if (&expr != &exprs.front()) {
+				Emit(Opcode::Pop, node);
+			}
+
+			CompileNode(expr.get());
+		}
+
+		return;
+	}
+
+	auto ixr (dynamic_cast<IndexerExpression*>(node));
+
+	if (ixr) {
+		CompileNode(ixr->GetOperand1().get());
+
+		auto index (dynamic_cast<LiteralExpression*>(ixr->GetOperand2().get()));
+
+		if (index) {
+			Emit(Opcode::GetFieldConst, node, AddConstant(String(index->GetValue())));
+		} else {
+			CompileNode(ixr->GetOperand2().get());
+			Emit(Opcode::GetField, node);
+		}
+
+		return;
+	}
+
+	auto lneg (dynamic_cast<LogicalNegateExpression*>(node));
+
+	if (lneg) {
+		CompileNode(lneg->GetOperand().get());
+		Emit(Opcode::LogicalNegate, node);
+		return;
+	}
+
+	auto land (dynamic_cast<LogicalAndExpression*>(node));
+	auto lor (dynamic_cast<LogicalOrExpression*>(node));
+
+	if (land || lor) {
+		auto bin (static_cast<BinaryExpression*>(node));
+
+		/* Short-circuit: keep the first operand as the result or replace it with the second one. */
+		CompileNode(bin->GetOperand1().get());
+
+		auto jump (m_Instructions.size());
+		Emit(land ? Opcode::JumpIfFalse : Opcode::JumpIfTrue, node);
+		Emit(Opcode::Pop, node);
+
+		CompileNode(bin->GetOperand2().get());
+
+		m_Instructions[jump].Arg = m_Instructions.size();
+		return;
+	}
+
+	auto in (dynamic_cast<InExpression*>(node));
+	auto notIn (dynamic_cast<NotInExpression*>(node));
+
+	if (in || notIn) {
+		auto bin (static_cast<BinaryExpression*>(node));
+
+		/* The array is evaluated first, the value not at all if the array is null. */
+		CompileNode(bin->GetOperand2().get());
+
+		auto jump (m_Instructions.size());
+		Emit(in ? Opcode::InPrepare : Opcode::NotInPrepare, node);
+
+		CompileNode(bin->GetOperand1().get());
+		Emit(in ? Opcode::In : Opcode::NotIn, node);
+
+		m_Instructions[jump].Arg = m_Instructions.size();
+		return;
+	}
+
+	if (CompileBinary(node)) {
+		return;
+	}
+
+	Emit(Opcode::Eval, node);
+}
+
+/**
+ * Emits the instructions for binary operators which evaluate both of their operands.
+ *
+ * @returns Whether the given expression is such an operator.
+ */
+bool BytecodeExpression::CompileBinary(Expression *node)
+{
+	auto bin (dynamic_cast<BinaryExpression*>(node));
+
+	if (!bin) {
+		return false;
+	}
+
+	Opcode op;
+
+	if (dynamic_cast<EqualExpression*>(node)) {
+		op = Opcode::Equal;
+	} else if (dynamic_cast<NotEqualExpression*>(node)) {
+		op = Opcode::NotEqual;
+	} else if (dynamic_cast<LessThanExpression*>(node)) {
+		op = Opcode::LessThan;
+	} else if (dynamic_cast<GreaterThanExpression*>(node)) {
+		op = Opcode::GreaterThan;
+	} else if (dynamic_cast<LessThanOrEqualExpression*>(node)) {
+		op = Opcode::LessThanOrEqual;
+	} else if (dynamic_cast<GreaterThanOrEqualExpression*>(node)) {
+		op = Opcode::GreaterThanOrEqual;
+	} else if (dynamic_cast<AddExpression*>(node)) {
+		op = Opcode::Add;
+	} else if (dynamic_cast<SubtractExpression*>(node)) {
+		op = Opcode::Subtract;
+	} else if (dynamic_cast<MultiplyExpression*>(node)) {
+		op = Opcode::Multiply;
+	} else if (dynamic_cast<DivideExpression*>(node)) {
+		op = Opcode::Divide;
+	} else if (dynamic_cast<ModuloExpression*>(node)) {
+		op = Opcode::Modulo;
+	} else {
+		return false;
+	}
+
+	CompileNode(bin->GetOperand1().get());
+
+	auto lit (dynamic_cast<LiteralExpression*>(bin->GetOperand2().get()));
+
+	/* Compare with literals in place instead of pushing a copy of them. */
+	if (lit && (op == Opcode::Equal || op == Opcode::NotEqual)) {
+		Emit(op == Opcode::Equal ? Opcode::EqualConst : Opcode::NotEqualConst, node, AddConstant(lit->GetValue()));
+		return true;
+	}
+
+	CompileNode(bin->GetOperand2().get());
+	Emit(op, node);
+
+	return true;
+}
+
+ExpressionResult BytecodeExpression::DoEvaluate(ScriptFrame& frame, DebugHint *) const
+{
+	Value inlineStack[l_InlineStackSize];
+	std::unique_ptr<Value[]> heapStack;
+	Value *stack = inlineStack;
+
+	if (m_MaxStackSize > l_InlineStackSize) {
+		heapStack.reset(new Value[m_MaxStackSize]);
+		stack = heapStack.get();
+	}
+
+	Value *sp = stack;
+	const Instruction *instr = nullptr;
+
+	try {
+		for (size_t ip = 0; ip < m_Instructions.size(); ip++) {
+			instr = &m_Instructions[ip];
+
+			switch (instr->Op) {
+				case Opcode::Push:
+					*sp++ = m_Constants[instr->Arg];
+					break;
+
+				case Opcode::Pop:
+					*--sp = Empty;
+					break;
+
+				case Opcode::Eval: {
+					ExpressionResult result = instr->Node->DoEvaluate(frame, nullptr);
+
+					if (result.GetCode() != ResultOK)
+						return result;
+
+					*sp++ = result.GetValue();
+					break;
+				}
+
+				case Opcode::GetField: {
+					Value index = std::move(*--sp);
+					sp[-1] = VMOps::GetField(sp[-1], index, frame.Sandboxed, instr->Node->GetDebugInfo());
+					break;
+				}
+
+				case Opcode::GetFieldConst:
+					sp[-1] = VMOps::GetField(sp[-1], m_Constants[instr->Arg].Get<String>(), frame.Sandboxed, instr->Node->GetDebugInfo());
+					break;
+
+				case Opcode::EqualConst:
+					sp[-1] = sp[-1] == m_Constants[instr->Arg];
+					break;
+
+				case Opcode::NotEqualConst:
+					sp[-1] = sp[-1] != m_Constants[instr->Arg];
+					break;
+
+				case Opcode::LogicalNegate:
+					sp[-1] = !sp[-1].ToBool();
+					break;
+
+				case Opcode::JumpIfFalse:
+					if (!sp[-1].ToBool())
+						ip = instr->Arg - 1u;
+					break;
+
+				case Opcode::JumpIfTrue:
+					if (sp[-1].ToBool())
+						ip = instr->Arg - 1u;
+					break;
+
+				case Opcode::InPrepare:
+				case Opcode::NotInPrepare:
+					if (sp[-1].IsEmpty()) {
+						sp[-1] = instr->Op == Opcode::NotInPrepare;
+						ip = instr->Arg - 1u;
+					} else if (!sp[-1].IsObjectType<Array>()) {
+						BOOST_THROW_EXCEPTION(ScriptError("Invalid right side argument for 'in' operator: " + JsonEncode(sp[-1]), instr->Node->GetDebugInfo()));
+					}
+					break;
+
+				case Opcode::In:
+				case Opcode::NotIn: {
+					Value value = std::move(*--sp);
+					Array::Ptr arr = sp[-1];
+					bool contains = arr->Contains(value);
+
+					sp[-1] = instr->Op == Opcode::In ? contains : !contains;
+					break;
+				}
+
+				default: {
+					Value operand2 = std::move(*--sp);
+					Value& operand1 = sp[-1];
+
+					switch (instr->Op) {
+						case Opcode::Equal:
+							operand1 = operand1 == operand2;
+							break;
+						case Opcode::NotEqual:
+							operand1 = operand1 != operand2;
+							break;
+						case Opcode::LessThan:
+							operand1 = operand1 < operand2;
+							break;
+						case Opcode::GreaterThan:
+							operand1 = operand1 > operand2;
+							break;
+						case Opcode::LessThanOrEqual:
+							operand1 = operand1 <= operand2;
+							break;
+						case Opcode::GreaterThanOrEqual:
+							operand1 = operand1 >= operand2;
+							break;
+						case Opcode::Add:
+							operand1 = operand1 + operand2;
+							break;
+						case Opcode::Subtract:
+							operand1 = operand1 - operand2;
+							break;
+						case Opcode::Multiply:
+							operand1 = operand1 * operand2;
+							break;
+						case Opcode::Divide:
+							operand1 = operand1 / operand2;
+							break;
+						case Opcode::Modulo:
+							operand1 = operand1 % operand2;
+							break;
+						default:
+							VERIFY(!"Invalid opcode.");
+					}
+				}
+			}
+		}
+	} catch (ScriptError& ex) {
+		ScriptBreakpoint(frame, &ex, instr->Node->GetDebugInfo());
+		throw;
+	} catch (const std::exception& ex) {
+		BOOST_THROW_EXCEPTION(ScriptError("Error while evaluating expression: " + String(ex.what()), instr->Node->GetDebugInfo())
+			<< boost::errinfo_nested_exception(boost::current_exception()));
+	}
+
+	return std::move(stack[0]);
+}
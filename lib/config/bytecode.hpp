@@ -0,0 +1,88 @@
+/* Icinga 2 | (c) 2012 Icinga GmbH | GPLv2+ */
+
+#ifndef BYTECODE_H
+#define BYTECODE_H
+
+#include "config/i2-config.hpp"
+#include "config/expression.hpp"
+#include <cstdint>
+#include <vector>
+
+namespace icinga
+{
+
+/**
+ * An expression tree compiled to instructions for a stack machine.
+ *
+ * Operators, literals, field accesses and inline blocks are executed by
+ * the dispatch loop in DoEvaluate(). All other subtrees (variables,
+ * function calls, assignments, ...) are evaluated by the tree walker.
+ * Errors carry the DebugInfo of the expression which raised them.
+ *
+ * @ingroup config
+ */
+class BytecodeExpression final : public Expression
+{
+public:
+	static Expression::Ptr Compile(const Expression::Ptr& expression);
+	static std::unique_ptr<Expression> Compile(std::unique_ptr<Expression> expression);
+
+	ExpressionResult DoEvaluate(ScriptFrame& frame, DebugHint *dhint) const override;
+	const DebugInfo& GetDebugInfo() const override;
+
+	size_t GetInstructionCount() const;
+
+private:
+	enum class Opcode : uint_least8_t
+	{
+		Push,
+		Pop,
+		Eval,
+		GetField,
+		GetFieldConst,
+		Equal,
+		EqualConst,
+		NotEqual,
+		NotEqualConst,
+		LessThan,
+		GreaterThan,
+		LessThanOrEqual,
+		GreaterThanOrEqual,
+		Add,
+		Subtract,
+		Multiply,
+		Divide,
+		Modulo,
+		LogicalNegate,
+		JumpIfFalse,
+		JumpIfTrue,
+		InPrepare,
+		In,
+		NotInPrepare,
+		NotIn
+	};
+
+	struct Instruction
+	{
+		Opcode Op;
+		size_t Arg; // constant index or jump target
+		Expression *Node; // evaluated by Eval, DebugInfo for errors
+	};
+
+	Expression::Ptr m_Expression;
+	std::vector<Instruction> m_Instructions;
+	std::vector<Value> m_Constants;
+	size_t m_StackSize{0};
+	size_t m_MaxStackSize{0};
+
+	explicit BytecodeExpression(Expression::Ptr expression);
+
+	void Emit(Opcode op, Expression *node, size_t arg = 0);
+	size_t AddConstant(const Value& value);
+	void CompileNode(Expression *node);
+	bool CompileBinary(Expression *node);
+};
+
+}
+
+#endif /* BYTECODE_H */
@@ -3,6 +3,7 @@
 
 #include "config/configcompiler.hpp"
 #include "config/expression.hpp"
+#include "base/debug.hpp"
 #include "base/exception.hpp"
 #include <utility>
 
@@ -41,7 +42,7 @@ do {							\
 
 %%
 \"				{
-	yyextra->m_LexBuffer.Clear();
+	yyextra->BeginLexText(yytext + 1);
 
 	yyextra->m_LocationBegin = *yylloc;
 
@@ -54,7 +55,7 @@ do {							\
 	yylloc->FirstLine = yyextra->m_LocationBegin.FirstLine;
 	yylloc->FirstColumn = yyextra->m_LocationBegin.FirstColumn;
 
-	yylval->text = new String(std::move(yyextra->m_LexBuffer));
+	yylval->text = yyextra->EndLexText(yytext);
 
 	return T_STRING;
 				}
@@ -74,7 +75,7 @@ do {							\
 		BOOST_THROW_EXCEPTION(ScriptError("Constant is out of bounds: " + String(yytext), *yylloc));
 	}
 
-	yyextra->m_LexBuffer += static_cast<char>(result);
+	yyextra->AppendLexChar(yytext, static_cast<char>(result));
 				}
 
 <STRING>\\[0-9]+		{
@@ -83,31 +84,26 @@ do {							\
 	 */
 	BOOST_THROW_EXCEPTION(ScriptError("Bad escape sequence found: " + String(yytext), *yylloc));
 				}
-<STRING>\\n			{ yyextra->m_LexBuffer += '\n'; }
-<STRING>\\\\			{ yyextra->m_LexBuffer += '\\'; }
-<STRING>\\\"			{ yyextra->m_LexBuffer += '"'; }
-<STRING>\\t			{ yyextra->m_LexBuffer += '\t'; }
-<STRING>\\r			{ yyextra->m_LexBuffer += '\r'; }
-<STRING>\\b			{ yyextra->m_LexBuffer += '\b'; }
-<STRING>\\f			{ yyextra->m_LexBuffer += '\f'; }
-<STRING>\\\n			{ yyextra->m_LexBuffer += yytext[1]; }
+<STRING>\\n			{ yyextra->AppendLexChar(yytext, '\n'); }
+<STRING>\\\\			{ yyextra->AppendLexChar(yytext, '\\'); }
+<STRING>\\\"			{ yyextra->AppendLexChar(yytext, '"'); }
+<STRING>\\t			{ yyextra->AppendLexChar(yytext, '\t'); }
+<STRING>\\r			{ yyextra->AppendLexChar(yytext, '\r'); }
+<STRING>\\b			{ yyextra->AppendLexChar(yytext, '\b'); }
+<STRING>\\f			{ yyextra->AppendLexChar(yytext, '\f'); }
+<STRING>\\\n			{ yyextra->AppendLexChar(yytext, yytext[1]); }
 <STRING>\\.			{
 	BOOST_THROW_EXCEPTION(ScriptError("Bad escape sequence found: " + String(yytext), *yylloc));
 				}
 
-<STRING>[^\\\n\"]+		{
-	char *yptr = yytext;
-
-	while (*yptr)
-		yyextra->m_LexBuffer += *yptr++;
-				}
+<STRING>[^\\\n\"]+		{ yyextra->AppendLexText(yytext, yyleng); }
 
 <STRING><<EOF>>			{
 	BOOST_THROW_EXCEPTION(ScriptError("End-of-file while in string literal", DebugInfoRange(yyextra->m_LocationBegin, *yylloc)));
 				}
 
 \{\{\{				{
-	yyextra->m_LexBuffer.Clear();
+	yyextra->BeginLexText(yytext + 3);
 
 	yyextra->m_LocationBegin = *yylloc;
 
@@ -124,12 +120,13 @@ do {							\
 	yylloc->FirstLine = yyextra->m_LocationBegin.FirstLine;
 	yylloc->FirstColumn = yyextra->m_LocationBegin.FirstColumn;
 
-	yylval->text = new String(std::move(yyextra->m_LexBuffer));
+	yylval->text = yyextra->EndLexText(yytext);
 
 	return T_STRING;
 				}
 
-<HEREDOC>(.|\n)			{ yyextra->m_LexBuffer += yytext[0]; }
+<HEREDOC>[^\}\n]+			{ yyextra->AppendLexText(yytext, yyleng); }
+<HEREDOC>(.|\n)			{ yyextra->AppendLexText(yytext, 1); }
 
 <INITIAL>{
 "/*"				BEGIN(C_COMMENT);
@@ -203,9 +200,9 @@ in				return T_IN;
 \|\|				return T_LOGICAL_OR;
 \{\{				return T_NULLARY_LAMBDA_BEGIN;
 \}\}				return T_NULLARY_LAMBDA_END;
-[a-zA-Z_][a-zA-Z0-9\_]*		{ yylval->text = new String(yytext); return T_IDENTIFIER; }
-@[a-zA-Z_][a-zA-Z0-9\_]*	{ yylval->text = new String(yytext + 1); return T_IDENTIFIER; }
-\<[^ \>]*\>			{ yytext[yyleng-1] = '\0'; yylval->text = new String(yytext + 1); return T_STRING_ANGLE; }
+[a-zA-Z_][a-zA-Z0-9\_]*		{ yylval->text = yyextra->MakeText(yytext, yytext + yyleng); return T_IDENTIFIER; }
+@[a-zA-Z_][a-zA-Z0-9\_]*	{ yylval->text = yyextra->MakeText(yytext + 1, yytext + yyleng); return T_IDENTIFIER; }
+\<[^ \>]*\>			{ yylval->text = yyextra->MakeText(yytext + 1, yytext + yyleng - 1); return T_STRING_ANGLE; }
 [0-9]+(\.[0-9]+)?ms		{ yylval->num = strtod(yytext, NULL) / 1000; return T_NUMBER; }
 [0-9]+(\.[0-9]+)?d		{ yylval->num = strtod(yytext, NULL) * 60 * 60 * 24; return T_NUMBER; }
 [0-9]+(\.[0-9]+)?h		{ yylval->num = strtod(yytext, NULL) * 60 * 60; return T_NUMBER; }
@@ -245,6 +242,16 @@ void ConfigCompiler::InitializeScanner()
 {
 	yylex_init(&m_Scanner);
 	yyset_extra(this, m_Scanner);
+
+	/* Scan the buffer in place instead of copying it through ReadInput(). */
+	if (m_Buffer) {
+		/* Fails unless the buffer is followed by two NUL bytes. */
+		VERIFY(yy_scan_buffer(m_Buffer, m_BufferSize + 2, m_Scanner));
+
+		/* Unlike yy_create_buffer(), yy_scan_buffer() leaves the position uninitialized. */
+		yyset_lineno(1, m_Scanner);
+		yyset_column(0, m_Scanner);
+	}
 }
 
 void ConfigCompiler::DestroyScanner()
@@ -68,7 +68,7 @@ static void MakeRBinaryOp(Expression** result, Expression *left, Expression *rig
 %lex-param { void *scanner }
 
 %union {
-	String *text;
+	icinga::CompilerText text;
 	double num;
 	bool boolean;
 	icinga::Expression *expr;
@@ -424,8 +424,7 @@ identifier_items: /* empty */
 identifier_items_inner: identifier
 	{
 		$$ = new std::vector<String>();
-		$$->emplace_back(std::move(*$1));
-		delete $1;
+		$$->emplace_back($1);
 	}
 	| identifier_items_inner ',' identifier
 	{
@@ -434,8 +433,7 @@ identifier_items_inner: identifier
 		else
 			$$ = new std::vector<String>();
 
-		$$->emplace_back(std::move(*$3));
-		delete $3;
+		$$->emplace_back($3);
 	}
 	;
 
@@ -468,8 +466,7 @@ lterm: T_LIBRARY rterm
 	}
 	| T_INCLUDE T_STRING_ANGLE
 	{
-		$$ = new IncludeExpression(Utility::DirName(context->GetPath()), MakeLiteral(std::move(*$2)), NULL, NULL, IncludeRegular, true, context->GetZone(), context->GetPackage(), @$);
-		delete $2;
+		$$ = new IncludeExpression(Utility::DirName(context->GetPath()), MakeLiteral(String($2)), NULL, NULL, IncludeRegular, true, context->GetZone(), context->GetPackage(), @$);
 	}
 	| T_INCLUDE_RECURSIVE rterm
 	{
@@ -610,9 +607,7 @@ lterm: T_LIBRARY rterm
 	{
 		EndFlowControlBlock(context);
 
-		$$ = new ForExpression(std::move(*$4), std::move(*$7), std::unique_ptr<Expression>($9), std::unique_ptr<Expression>($12), @$);
-		delete $4;
-		delete $7;
+		$$ = new ForExpression($4, $7, std::unique_ptr<Expression>($9), std::unique_ptr<Expression>($12), @$);
 	}
 	| T_FOR '(' optional_var identifier T_IN rterm ')'
 	{
@@ -622,8 +617,7 @@ lterm: T_LIBRARY rterm
 	{
 		EndFlowControlBlock(context);
 
-		$$ = new ForExpression(std::move(*$4), "", std::unique_ptr<Expression>($6), std::unique_ptr<Expression>($9), @$);
-		delete $4;
+		$$ = new ForExpression($4, "", std::unique_ptr<Expression>($6), std::unique_ptr<Expression>($9), @$);
 	}
 	| T_FUNCTION identifier '(' identifier_items ')' use_specifier
 	{
@@ -633,17 +627,17 @@ lterm: T_LIBRARY rterm
 	{
 		EndFlowControlBlock(context);
 
-		std::unique_ptr<FunctionExpression> fexpr{new FunctionExpression(*$2, std::move(*$4), std::move(*$6), std::unique_ptr<Expression>($8), @$)};
+		String name = $2;
+
+		std::unique_ptr<FunctionExpression> fexpr{new FunctionExpression(name, std::move(*$4), std::move(*$6), std::unique_ptr<Expression>($8), @$)};
 		delete $4;
 		delete $6;
 
-		$$ = new SetExpression(MakeIndexer(ScopeThis, std::move(*$2)), OpSetLiteral, std::move(fexpr), @$);
-		delete $2;
+		$$ = new SetExpression(MakeIndexer(ScopeThis, std::move(name)), OpSetLiteral, std::move(fexpr), @$);
 	}
 	| T_CONST T_IDENTIFIER T_SET rterm
 	{
-		$$ = new SetConstExpression(std::move(*$2), std::unique_ptr<Expression>($4), @$);
-		delete $2;
+		$$ = new SetConstExpression($2, std::unique_ptr<Expression>($4), @$);
 	}
 	| T_VAR rterm
 	{
@@ -840,8 +834,7 @@ rterm_side_effect: rterm '(' rterm_items ')'
 
 rterm_no_side_effect_no_dict: T_STRING
 	{
-		$$ = MakeLiteralRaw(std::move(*$1));
-		delete $1;
+		$$ = MakeLiteralRaw(String($1));
 	}
 	| T_NUMBER
 	{
@@ -857,8 +850,7 @@ rterm_no_side_effect_no_dict: T_STRING
 	}
 	| rterm '.' T_IDENTIFIER %dprec 2
 	{
-		$$ = new IndexerExpression(std::unique_ptr<Expression>($1), MakeLiteral(std::move(*$3)), @$);
-		delete $3;
+		$$ = new IndexerExpression(std::unique_ptr<Expression>($1), MakeLiteral(String($3)), @$);
 	}
 	| rterm '[' rterm ']'
 	{
@@ -866,8 +858,7 @@ rterm_no_side_effect_no_dict: T_STRING
 	}
 	| T_IDENTIFIER
 	{
-		$$ = new VariableExpression(std::move(*$1), context->GetImports(), @1);
-		delete $1;
+		$$ = new VariableExpression($1, context->GetImports(), @1);
 	}
 	| T_MULTIPLY rterm %prec DEREF_OP
 	{
@@ -922,8 +913,7 @@ rterm_no_side_effect_no_dict: T_STRING
 		EndFlowControlBlock(context);
 
 		std::vector<String> args;
-		args.emplace_back(std::move(*$1));
-		delete $1;
+		args.emplace_back($1);
 
 		$$ = new FunctionExpression("<anonymous>", std::move(args), {}, std::unique_ptr<Expression>($4), @$);
 	}
@@ -932,8 +922,7 @@ rterm_no_side_effect_no_dict: T_STRING
 		ASSERT(!dynamic_cast<DictExpression *>($3));
 
 		std::vector<String> args;
-		args.emplace_back(std::move(*$1));
-		delete $1;
+		args.emplace_back($1);
 
 		$$ = new FunctionExpression("<anonymous>", std::move(args), {}, std::unique_ptr<Expression>($3), @$);
 	}
@@ -1040,7 +1029,7 @@ rterm:
 
 target_type_specifier: /* empty */
 	{
-		$$ = new String();
+		$$ = CompilerText();
 	}
 	| T_TO identifier
 	{
@@ -1094,33 +1083,27 @@ use_specifier_items: use_specifier_item
 
 use_specifier_item: identifier
 	{
-		std::unique_ptr<Expression> var (new VariableExpression(*$1, context->GetImports(), @1));
-		$$ = new std::pair<String, std::unique_ptr<Expression> >(std::move(*$1), std::move(var));
-		delete $1;
+		String name = $1;
+		std::unique_ptr<Expression> var (new VariableExpression(name, context->GetImports(), @1));
+		$$ = new std::pair<String, std::unique_ptr<Expression> >(std::move(name), std::move(var));
 	}
 	| identifier T_SET rterm
 	{
-		$$ = new std::pair<String, std::unique_ptr<Expression> >(std::move(*$1), std::unique_ptr<Expression>($3));
-		delete $1;
+		$$ = new std::pair<String, std::unique_ptr<Expression> >($1, std::unique_ptr<Expression>($3));
 	}
 	;
 
 apply_for_specifier: /* empty */
 	| T_FOR '(' optional_var identifier T_FOLLOWS optional_var identifier T_IN rterm ')'
 	{
-		context->m_FKVar.top() = std::move(*$4);
-		delete $4;
-
-		context->m_FVVar.top() = std::move(*$7);
-		delete $7;
+		context->m_FKVar.top() = $4;
+		context->m_FVVar.top() = $7;
 
 		context->m_FTerm.top() = $9;
 	}
 	| T_FOR '(' optional_var identifier T_IN rterm ')'
 	{
-		context->m_FKVar.top() = std::move(*$4);
-		delete $4;
-
+		context->m_FKVar.top() = $4;
 		context->m_FVVar.top() = "";
 
 		context->m_FTerm.top() = $6;
@@ -1155,10 +1138,8 @@ apply:
 
 		context->m_Apply.pop();
 
-		String type = std::move(*$3);
-		delete $3;
-		String target = std::move(*$6);
-		delete $6;
+		String type = $3;
+		String target = $6;
 
 		if (!ApplyRule::IsValidSourceType(type))
 			BOOST_THROW_EXCEPTION(ScriptError("'apply' cannot be used with type '" + type + "'", @3));
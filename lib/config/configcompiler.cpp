@@ -2,18 +2,233 @@
 
 #include "config/configcompiler.hpp"
 #include "config/configitem.hpp"
+#include "config/configprofiler.hpp"
+#include "config/optimizer.hpp"
 #include "base/logger.hpp"
 #include "base/utility.hpp"
 #include "base/loader.hpp"
 #include "base/context.hpp"
 #include "base/exception.hpp"
+#include "base/configuration.hpp"
+#include "base/defer.hpp"
+#include "base/workqueue.hpp"
+#include <condition_variable>
+#include <cstring>
 #include <fstream>
+#include <mutex>
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <signal.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif /* _WIN32 */
 
 using namespace icinga;
 
 std::vector<String> ConfigCompiler::m_IncludeSearchDirs;
 std::mutex ConfigCompiler::m_ZoneDirsMutex;
 std::map<String, std::vector<ZoneFragment> > ConfigCompiler::m_ZoneDirs;
+std::mutex ConfigCompiler::m_StatsMutex;
+size_t ConfigCompiler::m_CompiledFiles = 0;
+double ConfigCompiler::m_CompileTime = 0;
+
+static std::mutex l_PathRecordersMutex;
+static std::set<ConfigPathRecorder *> l_PathRecorders;
+
+/* Only the outermost compilation of a thread is timed, the nested ones are part of it. */
+static thread_local unsigned int l_CompileDepth = 0;
+
+/**
+ * The work queue which compiles the files of all includes. Its threads are
+ * started on first use, i.e. after a daemonizing fork().
+ */
+static WorkQueue& GetCompileQueue()
+{
+	static WorkQueue *queue = []() {
+		auto *queue = new WorkQueue(25000, Configuration::Concurrency, LogNotice);
+		queue->SetName("ConfigCompiler::CollectIncludes");
+		return queue;
+	}();
+
+	return *queue;
+}
+
+#ifndef _WIN32
+class MappedConfigFile;
+
+/* The config files mapped by the current thread, the latest one first. */
+static thread_local MappedConfigFile *l_MappedConfigFiles = nullptr;
+
+static std::once_flag l_SigBusHandlerOnce;
+static struct sigaction l_PreviousSigBusAction;
+static size_t l_PageSize = 0;
+
+/**
+ * A private, writable mapping of a config file which is followed by the
+ * two NUL bytes the lexer expects at the end of an in-place buffer.
+ *
+ * Reading a page which was cut off by truncating the file raises SIGBUS.
+ * While the mapping exists, such pages are replaced with zeroed ones, so the
+ * lexer sees the end of its input there, and the mapping is marked as truncated.
+ */
+class MappedConfigFile
+{
+public:
+	MappedConfigFile(const MappedConfigFile&) = delete;
+	MappedConfigFile& operator=(const MappedConfigFile&) = delete;
+
+	explicit MappedConfigFile(const String& path)
+		: m_Previous(l_MappedConfigFiles)
+	{
+		std::call_once(l_SigBusHandlerOnce, []() {
+			l_PageSize = static_cast<size_t>(sysconf(_SC_PAGESIZE));
+
+			struct sigaction sa;
+			memset(&sa, 0, sizeof(sa));
+			sa.sa_sigaction = &MappedConfigFile::HandleSigBus;
+			sa.sa_flags = SA_SIGINFO;
+			sigemptyset(&sa.sa_mask);
+
+			(void)sigaction(SIGBUS, &sa, &l_PreviousSigBusAction);
+		});
+
+		l_MappedConfigFiles = this;
+
+		int fd = open(path.CStr(), O_RDONLY | O_CLOEXEC);
+
+		if (fd < 0)
+			return;
+
+		struct stat statbuf;
+
+		if (fstat(fd, &statbuf) < 0 || !S_ISREG(statbuf.st_mode) || statbuf.st_size == 0) {
+			(void)close(fd);
+			return;
+		}
+
+		auto size (static_cast<size_t>(statbuf.st_size));
+		size_t length = (size + 2 + l_PageSize - 1) / l_PageSize * l_PageSize;
+
+		/* Reserve zeroed pages for the file and its terminator, then map the file over them. */
+		void *base = mmap(nullptr, length, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+
+		if (base != MAP_FAILED && mmap(base, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_FIXED, fd, 0) == MAP_FAILED) {
+			(void)munmap(base, length);
+			base = MAP_FAILED;
+		}
+
+		(void)close(fd);
+
+		if (base == MAP_FAILED)
+			return;
+
+		m_Data = static_cast<char *>(base);
+		m_Size = size;
+		m_Length = length;
+
+		/* The rest of the file's last page reads as zeros only until the file grows. */
+		m_Data[size] = '\0';
+		m_Data[size + 1] = '\0';
+	}
+
+	~MappedConfigFile()
+	{
+		l_MappedConfigFiles = m_Previous;
+
+		if (m_Data)
+			(void)munmap(m_Data, m_Length);
+	}
+
+	char *GetData() const
+	{
+		return m_Data;
+	}
+
+	size_t GetSize() const
+	{
+		return m_Size;
+	}
+
+	bool IsTruncated() const
+	{
+		return m_Truncated;
+	}
+
+private:
+	char *m_Data{nullptr};
+	size_t m_Size{0};
+	size_t m_Length{0};
+	volatile sig_atomic_t m_Truncated{0};
+	MappedConfigFile *m_Previous;
+
+	static void HandleSigBus(int, siginfo_t *info, void *)
+	{
+		auto *addr (static_cast<char *>(info->si_addr));
+
+		for (MappedConfigFile *file = l_MappedConfigFiles; file; file = file->m_Previous) {
+			if (!file->m_Data || addr < file->m_Data || addr >= file->m_Data + file->m_Length)
+				continue;
+
+			char *page = file->m_Data + (addr - file->m_Data) / l_PageSize * l_PageSize;
+
+			if (mmap(page, l_PageSize, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_FIXED, -1, 0) != MAP_FAILED) {
+				file->m_Truncated = 1;
+				return;
+			}
+
+			break;
+		}
+
+		/* Not a truncated config file, the faulting access is repeated without this handler. */
+		(void)sigaction(SIGBUS, &l_PreviousSigBusAction, nullptr);
+	}
+};
+#endif /* _WIN32 */
+
+/**
+ * Reads a config file which can't be mapped into a buffer which is followed
+ * by the two NUL bytes the lexer expects at the end of an in-place buffer.
+ *
+ * @param stream The file.
+ * @param path The file's path.
+ * @param size Receives the size of the file's content.
+ * @returns The buffer.
+ */
+static std::vector<char> ReadConfigFile(std::istream& stream, const String& path, size_t& size)
+{
+	/* Start with the file's current size plus one byte, so its end is seen by the first read. */
+	stream.seekg(0, std::ios::end);
+	std::streamoff hint = stream.tellg();
+	stream.clear();
+	stream.seekg(0, std::ios::beg);
+	stream.clear();
+
+	std::vector<char> buffer (static_cast<size_t>(std::max<std::streamoff>(hint, 0)) + 3);
+	size = 0;
+
+	for (;;) {
+		stream.read(buffer.data() + size, buffer.size() - 2 - size);
+		size += static_cast<size_t>(stream.gcount());
+
+		if (!stream)
+			break;
+
+		buffer.resize(buffer.size() * 2);
+	}
+
+	if (stream.bad())
+		BOOST_THROW_EXCEPTION(posix_error()
+			<< boost::errinfo_api_function("std::ifstream::read")
+			<< boost::errinfo_errno(errno)
+			<< boost::errinfo_file_name(path));
+
+	buffer[size] = '\0';
+	buffer[size + 1] = '\0';
+
+	return buffer;
+}
 
 /**
  * Constructor for the ConfigCompiler class.
@@ -31,6 +246,23 @@ ConfigCompiler::ConfigCompiler(String path, std::istream *input,
 	InitializeScanner();
 }
 
+/**
+ * Constructor for the ConfigCompiler class which scans a buffer in place.
+ *
+ * @param path The path of the configuration file (or another name that
+ *        identifies the source of the configuration text).
+ * @param buffer The configuration text, followed by two NUL bytes. The lexer modifies it.
+ * @param size The size of the configuration text.
+ * @param zone The zone.
+ */
+ConfigCompiler::ConfigCompiler(String path, char *buffer, size_t size,
+	String zone, String package)
+	: m_Path(std::move(path)), m_Input(nullptr), m_Buffer(buffer), m_BufferSize(size),
+	m_Zone(std::move(zone)), m_Package(std::move(package)), m_Eof(false), m_OpenBraces(0)
+{
+	InitializeScanner();
+}
+
 /**
  * Destructor for the ConfigCompiler class.
  */
@@ -104,6 +336,158 @@ void ConfigCompiler::CollectIncludes(std::vector<std::unique_ptr<Expression> >&
 	}
 }
 
+/**
+ * Compiles the files of an include concurrently. The resulting expressions
+ * are appended in the order of the files, regardless of which one finishes first,
+ * and so are the messages logged while compiling them.
+ *
+ * @param expressions Where to store the expressions.
+ * @param files The files and the zones they belong to.
+ * @param package The package.
+ */
+void ConfigCompiler::CollectIncludes(std::vector<std::unique_ptr<Expression> >& expressions,
+	const std::vector<IncludedFile>& files, const String& package)
+{
+	WorkQueue& upq = GetCompileQueue();
+
+	/* The compile threads must not wait for each other. */
+	if (files.size() < 2 || upq.IsWorkerThread()) {
+		for (const IncludedFile& file : files)
+			CollectIncludes(expressions, file.Path, file.Zone, package);
+
+		return;
+	}
+
+	double start = Utility::GetTime();
+	bool outermost = l_CompileDepth++ == 0;
+	Defer timed ([start, outermost]() {
+		l_CompileDepth--;
+
+		if (outermost)
+			AddCompileTime(Utility::GetTime() - start);
+	});
+
+	std::vector<std::vector<std::unique_ptr<Expression> > > results (files.size());
+	std::vector<std::vector<LogEntry> > logs (files.size());
+
+	std::mutex mutex;
+	std::condition_variable cv;
+	size_t pending = files.size();
+
+	for (size_t i = 0; i < files.size(); i++) {
+		upq.Enqueue([&files, &results, &logs, &package, &mutex, &cv, &pending, i]() {
+			Defer done ([&mutex, &cv, &pending]() {
+				std::unique_lock<std::mutex> lock(mutex);
+
+				if (--pending == 0)
+					cv.notify_all();
+			});
+
+			l_CompileDepth++;
+			Defer depth ([]() { l_CompileDepth--; });
+
+			LogRecorder recorder (LogDebug, LogHoldBackCurrentThread);
+			CollectIncludes(results[i], files[i].Path, files[i].Zone, package);
+			logs[i] = recorder.TakeEntries();
+		});
+	}
+
+	{
+		std::unique_lock<std::mutex> lock(mutex);
+		cv.wait(lock, [&pending]() { return pending == 0; });
+	}
+
+	for (size_t i = 0; i < files.size(); i++) {
+		for (const LogEntry& entry : logs[i])
+			Log::Write(entry);
+
+		for (auto& expression : results[i])
+			expressions.emplace_back(std::move(expression));
+	}
+}
+
+/**
+ * Returns the text of a token. When scanning a buffer in place, the text is
+ * referenced there until the parser needs it. Otherwise the lexer reuses its
+ * buffer for the following input, so the text is copied.
+ *
+ * @param begin The start of the text in the lexer's buffer.
+ * @param end The end of the text.
+ * @returns The text.
+ */
+CompilerText ConfigCompiler::MakeText(const char *begin, const char *end)
+{
+	if (!m_Buffer) {
+		m_Texts.emplace_back(begin, end);
+
+		const String& text = m_Texts.back();
+		begin = text.CStr();
+		end = begin + text.GetLength();
+	}
+
+	return CompilerText{begin, end};
+}
+
+/**
+ * Starts a string literal. It's referenced in place like other tokens until
+ * an escape sequence makes it differ from its source.
+ *
+ * @param begin The start of the literal in the lexer's buffer.
+ */
+void ConfigCompiler::BeginLexText(const char *begin)
+{
+	m_LexBuffer.Clear();
+	m_LexBegin = begin;
+	m_LexCopy = !m_Buffer;
+}
+
+/**
+ * Appends a part of the source to the current string literal.
+ *
+ * @param text The part in the lexer's buffer.
+ * @param length Its length.
+ */
+void ConfigCompiler::AppendLexText(const char *text, size_t length)
+{
+	if (m_LexCopy)
+		m_LexBuffer.GetData().append(text, length);
+}
+
+/**
+ * Appends a character which differs from its source, e.g. for an escape sequence,
+ * to the current string literal. The literal is copied from now on.
+ *
+ * @param pos The start of the character's source in the lexer's buffer.
+ * @param ch The character.
+ */
+void ConfigCompiler::AppendLexChar(const char *pos, char ch)
+{
+	if (!m_LexCopy) {
+		m_LexBuffer = String(m_LexBegin, pos);
+		m_LexCopy = true;
+	}
+
+	m_LexBuffer += ch;
+}
+
+/**
+ * Finishes the current string literal.
+ *
+ * @param end The end of the literal in the lexer's buffer.
+ * @returns The literal's text.
+ */
+CompilerText ConfigCompiler::EndLexText(const char *end)
+{
+	if (!m_LexCopy)
+		return CompilerText{m_LexBegin, end};
+
+	m_Texts.emplace_back(std::move(m_LexBuffer));
+	m_LexBuffer.Clear();
+
+	const String& text = m_Texts.back();
+	return CompilerText{text.CStr(), text.CStr() + text.GetLength()};
+}
+
 /**
  * Handles an include directive.
  *
@@ -135,8 +519,8 @@ std::unique_ptr<Expression> ConfigCompiler::HandleInclude(const String& relative
 		}
 	}
 
-	std::vector<std::unique_ptr<Expression> > expressions;
-	auto funcCallback = [&expressions, zone, package](const String& file) { CollectIncludes(expressions, file, zone, package); };
+	std::vector<IncludedFile> files;
+	auto funcCallback = [&files, zone](const String& file) { files.push_back({ file, zone }); };
 
 	if (!Utility::Glob(includePath, funcCallback, GlobFile) && includePath.FindFirstOf("*?") == String::NPos) {
 		std::ostringstream msgbuf;
@@ -144,6 +528,9 @@ std::unique_ptr<Expression> ConfigCompiler::HandleInclude(const String& relative
 		BOOST_THROW_EXCEPTION(ScriptError(msgbuf.str(), debuginfo));
 	}
 
+	std::vector<std::unique_ptr<Expression> > expressions;
+	CollectIncludes(expressions, files, package);
+
 	std::unique_ptr<DictExpression> expr{new DictExpression(std::move(expressions))};
 	expr->MakeInline();
 	return std::move(expr);
@@ -167,17 +554,20 @@ std::unique_ptr<Expression> ConfigCompiler::HandleIncludeRecursive(const String&
 	else
 		ppath = relativeBase + "/" + path;
 
-	std::vector<std::unique_ptr<Expression> > expressions;
-	Utility::GlobRecursive(ppath, pattern, [&expressions, zone, package](const String& file) {
-		CollectIncludes(expressions, file, zone, package);
+	std::vector<IncludedFile> files;
+	Utility::GlobRecursive(ppath, pattern, [&files, zone](const String& file) {
+		files.push_back({ file, zone });
 	}, GlobFile);
 
+	std::vector<std::unique_ptr<Expression> > expressions;
+	CollectIncludes(expressions, files, package);
+
 	std::unique_ptr<DictExpression> dict{new DictExpression(std::move(expressions))};
 	dict->MakeInline();
 	return std::move(dict);
 }
 
-void ConfigCompiler::HandleIncludeZone(const String& relativeBase, const String& tag, const String& path, const String& pattern, const String& package, std::vector<std::unique_ptr<Expression> >& expressions)
+void ConfigCompiler::HandleIncludeZone(const String& relativeBase, const String& tag, const String& path, const String& pattern, std::vector<IncludedFile>& files)
 {
 	String zoneName = Utility::BaseName(path);
 
@@ -190,8 +580,8 @@ void ConfigCompiler::HandleIncludeZone(const String& relativeBase, const String&
 
 	RegisterZoneDir(tag, ppath, zoneName);
 
-	Utility::GlobRecursive(ppath, pattern, [&expressions, zoneName, package](const String& file) {
-		CollectIncludes(expressions, file, zoneName, package);
+	Utility::GlobRecursive(ppath, pattern, [&files, zoneName](const String& file) {
+		files.push_back({ file, zoneName });
 	}, GlobFile);
 }
 
@@ -217,11 +607,14 @@ std::unique_ptr<Expression> ConfigCompiler::HandleIncludeZones(const String& rel
 		newRelativeBase = ".";
 	}
 
-	std::vector<std::unique_ptr<Expression> > expressions;
-	Utility::Glob(ppath + "/*", [newRelativeBase, tag, pattern, package, &expressions](const String& path) {
-		HandleIncludeZone(newRelativeBase, tag, path, pattern, package, expressions);
+	std::vector<IncludedFile> files;
+	Utility::Glob(ppath + "/*", [newRelativeBase, tag, pattern, &files](const String& path) {
+		HandleIncludeZone(newRelativeBase, tag, path, pattern, files);
 	}, GlobDirectory);
 
+	std::vector<std::unique_ptr<Expression> > expressions;
+	CollectIncludes(expressions, files, package);
+
 	return std::unique_ptr<Expression>(new DictExpression(std::move(expressions)));
 }
 
@@ -250,6 +643,30 @@ std::unique_ptr<Expression> ConfigCompiler::CompileStream(const String& path,
 	}
 }
 
+/**
+ * Compiles a buffer in place, without copying it into the lexer.
+ *
+ * @param path A name identifying the buffer.
+ * @param buffer The configuration text, followed by two NUL bytes. The lexer modifies it.
+ * @param size The size of the configuration text.
+ * @returns Configuration items.
+ */
+std::unique_ptr<Expression> ConfigCompiler::CompileBuffer(const String& path,
+	char *buffer, size_t size, const String& zone, const String& package)
+{
+	CONTEXT("Compiling configuration buffer with name '" + path + "'");
+
+	ConfigCompiler ctx(path, buffer, size, zone, package);
+
+	try {
+		return ctx.Compile();
+	} catch (const ScriptError& ex) {
+		return std::unique_ptr<Expression>(new ThrowExpression(MakeLiteral(ex.what()), ex.IsIncompleteExpression(), ex.GetDebugInfo()));
+	} catch (const std::exception& ex) {
+		return std::unique_ptr<Expression>(new ThrowExpression(MakeLiteral(DiagnosticInformation(ex)), false));
+	}
+}
+
 /**
  * Compiles a file.
  *
@@ -261,18 +678,81 @@ std::unique_ptr<Expression> ConfigCompiler::CompileFile(const String& path, cons
 {
 	CONTEXT("Compiling configuration file '" + path + "'");
 
-	std::ifstream stream(path.CStr(), std::ifstream::in);
+#ifndef _WIN32
+	MappedConfigFile mapping (path);
+#endif /* _WIN32 */
 
-	if (!stream)
-		BOOST_THROW_EXCEPTION(posix_error()
-			<< boost::errinfo_api_function("std::ifstream::open")
-			<< boost::errinfo_errno(errno)
-			<< boost::errinfo_file_name(path));
+	std::ifstream stream;
+
+#ifndef _WIN32
+	/* Empty files and files which can't be mapped are read into a buffer. */
+	if (!mapping.GetData())
+#endif /* _WIN32 */
+	{
+		stream.open(path.CStr(), std::ifstream::in);
+
+		if (!stream)
+			BOOST_THROW_EXCEPTION(posix_error()
+				<< boost::errinfo_api_function("std::ifstream::open")
+				<< boost::errinfo_errno(errno)
+				<< boost::errinfo_file_name(path));
+	}
 
 	Log(LogNotice, "ConfigCompiler")
 		<< "Compiling config file: " << path;
 
-	return CompileStream(path, &stream, zone, package);
+	{
+		std::unique_lock<std::mutex> lock(m_StatsMutex);
+		m_CompiledFiles++;
+	}
+
+	{
+		std::unique_lock<std::mutex> lock(l_PathRecordersMutex);
+
+		for (ConfigPathRecorder *recorder : l_PathRecorders)
+			recorder->m_Paths.insert(path);
+	}
+
+	double start = Utility::GetTime();
+	bool outermost = l_CompileDepth++ == 0;
+	Defer timed ([start, outermost]() {
+		l_CompileDepth--;
+
+		if (outermost)
+			AddCompileTime(Utility::GetTime() - start);
+	});
+
+	ConfigProfiler::Frame pframe ([&path]() { return "parse " + path; });
+
+	std::unique_ptr<Expression> expr;
+
+#ifndef _WIN32
+	if (mapping.GetData()) {
+		expr = CompileBuffer(path, mapping.GetData(), mapping.GetSize(), zone, package);
+
+		if (mapping.IsTruncated())
+			BOOST_THROW_EXCEPTION(std::runtime_error("Config file '" + path + "' was truncated while it was compiled."));
+	} else
+#endif /* _WIN32 */
+	{
+		size_t size;
+		std::vector<char> buffer = ReadConfigFile(stream, path, size);
+		stream.close();
+
+		expr = CompileBuffer(path, buffer.data(), size, zone, package);
+	}
+
+	size_t rewrites = ExpressionOptimizer::Optimize(expr, true);
+
+	if (rewrites > 0) {
+		Log(LogDebug, "ConfigCompiler")
+			<< "Optimizer applied " << rewrites << " rewrites to config file: " << path;
+	}
+
+	if (ConfigProfiler::IsEnabled())
+		expr.reset(new ProfiledExpression("eval " + path, Expression::Ptr(expr.release())));
+
+	return expr;
 }
 
 /**
@@ -285,8 +765,16 @@ std::unique_ptr<Expression> ConfigCompiler::CompileFile(const String& path, cons
 std::unique_ptr<Expression> ConfigCompiler::CompileText(const String& path, const String& text,
 	const String& zone, const String& package)
 {
-	std::stringstream stream(text);
-	return CompileStream(path, &stream, zone, package);
+	/* Scan a copy of the text in place, so its tokens needn't be copied once more. */
+	std::vector<char> buffer (text.Begin(), text.End());
+	buffer.resize(buffer.size() + 2, '\0');
+
+	std::unique_ptr<Expression> expr = CompileBuffer(path, buffer.data(), text.GetLength(), zone, package);
+
+	/* The text may refer to locals which are provided by the caller. */
+	ExpressionOptimizer::Optimize(expr, false);
+
+	return expr;
 }
 
 /**
@@ -362,3 +850,54 @@ std::vector<Expression::Ptr> ConfigCompiler::GetImports() const
 {
 	return m_Imports;
 }
+
+void ConfigCompiler::AddCompileTime(double time)
+{
+	std::unique_lock<std::mutex> lock(m_StatsMutex);
+
+	m_CompileTime += time;
+}
+
+/**
+ * @returns The number of config files compiled so far.
+ */
+size_t ConfigCompiler::GetCompiledFiles()
+{
+	std::unique_lock<std::mutex> lock(m_StatsMutex);
+
+	return m_CompiledFiles;
+}
+
+/**
+ * @returns The wall-clock time spent compiling config files so far, in seconds.
+ */
+double ConfigCompiler::GetCompileTime()
+{
+	std::unique_lock<std::mutex> lock(m_StatsMutex);
+
+	return m_CompileTime;
+}
+
+ConfigPathRecorder::ConfigPathRecorder()
+{
+	std::unique_lock<std::mutex> lock(l_PathRecordersMutex);
+
+	l_PathRecorders.insert(this);
+}
+
+ConfigPathRecorder::~ConfigPathRecorder()
+{
+	std::unique_lock<std::mutex> lock(l_PathRecordersMutex);
+
+	l_PathRecorders.erase(this);
+}
+
+/**
+ * @returns The paths of the config files compiled so far.
+ */
+std::set<String> ConfigPathRecorder::GetPaths() const
+{
+	std::unique_lock<std::mutex> lock(l_PathRecordersMutex);
+
+	return m_Paths;
+}
@@ -10,8 +10,10 @@
 #include "base/initialize.hpp"
 #include "base/singleton.hpp"
 #include "base/string.hpp"
+#include <deque>
 #include <future>
 #include <iostream>
+#include <set>
 #include <stack>
 
 typedef union YYSTYPE YYSTYPE;
@@ -42,6 +44,23 @@ struct CompilerDebugInfo
 	}
 };
 
+/**
+ * The text of a token. It's referenced where the lexer found it until the
+ * parser needs it as a String, see ConfigCompiler::MakeText().
+ *
+ * @ingroup config
+ */
+struct CompilerText
+{
+	const char *Begin;
+	const char *End;
+
+	operator String() const
+	{
+		return String(Begin, End);
+	}
+};
+
 struct EItemInfo
 {
 	bool SideEffect;
@@ -61,6 +80,40 @@ struct ZoneFragment
 	String Path;
 };
 
+/**
+ * A file to be compiled as part of an include and the zone it belongs to.
+ *
+ * @ingroup config
+ */
+struct IncludedFile
+{
+	String Path;
+	String Zone;
+};
+
+/**
+ * Records the paths of all config files compiled while it exists,
+ * e.g. to hash them after validating the configuration.
+ *
+ * @ingroup config
+ */
+class ConfigPathRecorder
+{
+public:
+	ConfigPathRecorder();
+	~ConfigPathRecorder();
+
+	ConfigPathRecorder(const ConfigPathRecorder&) = delete;
+	ConfigPathRecorder& operator=(const ConfigPathRecorder&) = delete;
+
+	std::set<String> GetPaths() const;
+
+private:
+	std::set<String> m_Paths;
+
+	friend class ConfigCompiler;
+};
+
 /**
  * The configuration compiler can be used to compile a configuration file
  * into a number of configuration items.
@@ -72,12 +125,16 @@ class ConfigCompiler
 public:
 	explicit ConfigCompiler(String path, std::istream *input,
 		String zone = String(), String package = String());
+	ConfigCompiler(String path, char *buffer, size_t size,
+		String zone = String(), String package = String());
 	virtual ~ConfigCompiler();
 
 	std::unique_ptr<Expression> Compile();
 
 	static std::unique_ptr<Expression>CompileStream(const String& path, std::istream *stream,
 		const String& zone = String(), const String& package = String());
+	static std::unique_ptr<Expression>CompileBuffer(const String& path, char *buffer, size_t size,
+		const String& zone = String(), const String& package = String());
 	static std::unique_ptr<Expression>CompileFile(const String& path, const String& zone = String(),
 		const String& package = String());
 	static std::unique_ptr<Expression>CompileText(const String& path, const String& text,
@@ -98,6 +155,8 @@ public:
 
 	static void CollectIncludes(std::vector<std::unique_ptr<Expression> >& expressions,
 		const String& file, const String& zone, const String& package);
+	static void CollectIncludes(std::vector<std::unique_ptr<Expression> >& expressions,
+		const std::vector<IncludedFile>& files, const String& package);
 
 	static std::unique_ptr<Expression> HandleInclude(const String& relativeBase, const String& path, bool search,
 		const String& zone, const String& package, const DebugInfo& debuginfo = DebugInfo());
@@ -109,30 +168,53 @@ public:
 	size_t ReadInput(char *buffer, size_t max_bytes);
 	void *GetScanner() const;
 
+	CompilerText MakeText(const char *begin, const char *end);
+
+	void BeginLexText(const char *begin);
+	void AppendLexText(const char *text, size_t length);
+	void AppendLexChar(const char *pos, char ch);
+	CompilerText EndLexText(const char *end);
+
 	static std::vector<ZoneFragment> GetZoneDirs(const String& zone);
 	static void RegisterZoneDir(const String& tag, const String& ppath, const String& zoneName);
 
 	static bool HasZoneConfigAuthority(const String& zoneName);
 
+	static size_t GetCompiledFiles();
+	static double GetCompileTime();
+
 private:
 	std::promise<Expression::Ptr> m_Promise;
 
 	String m_Path;
 	std::istream *m_Input;
+	char *m_Buffer{nullptr};
+	size_t m_BufferSize{0};
 	String m_Zone;
 	String m_Package;
 	std::vector<Expression::Ptr> m_Imports;
 
 	void *m_Scanner;
 
+	/* The texts copied from the lexer's buffer, see MakeText(). */
+	std::deque<String> m_Texts;
+	const char *m_LexBegin{nullptr};
+	bool m_LexCopy{false};
+
 	static std::vector<String> m_IncludeSearchDirs;
 	static std::mutex m_ZoneDirsMutex;
 	static std::map<String, std::vector<ZoneFragment> > m_ZoneDirs;
 
+	static std::mutex m_StatsMutex;
+	static size_t m_CompiledFiles;
+	static double m_CompileTime;
+
 	void InitializeScanner();
 	void DestroyScanner();
 
-	static void HandleIncludeZone(const String& relativeBase, const String& tag, const String& path, const String& pattern, const String& package, std::vector<std::unique_ptr<Expression> >& expressions);
+	static void HandleIncludeZone(const String& relativeBase, const String& tag, const String& path, const String& pattern, std::vector<IncludedFile>& files);
+
+	static void AddCompileTime(double time);
 
 	static bool IsAbsolutePath(const String& path);
 
@@ -5,6 +5,7 @@
 #include "config/applyrule.hpp"
 #include "config/objectrule.hpp"
 #include "config/configcompiler.hpp"
+#include "config/configprofiler.hpp"
 #include "base/application.hpp"
 #include "base/configtype.hpp"
 #include "base/objectlock.hpp"
@@ -112,6 +113,7 @@ DebugInfo ConfigItem::GetDebugInfo() const
 
 Dictionary::Ptr ConfigItem::GetScope() const
 {
+	std::unique_lock<std::mutex> lock(m_ExpressionMutex);
 	return m_Scope;
 }
 
@@ -127,9 +129,19 @@ ConfigObject::Ptr ConfigItem::GetObject() const
  */
 Expression::Ptr ConfigItem::GetExpression() const
 {
+	std::unique_lock<std::mutex> lock(m_ExpressionMutex);
 	return m_Expression;
 }
 
+/**
+ * Marks a non-abstract item as imported by another one, so that its
+ * expression isn't released after activation.
+ */
+void ConfigItem::SetImported()
+{
+	m_Imported.store(true);
+}
+
 /**
 * Retrieves the object filter for the configuration item.
 *
@@ -176,6 +188,10 @@ ConfigObject::Ptr ConfigItem::Commit(bool discard)
 	if (IsAbstract())
 		return nullptr;
 
+	ConfigProfiler::Frame pframe ([this]() {
+		return m_DebugInfo.Path.IsEmpty() ? "commit object " + m_Type->GetName() : "commit " + m_DebugInfo.Path;
+	});
+
 	ConfigObject::Ptr dobj = static_pointer_cast<ConfigObject>(type->Instantiate(std::vector<Value>()));
 
 	dobj->SetDebugInfo(m_DebugInfo);
@@ -186,10 +202,11 @@ ConfigObject::Ptr ConfigItem::Commit(bool discard)
 	DebugHint debugHints;
 
 	ScriptFrame frame(true, dobj);
-	if (m_Scope)
-		m_Scope->CopyTo(frame.Locals);
+	Dictionary::Ptr scope = GetScope();
+	if (scope)
+		scope->CopyTo(frame.Locals);
 	try {
-		m_Expression->Evaluate(frame, &debugHints);
+		GetExpression()->Evaluate(frame, &debugHints);
 	} catch (const std::exception& ex) {
 		if (m_IgnoreOnError) {
 			Log(LogNotice, "ConfigObject")
@@ -206,8 +223,10 @@ ConfigObject::Ptr ConfigItem::Commit(bool discard)
 		throw;
 	}
 
-	if (discard)
+	if (discard) {
+		std::unique_lock<std::mutex> lock(m_ExpressionMutex);
 		m_Expression.reset();
+	}
 
 	String item_name;
 	String short_name = dobj->GetShortName();
@@ -356,8 +375,14 @@ void ConfigItem::Unregister()
 
 	std::unique_lock<std::mutex> lock(m_Mutex);
 	m_UnnamedItems.erase(std::remove(m_UnnamedItems.begin(), m_UnnamedItems.end(), this), m_UnnamedItems.end());
-	m_Items[m_Type].erase(m_Name);
-	m_DefaultTemplates[m_Type].erase(m_Name);
+
+	/* Unnamed items aren't in the maps, but another item with their short name may be. */
+	for (auto *items : { &m_Items[m_Type], &m_DefaultTemplates[m_Type] }) {
+		auto it (items->find(m_Name));
+
+		if (it != items->end() && it->second == this)
+			items->erase(it);
+	}
 }
 
 /**
@@ -608,7 +633,27 @@ bool ConfigItem::CommitItems(const ActivationContext::Ptr& context, WorkQueue& u
 	if (!CommitNewItems(context, upq, newItems)) {
 		upq.ReportExceptions("config");
 
-		for (const ConfigItem::Ptr& item : newItems) {
+		/* Besides the committed items, remove the ones which failed or weren't committed yet,
+		 * e.g. the ones generated by apply rules, so the objects can be created again later. */
+		std::vector<ConfigItem::Ptr> items (newItems);
+
+		{
+			std::unique_lock<std::mutex> lock(m_Mutex);
+
+			for (const TypeMap::value_type& kv : m_Items) {
+				for (const ItemMap::value_type& kv2 : kv.second) {
+					if (kv2.second->m_ActivationContext == context)
+						items.push_back(kv2.second);
+				}
+			}
+
+			for (const ConfigItem::Ptr& item : m_UnnamedItems) {
+				if (item->m_ActivationContext == context)
+					items.push_back(item);
+			}
+		}
+
+		for (const ConfigItem::Ptr& item : items) {
 			item->Unregister();
 		}
 
@@ -818,3 +863,42 @@ void ConfigItem::RemoveIgnoredItems(const String& allowedConfigPath)
 
 	m_IgnoredItems.clear();
 }
+
+/**
+ * Releases the expressions of the committed objects once the configuration
+ * has been activated. Templates, objects imported by other ones, group
+ * assign rules and the items themselves are kept for runtime object
+ * creation and the API.
+ *
+ * @returns The number of released expressions.
+ */
+size_t ConfigItem::ReleaseCommittedItems()
+{
+	std::unique_lock<std::mutex> lock(m_Mutex);
+
+	size_t released = 0;
+
+	for (const TypeMap::value_type& kv : m_Items) {
+		for (const ItemMap::value_type& kv2 : kv.second) {
+			const ConfigItem::Ptr& item = kv2.second;
+
+			if (item->m_Abstract || !item->m_Object || item->m_Imported.load())
+				continue;
+
+			std::unique_lock<std::mutex> ilock(item->m_ExpressionMutex);
+
+			if (!item->m_Expression)
+				continue;
+
+			item->m_Expression.reset();
+
+			/* Group assign rules are evaluated in their item's scope. */
+			if (!item->m_Filter)
+				item->m_Scope.reset();
+
+			released++;
+		}
+	}
+
+	return released;
+}
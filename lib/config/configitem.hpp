@@ -8,6 +8,8 @@
 #include "config/activationcontext.hpp"
 #include "base/configobject.hpp"
 #include "base/workqueue.hpp"
+#include <atomic>
+#include <mutex>
 
 namespace icinga
 {
@@ -41,6 +43,8 @@ public:
 	Expression::Ptr GetExpression() const;
 	Expression::Ptr GetFilter() const;
 
+	void SetImported();
+
 	void Register();
 	void Unregister();
 
@@ -62,6 +66,7 @@ public:
 	static std::vector<ConfigItem::Ptr> GetDefaultTemplates(const Type::Ptr& type);
 
 	static void RemoveIgnoredItems(const String& allowedConfigPath);
+	static size_t ReleaseCommittedItems();
 
 private:
 	Type::Ptr m_Type; /**< The object type. */
@@ -80,6 +85,9 @@ private:
 
 	ConfigObject::Ptr m_Object;
 
+	mutable std::mutex m_ExpressionMutex; /**< Protects m_Expression and m_Scope which may be released after activation. */
+	std::atomic<bool> m_Imported{false}; /**< Whether the configuration imports this (non-abstract) item. */
+
 	static std::mutex m_Mutex;
 
 	typedef std::map<String, ConfigItem::Ptr> ItemMap;
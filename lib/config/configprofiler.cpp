@@ -0,0 +1,188 @@
+/* Icinga 2 | (c) 2012 Icinga GmbH | GPLv2+ */
+
+#include "config/configprofiler.hpp"
+#include <algorithm>
+#include <chrono>
+#include <iomanip>
+#include <memory>
+#include <mutex>
+#include <ostream>
+#include <unordered_map>
+#include <vector>
+
+using namespace icinga;
+
+std::atomic<bool> ConfigProfiler::m_Enabled (false);
+
+namespace
+{
+
+struct ProfilerStats
+{
+	uint_fast64_t Count{0};
+	double Total{0};
+	double Self{0};
+};
+
+struct ProfilerStackFrame
+{
+	String Label;
+	std::chrono::steady_clock::time_point Start;
+	double Children;
+};
+
+struct ProfilerThread
+{
+	std::mutex Mutex;
+	std::vector<ProfilerStackFrame> Stack;
+	std::unordered_map<String, ProfilerStats> Labels;
+	std::unordered_map<String, double> Stacks;
+};
+
+}
+
+static std::mutex l_ProfilerThreadsMutex;
+static std::vector<std::shared_ptr<ProfilerThread> > l_ProfilerThreads;
+
+static ProfilerThread& GetProfilerThread()
+{
+	/* Outlives the thread, so the report includes the work queue threads which are already gone. */
+	static thread_local std::shared_ptr<ProfilerThread> thread;
+
+	if (!thread) {
+		thread = std::make_shared<ProfilerThread>();
+
+		std::unique_lock<std::mutex> lock(l_ProfilerThreadsMutex);
+		l_ProfilerThreads.push_back(thread);
+	}
+
+	return *thread;
+}
+
+void ConfigProfiler::Enable()
+{
+	m_Enabled.store(true);
+}
+
+void ConfigProfiler::Push(String label)
+{
+	ProfilerThread& thread (GetProfilerThread());
+	std::unique_lock<std::mutex> lock(thread.Mutex);
+
+	/* ';' separates the frames of a folded stack. */
+	std::replace(label.Begin(), label.End(), ';', ',');
+
+	thread.Stack.push_back({ std::move(label), std::chrono::steady_clock::now(), 0 });
+}
+
+void ConfigProfiler::Pop()
+{
+	auto now (std::chrono::steady_clock::now());
+	ProfilerThread& thread (GetProfilerThread());
+	std::unique_lock<std::mutex> lock(thread.Mutex);
+
+	if (thread.Stack.empty())
+		return;
+
+	ProfilerStackFrame& frame (thread.Stack.back());
+	double total = std::chrono::duration<double>(now - frame.Start).count();
+	double self = std::max(0.0, total - frame.Children);
+
+	String stack;
+
+	for (auto& entry : thread.Stack) {
+		if (!stack.IsEmpty())
+			stack += ";";
+
+		stack += entry.Label;
+	}
+
+	thread.Stacks[stack] += self;
+
+	ProfilerStats& stats (thread.Labels[frame.Label]);
+	stats.Count++;
+	stats.Self += self;
+
+	/* Recursive frames are already accounted for by their outermost instance. */
+	if (std::none_of(thread.Stack.begin(), thread.Stack.end() - 1,
+		[&frame](const ProfilerStackFrame& entry) { return entry.Label == frame.Label; }))
+		stats.Total += total;
+
+	thread.Stack.pop_back();
+
+	if (!thread.Stack.empty())
+		thread.Stack.back().Children += total;
+}
+
+/**
+ * Writes the frame labels sorted by their total time.
+ *
+ * @param fp The output stream.
+ */
+void ConfigProfiler::WriteReport(std::ostream& fp)
+{
+	std::unordered_map<String, ProfilerStats> labels;
+
+	{
+		std::unique_lock<std::mutex> lock(l_ProfilerThreadsMutex);
+
+		for (auto& thread : l_ProfilerThreads) {
+			std::unique_lock<std::mutex> tlock(thread->Mutex);
+
+			for (auto& kv : thread->Labels) {
+				ProfilerStats& stats (labels[kv.first]);
+				stats.Count += kv.second.Count;
+				stats.Total += kv.second.Total;
+				stats.Self += kv.second.Self;
+			}
+		}
+	}
+
+	std::vector<std::pair<String, ProfilerStats> > sorted (labels.begin(), labels.end());
+
+	std::sort(sorted.begin(), sorted.end(), [](const std::pair<String, ProfilerStats>& a, const std::pair<String, ProfilerStats>& b) {
+		return a.second.Total > b.second.Total;
+	});
+
+	/* Frames of different threads overlap, so the times add up to more than the wall clock time. */
+	fp << std::setw(12) << "total (ms)" << std::setw(12) << "self (ms)" << std::setw(10) << "count" << "  frame\n";
+
+	fp << std::fixed << std::setprecision(2);
+
+	for (auto& entry : sorted) {
+		fp << std::setw(12) << entry.second.Total * 1000 << std::setw(12) << entry.second.Self * 1000
+			<< std::setw(10) << entry.second.Count << "  " << entry.first << "\n";
+	}
+}
+
+/**
+ * Writes the self time (in microseconds) of each stack in the folded stack
+ * format, e.g. for flamegraph.pl.
+ *
+ * @param fp The output stream.
+ */
+void ConfigProfiler::WriteFoldedStacks(std::ostream& fp)
+{
+	std::unordered_map<String, double> stacks;
+
+	{
+		std::unique_lock<std::mutex> lock(l_ProfilerThreadsMutex);
+
+		for (auto& thread : l_ProfilerThreads) {
+			std::unique_lock<std::mutex> tlock(thread->Mutex);
+
+			for (auto& kv : thread->Stacks)
+				stacks[kv.first] += kv.second;
+		}
+	}
+
+	std::vector<std::pair<String, double> > sorted (stacks.begin(), stacks.end());
+	std::sort(sorted.begin(), sorted.end());
+
+	for (auto& entry : sorted) {
+		auto usec (static_cast<uint_fast64_t>(entry.second * 1000000));
+
+		if (usec > 0)
+			fp << entry.first << " " << usec << "\n";
+	}
+}
@@ -0,0 +1,108 @@
+/* Icinga 2 | (c) 2012 Icinga GmbH | GPLv2+ */
+
+#ifndef CONFIGPROFILER_H
+#define CONFIGPROFILER_H
+
+#include "config/i2-config.hpp"
+#include "config/expression.hpp"
+#include <atomic>
+#include <iosfwd>
+
+namespace icinga
+{
+
+/**
+ * Measures where the config evaluation spends its time.
+ *
+ * Config files, apply rules, templates and user functions push a frame
+ * onto a per-thread stack while they're evaluated. The profiler records
+ * the evaluation count, the total and the self time per frame label and
+ * the self time per stack, which is written in the folded stack format
+ * understood by flamegraph.pl.
+ *
+ * @ingroup config
+ */
+class ConfigProfiler
+{
+public:
+	class Frame
+	{
+	public:
+		/**
+		 * Pushes a frame if the profiler is enabled.
+		 *
+		 * @param label Returns the frame's label, only called if the profiler is enabled.
+		 */
+		template<typename F>
+		explicit Frame(const F& label)
+			: m_Active(IsEnabled())
+		{
+			if (m_Active)
+				Push(label());
+		}
+
+		Frame(const Frame&) = delete;
+		Frame& operator=(const Frame&) = delete;
+
+		~Frame()
+		{
+			if (m_Active)
+				Pop();
+		}
+
+	private:
+		bool m_Active;
+	};
+
+	static void Enable();
+
+	static inline bool IsEnabled()
+	{
+		return m_Enabled.load(std::memory_order_relaxed);
+	}
+
+	static void WriteReport(std::ostream& fp);
+	static void WriteFoldedStacks(std::ostream& fp);
+
+private:
+	static std::atomic<bool> m_Enabled;
+
+	ConfigProfiler();
+
+	static void Push(String label);
+	static void Pop();
+};
+
+/**
+ * Evaluates an expression within a profiler frame.
+ *
+ * @ingroup config
+ */
+class ProfiledExpression final : public Expression
+{
+public:
+	ProfiledExpression(String label, Expression::Ptr expression)
+		: m_Label(std::move(label)), m_Expression(std::move(expression))
+	{ }
+
+protected:
+	ExpressionResult DoEvaluate(ScriptFrame& frame, DebugHint *dhint) const override
+	{
+		ConfigProfiler::Frame pframe ([this]() { return m_Label; });
+
+		return m_Expression->DoEvaluate(frame, dhint);
+	}
+
+	const DebugInfo& GetDebugInfo() const override
+	{
+		return m_Expression->GetDebugInfo();
+	}
+
+private:
+	String m_Label;
+	Expression::Ptr m_Expression;
+};
+
+}
+
+#endif /* CONFIGPROFILER_H */
@@ -3,6 +3,8 @@
 #include "config/expression.hpp"
 #include "config/configitem.hpp"
 #include "config/configcompiler.hpp"
+#include "config/optimizer.hpp"
+#include "config/configprofiler.hpp"
 #include "config/vmops.hpp"
 #include "base/array.hpp"
 #include "base/json.hpp"
@@ -13,6 +15,7 @@
 #include "base/loader.hpp"
 #include "base/reference.hpp"
 #include "base/namespace.hpp"
+#include "base/objectlock.hpp"
 #include "base/defer.hpp"
 #include <boost/exception_ptr.hpp>
 #include <boost/exception/errinfo_nested_exception.hpp>
@@ -116,7 +119,10 @@ ExpressionResult VariableExpression::DoEvaluate(ScriptFrame& frame, DebugHint *d
 		return value;
 	else if (frame.Self.IsObject() && frame.Locals != frame.Self.Get<Object::Ptr>() && frame.Self.Get<Object::Ptr>()->GetOwnField(m_Variable, &value))
 		return value;
-	else if (VMOps::FindVarImport(frame, m_Imports, m_Variable, &value, m_DebugInfo))
+	else if (m_ImportValue) {
+		ObjectLock olock(m_ImportNamespace);
+		return m_ImportValue->Get(m_DebugInfo);
+	} else if (!m_SkipImports && VMOps::FindVarImport(frame, m_Imports, m_Variable, &value, m_DebugInfo))
 		return value;
 	else
 		return ScriptGlobal::Get(m_Variable);
@@ -136,7 +142,9 @@ bool VariableExpression::GetReference(ScriptFrame& frame, bool init_dict, Value
 
 		if (dhint && *dhint)
 			*dhint = new DebugHint((*dhint)->GetChild(m_Variable));
-	} else if (VMOps::FindVarImportRef(frame, m_Imports, m_Variable, parent, m_DebugInfo)) {
+	} else if (m_ImportNamespace) {
+		*parent = m_ImportNamespace;
+	} else if (!m_SkipImports && VMOps::FindVarImportRef(frame, m_Imports, m_Variable, parent, m_DebugInfo)) {
 		return true;
 	} else if (ScriptGlobal::Exists(m_Variable)) {
 		*parent = ScriptGlobal::GetGlobals();
@@ -680,6 +688,10 @@ ExpressionResult SetConstExpression::DoEvaluate(ScriptFrame& frame, DebugHint *d
 	if (dynamic_pointer_cast<ConstEmbeddedNamespaceValue>(attr)) {
 		std::ostringstream msgbuf;
 		msgbuf << "Value for constant '" << m_Name << "' was modified. This behaviour is deprecated.\n";
+
+		if (ExpressionOptimizer::IsResolvedConstant(m_Name))
+			msgbuf << "Config files which were compiled before this assignment use the previous value.\n";
+
 		ShowCodeLocation(msgbuf, GetDebugInfo(), false);
 		Log(LogWarning, msgbuf.str());
 	}
@@ -879,12 +891,24 @@ ExpressionResult ImportExpression::DoEvaluate(ScriptFrame& frame, DebugHint *dhi
 	if (!item)
 		BOOST_THROW_EXCEPTION(ScriptError("Import references unknown template: '" + name + "'", m_DebugInfo));
 
+	ConfigProfiler::Frame pframe ([&type, &name]() { return "template " + type + " '" + name + "'"; });
+
+	Expression::Ptr expression = item->GetExpression();
+
+	if (!expression) {
+		BOOST_THROW_EXCEPTION(ScriptError("Import references object '" + name + "' whose configuration was released after activation"
+			" (--compact-config). Only templates and objects which the configuration imports can be imported at runtime.", m_DebugInfo));
+	}
+
+	if (!item->IsAbstract())
+		item->SetImported();
+
 	Dictionary::Ptr scope = item->GetScope();
 
 	if (scope)
 		scope->CopyTo(frame.Locals);
 
-	ExpressionResult result = item->GetExpression()->Evaluate(frame, dhint);
+	ExpressionResult result = expression->Evaluate(frame, dhint);
 	CHECK_RESULT(result);
 
 	return Empty;
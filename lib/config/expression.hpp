@@ -8,6 +8,7 @@
 #include "base/array.hpp"
 #include "base/dictionary.hpp"
 #include "base/function.hpp"
+#include "base/namespace.hpp"
 #include "base/exception.hpp"
 #include "base/scriptframe.hpp"
 #include "base/shared-object.hpp"
@@ -17,6 +18,8 @@
 namespace icinga
 {
 
+class ExpressionOptimizer;
+
 struct DebugHint
 {
 public:
@@ -272,8 +275,15 @@ public:
 		: DebuggableExpression(debugInfo), m_Operand(std::move(operand))
 	{ }
 
+	inline const std::unique_ptr<Expression>& GetOperand() const noexcept
+	{
+		return m_Operand;
+	}
+
 protected:
 	std::unique_ptr<Expression> m_Operand;
+
+	friend class ExpressionOptimizer;
 };
 
 class BinaryExpression : public DebuggableExpression
@@ -296,6 +306,8 @@ public:
 protected:
 	std::unique_ptr<Expression> m_Operand1;
 	std::unique_ptr<Expression> m_Operand2;
+
+	friend class ExpressionOptimizer;
 };
 
 class VariableExpression final : public DebuggableExpression
@@ -316,6 +328,12 @@ private:
 	String m_Variable;
 	std::vector<Expression::Ptr> m_Imports;
 
+	/* Set by ExpressionOptimizer if the imports are known to contain the variable or not to contain it. */
+	Namespace::Ptr m_ImportNamespace;
+	NamespaceValue::Ptr m_ImportValue;
+	bool m_SkipImports{false};
+
+	friend class ExpressionOptimizer;
 	friend void BindToScope(std::unique_ptr<Expression>& expr, ScopeSpecifier scopeSpec);
 };
 
@@ -606,11 +624,18 @@ public:
 		: DebuggableExpression(debugInfo), m_Expressions(std::move(expressions))
 	{ }
 
+	inline const std::vector<std::unique_ptr<Expression> >& GetExpressions() const noexcept
+	{
+		return m_Expressions;
+	}
+
 protected:
 	ExpressionResult DoEvaluate(ScriptFrame& frame, DebugHint *dhint) const override;
 
 private:
 	std::vector<std::unique_ptr<Expression> > m_Expressions;
+
+	friend class ExpressionOptimizer;
 };
 
 class DictExpression final : public DebuggableExpression
@@ -622,6 +647,16 @@ public:
 
 	void MakeInline();
 
+	inline const std::vector<std::unique_ptr<Expression> >& GetExpressions() const noexcept
+	{
+		return m_Expressions;
+	}
+
+	inline bool IsInline() const noexcept
+	{
+		return m_Inline;
+	}
+
 protected:
 	ExpressionResult DoEvaluate(ScriptFrame& frame, DebugHint *dhint) const override;
 
@@ -629,6 +664,7 @@ private:
 	std::vector<std::unique_ptr<Expression> > m_Expressions;
 	bool m_Inline{false};
 
+	friend class ExpressionOptimizer;
 	friend void BindToScope(std::unique_ptr<Expression>& expr, ScopeSpecifier scopeSpec);
 };
 
@@ -643,6 +679,8 @@ protected:
 	String m_Name;
 
 	ExpressionResult DoEvaluate(ScriptFrame& frame, DebugHint *dhint) const override;
+
+	friend class ExpressionOptimizer;
 };
 
 class SetExpression final : public BinaryExpression
@@ -678,6 +716,8 @@ private:
 	std::unique_ptr<Expression> m_Condition;
 	std::unique_ptr<Expression> m_TrueBranch;
 	std::unique_ptr<Expression> m_FalseBranch;
+
+	friend class ExpressionOptimizer;
 };
 
 class WhileExpression final : public DebuggableExpression
@@ -693,6 +733,8 @@ protected:
 private:
 	std::unique_ptr<Expression> m_Condition;
 	std::unique_ptr<Expression> m_LoopBody;
+
+	friend class ExpressionOptimizer;
 };
 
 
@@ -776,6 +818,8 @@ protected:
 private:
 	std::unique_ptr<Expression> m_Message;
 	bool m_IncompleteExpr;
+
+	friend class ExpressionOptimizer;
 };
 
 class ImportExpression final : public DebuggableExpression
@@ -790,6 +834,8 @@ protected:
 
 private:
 	std::unique_ptr<Expression> m_Name;
+
+	friend class ExpressionOptimizer;
 };
 
 class ImportDefaultTemplatesExpression final : public DebuggableExpression
@@ -819,6 +865,8 @@ private:
 	std::vector<String> m_Args;
 	std::map<String, std::unique_ptr<Expression> > m_ClosedVars;
 	Expression::Ptr m_Expression;
+
+	friend class ExpressionOptimizer;
 };
 
 class ApplyExpression final : public DebuggableExpression
@@ -849,6 +897,8 @@ private:
 	bool m_IgnoreOnError;
 	std::map<String, std::unique_ptr<Expression> > m_ClosedVars;
 	Expression::Ptr m_Expression;
+
+	friend class ExpressionOptimizer;
 };
 
 class NamespaceExpression final : public DebuggableExpression
@@ -863,6 +913,8 @@ protected:
 
 private:
 	Expression::Ptr m_Expression;
+
+	friend class ExpressionOptimizer;
 };
 
 class ObjectExpression final : public DebuggableExpression
@@ -890,6 +942,8 @@ private:
 	bool m_IgnoreOnError;
 	std::map<String, std::unique_ptr<Expression> > m_ClosedVars;
 	Expression::Ptr m_Expression;
+
+	friend class ExpressionOptimizer;
 };
 
 class ForExpression final : public DebuggableExpression
@@ -907,6 +961,8 @@ private:
 	String m_FVVar;
 	std::unique_ptr<Expression> m_Value;
 	std::unique_ptr<Expression> m_Expression;
+
+	friend class ExpressionOptimizer;
 };
 
 class LibraryExpression final : public UnaryExpression
@@ -948,6 +1004,8 @@ private:
 	bool m_SearchIncludes;
 	String m_Zone;
 	String m_Package;
+
+	friend class ExpressionOptimizer;
 };
 
 class BreakpointExpression final : public DebuggableExpression
@@ -974,6 +1032,8 @@ protected:
 private:
 	std::unique_ptr<Expression> m_TryBody;
 	std::unique_ptr<Expression> m_ExceptBody;
+
+	friend class ExpressionOptimizer;
 };
 
 }
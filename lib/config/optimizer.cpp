@@ -0,0 +1,408 @@
+/* Icinga 2 | (c) 2012 Icinga GmbH | GPLv2+ */
+
+#include "config/optimizer.hpp"
+#include "base/json.hpp"
+#include "base/logger.hpp"
+#include "base/namespace.hpp"
+#include "base/scriptglobal.hpp"
+#include "base/type.hpp"
+
+using namespace icinga;
+
+std::mutex ExpressionOptimizer::m_ResolvedConstantsMutex;
+std::set<String> ExpressionOptimizer::m_ResolvedConstants;
+
+/* The imports every VariableExpression starts with, further ones are added by 'using'. */
+static const size_t l_DefaultImportCount = 4;
+
+ExpressionOptimizer::ExpressionOptimizer(bool resolveConstants)
+	: m_ResolveConstants(resolveConstants)
+{ }
+
+/**
+ * Optimizes the given expression tree in place.
+ *
+ * Constants must only be resolved if all the local variables the tree can
+ * see are declared in the tree itself, i.e. not for API filters or console
+ * input.
+ *
+ * @param expression The expression tree.
+ * @param resolveConstants Whether to replace references to constants with their value.
+ * @returns The number of rewrites.
+ */
+size_t ExpressionOptimizer::Optimize(std::unique_ptr<Expression>& expression, bool resolveConstants)
+{
+	ExpressionOptimizer optimizer (resolveConstants);
+
+	if (resolveConstants) {
+		optimizer.Visit(expression);
+	}
+
+	optimizer.m_Collecting = false;
+	optimizer.Visit(expression);
+
+	return optimizer.m_Rewrites;
+}
+
+/**
+ * @returns Whether references to the given constant have been replaced with its value.
+ */
+bool ExpressionOptimizer::IsResolvedConstant(const String& name)
+{
+	std::unique_lock<std::mutex> lock (m_ResolvedConstantsMutex);
+	return m_ResolvedConstants.find(name) != m_ResolvedConstants.end();
+}
+
+/**
+ * Visits the given subtree and replaces its root if it can be rewritten.
+ *
+ * @param slot The subtree.
+ * @param reference Whether the subtree is used as a reference, e.g. on the left side of an assignment.
+ */
+void ExpressionOptimizer::Visit(std::unique_ptr<Expression>& slot, bool reference)
+{
+	if (!slot)
+		return;
+
+	VisitChildren(slot.get(), reference);
+
+	if (m_Collecting) {
+		CollectDeclarations(slot.get());
+		return;
+	}
+
+	auto replacement (Rewrite(slot.get(), reference));
+
+	if (replacement)
+		slot = std::move(replacement);
+}
+
+void ExpressionOptimizer::Visit(Expression::Ptr& slot)
+{
+	if (!slot)
+		return;
+
+	VisitChildren(slot.get(), false);
+
+	if (m_Collecting) {
+		CollectDeclarations(slot.get());
+		return;
+	}
+
+	auto replacement (Rewrite(slot.get(), false));
+
+	if (replacement)
+		slot = replacement.release();
+}
+
+void ExpressionOptimizer::VisitChildren(Expression *node, bool reference)
+{
+	if (auto set = dynamic_cast<SetExpression*>(node)) {
+		Visit(static_cast<BinaryExpression*>(set)->m_Operand1, true);
+		Visit(static_cast<BinaryExpression*>(set)->m_Operand2);
+	} else if (auto indexer = dynamic_cast<IndexerExpression*>(node)) {
+		Visit(static_cast<BinaryExpression*>(indexer)->m_Operand1, reference);
+		Visit(static_cast<BinaryExpression*>(indexer)->m_Operand2);
+	} else if (auto binary = dynamic_cast<BinaryExpression*>(node)) {
+		Visit(binary->m_Operand1);
+		Visit(binary->m_Operand2);
+	} else if (auto unary = dynamic_cast<UnaryExpression*>(node)) {
+		Visit(unary->m_Operand, dynamic_cast<RefExpression*>(node) != nullptr);
+	} else if (auto call = dynamic_cast<FunctionCallExpression*>(node)) {
+		Visit(call->m_FName, true);
+
+		for (auto& arg : call->m_Args)
+			Visit(arg);
+	} else if (auto array = dynamic_cast<ArrayExpression*>(node)) {
+		for (auto& expr : array->m_Expressions)
+			Visit(expr);
+	} else if (auto dict = dynamic_cast<DictExpression*>(node)) {
+		for (auto& expr : dict->m_Expressions)
+			Visit(expr);
+	} else if (auto cond = dynamic_cast<ConditionalExpression*>(node)) {
+		Visit(cond->m_Condition);
+		Visit(cond->m_TrueBranch);
+		Visit(cond->m_FalseBranch);
+	} else if (auto loop = dynamic_cast<WhileExpression*>(node)) {
+		Visit(loop->m_Condition);
+		Visit(loop->m_LoopBody);
+	} else if (auto loop = dynamic_cast<ForExpression*>(node)) {
+		Visit(loop->m_Value);
+		Visit(loop->m_Expression);
+	} else if (auto func = dynamic_cast<FunctionExpression*>(node)) {
+		for (auto& closedVar : func->m_ClosedVars)
+			Visit(closedVar.second);
+
+		Visit(func->m_Expression);
+	} else if (auto apply = dynamic_cast<ApplyExpression*>(node)) {
+		Visit(apply->m_Name);
+		Visit(apply->m_Filter);
+		Visit(apply->m_FTerm);
+
+		for (auto& closedVar : apply->m_ClosedVars)
+			Visit(closedVar.second);
+
+		Visit(apply->m_Expression);
+	} else if (auto object = dynamic_cast<ObjectExpression*>(node)) {
+		Visit(object->m_Type);
+		Visit(object->m_Name);
+		Visit(object->m_Filter);
+
+		for (auto& closedVar : object->m_ClosedVars)
+			Visit(closedVar.second);
+
+		Visit(object->m_Expression);
+	} else if (auto ns = dynamic_cast<NamespaceExpression*>(node)) {
+		Visit(ns->m_Expression);
+	} else if (auto thr = dynamic_cast<ThrowExpression*>(node)) {
+		Visit(thr->m_Message);
+	} else if (auto import = dynamic_cast<ImportExpression*>(node)) {
+		Visit(import->m_Name);
+	} else if (auto include = dynamic_cast<IncludeExpression*>(node)) {
+		Visit(include->m_Path);
+		Visit(include->m_Pattern);
+		Visit(include->m_Name);
+	} else if (auto tryExcept = dynamic_cast<TryExceptExpression*>(node)) {
+		Visit(tryExcept->m_TryBody);
+		Visit(tryExcept->m_ExceptBody);
+	}
+}
+
+/**
+ * Records the names which the tree may assign to. These can't be resolved
+ * as constants because a local variable or field might shadow the constant.
+ */
+void ExpressionOptimizer::CollectDeclarations(Expression *node)
+{
+	if (auto set = dynamic_cast<SetExpression*>(node)) {
+		auto& lhs (set->GetOperand1());
+
+		if (auto var = dynamic_cast<VariableExpression*>(lhs.get())) {
+			m_Declarations.insert(var->GetVariable());
+		} else if (auto indexer = dynamic_cast<IndexerExpression*>(lhs.get())) {
+			auto index (dynamic_cast<LiteralExpression*>(indexer->GetOperand2().get()));
+
+			if (index && index->GetValue().IsString())
+				m_Declarations.insert(index->GetValue());
+		}
+	} else if (auto constant = dynamic_cast<SetConstExpression*>(node)) {
+		m_Declarations.insert(constant->m_Name);
+	} else if (auto loop = dynamic_cast<ForExpression*>(node)) {
+		m_Declarations.insert(loop->m_FKVar);
+		m_Declarations.insert(loop->m_FVVar);
+	} else if (auto func = dynamic_cast<FunctionExpression*>(node)) {
+		m_Declarations.insert(func->m_Args.begin(), func->m_Args.end());
+
+		for (auto& closedVar : func->m_ClosedVars)
+			m_Declarations.insert(closedVar.first);
+	} else if (auto apply = dynamic_cast<ApplyExpression*>(node)) {
+		/* The rules are evaluated with the target objects as locals. */
+		m_Declarations.insert({ "host", "service", apply->m_FKVar, apply->m_FVVar });
+
+		for (auto& closedVar : apply->m_ClosedVars)
+			m_Declarations.insert(closedVar.first);
+	} else if (auto object = dynamic_cast<ObjectExpression*>(node)) {
+		for (auto& closedVar : object->m_ClosedVars)
+			m_Declarations.insert(closedVar.first);
+	}
+}
+
+std::unique_ptr<Expression> ExpressionOptimizer::Rewrite(Expression *node, bool reference)
+{
+	if (auto var = dynamic_cast<VariableExpression*>(node)) {
+		BindImports(var);
+
+		if (m_ResolveConstants && !reference)
+			return ResolveConstant(var);
+
+		return nullptr;
+	}
+
+	if (auto cond = dynamic_cast<ConditionalExpression*>(node)) {
+		auto condition (dynamic_cast<LiteralExpression*>(cond->m_Condition.get()));
+
+		if (!condition)
+			return nullptr;
+
+		bool taken = condition->GetValue().ToBool();
+
+		Log(LogDebug, "ExpressionOptimizer")
+			<< "Removed the " << (taken ? "false" : "true") << " branch of the conditional " << node->GetDebugInfo();
+
+		m_Rewrites++;
+
+		if (taken)
+			return std::move(cond->m_TrueBranch);
+		else if (cond->m_FalseBranch)
+			return std::move(cond->m_FalseBranch);
+		else
+			return MakeLiteral();
+	}
+
+	if (dynamic_cast<LogicalAndExpression*>(node) || dynamic_cast<LogicalOrExpression*>(node)) {
+		auto binary (static_cast<BinaryExpression*>(node));
+		auto operand1 (dynamic_cast<LiteralExpression*>(binary->m_Operand1.get()));
+
+		if (!operand1)
+			return nullptr;
+
+		/* The first operand is the result if it short-circuits the operator, the second one otherwise. */
+		bool shortCircuit = operand1->GetValue().ToBool() == (dynamic_cast<LogicalOrExpression*>(node) != nullptr);
+
+		Log(LogDebug, "ExpressionOptimizer")
+			<< "Removed the " << (shortCircuit ? "second" : "first") << " operand of the logical operator " << node->GetDebugInfo();
+
+		m_Rewrites++;
+
+		return std::move(shortCircuit ? binary->m_Operand1 : binary->m_Operand2);
+	}
+
+	return Fold(node);
+}
+
+/**
+ * Evaluates operators whose operands are scalar literals. Operators which
+ * raise an error are left alone so that the error is raised at runtime.
+ */
+std::unique_ptr<Expression> ExpressionOptimizer::Fold(Expression *node)
+{
+	std::vector<Expression*> operands;
+
+	if (dynamic_cast<NegateExpression*>(node) || dynamic_cast<LogicalNegateExpression*>(node)) {
+		operands.emplace_back(static_cast<UnaryExpression*>(node)->m_Operand.get());
+	} else if (dynamic_cast<AddExpression*>(node) || dynamic_cast<SubtractExpression*>(node)
+		|| dynamic_cast<MultiplyExpression*>(node) || dynamic_cast<DivideExpression*>(node)
+		|| dynamic_cast<ModuloExpression*>(node) || dynamic_cast<XorExpression*>(node)
+		|| dynamic_cast<BinaryAndExpression*>(node) || dynamic_cast<BinaryOrExpression*>(node)
+		|| dynamic_cast<ShiftLeftExpression*>(node) || dynamic_cast<ShiftRightExpression*>(node)
+		|| dynamic_cast<EqualExpression*>(node) || dynamic_cast<NotEqualExpression*>(node)
+		|| dynamic_cast<LessThanExpression*>(node) || dynamic_cast<GreaterThanExpression*>(node)
+		|| dynamic_cast<LessThanOrEqualExpression*>(node) || dynamic_cast<GreaterThanOrEqualExpression*>(node)) {
+		auto binary (static_cast<BinaryExpression*>(node));
+		operands.emplace_back(binary->m_Operand1.get());
+		operands.emplace_back(binary->m_Operand2.get());
+	} else {
+		return nullptr;
+	}
+
+	for (auto operand : operands) {
+		auto lit (dynamic_cast<LiteralExpression*>(operand));
+
+		if (!lit || lit->GetValue().IsObject())
+			return nullptr;
+	}
+
+	Value result;
+
+	try {
+		ScriptFrame frame (false);
+		result = node->DoEvaluate(frame, nullptr).GetValue();
+	} catch (const std::exception&) {
+		return nullptr;
+	}
+
+	if (result.IsObject())
+		return nullptr;
+
+	Log(LogDebug, "ExpressionOptimizer")
+		<< "Folded the operator " << node->GetDebugInfo() << " into " << JsonEncode(result);
+
+	m_Rewrites++;
+
+	return MakeLiteral(result);
+}
+
+/**
+ * Looks the variable up in its imports once instead of on every evaluation.
+ *
+ * The default imports are namespaces and objects which the config can't add
+ * fields to, so the result stays valid. Variables with imports added by
+ * 'using' are left to the dynamic lookup.
+ */
+void ExpressionOptimizer::BindImports(VariableExpression *var)
+{
+	if (var->m_Imports.size() != l_DefaultImportCount || var->m_ImportNamespace || var->m_SkipImports)
+		return;
+
+	const String& name = var->GetVariable();
+	ScriptFrame frame (false);
+
+	for (auto& import : var->m_Imports) {
+		Value vobj;
+
+		try {
+			vobj = import->Evaluate(frame).GetValue();
+		} catch (const std::exception&) {
+			return;
+		}
+
+		if (!vobj.IsObject())
+			return;
+
+		Object::Ptr obj = vobj;
+
+		if (!obj->HasOwnField(name))
+			continue;
+
+		/* Fields of other objects may be computed, only namespace entries are bound. */
+		Namespace::Ptr ns = dynamic_pointer_cast<Namespace>(obj);
+
+		if (ns) {
+			var->m_ImportNamespace = ns;
+			var->m_ImportValue = ns->GetAttribute(name);
+		}
+
+		return;
+	}
+
+	var->m_SkipImports = true;
+}
+
+/**
+ * Replaces a reference to a scalar constant with the constant's value,
+ * unless anything else the variable lookup checks first may define it.
+ */
+std::unique_ptr<Expression> ExpressionOptimizer::ResolveConstant(VariableExpression *var)
+{
+	const String& name = var->GetVariable();
+
+	if (!var->m_SkipImports || m_Declarations.find(name) != m_Declarations.end())
+		return nullptr;
+
+	auto constant (dynamic_pointer_cast<ConstEmbeddedNamespaceValue>(ScriptGlobal::GetGlobals()->GetAttribute(name)));
+
+	if (!constant)
+		return nullptr;
+
+	Value value = constant->Get(DebugInfo());
+
+	if (value.IsObject())
+		return nullptr;
+
+	/* Fields of the objects which are being configured shadow constants, too. */
+	static const std::set<String> fieldNames = []() {
+		std::set<String> names;
+
+		for (auto& type : Type::GetAllTypes()) {
+			for (int i = 0; i < type->GetFieldCount(); i++)
+				names.insert(type->GetFieldInfo(i).Name);
+		}
+
+		return names;
+	}();
+
+	if (fieldNames.find(name) != fieldNames.end())
+		return nullptr;
+
+	{
+		std::unique_lock<std::mutex> lock (m_ResolvedConstantsMutex);
+		m_ResolvedConstants.insert(name);
+	}
+
+	Log(LogDebug, "ExpressionOptimizer")
+		<< "Replaced the constant '" << name << "' " << static_cast<Expression*>(var)->GetDebugInfo() << " with " << JsonEncode(value);
+
+	m_Rewrites++;
+
+	return MakeLiteral(value);
+}
@@ -0,0 +1,58 @@
+/* Icinga 2 | (c) 2012 Icinga GmbH | GPLv2+ */
+
+#ifndef OPTIMIZER_H
+#define OPTIMIZER_H
+
+#include "config/i2-config.hpp"
+#include "config/expression.hpp"
+#include <mutex>
+#include <set>
+
+namespace icinga
+{
+
+/**
+ * Rewrites a freshly compiled expression tree before it is evaluated.
+ *
+ * Operators whose operands are literals are folded into a literal,
+ * conditionals with a literal condition are replaced by the branch which
+ * is taken and, optionally, references to scalar constants are replaced
+ * by their value. Each rewrite is logged at debug level.
+ *
+ * Variables are bound to the import namespace entry they refer to, which
+ * saves evaluating the imports whenever the variable isn't a local.
+ *
+ * @ingroup config
+ */
+class ExpressionOptimizer
+{
+public:
+	static size_t Optimize(std::unique_ptr<Expression>& expression, bool resolveConstants);
+
+	static bool IsResolvedConstant(const String& name);
+
+private:
+	bool m_ResolveConstants;
+	bool m_Collecting{true};
+	std::set<String> m_Declarations;
+	size_t m_Rewrites{0};
+
+	static std::mutex m_ResolvedConstantsMutex;
+	static std::set<String> m_ResolvedConstants;
+
+	explicit ExpressionOptimizer(bool resolveConstants);
+
+	void Visit(std::unique_ptr<Expression>& slot, bool reference = false);
+	void Visit(Expression::Ptr& slot);
+	void VisitChildren(Expression *node, bool reference);
+	void CollectDeclarations(Expression *node);
+
+	std::unique_ptr<Expression> Rewrite(Expression *node, bool reference);
+	std::unique_ptr<Expression> Fold(Expression *node);
+	void BindImports(VariableExpression *var);
+	std::unique_ptr<Expression> ResolveConstant(VariableExpression *var);
+};
+
+}
+
+#endif /* OPTIMIZER_H */
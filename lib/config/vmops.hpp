@@ -8,6 +8,7 @@
 #include "config/configitembuilder.hpp"
 #include "config/applyrule.hpp"
 #include "config/objectrule.hpp"
+#include "config/configprofiler.hpp"
 #include "base/debuginfo.hpp"
 #include "base/array.hpp"
 #include "base/dictionary.hpp"
@@ -18,6 +19,7 @@
 #include "base/convert.hpp"
 #include "base/objectlock.hpp"
 #include <map>
+#include <sstream>
 #include <vector>
 
 namespace icinga
@@ -95,10 +97,16 @@ public:
 	{
 		auto evaluatedClosedVars = EvaluateClosedVars(frame, closedVars);
 
-		auto wrapper = [argNames, evaluatedClosedVars, expression](const std::vector<Value>& arguments) -> Value {
+		auto wrapper = [name, argNames, evaluatedClosedVars, expression](const std::vector<Value>& arguments) -> Value {
 			if (arguments.size() < argNames.size())
 				BOOST_THROW_EXCEPTION(std::invalid_argument("Too few arguments for function"));
 
+			ConfigProfiler::Frame pframe ([&name, &expression]() {
+				std::ostringstream msgbuf;
+				msgbuf << "function " << (name.IsEmpty() ? "<anonymous>" : name) << " " << expression->GetDebugInfo();
+				return String(msgbuf.str());
+			});
+
 			ScriptFrame *frame = ScriptFrame::GetCurrentFrame();
 
 			frame->Locals = new Dictionary();
@@ -18,12 +18,14 @@
 #include "base/utility.hpp"
 #include "base/convert.hpp"
 #include "base/defer.hpp"
+#include "base/io-engine.hpp"
 #include "remote/actionshandler.hpp"
 #include <fstream>
 
 using namespace icinga;
 
 REGISTER_APIACTION(process_check_result, "Service;Host", &ApiActions::ProcessCheckResult);
+REGISTER_APIACTION(process_check_results, "", &ApiActions::ProcessCheckResults);
 REGISTER_APIACTION(reschedule_check, "Service;Host", &ApiActions::RescheduleCheck);
 REGISTER_APIACTION(send_custom_notification, "Service;Host", &ApiActions::SendCustomNotification);
 REGISTER_APIACTION(delay_notification, "Service;Host", &ApiActions::DelayNotification);
@@ -140,6 +142,116 @@ Dictionary::Ptr ApiActions::ProcessCheckResult(const ConfigObject::Ptr& object,
 	return ApiActions::CreateResult(500, "Unexpected result (" + std::to_string(static_cast<int>(result)) + ") for object '" + checkable->GetName() + "'. Please submit a bug report at https://github.com/Icinga/icinga2");
 }
 
+/**
+ * Processes an entry of a batch of passive check results.
+ */
+Dictionary::Ptr ApiActions::ProcessBatchedCheckResult(const Value& rawItem, ScriptFrame& permissionFrame, Expression *permissionFilter)
+{
+	if (!rawItem.IsObjectType<Dictionary>())
+		return ApiActions::CreateResult(400, "Check result must be an object.");
+
+	Dictionary::Ptr item = rawItem;
+	String hostName = item->Get("host");
+	String serviceName = item->Get("service");
+
+	if (hostName.IsEmpty())
+		return ApiActions::CreateResult(400, "Parameter 'host' is required.");
+
+	Checkable::Ptr checkable;
+
+	if (serviceName.IsEmpty())
+		checkable = Host::GetByName(hostName);
+	else
+		checkable = Service::GetByNamePair(hostName, serviceName);
+
+	if (!checkable)
+		return ApiActions::CreateResult(404, "Cannot process passive check result for non-existent object '"
+			+ (serviceName.IsEmpty() ? hostName : hostName + "!" + serviceName) + "'.");
+
+	try {
+		if (!FilterUtility::EvaluateFilter(permissionFrame, permissionFilter, checkable))
+			return ApiActions::CreateResult(403, "Access denied to object '" + checkable->GetName() + "'.");
+
+		return ProcessCheckResult(checkable, item);
+	} catch (const std::exception& ex) {
+		return ApiActions::CreateResult(500, "Could not process check result for object '"
+			+ checkable->GetName() + "': " + DiagnosticInformation(ex, false));
+	}
+}
+
+/**
+ * Processes a batch of passive check results.
+ *
+ * The checkables are looked up by name instead of evaluating a filter per
+ * result. The results are processed in the order they were passed, in
+ * chunks between which the other coroutines of the HTTP connection's
+ * thread may run.
+ */
+Dictionary::Ptr ApiActions::ProcessCheckResults(const ConfigObject::Ptr&,
+	const Dictionary::Ptr& params)
+{
+	static const size_t chunkSize = 100;
+
+	Value rawItems = params->Get("results");
+
+	if (!rawItems.IsObjectType<Array>())
+		return ApiActions::CreateResult(400, "Parameter 'results' must be an array.");
+
+	Array::Ptr items = rawItems;
+	ApiUser::Ptr user = ActionsHandler::AuthenticatedApiUser;
+	boost::asio::yield_context *yc = ActionsHandler::Yield;
+
+	/* Resolve the permissions once, the filter is evaluated per checkable. */
+	Expression *rawPermissionFilter = nullptr;
+	FilterUtility::CheckPermission(user, "actions/process-check-result", &rawPermissionFilter);
+	std::unique_ptr<Expression> permissionFilter (rawPermissionFilter);
+
+	std::vector<Dictionary::Ptr> results (items->GetLength());
+
+	for (size_t begin = 0; begin < results.size(); begin += chunkSize) {
+		if (begin > 0 && yc)
+			IoEngine::YieldCurrentCoroutine(*yc);
+
+		/* Script frames are per thread, so none may exist while yielding. */
+		Namespace::Ptr permissionFrameNS = new Namespace();
+		ScriptFrame permissionFrame (false, permissionFrameNS);
+
+		for (size_t i = begin; i < std::min(begin + chunkSize, results.size()); i++)
+			results[i] = ProcessBatchedCheckResult(items->Get(i), permissionFrame, permissionFilter.get());
+	}
+
+	ArrayData resultsData;
+	resultsData.reserve(results.size());
+
+	std::set<int> failedCodes;
+	size_t failed = 0;
+
+	for (auto& result : results) {
+		int code = result->Get("code");
+
+		if (code < 200 || code > 299) {
+			failedCodes.insert(code);
+			failed++;
+		}
+
+		resultsData.emplace_back(std::move(result));
+	}
+
+	int code = 200;
+
+	/* Same as for actions on multiple objects: a single failure code is passed on, mixed ones result in 500. */
+	if (failed == resultsData.size() && failedCodes.size() == 1u)
+		code = *failedCodes.begin();
+	else if (failed)
+		code = 500;
+
+	String status = "Processed " + Convert::ToString(resultsData.size()) + " check results, " + Convert::ToString(failed) + " failed.";
+
+	return ApiActions::CreateResult(code, status, new Dictionary({
+		{ "results", new Array(std::move(resultsData)) }
+	}));
+}
+
 Dictionary::Ptr ApiActions::RescheduleCheck(const ConfigObject::Ptr& object,
 	const Dictionary::Ptr& params)
 {
@@ -11,6 +11,9 @@
 namespace icinga
 {
 
+class Expression;
+struct ScriptFrame;
+
 /**
  * @ingroup icinga
  */
@@ -18,6 +21,7 @@ class ApiActions
 {
 public:
 	static Dictionary::Ptr ProcessCheckResult(const ConfigObject::Ptr& object, const Dictionary::Ptr& params);
+	static Dictionary::Ptr ProcessCheckResults(const ConfigObject::Ptr& object, const Dictionary::Ptr& params);
 	static Dictionary::Ptr RescheduleCheck(const ConfigObject::Ptr& object, const Dictionary::Ptr& params);
 	static Dictionary::Ptr SendCustomNotification(const ConfigObject::Ptr& object, const Dictionary::Ptr& params);
 	static Dictionary::Ptr DelayNotification(const ConfigObject::Ptr& object, const Dictionary::Ptr& params);
@@ -35,6 +39,7 @@ public:
 private:
 	static Dictionary::Ptr CreateResult(int code, const String& status, const Dictionary::Ptr& additional = nullptr);
 	static Value GetSingleObjectByNameUsingPermissions(const String& type, const String& value, const ApiUser::Ptr& user);
+	static Dictionary::Ptr ProcessBatchedCheckResult(const Value& rawItem, ScriptFrame& permissionFrame, Expression *permissionFilter);
 };
 
 }
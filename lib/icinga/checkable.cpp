@@ -8,6 +8,7 @@
 #include "base/utility.hpp"
 #include "base/exception.hpp"
 #include "base/timer.hpp"
+#include "base/deadlinescheduler.hpp"
 #include <boost/thread/once.hpp>
 
 using namespace icinga;
@@ -30,6 +31,7 @@ boost::signals2::signal<void (const Checkable::Ptr&, double)> Checkable::OnFlapp
 
 static Timer::Ptr l_CheckablesFireSuppressedNotifications;
 static Timer::Ptr l_CleanDeadlinedExecutions;
+static DeadlineScheduler::Ptr l_AcknowledgementsExpireScheduler;
 
 thread_local std::function<void(const Value& commandLine, const ProcessResult&)> Checkable::ExecuteCommandProcessFinishedHandler;
 
@@ -41,6 +43,38 @@ void Checkable::StaticInitialize()
 	Downtime::OnDowntimeTriggered.connect([](const Downtime::Ptr& downtime) { Checkable::NotifyFlexibleDowntimeStart(downtime); });
 	/* fixed/flexible downtime end */
 	Downtime::OnDowntimeRemoved.connect([](const Downtime::Ptr& downtime) { Checkable::NotifyDowntimeEnd(downtime); });
+
+	Checkable::OnAcknowledgementExpiryChanged.connect([](const Checkable::Ptr& checkable, const Value&) {
+		if (checkable->GetStartCalled() && !checkable->GetStopCalled())
+			checkable->ScheduleAcknowledgementExpiry();
+	});
+
+	/* Changes which don't emit ConfigObject::OnStateChanged, each of them updates the change version once. */
+	auto updateChangeVersion ([](const Checkable::Ptr& checkable) {
+		if (checkable && checkable->IsActive())
+			checkable->UpdateChangeVersion();
+	});
+
+	Checkable::OnAcknowledgementSet.connect([updateChangeVersion](const Checkable::Ptr& checkable, const String&, const String&,
+		AcknowledgementType, bool, bool, double, double, const MessageOrigin::Ptr&) {
+		updateChangeVersion(checkable);
+	});
+
+	Checkable::OnAcknowledgementCleared.connect([updateChangeVersion](const Checkable::Ptr& checkable, const String&, double, const MessageOrigin::Ptr&) {
+		updateChangeVersion(checkable);
+	});
+
+	Checkable::OnFlappingChange.connect([updateChangeVersion](const Checkable::Ptr& checkable, double) {
+		updateChangeVersion(checkable);
+	});
+
+	Checkable::OnNextCheckUpdated.connect(updateChangeVersion);
+
+	for (auto *signal : { &Downtime::OnDowntimeAdded, &Downtime::OnDowntimeRemoved, &Downtime::OnDowntimeStarted, &Downtime::OnDowntimeTriggered }) {
+		signal->connect([updateChangeVersion](const Downtime::Ptr& downtime) {
+			updateChangeVersion(downtime->GetCheckable());
+		});
+	}
 }
 
 Checkable::Checkable()
@@ -110,7 +144,20 @@ void Checkable::Start(bool runtimeCreated)
 		l_CleanDeadlinedExecutions->SetInterval(300);
 		l_CleanDeadlinedExecutions->OnTimerExpired.connect(&Checkable::CleanDeadlinedExecutions);
 		l_CleanDeadlinedExecutions->Start();
+
+		l_AcknowledgementsExpireScheduler = new DeadlineScheduler("acknowledgements_expire", [](const Object::Ptr& object) {
+			AcknowledgementExpireHandler(static_pointer_cast<Checkable>(object));
+		});
 	});
+
+	ScheduleAcknowledgementExpiry();
+}
+
+void Checkable::Stop(bool runtimeRemoved)
+{
+	l_AcknowledgementsExpireScheduler->Cancel(this);
+
+	ObjectImpl<Checkable>::Stop(runtimeRemoved);
 }
 
 void Checkable::AddGroup(const String& name)
@@ -190,6 +237,34 @@ void Checkable::ClearAcknowledgement(const String& removedBy, double changeTime,
 	}
 }
 
+/**
+ * (Re-)arms the deadline at which an expiring acknowledgement gets cleared.
+ */
+void Checkable::ScheduleAcknowledgementExpiry()
+{
+	double expiry = GetAcknowledgementExpiry();
+
+	if (expiry == 0 || GetAcknowledgementRaw() == AcknowledgementNone)
+		l_AcknowledgementsExpireScheduler->Cancel(this);
+	else
+		l_AcknowledgementsExpireScheduler->Schedule(this, expiry);
+}
+
+void Checkable::AcknowledgementExpireHandler(const Checkable::Ptr& checkable)
+{
+	if (!checkable->IsActive()) {
+		/* Start() armed the deadline, but the activation hasn't finished yet. */
+		if (!checkable->GetStopCalled())
+			l_AcknowledgementsExpireScheduler->Schedule(checkable, Utility::GetTime() + 1);
+
+		return;
+	}
+
+	/* Clears the acknowledgement if it has expired. */
+	if (checkable->GetAcknowledgement() != AcknowledgementNone)
+		checkable->ScheduleAcknowledgementExpiry();
+}
+
 Endpoint::Ptr Checkable::GetCommandEndpoint() const
 {
 	return Endpoint::GetByName(GetCommandEndpointRaw());
@@ -290,6 +365,28 @@ void Checkable::ValidateMaxCheckAttempts(const Lazy<int>& lvalue, const Validati
 		BOOST_THROW_EXCEPTION(ValidationError(this, { "max_check_attempts" }, "Value must be greater than 0."));
 }
 
+void Checkable::ValidateCheckPriority(const Lazy<String>& lvalue, const ValidationUtils& utils)
+{
+	ObjectImpl<Checkable>::ValidateCheckPriority(lvalue, utils);
+
+	String priority = lvalue();
+
+	if (priority != "high" && priority != "normal" && priority != "low")
+		BOOST_THROW_EXCEPTION(ValidationError(this, { "check_priority" }, "Priority must be one of 'high', 'normal' or 'low'."));
+}
+
+CheckPriority Checkable::GetCheckPriorityClass() const
+{
+	String priority = GetCheckPriority();
+
+	if (priority == "high")
+		return CheckPriorityHigh;
+	else if (priority == "low")
+		return CheckPriorityLow;
+	else
+		return CheckPriorityNormal;
+}
+
 void Checkable::CleanDeadlinedExecutions(const Timer * const&)
 {
 	double now = Utility::GetTime();
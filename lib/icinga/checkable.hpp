@@ -193,6 +193,9 @@ public:
 	void ValidateCheckInterval(const Lazy<double>& lvalue, const ValidationUtils& value) final;
 	void ValidateRetryInterval(const Lazy<double>& lvalue, const ValidationUtils& value) final;
 	void ValidateMaxCheckAttempts(const Lazy<int>& lvalue, const ValidationUtils& value) final;
+	void ValidateCheckPriority(const Lazy<String>& lvalue, const ValidationUtils& value) final;
+
+	CheckPriority GetCheckPriorityClass() const;
 
 	bool NotificationReasonApplies(NotificationType type);
 	bool NotificationReasonSuppressed(NotificationType type);
@@ -209,6 +212,7 @@ public:
 
 protected:
 	void Start(bool runtimeCreated) override;
+	void Stop(bool runtimeRemoved) override;
 	void OnConfigLoaded() override;
 	void OnAllConfigLoaded() override;
 
@@ -234,6 +238,9 @@ private:
 	static void FireSuppressedNotificationsTimer(const Timer * const&);
 	static void CleanDeadlinedExecutions(const Timer * const&);
 
+	void ScheduleAcknowledgementExpiry();
+	static void AcknowledgementExpireHandler(const Checkable::Ptr& checkable);
+
 	/* Comments */
 	std::set<Comment::Ptr> m_Comments;
 	mutable std::mutex m_CommentMutex;
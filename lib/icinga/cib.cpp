@@ -10,6 +10,12 @@
 #include "base/perfdatavalue.hpp"
 #include "base/configtype.hpp"
 #include "base/statsfunction.hpp"
+#include "base/initialize.hpp"
+#include "base/timer.hpp"
+#include <boost/thread/once.hpp>
+#include <numeric>
+#include <set>
+#include <unordered_map>
 
 using namespace icinga;
 
@@ -58,198 +64,342 @@ int CIB::GetPassiveServiceChecksStatistics(long timespan)
 	return m_PassiveServiceChecksStatistics.UpdateAndGetValues(Utility::GetTime(), timespan);
 }
 
-CheckableCheckStatistics CIB::CalculateHostCheckStats()
+/* Indices of the host/service counters. A checkable's cached flags have the
+ * corresponding bits set, hosts only use the first two state counters. */
+enum CIBCounter
+{
+	CIBCounterState0,
+	CIBCounterState1,
+	CIBCounterState2,
+	CIBCounterState3,
+	CIBCounterPending,
+	CIBCounterUnreachable,
+	CIBCounterFlapping,
+	CIBCounterInDowntime,
+	CIBCounterAcknowledged,
+	CIBCounterHandled,
+	CIBCounterProblem,
+	CIBCounterCount
+};
+
+struct CIBCheckableEntry
+{
+	uint64_t Generation;
+	bool Active;
+	bool IsHost;
+	unsigned int Flags;
+	bool HasCheckResult;
+	double Latency;
+	double ExecutionTime;
+};
+
+struct CIBTypeStatistics
+{
+	int64_t Counters[CIBCounterCount] = {};
+	std::multiset<double> Latencies;
+	std::multiset<double> ExecutionTimes;
+	double SumLatency = 0;
+	double SumExecutionTime = 0;
+};
+
+std::mutex CIB::m_Mutex;
+static uint64_t l_Generation = 0;
+static std::unordered_map<Checkable *, CIBCheckableEntry> l_CheckableEntries;
+static CIBTypeStatistics l_HostStatistics;
+static CIBTypeStatistics l_ServiceStatistics;
+static Timer::Ptr l_ReconcileTimer;
+
+INITIALIZE_ONCE(&CIB::StaticInitialize);
+
+void CIB::StaticInitialize()
 {
-	double min_latency = -1, max_latency = 0, sum_latency = 0;
-	int count_latency = 0;
-	double min_execution_time = -1, max_execution_time = 0, sum_execution_time = 0;
-	int count_execution_time = 0;
-	bool checkresult = false;
+	Checkable::OnNewCheckResult.connect([](const Checkable::Ptr& checkable, const CheckResult::Ptr&, const MessageOrigin::Ptr&) {
+		UpdateCheckableStatistics(checkable);
+	});
+	Checkable::OnStateChange.connect([](const Checkable::Ptr& checkable, const CheckResult::Ptr&, StateType, const MessageOrigin::Ptr&) {
+		UpdateCheckableStatistics(checkable);
+	});
+	Checkable::OnReachabilityChanged.connect([](const Checkable::Ptr&, const CheckResult::Ptr&, const std::set<Checkable::Ptr>& children, const MessageOrigin::Ptr&) {
+		UpdateChildrenStatistics(children);
+	});
+	Checkable::OnFlappingChange.connect([](const Checkable::Ptr& checkable, double) {
+		UpdateCheckableStatistics(checkable);
+	});
+	Checkable::OnAcknowledgementSet.connect([](const Checkable::Ptr& checkable, const String&, const String&, AcknowledgementType, bool, bool, double, double, const MessageOrigin::Ptr&) {
+		UpdateCheckableStatistics(checkable);
+	});
+	Checkable::OnAcknowledgementCleared.connect([](const Checkable::Ptr& checkable, const String&, double, const MessageOrigin::Ptr&) {
+		UpdateCheckableStatistics(checkable);
+	});
+
+	for (auto signal : { &Downtime::OnDowntimeAdded, &Downtime::OnDowntimeRemoved, &Downtime::OnDowntimeStarted, &Downtime::OnDowntimeTriggered }) {
+		signal->connect([](const Downtime::Ptr& downtime) {
+			Checkable::Ptr checkable = downtime->GetCheckable();
+
+			if (checkable)
+				UpdateCheckableStatistics(checkable);
+		});
+	}
 
-	for (const Host::Ptr& host : ConfigType::GetObjectsByType<Host>()) {
-		ObjectLock olock(host);
+	ConfigObject::OnActiveChanged.connect([](const ConfigObject::Ptr& object, const Value&) {
+		Checkable::Ptr checkable = dynamic_pointer_cast<Checkable>(object);
 
-		CheckResult::Ptr cr = host->GetLastCheckResult();
+		if (!checkable)
+			return;
 
-		if (!cr)
-			continue;
+		UpdateCheckableStatistics(checkable);
 
-		/* set to true, we have a checkresult */
-		checkresult = true;
+		static boost::once_flag once = BOOST_ONCE_INIT;
 
-		/* latency */
-		double latency = cr->CalculateLatency();
+		boost::call_once(once, []() {
+			l_ReconcileTimer = new Timer();
+			l_ReconcileTimer->SetInterval(300);
+			l_ReconcileTimer->OnTimerExpired.connect([](const Timer * const&) { ReconcileStatistics(); });
+			l_ReconcileTimer->Start();
+		});
+	});
+}
 
-		if (min_latency == -1 || latency < min_latency)
-			min_latency = latency;
+static void ApplyCheckableEntry(const CIBCheckableEntry& entry, int sign)
+{
+	CIBTypeStatistics& stats = entry.IsHost ? l_HostStatistics : l_ServiceStatistics;
 
-		if (latency > max_latency)
-			max_latency = latency;
+	for (int i = 0; i < CIBCounterCount; i++) {
+		if (entry.Flags & (1u << i))
+			stats.Counters[i] += sign;
+	}
 
-		sum_latency += latency;
-		count_latency++;
+	if (!entry.HasCheckResult)
+		return;
 
-		/* execution_time */
-		double execution_time = cr->CalculateExecutionTime();
+	if (sign > 0) {
+		stats.Latencies.insert(entry.Latency);
+		stats.ExecutionTimes.insert(entry.ExecutionTime);
+	} else {
+		stats.Latencies.erase(stats.Latencies.find(entry.Latency));
+		stats.ExecutionTimes.erase(stats.ExecutionTimes.find(entry.ExecutionTime));
+	}
 
-		if (min_execution_time == -1 || execution_time < min_execution_time)
-			min_execution_time = execution_time;
+	stats.SumLatency += sign * entry.Latency;
+	stats.SumExecutionTime += sign * entry.ExecutionTime;
+}
 
-		if (execution_time > max_execution_time)
-			max_execution_time = execution_time;
+/**
+ * Recalculates the cached flags of a checkable and applies the difference to
+ * the counters. Inactive checkables aren't counted.
+ *
+ * @returns Whether the reachability of the checkable changed.
+ */
+bool CIB::UpdateCheckableStatistics(const Checkable::Ptr& checkable)
+{
+	Host::Ptr host;
+	Service::Ptr service;
+	tie(host, service) = GetHostService(checkable);
+
+	CIBCheckableEntry entry = {};
 
-		sum_execution_time += execution_time;
-		count_execution_time++;
+	/* Concurrent updates of the same checkable may finish in any order, the one which started last wins. */
+	{
+		std::unique_lock<std::mutex> lock(m_Mutex);
+		entry.Generation = ++l_Generation;
 	}
 
-	if (!checkresult) {
-		min_latency = 0;
-		min_execution_time = 0;
+	/* The flags are calculated without any lock, walking the dependencies and downtimes may take a while. */
+	entry.Active = checkable->IsActive();
+
+	if (entry.Active) {
+		entry.IsHost = !service;
+
+		CheckResult::Ptr cr = checkable->GetLastCheckResult();
+		bool reachable = checkable->IsReachable();
+
+		if (service)
+			entry.Flags |= 1u << service->GetState();
+		else if (reachable)
+			entry.Flags |= 1u << host->GetState();
+
+		if (!reachable)
+			entry.Flags |= 1u << CIBCounterUnreachable;
+
+		if (cr) {
+			entry.HasCheckResult = true;
+			entry.Latency = cr->CalculateLatency();
+			entry.ExecutionTime = cr->CalculateExecutionTime();
+		} else
+			entry.Flags |= 1u << CIBCounterPending;
+
+		if (checkable->IsFlapping())
+			entry.Flags |= 1u << CIBCounterFlapping;
+		if (checkable->IsInDowntime())
+			entry.Flags |= 1u << CIBCounterInDowntime;
+		if (checkable->IsAcknowledged())
+			entry.Flags |= 1u << CIBCounterAcknowledged;
+
+		if (checkable->GetHandled())
+			entry.Flags |= 1u << CIBCounterHandled;
+		if (checkable->GetProblem())
+			entry.Flags |= 1u << CIBCounterProblem;
 	}
 
-	CheckableCheckStatistics ccs;
+	std::unique_lock<std::mutex> lock(m_Mutex);
 
-	ccs.min_latency = min_latency;
-	ccs.max_latency = max_latency;
-	ccs.avg_latency = sum_latency / count_latency;
-	ccs.min_execution_time = min_execution_time;
-	ccs.max_execution_time = max_execution_time;
-	ccs.avg_execution_time = sum_execution_time / count_execution_time;
+	unsigned int oldFlags = 0;
+	auto it (l_CheckableEntries.find(checkable.get()));
 
-	return ccs;
-}
+	if (it != l_CheckableEntries.end()) {
+		if (it->second.Generation > entry.Generation)
+			return false;
 
-CheckableCheckStatistics CIB::CalculateServiceCheckStats()
-{
-	double min_latency = -1, max_latency = 0, sum_latency = 0;
-	int count_latency = 0;
-	double min_execution_time = -1, max_execution_time = 0, sum_execution_time = 0;
-	int count_execution_time = 0;
-	bool checkresult = false;
+		oldFlags = it->second.Flags;
 
-	for (const Service::Ptr& service : ConfigType::GetObjectsByType<Service>()) {
-		ObjectLock olock(service);
+		if (it->second.Active)
+			ApplyCheckableEntry(it->second, -1);
+	}
 
-		CheckResult::Ptr cr = service->GetLastCheckResult();
+	/* Inactive checkables are kept until the next reconciliation, so an older update can't count them again. */
+	if (entry.Active)
+		ApplyCheckableEntry(entry, 1);
 
-		if (!cr)
-			continue;
+	l_CheckableEntries[checkable.get()] = entry;
+
+	return (oldFlags ^ entry.Flags) & (1u << CIBCounterUnreachable);
+}
 
-		/* set to true, we have a checkresult */
-		checkresult = true;
+/**
+ * Updates the children of a checkable whose state changed, and their children
+ * in turn as long as their reachability changes.
+ */
+void CIB::UpdateChildrenStatistics(const std::set<Checkable::Ptr>& children)
+{
+	std::set<Checkable::Ptr> visited;
+	std::vector<Checkable::Ptr> pending (children.begin(), children.end());
 
-		/* latency */
-		double latency = cr->CalculateLatency();
+	while (!pending.empty()) {
+		Checkable::Ptr child = std::move(pending.back());
+		pending.pop_back();
 
-		if (min_latency == -1 || latency < min_latency)
-			min_latency = latency;
+		if (!visited.insert(child).second)
+			continue;
 
-		if (latency > max_latency)
-			max_latency = latency;
+		if (UpdateCheckableStatistics(child)) {
+			for (const Checkable::Ptr& grandchild : child->GetChildren())
+				pending.push_back(grandchild);
+		}
+	}
+}
 
-		sum_latency += latency;
-		count_latency++;
+/**
+ * Catches up with changes which aren't signalled, e.g. downtimes coming into
+ * effect between events or transitive reachability changes.
+ */
+void CIB::ReconcileStatistics()
+{
+	uint64_t generation;
 
-		/* execution_time */
-		double execution_time = cr->CalculateExecutionTime();
+	{
+		std::unique_lock<std::mutex> lock(m_Mutex);
+		generation = l_Generation;
+	}
 
-		if (min_execution_time == -1 || execution_time < min_execution_time)
-			min_execution_time = execution_time;
+	for (const Host::Ptr& host : ConfigType::GetObjectsByType<Host>())
+		UpdateCheckableStatistics(host);
 
-		if (execution_time > max_execution_time)
-			max_execution_time = execution_time;
+	for (const Service::Ptr& service : ConfigType::GetObjectsByType<Service>())
+		UpdateCheckableStatistics(service);
 
-		sum_execution_time += execution_time;
-		count_execution_time++;
+	std::unique_lock<std::mutex> lock(m_Mutex);
+
+	/* Forget the inactive checkables recorded before the reconciliation started,
+	 * the updates which were running back then have finished. */
+	for (auto it (l_CheckableEntries.begin()); it != l_CheckableEntries.end();) {
+		if (!it->second.Active && it->second.Generation <= generation)
+			it = l_CheckableEntries.erase(it);
+		else
+			++it;
 	}
 
-	if (!checkresult) {
-		min_latency = 0;
-		min_execution_time = 0;
+	/* Get rid of the rounding errors accumulated by the incremental updates. */
+
+	for (CIBTypeStatistics *stats : { &l_HostStatistics, &l_ServiceStatistics }) {
+		stats->SumLatency = std::accumulate(stats->Latencies.begin(), stats->Latencies.end(), 0.0);
+		stats->SumExecutionTime = std::accumulate(stats->ExecutionTimes.begin(), stats->ExecutionTimes.end(), 0.0);
 	}
+}
 
+static CheckableCheckStatistics GetCheckStatistics(const CIBTypeStatistics& stats)
+{
 	CheckableCheckStatistics ccs;
 
-	ccs.min_latency = min_latency;
-	ccs.max_latency = max_latency;
-	ccs.avg_latency = sum_latency / count_latency;
-	ccs.min_execution_time = min_execution_time;
-	ccs.max_execution_time = max_execution_time;
-	ccs.avg_execution_time = sum_execution_time / count_execution_time;
+	if (stats.Latencies.empty()) {
+		ccs.min_latency = 0;
+		ccs.max_latency = 0;
+		ccs.min_execution_time = 0;
+		ccs.max_execution_time = 0;
+	} else {
+		ccs.min_latency = *stats.Latencies.begin();
+		ccs.max_latency = std::max(*stats.Latencies.rbegin(), 0.0);
+		ccs.min_execution_time = *stats.ExecutionTimes.begin();
+		ccs.max_execution_time = std::max(*stats.ExecutionTimes.rbegin(), 0.0);
+	}
+
+	ccs.avg_latency = stats.SumLatency / stats.Latencies.size();
+	ccs.avg_execution_time = stats.SumExecutionTime / stats.ExecutionTimes.size();
 
 	return ccs;
 }
 
+CheckableCheckStatistics CIB::CalculateHostCheckStats()
+{
+	std::unique_lock<std::mutex> lock(m_Mutex);
+
+	return GetCheckStatistics(l_HostStatistics);
+}
+
+CheckableCheckStatistics CIB::CalculateServiceCheckStats()
+{
+	std::unique_lock<std::mutex> lock(m_Mutex);
+
+	return GetCheckStatistics(l_ServiceStatistics);
+}
+
 ServiceStatistics CIB::CalculateServiceStats()
 {
-	ServiceStatistics ss = {};
-
-	for (const Service::Ptr& service : ConfigType::GetObjectsByType<Service>()) {
-		ObjectLock olock(service);
-
-		if (service->GetState() == ServiceOK)
-			ss.services_ok++;
-		if (service->GetState() == ServiceWarning)
-			ss.services_warning++;
-		if (service->GetState() == ServiceCritical)
-			ss.services_critical++;
-		if (service->GetState() == ServiceUnknown)
-			ss.services_unknown++;
-
-		CheckResult::Ptr cr = service->GetLastCheckResult();
-
-		if (!cr)
-			ss.services_pending++;
-
-		if (!service->IsReachable())
-			ss.services_unreachable++;
-
-		if (service->IsFlapping())
-			ss.services_flapping++;
-		if (service->IsInDowntime())
-			ss.services_in_downtime++;
-		if (service->IsAcknowledged())
-			ss.services_acknowledged++;
-
-		if (service->GetHandled())
-			ss.services_handled++;
-		if (service->GetProblem())
-			ss.services_problem++;
-	}
+	std::unique_lock<std::mutex> lock(m_Mutex);
+
+	const int64_t *counters = l_ServiceStatistics.Counters;
+	ServiceStatistics ss;
+
+	ss.services_ok = counters[ServiceOK];
+	ss.services_warning = counters[ServiceWarning];
+	ss.services_critical = counters[ServiceCritical];
+	ss.services_unknown = counters[ServiceUnknown];
+	ss.services_pending = counters[CIBCounterPending];
+	ss.services_unreachable = counters[CIBCounterUnreachable];
+	ss.services_flapping = counters[CIBCounterFlapping];
+	ss.services_in_downtime = counters[CIBCounterInDowntime];
+	ss.services_acknowledged = counters[CIBCounterAcknowledged];
+	ss.services_handled = counters[CIBCounterHandled];
+	ss.services_problem = counters[CIBCounterProblem];
 
 	return ss;
 }
 
 HostStatistics CIB::CalculateHostStats()
 {
-	HostStatistics hs = {};
-
-	for (const Host::Ptr& host : ConfigType::GetObjectsByType<Host>()) {
-		ObjectLock olock(host);
-
-		if (host->IsReachable()) {
-			if (host->GetState() == HostUp)
-				hs.hosts_up++;
-			if (host->GetState() == HostDown)
-				hs.hosts_down++;
-		} else
-			hs.hosts_unreachable++;
-
-		if (!host->GetLastCheckResult())
-			hs.hosts_pending++;
-
-		if (host->IsFlapping())
-			hs.hosts_flapping++;
-		if (host->IsInDowntime())
-			hs.hosts_in_downtime++;
-		if (host->IsAcknowledged())
-			hs.hosts_acknowledged++;
-
-		if (host->GetHandled())
-			hs.hosts_handled++;
-		if (host->GetProblem())
-			hs.hosts_problem++;
-	}
+	std::unique_lock<std::mutex> lock(m_Mutex);
+
+	const int64_t *counters = l_HostStatistics.Counters;
+	HostStatistics hs;
+
+	hs.hosts_up = counters[HostUp];
+	hs.hosts_down = counters[HostDown];
+	hs.hosts_unreachable = counters[CIBCounterUnreachable];
+	hs.hosts_pending = counters[CIBCounterPending];
+	hs.hosts_flapping = counters[CIBCounterFlapping];
+	hs.hosts_in_downtime = counters[CIBCounterInDowntime];
+	hs.hosts_acknowledged = counters[CIBCounterAcknowledged];
+	hs.hosts_handled = counters[CIBCounterHandled];
+	hs.hosts_problem = counters[CIBCounterProblem];
 
 	return hs;
 }
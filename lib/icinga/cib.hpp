@@ -4,6 +4,7 @@
 #define CIB_H
 
 #include "icinga/i2-icinga.hpp"
+#include "icinga/checkable.hpp"
 #include "base/ringbuffer.hpp"
 #include "base/dictionary.hpp"
 #include "base/array.hpp"
@@ -50,6 +51,10 @@ struct HostStatistics {
  * Common Information Base class. Holds some statistics (and will likely be
  * removed/refactored).
  *
+ * The host and service statistics are maintained incrementally from the
+ * checkables' events and periodically reconciled against the objects, so
+ * querying them doesn't iterate all hosts and services.
+ *
  * @ingroup icinga
  */
 class CIB
@@ -76,9 +81,15 @@ public:
 
 	static void StatsFunc(const Dictionary::Ptr& status, const Array::Ptr& perfdata);
 
+	static void StaticInitialize();
+	static void ReconcileStatistics();
+
 private:
 	CIB();
 
+	static bool UpdateCheckableStatistics(const Checkable::Ptr& checkable);
+	static void UpdateChildrenStatistics(const std::set<Checkable::Ptr>& children);
+
 	static std::mutex m_Mutex;
 	static RingBuffer m_ActiveHostChecksStatistics;
 	static RingBuffer m_PassiveHostChecksStatistics;
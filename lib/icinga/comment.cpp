@@ -6,7 +6,7 @@
 #include "remote/configobjectutility.hpp"
 #include "base/utility.hpp"
 #include "base/configtype.hpp"
-#include "base/timer.hpp"
+#include "base/deadlinescheduler.hpp"
 #include <boost/thread/once.hpp>
 
 using namespace icinga;
@@ -14,7 +14,7 @@ using namespace icinga;
 static int l_NextCommentID = 1;
 static std::mutex l_CommentMutex;
 static std::map<int, String> l_LegacyCommentsCache;
-static Timer::Ptr l_CommentsExpireTimer;
+static DeadlineScheduler::Ptr l_CommentsExpireScheduler;
 
 boost::signals2::signal<void (const Comment::Ptr&)> Comment::OnCommentAdded;
 boost::signals2::signal<void (const Comment::Ptr&)> Comment::OnCommentRemoved;
@@ -22,6 +22,16 @@ boost::signals2::signal<void (const Comment::Ptr&, const String&, double, const
 
 REGISTER_TYPE(Comment);
 
+INITIALIZE_ONCE(&Comment::StaticInitialize);
+
+void Comment::StaticInitialize()
+{
+	Comment::OnExpireTimeChanged.connect([](const Comment::Ptr& comment, const Value&) {
+		if (comment->GetStartCalled() && !comment->GetStopCalled())
+			comment->ScheduleExpiry();
+	});
+}
+
 String CommentNameComposer::MakeName(const String& shortName, const Object::Ptr& context) const
 {
 	Comment::Ptr comment = dynamic_pointer_cast<Comment>(context);
@@ -81,10 +91,9 @@ void Comment::Start(bool runtimeCreated)
 	static boost::once_flag once = BOOST_ONCE_INIT;
 
 	boost::call_once(once, [this]() {
-		l_CommentsExpireTimer = new Timer();
-		l_CommentsExpireTimer->SetInterval(60);
-		l_CommentsExpireTimer->OnTimerExpired.connect([](const Timer * const&) { CommentsExpireTimerHandler(); });
-		l_CommentsExpireTimer->Start();
+		l_CommentsExpireScheduler = new DeadlineScheduler("comments_expire", [](const Object::Ptr& object) {
+			CommentExpireHandler(static_pointer_cast<Comment>(object));
+		});
 	});
 
 	{
@@ -99,10 +108,14 @@ void Comment::Start(bool runtimeCreated)
 
 	if (runtimeCreated)
 		OnCommentAdded(this);
+
+	ScheduleExpiry();
 }
 
 void Comment::Stop(bool runtimeRemoved)
 {
+	l_CommentsExpireScheduler->Cancel(this);
+
 	GetCheckable()->UnregisterComment(this);
 
 	if (runtimeRemoved)
@@ -237,22 +250,31 @@ String Comment::GetCommentIDFromLegacyID(int id)
 	return it->second;
 }
 
-void Comment::CommentsExpireTimerHandler()
+/**
+ * (Re-)arms the expiry deadline of this comment.
+ */
+void Comment::ScheduleExpiry()
 {
-	std::vector<Comment::Ptr> comments;
-
-	for (const Comment::Ptr& comment : ConfigType::GetObjectsByType<Comment>()) {
-		comments.push_back(comment);
-	}
+	/* Do not remove persistent comments from an acknowledgement */
+	if (GetExpireTime() == 0 || (GetEntryType() == CommentAcknowledgement && GetPersistent()))
+		l_CommentsExpireScheduler->Cancel(this);
+	else
+		l_CommentsExpireScheduler->Schedule(this, GetExpireTime());
+}
 
-	for (const Comment::Ptr& comment : comments) {
-		/* Only remove comments which are activated after daemon start. */
-		if (comment->IsActive() && comment->IsExpired()) {
-			/* Do not remove persistent comments from an acknowledgement */
-			if (comment->GetEntryType() == CommentAcknowledgement && comment->GetPersistent())
-				continue;
+void Comment::CommentExpireHandler(const Comment::Ptr& comment)
+{
+	/* Only remove comments which are activated after daemon start. */
+	if (!comment->IsActive()) {
+		/* Start() armed the deadline, but the activation hasn't finished yet. */
+		if (!comment->GetStopCalled())
+			l_CommentsExpireScheduler->Schedule(comment, Utility::GetTime() + 1);
 
-			RemoveComment(comment->GetName());
-		}
+		return;
 	}
+
+	if (comment->IsExpired())
+		RemoveComment(comment->GetName());
+	else
+		comment->ScheduleExpiry();
 }
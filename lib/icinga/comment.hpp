@@ -29,9 +29,12 @@ public:
 	intrusive_ptr<Checkable> GetCheckable() const;
 
 	bool IsExpired() const;
+	void ScheduleExpiry();
 
 	void SetRemovalInfo(const String& removedBy, double removeTime, const MessageOrigin::Ptr& origin = nullptr);
 
+	static void StaticInitialize();
+
 	static int GetNextCommentID();
 
 	static String AddComment(const intrusive_ptr<Checkable>& checkable, CommentType entryType,
@@ -51,7 +54,7 @@ protected:
 private:
 	ObjectImpl<Checkable>::Ptr m_Checkable;
 
-	static void CommentsExpireTimerHandler();
+	static void CommentExpireHandler(const Comment::Ptr& comment);
 };
 
 }
@@ -6,8 +6,8 @@
 #include "icinga/scheduleddowntime.hpp"
 #include "remote/configobjectutility.hpp"
 #include "base/configtype.hpp"
+#include "base/deadlinescheduler.hpp"
 #include "base/utility.hpp"
-#include "base/timer.hpp"
 #include <boost/thread/once.hpp>
 #include <cmath>
 
@@ -16,8 +16,8 @@ using namespace icinga;
 static int l_NextDowntimeID = 1;
 static std::mutex l_DowntimeMutex;
 static std::map<int, String> l_LegacyDowntimesCache;
-static Timer::Ptr l_DowntimesExpireTimer;
-static Timer::Ptr l_DowntimesStartTimer;
+static DeadlineScheduler::Ptr l_DowntimesStartScheduler;
+static DeadlineScheduler::Ptr l_DowntimesExpireScheduler;
 
 boost::signals2::signal<void (const Downtime::Ptr&)> Downtime::OnDowntimeAdded;
 boost::signals2::signal<void (const Downtime::Ptr&)> Downtime::OnDowntimeRemoved;
@@ -34,6 +34,24 @@ void Downtime::StaticInitialize()
 	ScriptGlobal::Set("Icinga.DowntimeNoChildren", "DowntimeNoChildren", true);
 	ScriptGlobal::Set("Icinga.DowntimeTriggeredChildren", "DowntimeTriggeredChildren", true);
 	ScriptGlobal::Set("Icinga.DowntimeNonTriggeredChildren", "DowntimeNonTriggeredChildren", true);
+
+	auto reschedule ([](const Downtime::Ptr& downtime, const Value&) {
+		if (downtime->GetStartCalled() && !downtime->GetStopCalled())
+			downtime->ScheduleTransitions();
+	});
+
+	Downtime::OnStartTimeChanged.connect(reschedule);
+	Downtime::OnEndTimeChanged.connect(reschedule);
+	Downtime::OnTriggerTimeChanged.connect(reschedule);
+	Downtime::OnDurationChanged.connect(reschedule);
+
+	/* Starting and triggering a downtime change it as well as its checkable, see Checkable::StaticInitialize(). */
+	for (auto *signal : { &Downtime::OnDowntimeStarted, &Downtime::OnDowntimeTriggered }) {
+		signal->connect([](const Downtime::Ptr& downtime) {
+			if (downtime->IsActive())
+				downtime->UpdateChangeVersion();
+		});
+	}
 }
 
 String DowntimeNameComposer::MakeName(const String& shortName, const Object::Ptr& context) const
@@ -93,15 +111,13 @@ void Downtime::Start(bool runtimeCreated)
 	static boost::once_flag once = BOOST_ONCE_INIT;
 
 	boost::call_once(once, [this]() {
-		l_DowntimesStartTimer = new Timer();
-		l_DowntimesStartTimer->SetInterval(5);
-		l_DowntimesStartTimer->OnTimerExpired.connect([](const Timer * const&){ DowntimesStartTimerHandler(); });
-		l_DowntimesStartTimer->Start();
-
-		l_DowntimesExpireTimer = new Timer();
-		l_DowntimesExpireTimer->SetInterval(60);
-		l_DowntimesExpireTimer->OnTimerExpired.connect([](const Timer * const&) { DowntimesExpireTimerHandler(); });
-		l_DowntimesExpireTimer->Start();
+		l_DowntimesStartScheduler = new DeadlineScheduler("downtimes_start", [](const Object::Ptr& object) {
+			DowntimeStartHandler(static_pointer_cast<Downtime>(object));
+		});
+
+		l_DowntimesExpireScheduler = new DeadlineScheduler("downtimes_expire", [](const Object::Ptr& object) {
+			DowntimeExpireHandler(static_pointer_cast<Downtime>(object));
+		});
 	});
 
 	{
@@ -142,10 +158,15 @@ void Downtime::Start(bool runtimeCreated)
 		/* Trigger fixed downtime immediately. */
 		TriggerDowntime(std::fmax(GetStartTime(), GetEntryTime()));
 	}
+
+	ScheduleTransitions();
 }
 
 void Downtime::Stop(bool runtimeRemoved)
 {
+	l_DowntimesStartScheduler->Cancel(this);
+	l_DowntimesExpireScheduler->Cancel(this);
+
 	GetCheckable()->UnregisterDowntime(this);
 
 	Downtime::Ptr parent = GetByName(GetParent());
@@ -481,31 +502,75 @@ String Downtime::GetDowntimeIDFromLegacyID(int id)
 	return it->second;
 }
 
-void Downtime::DowntimesStartTimerHandler()
+/**
+ * Returns the time at which IsExpired() starts to return true
+ * given the current trigger state.
+ */
+double Downtime::GetExpiryTime() const
 {
-	/* Start fixed downtimes. Flexible downtimes will be triggered on-demand. */
-	for (const Downtime::Ptr& downtime : ConfigType::GetObjectsByType<Downtime>()) {
-		if (downtime->IsActive() &&
-			downtime->CanBeTriggered() &&
-			downtime->GetFixed()) {
-			/* Send notifications. */
-			OnDowntimeStarted(downtime);
-
-			/* Trigger fixed downtime immediately. */
-			downtime->TriggerDowntime(std::fmax(downtime->GetStartTime(), downtime->GetEntryTime()));
-		}
+	if (!GetFixed()) {
+		double triggerTime = GetTriggerTime();
+
+		if (triggerTime > 0)
+			return triggerTime + GetDuration();
 	}
+
+	return GetEndTime();
+}
+
+/**
+ * (Re-)arms the start and expiry deadlines of this downtime. Has to be
+ * called whenever one of the timestamps they depend on changes.
+ */
+void Downtime::ScheduleTransitions()
+{
+	/* Flexible downtimes will be triggered on-demand. */
+	if (GetFixed() && GetTriggerTime() == 0 && GetEndTime() > Utility::GetTime())
+		l_DowntimesStartScheduler->Schedule(this, GetStartTime());
+	else
+		l_DowntimesStartScheduler->Cancel(this);
+
+	if (!HasValidConfigOwner())
+		l_DowntimesExpireScheduler->Schedule(this, 0);
+	else
+		l_DowntimesExpireScheduler->Schedule(this, GetExpiryTime());
 }
 
-void Downtime::DowntimesExpireTimerHandler()
+void Downtime::DowntimeStartHandler(const Downtime::Ptr& downtime)
 {
-	for (const Downtime::Ptr& downtime : ConfigType::GetObjectsByType<Downtime>()) {
-		/* Only remove downtimes which are activated after daemon start. */
-		if (downtime->IsActive() && (downtime->IsExpired() || !downtime->HasValidConfigOwner()))
-			RemoveDowntime(downtime->GetName(), false, false, true);
+	if (!downtime->IsActive()) {
+		/* Start() armed the deadline, but the activation hasn't finished yet. */
+		if (!downtime->GetStopCalled())
+			l_DowntimesStartScheduler->Schedule(downtime, Utility::GetTime() + 1);
+
+		return;
+	}
+
+	if (downtime->CanBeTriggered() && downtime->GetFixed()) {
+		/* Send notifications. */
+		OnDowntimeStarted(downtime);
+
+		/* Trigger fixed downtime immediately. */
+		downtime->TriggerDowntime(std::fmax(downtime->GetStartTime(), downtime->GetEntryTime()));
 	}
 }
 
+void Downtime::DowntimeExpireHandler(const Downtime::Ptr& downtime)
+{
+	/* Only remove downtimes which are activated after daemon start. */
+	if (!downtime->IsActive()) {
+		if (!downtime->GetStopCalled())
+			l_DowntimesExpireScheduler->Schedule(downtime, Utility::GetTime() + 1);
+
+		return;
+	}
+
+	if (downtime->IsExpired() || !downtime->HasValidConfigOwner())
+		RemoveDowntime(downtime->GetName(), false, false, true);
+	else
+		downtime->ScheduleTransitions();
+}
+
 void Downtime::ValidateStartTime(const Lazy<Timestamp>& lvalue, const ValidationUtils& utils)
 {
 	ObjectImpl<Downtime>::ValidateStartTime(lvalue, utils);
@@ -60,6 +60,7 @@ public:
 	std::set<Downtime::Ptr> GetChildren() const;
 
 	void TriggerDowntime(double triggerTime);
+	void ScheduleTransitions();
 	void SetRemovalInfo(const String& removedBy, double removeTime, const MessageOrigin::Ptr& origin = nullptr);
 
 	void OnAllConfigLoaded() override;
@@ -82,9 +83,10 @@ private:
 	mutable std::mutex m_ChildrenMutex;
 
 	bool CanBeTriggered();
+	double GetExpiryTime() const;
 
-	static void DowntimesStartTimerHandler();
-	static void DowntimesExpireTimerHandler();
+	static void DowntimeStartHandler(const Downtime::Ptr& downtime);
+	static void DowntimeExpireHandler(const Downtime::Ptr& downtime);
 };
 
 }
@@ -2,6 +2,7 @@
 
 #include "icinga/hostgroup.hpp"
 #include "icinga/hostgroup-ti.cpp"
+#include "remote/filterutility.hpp"
 #include "config/objectrule.hpp"
 #include "config/configitem.hpp"
 #include "base/configtype.hpp"
@@ -16,6 +17,32 @@ REGISTER_TYPE(HostGroup);
 
 INITIALIZE_ONCE([]() {
 	ObjectRule::RegisterType("HostGroup");
+
+	FilterUtility::RegisterIndex("Host", "host.groups", FilterIndexKind::Contains, [](const String& name) {
+		std::vector<ConfigObject::Ptr> hosts;
+		HostGroup::Ptr group = HostGroup::GetByName(name);
+
+		if (group) {
+			for (const Host::Ptr& host : group->GetMembers())
+				hosts.emplace_back(host);
+		}
+
+		return hosts;
+	});
+
+	FilterUtility::RegisterIndex("Service", "host.groups", FilterIndexKind::Contains, [](const String& name) {
+		std::vector<ConfigObject::Ptr> services;
+		HostGroup::Ptr group = HostGroup::GetByName(name);
+
+		if (group) {
+			for (const Host::Ptr& host : group->GetMembers()) {
+				for (const Service::Ptr& service : host->GetServices())
+					services.emplace_back(service);
+			}
+		}
+
+		return services;
+	});
 });
 
 bool HostGroup::EvaluateObjectRule(const Host::Ptr& host, const ConfigItem::Ptr& group)
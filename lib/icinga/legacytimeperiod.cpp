@@ -159,50 +159,29 @@ boost::gregorian::date LegacyTimePeriod::GetEndOfMonthDay(int year, int month)
 }
 
 /**
- * Finds the first day on or after the day given by reference and writes the beginning and end time of that day to
- * the output parameters begin and end.
+ * Parses a day specification into its components so that it can be expanded
+ * for many reference times without parsing it again.
  *
- * @param timespec Day to find, for example "2021-10-20", "sunday", ...
- * @param begin if != nullptr, set to 00:00:00 on that day
- * @param end if != nullptr, set to 24:00:00 on that day (i.e. 00:00:00 of the next day)
- * @param reference Time to begin the search at
+ * @param timespec Day specification, for example "2021-10-20", "sunday", ...
+ * @return The parsed specification
  */
-void LegacyTimePeriod::ParseTimeSpec(const String& timespec, tm *begin, tm *end, const tm *reference)
+LegacyTimeSpec LegacyTimePeriod::CompileTimeSpec(const String& timespec)
 {
+	LegacyTimeSpec spec;
+
 	/* YYYY-MM-DD */
 	if (timespec.GetLength() == 10 && timespec[4] == '-' && timespec[7] == '-') {
-		int year = Convert::ToLong(timespec.SubStr(0, 4));
-		int month = Convert::ToLong(timespec.SubStr(5, 2));
-		int day = Convert::ToLong(timespec.SubStr(8, 2));
+		spec.Type = LegacyTimeSpec::TimeSpecDate;
+		spec.Year = Convert::ToLong(timespec.SubStr(0, 4));
+		spec.Month = Convert::ToLong(timespec.SubStr(5, 2)) - 1;
+		spec.Day = Convert::ToLong(timespec.SubStr(8, 2));
 
-		if (month < 1 || month > 12)
+		if (spec.Month < 0 || spec.Month > 11)
 			BOOST_THROW_EXCEPTION(std::invalid_argument("Invalid month in time specification: " + timespec));
-		if (day < 1 || day > 31)
+		if (spec.Day < 1 || spec.Day > 31)
 			BOOST_THROW_EXCEPTION(std::invalid_argument("Invalid day in time specification: " + timespec));
 
-		if (begin) {
-			*begin = *reference;
-			begin->tm_year = year - 1900;
-			begin->tm_mon = month - 1;
-			begin->tm_mday = day;
-			begin->tm_hour = 0;
-			begin->tm_min = 0;
-			begin->tm_sec = 0;
-			begin->tm_isdst = -1;
-		}
-
-		if (end) {
-			*end = *reference;
-			end->tm_year = year - 1900;
-			end->tm_mon = month - 1;
-			end->tm_mday = day;
-			end->tm_hour = 24;
-			end->tm_min = 0;
-			end->tm_sec = 0;
-			end->tm_isdst = -1;
-		}
-
-		return;
+		return spec;
 	}
 
 	std::vector<String> tokens = timespec.Split(" ");
@@ -210,114 +189,182 @@ void LegacyTimePeriod::ParseTimeSpec(const String& timespec, tm *begin, tm *end,
 	int mon = -1;
 
 	if (tokens.size() > 1 && (tokens[0] == "day" || (mon = MonthFromString(tokens[0])) != -1)) {
-		if (mon == -1)
-			mon = reference->tm_mon;
+		spec.Type = LegacyTimeSpec::TimeSpecMonthDay;
+		spec.Month = mon;
+		spec.Day = Convert::ToLong(tokens[1]);
+
+		return spec;
+	}
+
+	int wday;
+
+	if (tokens.size() >= 1 && (wday = WeekdayFromString(tokens[0])) != -1) {
+		spec.Type = LegacyTimeSpec::TimeSpecWeekday;
+		spec.Weekday = wday;
+
+		if (tokens.size() > 2) {
+			mon = MonthFromString(tokens[2]);
+
+			if (mon == -1)
+				BOOST_THROW_EXCEPTION(std::invalid_argument("Invalid month in time specification: " + timespec));
+		}
 
-		int mday = Convert::ToLong(tokens[1]);
+		spec.Month = mon;
+		spec.HasDay = tokens.size() > 1;
 
-		if (begin) {
-			*begin = *reference;
-			begin->tm_mon = mon;
-			begin->tm_mday = mday;
-			begin->tm_hour = 0;
-			begin->tm_min = 0;
-			begin->tm_sec = 0;
-			begin->tm_isdst = -1;
+		if (spec.HasDay)
+			spec.Day = Convert::ToLong(tokens[1]);
 
-			/* day -X: Negative days are relative to the next month. */
-			if (mday < 0) {
-				boost::gregorian::date d(GetEndOfMonthDay(reference->tm_year + 1900, mon + 1)); //TODO: Refactor this mess into full Boost.DateTime
+		return spec;
+	}
 
-				//Depending on the number, we need to substract specific days (counting starts at 0).
-				d = d - boost::gregorian::days(mday * -1 - 1);
+	BOOST_THROW_EXCEPTION(std::invalid_argument("Invalid time specification: " + timespec));
+}
 
-				*begin = boost::gregorian::to_tm(d);
+/**
+ * Finds the first day on or after the day given by reference and writes the beginning and end time of that day to
+ * the output parameters begin and end.
+ *
+ * @param spec Day to find, as returned by CompileTimeSpec()
+ * @param begin if != nullptr, set to 00:00:00 on that day
+ * @param end if != nullptr, set to 24:00:00 on that day (i.e. 00:00:00 of the next day)
+ * @param reference Time to begin the search at
+ */
+void LegacyTimePeriod::ExpandTimeSpec(const LegacyTimeSpec& spec, tm *begin, tm *end, const tm *reference)
+{
+	switch (spec.Type) {
+		case LegacyTimeSpec::TimeSpecDate:
+			if (begin) {
+				*begin = *reference;
+				begin->tm_year = spec.Year - 1900;
+				begin->tm_mon = spec.Month;
+				begin->tm_mday = spec.Day;
 				begin->tm_hour = 0;
 				begin->tm_min = 0;
 				begin->tm_sec = 0;
+				begin->tm_isdst = -1;
 			}
-		}
 
-		if (end) {
-			*end = *reference;
-			end->tm_mon = mon;
-			end->tm_mday = mday;
-			end->tm_hour = 24;
-			end->tm_min = 0;
-			end->tm_sec = 0;
-			end->tm_isdst = -1;
+			if (end) {
+				*end = *reference;
+				end->tm_year = spec.Year - 1900;
+				end->tm_mon = spec.Month;
+				end->tm_mday = spec.Day;
+				end->tm_hour = 24;
+				end->tm_min = 0;
+				end->tm_sec = 0;
+				end->tm_isdst = -1;
+			}
+
+			break;
 
-			/* day -X: Negative days are relative to the next month. */
-			if (mday < 0) {
-				boost::gregorian::date d(GetEndOfMonthDay(reference->tm_year + 1900, mon + 1)); //TODO: Refactor this mess into full Boost.DateTime
+		case LegacyTimeSpec::TimeSpecMonthDay: {
+			int mon = spec.Month == -1 ? reference->tm_mon : spec.Month;
+			int mday = spec.Day;
+
+			if (begin) {
+				*begin = *reference;
+				begin->tm_mon = mon;
+				begin->tm_mday = mday;
+				begin->tm_hour = 0;
+				begin->tm_min = 0;
+				begin->tm_sec = 0;
+				begin->tm_isdst = -1;
 
-				//Depending on the number, we need to substract specific days (counting starts at 0).
-				d = d - boost::gregorian::days(mday * -1 - 1);
+				/* day -X: Negative days are relative to the next month. */
+				if (mday < 0) {
+					boost::gregorian::date d(GetEndOfMonthDay(reference->tm_year + 1900, mon + 1)); //TODO: Refactor this mess into full Boost.DateTime
 
-				// End date is one day in the future, starting 00:00:00
-				d = d + boost::gregorian::days(1);
+					//Depending on the number, we need to substract specific days (counting starts at 0).
+					d = d - boost::gregorian::days(mday * -1 - 1);
 
-				*end = boost::gregorian::to_tm(d);
-				end->tm_hour = 0;
-				end->tm_min = 0;
-				end->tm_sec = 0;
+					*begin = boost::gregorian::to_tm(d);
+					begin->tm_hour = 0;
+					begin->tm_min = 0;
+					begin->tm_sec = 0;
+				}
 			}
-		}
 
-		return;
-	}
+			if (end) {
+				*end = *reference;
+				end->tm_mon = mon;
+				end->tm_mday = mday;
+				end->tm_hour = 24;
+				end->tm_min = 0;
+				end->tm_sec = 0;
+				end->tm_isdst = -1;
 
-	int wday;
+				/* day -X: Negative days are relative to the next month. */
+				if (mday < 0) {
+					boost::gregorian::date d(GetEndOfMonthDay(reference->tm_year + 1900, mon + 1)); //TODO: Refactor this mess into full Boost.DateTime
 
-	if (tokens.size() >= 1 && (wday = WeekdayFromString(tokens[0])) != -1) {
-		tm myref = *reference;
-		myref.tm_isdst = -1;
+					//Depending on the number, we need to substract specific days (counting starts at 0).
+					d = d - boost::gregorian::days(mday * -1 - 1);
 
-		if (tokens.size() > 2) {
-			mon = MonthFromString(tokens[2]);
+					// End date is one day in the future, starting 00:00:00
+					d = d + boost::gregorian::days(1);
 
-			if (mon == -1)
-				BOOST_THROW_EXCEPTION(std::invalid_argument("Invalid month in time specification: " + timespec));
+					*end = boost::gregorian::to_tm(d);
+					end->tm_hour = 0;
+					end->tm_min = 0;
+					end->tm_sec = 0;
+				}
+			}
 
-			myref.tm_mon = mon;
+			break;
 		}
 
-		int n = 0;
+		case LegacyTimeSpec::TimeSpecWeekday: {
+			tm myref = *reference;
+			myref.tm_isdst = -1;
 
-		if (tokens.size() > 1)
-			n = Convert::ToLong(tokens[1]);
+			if (spec.Month != -1)
+				myref.tm_mon = spec.Month;
 
-		if (begin) {
-			*begin = myref;
+			if (begin) {
+				*begin = myref;
 
-			if (tokens.size() > 1)
-				FindNthWeekday(wday, n, begin);
-			else
-				begin->tm_mday += (7 - begin->tm_wday + wday) % 7;
+				if (spec.HasDay)
+					FindNthWeekday(spec.Weekday, spec.Day, begin);
+				else
+					begin->tm_mday += (7 - begin->tm_wday + spec.Weekday) % 7;
 
-			begin->tm_hour = 0;
-			begin->tm_min = 0;
-			begin->tm_sec = 0;
-		}
+				begin->tm_hour = 0;
+				begin->tm_min = 0;
+				begin->tm_sec = 0;
+			}
 
-		if (end) {
-			*end = myref;
+			if (end) {
+				*end = myref;
 
-			if (tokens.size() > 1)
-				FindNthWeekday(wday, n, end);
-			else
-				end->tm_mday += (7 - end->tm_wday + wday) % 7;
+				if (spec.HasDay)
+					FindNthWeekday(spec.Weekday, spec.Day, end);
+				else
+					end->tm_mday += (7 - end->tm_wday + spec.Weekday) % 7;
 
-			end->tm_hour = 0;
-			end->tm_min = 0;
-			end->tm_sec = 0;
-			end->tm_mday++;
-		}
+				end->tm_hour = 0;
+				end->tm_min = 0;
+				end->tm_sec = 0;
+				end->tm_mday++;
+			}
 
-		return;
+			break;
+		}
 	}
+}
 
-	BOOST_THROW_EXCEPTION(std::invalid_argument("Invalid time specification: " + timespec));
+/**
+ * Finds the first day on or after the day given by reference and writes the beginning and end time of that day to
+ * the output parameters begin and end.
+ *
+ * @param timespec Day to find, for example "2021-10-20", "sunday", ...
+ * @param begin if != nullptr, set to 00:00:00 on that day
+ * @param end if != nullptr, set to 24:00:00 on that day (i.e. 00:00:00 of the next day)
+ * @param reference Time to begin the search at
+ */
+void LegacyTimePeriod::ParseTimeSpec(const String& timespec, tm *begin, tm *end, const tm *reference)
+{
+	ExpandTimeSpec(CompileTimeSpec(timespec), begin, end, reference);
 }
 
 /**
@@ -330,26 +377,26 @@ void LegacyTimePeriod::ParseTimeSpec(const String& timespec, tm *begin, tm *end,
  *   begin - end / stride
  *
  * @param timerange Text representation of a day range or a single day, for example "2021-10-20", "monday - friday", ...
- * @param begin Output parameter set to 00:00:00 of the first day of the range
- * @param end Output parameter set to 24:00:00 of the last day of the range (i.e. 00:00:00 of the day after)
- * @param stride Output parameter for the stride (for every n-th day)
- * @param reference Expand the range relative to this timestamp
+ * @return The parsed day range
  */
-void LegacyTimePeriod::ParseTimeRange(const String& timerange, tm *begin, tm *end, int *stride, const tm *reference)
+LegacyDayDefinition LegacyTimePeriod::CompileDayDefinition(const String& timerange)
 {
+	LegacyDayDefinition result;
 	String def = timerange;
 
+	result.Text = timerange;
+
 	/* Figure out the stride. */
 	size_t pos = def.FindFirstOf('/');
 
 	if (pos != String::NPos) {
 		String strStride = def.SubStr(pos + 1).Trim();
-		*stride = Convert::ToLong(strStride);
+		result.Stride = Convert::ToLong(strStride);
 
 		/* Remove the stride parameter from the definition. */
 		def = def.SubStr(0, pos);
 	} else {
-		*stride = 1; /* User didn't specify anything, assume default. */
+		result.Stride = 1; /* User didn't specify anything, assume default. */
 	}
 
 	/* Figure out whether the user has specified two dates. */
@@ -360,7 +407,7 @@ void LegacyTimePeriod::ParseTimeRange(const String& timerange, tm *begin, tm *en
 
 		String second = def.SubStr(pos + 1).Trim();
 
-		ParseTimeSpec(first, begin, nullptr, reference);
+		result.Begin = CompileTimeSpec(first);
 
 		/* If the second definition starts with a number we need
 		 * to add the first word from the first definition, e.g.:
@@ -381,61 +428,120 @@ void LegacyTimePeriod::ParseTimeRange(const String& timerange, tm *begin, tm *en
 			second = first.SubStr(0, xpos + 1) + second;
 		}
 
-		ParseTimeSpec(second, nullptr, end, reference);
+		result.End = CompileTimeSpec(second);
 	} else {
-		ParseTimeSpec(def, begin, end, reference);
+		result.Begin = CompileTimeSpec(def);
+		result.End = result.Begin;
 	}
+
+	return result;
+}
+
+/**
+ * Parse a range of days.
+ *
+ * @param timerange Text representation of a day range or a single day, see CompileDayDefinition()
+ * @param begin Output parameter set to 00:00:00 of the first day of the range
+ * @param end Output parameter set to 24:00:00 of the last day of the range (i.e. 00:00:00 of the day after)
+ * @param stride Output parameter for the stride (for every n-th day)
+ * @param reference Expand the range relative to this timestamp
+ */
+void LegacyTimePeriod::ParseTimeRange(const String& timerange, tm *begin, tm *end, int *stride, const tm *reference)
+{
+	LegacyDayDefinition def = CompileDayDefinition(timerange);
+
+	ExpandTimeSpec(def.Begin, begin, nullptr, reference);
+	ExpandTimeSpec(def.End, nullptr, end, reference);
+	*stride = def.Stride;
 }
 
 bool LegacyTimePeriod::IsInDayDefinition(const String& daydef, const tm *reference)
+{
+	return IsInDayDefinition(CompileDayDefinition(daydef), reference);
+}
+
+bool LegacyTimePeriod::IsInDayDefinition(const LegacyDayDefinition& daydef, const tm *reference)
 {
 	tm begin, end;
-	int stride;
 
-	ParseTimeRange(daydef, &begin, &end, &stride, reference);
+	ExpandTimeSpec(daydef.Begin, &begin, nullptr, reference);
+	ExpandTimeSpec(daydef.End, nullptr, &end, reference);
 
 	Log(LogDebug, "LegacyTimePeriod")
-		<< "ParseTimeRange: '" << daydef << "' => " << mktime(&begin)
-		<< " -> " << mktime(&end) << ", stride: " << stride;
+		<< "ParseTimeRange: '" << daydef.Text << "' => " << mktime(&begin)
+		<< " -> " << mktime(&end) << ", stride: " << daydef.Stride;
 
-	return IsInTimeRange(&begin, &end, stride, reference);
+	return IsInTimeRange(&begin, &end, daydef.Stride, reference);
 }
 
 static inline
-void ProcessTimeRaw(const String& in, const tm *reference, tm *out)
+void CompileTimeRaw(const String& in, int *hour, int *min, int *sec)
 {
-	*out = *reference;
-
 	auto hd (in.Split(":"));
 
 	switch (hd.size()) {
 		case 2:
-			out->tm_sec = 0;
+			*sec = 0;
 			break;
 		case 3:
-			out->tm_sec = Convert::ToLong(hd[2]);
+			*sec = Convert::ToLong(hd[2]);
 			break;
 		default:
 			BOOST_THROW_EXCEPTION(std::invalid_argument("Invalid time specification: " + in));
 	}
 
-	out->tm_hour = Convert::ToLong(hd[0]);
-	out->tm_min = Convert::ToLong(hd[1]);
+	*hour = Convert::ToLong(hd[0]);
+	*min = Convert::ToLong(hd[1]);
 }
 
-void LegacyTimePeriod::ProcessTimeRangeRaw(const String& timerange, const tm *reference, tm *begin, tm *end)
+LegacyTimeOfDayRange LegacyTimePeriod::CompileTimeRange(const String& timerange)
 {
+	LegacyTimeOfDayRange range;
 	std::vector<String> times = timerange.Split("-");
 
 	if (times.size() != 2)
 		BOOST_THROW_EXCEPTION(std::invalid_argument("Invalid timerange: " + timerange));
 
-	ProcessTimeRaw(times[0], reference, begin);
-	ProcessTimeRaw(times[1], reference, end);
+	CompileTimeRaw(times[0], &range.BeginHour, &range.BeginMinute, &range.BeginSecond);
+	CompileTimeRaw(times[1], &range.EndHour, &range.EndMinute, &range.EndSecond);
+
+	if (range.BeginHour * 3600 + range.BeginMinute * 60 + range.BeginSecond >=
+		range.EndHour * 3600 + range.EndMinute * 60 + range.EndSecond)
+		range.EndHour += 24;
 
-	if (begin->tm_hour * 3600 + begin->tm_min * 60 + begin->tm_sec >=
-		end->tm_hour * 3600 + end->tm_min * 60 + end->tm_sec)
-		end->tm_hour += 24;
+	return range;
+}
+
+/**
+ * Parses a list of comma separated time ranges, see ProcessTimeRanges().
+ */
+std::vector<LegacyTimeOfDayRange> LegacyTimePeriod::CompileTimeRanges(const String& timeranges)
+{
+	std::vector<LegacyTimeOfDayRange> result;
+
+	for (const String& range : timeranges.Split(",")) {
+		result.push_back(CompileTimeRange(range));
+	}
+
+	return result;
+}
+
+void LegacyTimePeriod::ExpandTimeRange(const LegacyTimeOfDayRange& timerange, const tm *reference, tm *begin, tm *end)
+{
+	*begin = *reference;
+	begin->tm_hour = timerange.BeginHour;
+	begin->tm_min = timerange.BeginMinute;
+	begin->tm_sec = timerange.BeginSecond;
+
+	*end = *reference;
+	end->tm_hour = timerange.EndHour;
+	end->tm_min = timerange.EndMinute;
+	end->tm_sec = timerange.EndSecond;
+}
+
+void LegacyTimePeriod::ProcessTimeRangeRaw(const String& timerange, const tm *reference, tm *begin, tm *end)
+{
+	ExpandTimeRange(CompileTimeRange(timerange), reference, begin, end);
 }
 
 Dictionary::Ptr LegacyTimePeriod::ProcessTimeRange(const String& timestamp, const tm *reference)
@@ -459,15 +565,26 @@ Dictionary::Ptr LegacyTimePeriod::ProcessTimeRange(const String& timestamp, cons
  */
 void LegacyTimePeriod::ProcessTimeRanges(const String& timeranges, const tm *reference, const Array::Ptr& result)
 {
-	std::vector<String> ranges = timeranges.Split(",");
+	ProcessTimeRanges(CompileTimeRanges(timeranges), reference, result);
+}
+
+void LegacyTimePeriod::ProcessTimeRanges(const std::vector<LegacyTimeOfDayRange>& timeranges, const tm *reference, const Array::Ptr& result)
+{
+	for (const LegacyTimeOfDayRange& range : timeranges) {
+		tm begin, end;
+
+		ExpandTimeRange(range, reference, &begin, &end);
 
-	for (const String& range : ranges) {
-		Dictionary::Ptr segment = ProcessTimeRange(range, reference);
+		long tsbegin = mktime(&begin);
+		long tsend = mktime(&end);
 
-		if (segment->Get("begin") >= segment->Get("end"))
+		if (tsbegin >= tsend)
 			continue;
 
-		result->Add(segment);
+		result->Add(new Dictionary({
+			{ "begin", tsbegin },
+			{ "end", tsend }
+		}));
 	}
 }
 
@@ -579,6 +696,52 @@ Dictionary::Ptr LegacyTimePeriod::FindNextSegment(const String& daydef, const St
 	return nullptr;
 }
 
+LegacyTimeRanges::LegacyTimeRanges(const Dictionary::Ptr& ranges)
+	: m_Source(ranges)
+{
+	ObjectLock olock(ranges);
+	for (const Dictionary::Pair& kv : ranges) {
+		m_Entries.push_back({
+			kv.first,
+			LegacyTimePeriod::CompileDayDefinition(kv.first),
+			LegacyTimePeriod::CompileTimeRanges(kv.second)
+		});
+	}
+}
+
+Dictionary::Ptr LegacyTimeRanges::GetSource() const
+{
+	return m_Source;
+}
+
+const std::vector<LegacyTimeRanges::Entry>& LegacyTimeRanges::GetEntries() const
+{
+	return m_Entries;
+}
+
+/**
+ * Returns the parsed 'ranges' of the time period. They are only parsed again
+ * after the attribute has been replaced.
+ */
+LegacyTimeRanges::Ptr LegacyTimePeriod::GetCompiledRanges(const TimePeriod::Ptr& tp, const Dictionary::Ptr& ranges)
+{
+	{
+		ObjectLock olock(tp);
+
+		auto compiled (dynamic_pointer_cast<LegacyTimeRanges>(tp->GetCompiledRanges()));
+
+		if (compiled && compiled->GetSource() == ranges)
+			return compiled;
+	}
+
+	LegacyTimeRanges::Ptr compiled = new LegacyTimeRanges(ranges);
+
+	ObjectLock olock(tp);
+	tp->SetCompiledRanges(compiled);
+
+	return compiled;
+}
+
 Array::Ptr LegacyTimePeriod::ScriptFunc(const TimePeriod::Ptr& tp, double begin, double end)
 {
 	Array::Ptr segments = new Array();
@@ -586,6 +749,8 @@ Array::Ptr LegacyTimePeriod::ScriptFunc(const TimePeriod::Ptr& tp, double begin,
 	Dictionary::Ptr ranges = tp->GetRanges();
 
 	if (ranges) {
+		LegacyTimeRanges::Ptr compiled = GetCompiledRanges(tp, ranges);
+
 		tm tm_begin = Utility::LocalTime(begin);
 
 		// Always evaluate time periods for full days as their ranges are given per day.
@@ -617,22 +782,21 @@ Array::Ptr LegacyTimePeriod::ScriptFunc(const TimePeriod::Ptr& tp, double begin,
 				<< "Checking reference time " << mktime_const(&reference);
 #endif /* I2_DEBUG */
 
-			ObjectLock olock(ranges);
-			for (const Dictionary::Pair& kv : ranges) {
-				if (!IsInDayDefinition(kv.first, &reference)) {
+			for (const LegacyTimeRanges::Entry& entry : compiled->GetEntries()) {
+				if (!IsInDayDefinition(entry.Day, &reference)) {
 #ifdef I2_DEBUG
 					Log(LogDebug, "LegacyTimePeriod")
-						<< "Not in day definition '" << kv.first << "'.";
+						<< "Not in day definition '" << entry.DayDefinition << "'.";
 #endif /* I2_DEBUG */
 					continue;
 				}
 
 #ifdef I2_DEBUG
 				Log(LogDebug, "LegacyTimePeriod")
-					<< "In day definition '" << kv.first << "'.";
+					<< "In day definition '" << entry.DayDefinition << "'.";
 #endif /* I2_DEBUG */
 
-				ProcessTimeRanges(kv.second, &reference, segments);
+				ProcessTimeRanges(entry.Times, &reference, segments);
 			}
 		}
 	}
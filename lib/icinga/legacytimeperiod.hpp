@@ -7,10 +7,88 @@
 #include "icinga/timeperiod.hpp"
 #include "base/dictionary.hpp"
 #include <boost/date_time/gregorian/gregorian.hpp>
+#include <vector>
 
 namespace icinga
 {
 
+/**
+ * A parsed day specification, e.g. "2021-10-20", "day 1", "march 15" or "monday 2 may".
+ *
+ * @ingroup icinga
+ */
+struct LegacyTimeSpec
+{
+	enum SpecType
+	{
+		TimeSpecDate,
+		TimeSpecMonthDay,
+		TimeSpecWeekday
+	};
+
+	SpecType Type{TimeSpecDate};
+	int Year{0};
+	int Month{-1}; /**< -1 refers to the month of the reference time. */
+	int Day{0}; /**< Day of month, or the n-th occurrence for weekdays. */
+	int Weekday{0};
+	bool HasDay{false};
+};
+
+/**
+ * A parsed range of days, e.g. "monday - friday / 2".
+ *
+ * @ingroup icinga
+ */
+struct LegacyDayDefinition
+{
+	String Text;
+	LegacyTimeSpec Begin;
+	LegacyTimeSpec End;
+	int Stride{1};
+};
+
+/**
+ * A parsed time range within a day, e.g. "08:00-17:00".
+ *
+ * @ingroup icinga
+ */
+struct LegacyTimeOfDayRange
+{
+	int BeginHour{0};
+	int BeginMinute{0};
+	int BeginSecond{0};
+	int EndHour{0};
+	int EndMinute{0};
+	int EndSecond{0};
+};
+
+/**
+ * The parsed 'ranges' attribute of a time period.
+ *
+ * @ingroup icinga
+ */
+class LegacyTimeRanges final : public Object
+{
+public:
+	DECLARE_PTR_TYPEDEFS(LegacyTimeRanges);
+
+	struct Entry
+	{
+		String DayDefinition;
+		LegacyDayDefinition Day;
+		std::vector<LegacyTimeOfDayRange> Times;
+	};
+
+	LegacyTimeRanges(const Dictionary::Ptr& ranges);
+
+	Dictionary::Ptr GetSource() const;
+	const std::vector<Entry>& GetEntries() const;
+
+private:
+	Dictionary::Ptr m_Source;
+	std::vector<Entry> m_Entries;
+};
+
 /**
  * Implements Icinga 1.x time periods.
  *
@@ -25,12 +103,20 @@ public:
 	static void FindNthWeekday(int wday, int n, tm *reference);
 	static int WeekdayFromString(const String& daydef);
 	static int MonthFromString(const String& monthdef);
+	static LegacyTimeSpec CompileTimeSpec(const String& timespec);
+	static void ExpandTimeSpec(const LegacyTimeSpec& spec, tm *begin, tm *end, const tm *reference);
 	static void ParseTimeSpec(const String& timespec, tm *begin, tm *end, const tm *reference);
+	static LegacyDayDefinition CompileDayDefinition(const String& timerange);
 	static void ParseTimeRange(const String& timerange, tm *begin, tm *end, int *stride, const tm *reference);
 	static bool IsInDayDefinition(const String& daydef, const tm *reference);
+	static bool IsInDayDefinition(const LegacyDayDefinition& daydef, const tm *reference);
+	static LegacyTimeOfDayRange CompileTimeRange(const String& timerange);
+	static std::vector<LegacyTimeOfDayRange> CompileTimeRanges(const String& timeranges);
+	static void ExpandTimeRange(const LegacyTimeOfDayRange& timerange, const tm *reference, tm *begin, tm *end);
 	static void ProcessTimeRangeRaw(const String& timerange, const tm *reference, tm *begin, tm *end);
 	static Dictionary::Ptr ProcessTimeRange(const String& timerange, const tm *reference);
 	static void ProcessTimeRanges(const String& timeranges, const tm *reference, const Array::Ptr& result);
+	static void ProcessTimeRanges(const std::vector<LegacyTimeOfDayRange>& timeranges, const tm *reference, const Array::Ptr& result);
 	static Dictionary::Ptr FindNextSegment(const String& daydef, const String& timeranges, const tm *reference);
 	static Dictionary::Ptr FindRunningSegment(const String& daydef, const String& timeranges, const tm *reference);
 
@@ -38,6 +124,7 @@ private:
 	LegacyTimePeriod();
 
 	static boost::gregorian::date GetEndOfMonthDay(int year, int month);
+	static LegacyTimeRanges::Ptr GetCompiledRanges(const TimePeriod::Ptr& tp, const Dictionary::Ptr& ranges);
 };
 
 }
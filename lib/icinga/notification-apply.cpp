@@ -135,7 +135,7 @@ void Notification::EvaluateApplyRules(const Host::Ptr& host)
 {
 	CONTEXT("Evaluating 'apply' rules for host '" + host->GetName() + "'");
 
-	for (auto& rule : ApplyRule::GetRules(Notification::TypeInstance, Host::TypeInstance))
+	for (auto& rule : ApplyRule::GetRules(Notification::TypeInstance, Host::TypeInstance, new Dictionary({ { "host", host } })))
 	{
 		if (EvaluateApplyRule(host, *rule))
 			rule->AddMatch();
@@ -151,7 +151,7 @@ void Notification::EvaluateApplyRules(const Service::Ptr& service)
 {
 	CONTEXT("Evaluating 'apply' rules for service '" + service->GetName() + "'");
 
-	for (auto& rule : ApplyRule::GetRules(Notification::TypeInstance, Service::TypeInstance)) {
+	for (auto& rule : ApplyRule::GetRules(Notification::TypeInstance, Service::TypeInstance, new Dictionary({ { "host", service->GetHost() }, { "service", service } }))) {
 		if (EvaluateApplyRule(service, *rule))
 			rule->AddMatch();
 	}
@@ -96,6 +96,19 @@ void Notification::StaticInitialize()
 	m_TypeFilterMap["Recovery"] = NotificationRecovery;
 	m_TypeFilterMap["FlappingStart"] = NotificationFlappingStart;
 	m_TypeFilterMap["FlappingEnd"] = NotificationFlappingEnd;
+
+	/* Sending a notification updates a few of these, notifications are rare enough to count each of them as a change. */
+	auto updateChangeVersion ([](const Notification::Ptr& notification, const Value&) {
+		if (notification->IsActive())
+			notification->UpdateChangeVersion();
+	});
+
+	Notification::OnLastNotificationChanged.connect(updateChangeVersion);
+	ObjectImpl<Notification>::OnNextNotificationChanged.connect(updateChangeVersion);
+	Notification::OnNotificationNumberChanged.connect(updateChangeVersion);
+	Notification::OnLastProblemNotificationChanged.connect(updateChangeVersion);
+	Notification::OnNoMoreNotificationsChanged.connect(updateChangeVersion);
+	Notification::OnNotifiedProblemUsersChanged.connect(updateChangeVersion);
 }
 
 void Notification::OnConfigLoaded()
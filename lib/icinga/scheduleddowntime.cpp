@@ -88,6 +88,29 @@ void ScheduledDowntime::Start(bool runtimeCreated)
 		Utility::QueueAsyncCallback([this]() { CreateNextDowntime(); });
 }
 
+void ScheduledDowntime::Stop(bool runtimeRemoved)
+{
+	if (runtimeRemoved && Host::GetByName(GetHostName())) {
+		Checkable::Ptr checkable = GetCheckable();
+
+		if (checkable) {
+			auto name (GetName());
+			auto localZone (Zone::GetLocalZone());
+
+			/* Downtimes lose their config owner with us, remove them once we're gone. */
+			for (const Downtime::Ptr& downtime : checkable->GetDowntimes()) {
+				if (downtime->GetConfigOwner() == name && Zone::GetByName(downtime->GetAuthoritativeZone()) == localZone) {
+					Utility::QueueAsyncCallback([downtime]() {
+						Downtime::RemoveDowntime(downtime->GetName(), false, false, true);
+					});
+				}
+			}
+		}
+	}
+
+	ObjectImpl<ScheduledDowntime>::Stop(runtimeRemoved);
+}
+
 void ScheduledDowntime::TimerProc()
 {
 	for (const ScheduledDowntime::Ptr& sd : ConfigType::GetObjectsByType<ScheduledDowntime>()) {
@@ -123,7 +123,7 @@ void Service::EvaluateApplyRules(const Host::Ptr& host)
 {
 	CONTEXT("Evaluating 'apply' rules for host '" + host->GetName() + "'");
 
-	for (auto& rule : ApplyRule::GetRules(Service::TypeInstance, Host::TypeInstance)) {
+	for (auto& rule : ApplyRule::GetRules(Service::TypeInstance, Host::TypeInstance, new Dictionary({ { "host", host } }))) {
 		if (EvaluateApplyRule(host, *rule))
 			rule->AddMatch();
 	}
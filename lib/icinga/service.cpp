@@ -5,6 +5,7 @@
 #include "icinga/servicegroup.hpp"
 #include "icinga/scheduleddowntime.hpp"
 #include "icinga/pluginutility.hpp"
+#include "remote/filterutility.hpp"
 #include "base/objectlock.hpp"
 #include "base/convert.hpp"
 #include "base/utility.hpp"
@@ -13,6 +14,23 @@ using namespace icinga;
 
 REGISTER_TYPE(Service);
 
+INITIALIZE_ONCE([]() {
+	auto hostServices ([](const String& name) {
+		std::vector<ConfigObject::Ptr> services;
+		Host::Ptr host = Host::GetByName(name);
+
+		if (host) {
+			for (const Service::Ptr& service : host->GetServices())
+				services.emplace_back(service);
+		}
+
+		return services;
+	});
+
+	FilterUtility::RegisterIndex("Service", "host.name", FilterIndexKind::Equal, hostServices);
+	FilterUtility::RegisterIndex("Service", "service.host_name", FilterIndexKind::Equal, hostServices);
+});
+
 boost::signals2::signal<void (const Service::Ptr&, const CheckResult::Ptr&, const MessageOrigin::Ptr&)> Service::OnHostProblemChanged;
 
 String ServiceNameComposer::MakeName(const String& shortName, const Object::Ptr& context) const
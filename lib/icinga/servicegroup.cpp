@@ -2,6 +2,7 @@
 
 #include "icinga/servicegroup.hpp"
 #include "icinga/servicegroup-ti.cpp"
+#include "remote/filterutility.hpp"
 #include "config/objectrule.hpp"
 #include "config/configitem.hpp"
 #include "base/configtype.hpp"
@@ -16,6 +17,18 @@ REGISTER_TYPE(ServiceGroup);
 
 INITIALIZE_ONCE([]() {
 	ObjectRule::RegisterType("ServiceGroup");
+
+	FilterUtility::RegisterIndex("Service", "service.groups", FilterIndexKind::Contains, [](const String& name) {
+		std::vector<ConfigObject::Ptr> services;
+		ServiceGroup::Ptr group = ServiceGroup::GetByName(name);
+
+		if (group) {
+			for (const Service::Ptr& service : group->GetMembers())
+				services.emplace_back(service);
+		}
+
+		return services;
+	});
 });
 
 bool ServiceGroup::EvaluateObjectRule(const Service::Ptr& service, const ConfigItem::Ptr& group)
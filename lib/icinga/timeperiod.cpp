@@ -10,6 +10,8 @@
 #include "base/timer.hpp"
 #include "base/utility.hpp"
 #include <boost/thread/once.hpp>
+#include <algorithm>
+#include <limits>
 
 using namespace icinga;
 
@@ -42,6 +44,8 @@ void TimePeriod::AddSegment(double begin, double end)
 {
 	ASSERT(OwnsLock());
 
+	InvalidateSegmentIndex();
+
 	Log(LogDebug, "TimePeriod")
 		<< "Adding segment '" << Utility::FormatDateTime("%c", begin) << "' <-> '"
 		<< Utility::FormatDateTime("%c", end) << "' to TimePeriod '" << GetName() << "'";
@@ -103,6 +107,8 @@ void TimePeriod::RemoveSegment(double begin, double end)
 {
 	ASSERT(OwnsLock());
 
+	InvalidateSegmentIndex();
+
 	Log(LogDebug, "TimePeriod")
 		<< "Removing segment '" << Utility::FormatDateTime("%c", begin) << "' <-> '"
 		<< Utility::FormatDateTime("%c", end) << "' from TimePeriod '" << GetName() << "'";
@@ -184,6 +190,8 @@ void TimePeriod::PurgeSegments(double end)
 
 	SetValidBegin(end);
 
+	InvalidateSegmentIndex();
+
 	Array::Ptr segments = GetSegments();
 
 	if (!segments)
@@ -286,39 +294,100 @@ bool TimePeriod::IsInside(double ts) const
 	if (GetValidBegin().IsEmpty() || ts < GetValidBegin() || GetValidEnd().IsEmpty() || ts > GetValidEnd())
 		return true; /* Assume that all invalid regions are "inside". */
 
-	Array::Ptr segments = GetSegments();
+	UpdateSegmentIndex();
 
-	if (segments) {
-		ObjectLock dlock(segments);
-		for (const Dictionary::Ptr& segment : segments) {
-			if (ts > segment->Get("begin") && ts < segment->Get("end"))
-				return true;
-		}
-	}
+	/* Segments which begin before ts, one of them contains ts if it also ends after it. */
+	auto it (std::lower_bound(m_SegmentsByBegin.begin(), m_SegmentsByBegin.end(), std::make_pair(ts, std::numeric_limits<double>::lowest())));
 
-	return false;
+	if (it == m_SegmentsByBegin.begin())
+		return false;
+
+	return m_SegmentsMaxEnd[it - m_SegmentsByBegin.begin() - 1] > ts;
 }
 
 double TimePeriod::FindNextTransition(double begin)
 {
 	ObjectLock olock(this);
 
-	Array::Ptr segments = GetSegments();
+	UpdateSegmentIndex();
 
 	double closestTransition = -1;
 
+	auto nextBegin (std::upper_bound(m_SegmentsByBegin.begin(), m_SegmentsByBegin.end(), begin,
+		[](double ts, const std::pair<double, double>& segment) { return ts < segment.first; }));
+
+	if (nextBegin != m_SegmentsByBegin.end())
+		closestTransition = nextBegin->first;
+
+	auto nextEnd (std::upper_bound(m_SegmentEnds.begin(), m_SegmentEnds.end(), begin));
+
+	if (nextEnd != m_SegmentEnds.end() && (*nextEnd < closestTransition || closestTransition == -1))
+		closestTransition = *nextEnd;
+
+	return closestTransition;
+}
+
+Object::Ptr TimePeriod::GetCompiledRanges() const
+{
+	ASSERT(OwnsLock());
+
+	return m_CompiledRanges;
+}
+
+void TimePeriod::SetCompiledRanges(const Object::Ptr& ranges)
+{
+	ASSERT(OwnsLock());
+
+	m_CompiledRanges = ranges;
+}
+
+void TimePeriod::InvalidateSegmentIndex()
+{
+	ASSERT(OwnsLock());
+
+	m_SegmentIndexValid = false;
+}
+
+/**
+ * Rebuilds the lookup structures for IsInside() and FindNextTransition()
+ * if the segments have changed since they were built last.
+ */
+void TimePeriod::UpdateSegmentIndex() const
+{
+	ASSERT(OwnsLock());
+
+	Array::Ptr segments = GetSegments();
+
+	if (m_SegmentIndexValid && m_IndexedSegments == segments)
+		return;
+
+	m_SegmentsByBegin.clear();
+	m_SegmentsMaxEnd.clear();
+	m_SegmentEnds.clear();
+
 	if (segments) {
 		ObjectLock dlock(segments);
 		for (const Dictionary::Ptr& segment : segments) {
-			if (segment->Get("begin") > begin && (segment->Get("begin") < closestTransition || closestTransition == -1))
-				closestTransition = segment->Get("begin");
+			double begin = segment->Get("begin");
+			double end = segment->Get("end");
 
-			if (segment->Get("end") > begin && (segment->Get("end") < closestTransition || closestTransition == -1))
-				closestTransition = segment->Get("end");
+			m_SegmentsByBegin.emplace_back(begin, end);
+			m_SegmentEnds.push_back(end);
 		}
 	}
 
-	return closestTransition;
+	std::sort(m_SegmentsByBegin.begin(), m_SegmentsByBegin.end());
+	std::sort(m_SegmentEnds.begin(), m_SegmentEnds.end());
+
+	double maxEnd = std::numeric_limits<double>::lowest();
+
+	for (auto& segment : m_SegmentsByBegin) {
+		maxEnd = std::max(maxEnd, segment.second);
+		m_SegmentsMaxEnd.push_back(maxEnd);
+	}
+
+	m_IndexedSegments = segments;
+	m_SegmentIndexValid = true;
 }
 
 void TimePeriod::UpdateTimerHandler()
@@ -5,6 +5,8 @@
 
 #include "icinga/i2-icinga.hpp"
 #include "icinga/timeperiod-ti.hpp"
+#include <utility>
+#include <vector>
 
 namespace icinga
 {
@@ -29,9 +31,26 @@ public:
 	bool IsInside(double ts) const;
 	double FindNextTransition(double begin);
 
+	Object::Ptr GetCompiledRanges() const;
+	void SetCompiledRanges(const Object::Ptr& ranges);
+
 	void ValidateRanges(const Lazy<Dictionary::Ptr>& lvalue, const ValidationUtils& utils) override;
 
 private:
+	/* Parsed representation of the ranges attribute, owned by the update function. */
+	Object::Ptr m_CompiledRanges;
+
+	/* Segments sorted by their begin, with the running maximum of their ends,
+	 * and all ends sorted separately. Rebuilt lazily when the segments change. */
+	mutable Array::Ptr m_IndexedSegments;
+	mutable bool m_SegmentIndexValid{false};
+	mutable std::vector<std::pair<double, double> > m_SegmentsByBegin;
+	mutable std::vector<double> m_SegmentsMaxEnd;
+	mutable std::vector<double> m_SegmentEnds;
+
+	void InvalidateSegmentIndex();
+	void UpdateSegmentIndex() const;
+
 	void AddSegment(double s, double end);
 	void AddSegment(const Dictionary::Ptr& segment);
 	void RemoveSegment(double begin, double end);
@@ -3,6 +3,7 @@
 #include "icinga/usergroup.hpp"
 #include "icinga/usergroup-ti.cpp"
 #include "icinga/notification.hpp"
+#include "remote/filterutility.hpp"
 #include "config/objectrule.hpp"
 #include "config/configitem.hpp"
 #include "base/configtype.hpp"
@@ -17,6 +18,18 @@ REGISTER_TYPE(UserGroup);
 
 INITIALIZE_ONCE([]() {
 	ObjectRule::RegisterType("UserGroup");
+
+	FilterUtility::RegisterIndex("User", "user.groups", FilterIndexKind::Contains, [](const String& name) {
+		std::vector<ConfigObject::Ptr> users;
+		UserGroup::Ptr group = UserGroup::GetByName(name);
+
+		if (group) {
+			for (const User::Ptr& user : group->GetMembers())
+				users.emplace_back(user);
+		}
+
+		return users;
+	});
 });
 
 bool UserGroup::EvaluateObjectRule(const User::Ptr& user, const ConfigItem::Ptr& group)
@@ -12,6 +12,7 @@
 using namespace icinga;
 
 thread_local ApiUser::Ptr ActionsHandler::AuthenticatedApiUser;
+thread_local boost::asio::yield_context *ActionsHandler::Yield = nullptr;
 
 REGISTER_URLHANDLER("/v1/actions", ActionsHandler);
 
@@ -75,8 +76,10 @@ bool ActionsHandler::HandleRequest(
 	bool verbose = false;
 
 	ActionsHandler::AuthenticatedApiUser = user;
+	ActionsHandler::Yield = &yc;
 	Defer a ([]() {
 		ActionsHandler::AuthenticatedApiUser = nullptr;
+		ActionsHandler::Yield = nullptr;
 	});
 
 	if (params)
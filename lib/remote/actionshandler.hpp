@@ -14,6 +14,7 @@ public:
 	DECLARE_PTR_TYPEDEFS(ActionsHandler);
 
 	static thread_local ApiUser::Ptr AuthenticatedApiUser;
+	static thread_local boost::asio::yield_context *Yield;
 
 	bool HandleRequest(
 		AsioTlsStream& stream,
@@ -8,6 +8,8 @@
 #include "remote/apifunction.hpp"
 #include "remote/configpackageutility.hpp"
 #include "remote/configobjectutility.hpp"
+#include "remote/eventqueue.hpp"
+#include "remote/apiuser.hpp"
 #include "base/convert.hpp"
 #include "base/defer.hpp"
 #include "base/io-engine.hpp"
@@ -1642,6 +1644,34 @@ std::pair<Dictionary::Ptr, Dictionary::Ptr> ApiListener::GetStatus()
 	double syncQueueItemRate = m_SyncQueue.GetTaskCount(60) / 60.0;
 	double relayQueueItemRate = m_RelayQueue.GetTaskCount(60) / 60.0;
 
+	/* event streams */
+	ArrayData eventStreams;
+	size_t eventsQueued = 0;
+	uint_fast64_t eventsDropped = 0;
+
+	for (auto& inbox : EventsRouter::GetInstance().GetAllInboxes()) {
+		Dictionary::Ptr inboxStatus = inbox->GetStatus();
+
+		eventsQueued += inboxStatus->Get("depth");
+		eventsDropped += inboxStatus->Get("dropped");
+		eventStreams.emplace_back(std::move(inboxStatus));
+	}
+
+	size_t eventStreamCount = eventStreams.size();
+
+	/* API users */
+	DictionaryData httpUsers;
+	uint_fast64_t httpRateLimited = 0;
+	uint_fast64_t httpConcurrencyLimited = 0;
+
+	for (const ApiUser::Ptr& user : ConfigType::GetObjectsByType<ApiUser>()) {
+		Dictionary::Ptr userStats = user->GetRequestStats();
+
+		httpRateLimited += userStats->Get("rate_limited");
+		httpConcurrencyLimited += userStats->Get("concurrency_limited");
+		httpUsers.emplace_back(user->GetName(), std::move(userStats));
+	}
+
 	Dictionary::Ptr status = new Dictionary({
 		{ "identity", GetIdentity() },
 		{ "num_endpoints", allEndpoints },
@@ -1662,7 +1692,16 @@ std::pair<Dictionary::Ptr, Dictionary::Ptr> ApiListener::GetStatus()
 		}) },
 
 		{ "http", new Dictionary({
-			{ "clients", httpClients }
+			{ "clients", httpClients },
+			{ "users", new Dictionary(std::move(httpUsers)) },
+			{ "rate_limited", httpRateLimited },
+			{ "concurrency_limited", httpConcurrencyLimited }
+		}) },
+
+		{ "events", new Dictionary({
+			{ "streams", new Array(std::move(eventStreams)) },
+			{ "queued", eventsQueued },
+			{ "dropped", eventsDropped }
 		}) }
 	});
 
@@ -1673,6 +1712,11 @@ std::pair<Dictionary::Ptr, Dictionary::Ptr> ApiListener::GetStatus()
 
 	perfdata->Set("num_json_rpc_anonymous_clients", jsonRpcAnonymousClients);
 	perfdata->Set("num_http_clients", httpClients);
+	perfdata->Set("num_http_rate_limited", httpRateLimited);
+	perfdata->Set("num_http_concurrency_limited", httpConcurrencyLimited);
+	perfdata->Set("num_events_streams", eventStreamCount);
+	perfdata->Set("num_events_queued", eventsQueued);
+	perfdata->Set("num_events_dropped", eventsDropped);
 	perfdata->Set("num_json_rpc_sync_queue_items", syncQueueItems);
 	perfdata->Set("num_json_rpc_relay_queue_items", relayQueueItems);
 
@@ -1884,6 +1928,24 @@ void ApiListener::ValidateTlsHandshakeTimeout(const Lazy<double>& lvalue, const
 		BOOST_THROW_EXCEPTION(ValidationError(this, { "tls_handshake_timeout" }, "Value must be greater than 0."));
 }
 
+void ApiListener::ValidateEventsQueueSize(const Lazy<int>& lvalue, const ValidationUtils& utils)
+{
+	ObjectImpl<ApiListener>::ValidateEventsQueueSize(lvalue, utils);
+
+	if (lvalue() < 0)
+		BOOST_THROW_EXCEPTION(ValidationError(this, { "events_queue_size" }, "Value must not be negative."));
+}
+
+void ApiListener::ValidateEventsOverflow(const Lazy<String>& lvalue, const ValidationUtils& utils)
+{
+	ObjectImpl<ApiListener>::ValidateEventsOverflow(lvalue, utils);
+
+	EventsOverflow overflow;
+
+	if (!EventsInbox::ParseOverflow(lvalue(), overflow))
+		BOOST_THROW_EXCEPTION(ValidationError(this, { "events_overflow" }, "Value must be one of 'drop-oldest', 'drop-newest' or 'disconnect'."));
+}
+
 bool ApiListener::IsHACluster()
 {
 	Zone::Ptr zone = Zone::GetLocalZone();
@@ -158,6 +158,8 @@ protected:
 
 	void ValidateTlsProtocolmin(const Lazy<String>& lvalue, const ValidationUtils& utils) override;
 	void ValidateTlsHandshakeTimeout(const Lazy<double>& lvalue, const ValidationUtils& utils) override;
+	void ValidateEventsQueueSize(const Lazy<int>& lvalue, const ValidationUtils& utils) override;
+	void ValidateEventsOverflow(const Lazy<String>& lvalue, const ValidationUtils& utils) override;
 
 private:
 	Shared<boost::asio::ssl::context>::Ptr m_SSLContext;
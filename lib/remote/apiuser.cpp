@@ -4,8 +4,11 @@
 #include "remote/apiuser-ti.cpp"
 #include "base/configtype.hpp"
 #include "base/base64.hpp"
+#include "base/objectlock.hpp"
 #include "base/tlsutility.hpp"
 #include "base/utility.hpp"
+#include <algorithm>
+#include <cmath>
 
 using namespace icinga;
 
@@ -53,3 +56,169 @@ ApiUser::Ptr ApiUser::GetByAuthHeader(const String& auth_header)
 	return user;
 }
 
+
+/**
+ * Admits a request of this user unless its rate limit or one of its
+ * concurrency budgets is exhausted. Admitted requests must be passed
+ * to FinishRequest() once they're done.
+ *
+ * @param path The request's URL path.
+ * @param urlPatterns Receives the max_concurrent_requests_by_url patterns whose budget the request takes.
+ * @param retryAfter Receives the seconds until the rate limit admits the next request.
+ * @param now The current time.
+ * @returns Whether the request was admitted and if not, why.
+ */
+ApiUserAdmission ApiUser::AdmitRequest(const String& path, std::vector<String>& urlPatterns, double& retryAfter,
+	std::chrono::steady_clock::time_point now)
+{
+	urlPatterns.clear();
+	retryAfter = 0;
+
+	int maxConcurrentRequests = GetMaxConcurrentRequests();
+	Dictionary::Ptr maxConcurrentRequestsByUrl = GetMaxConcurrentRequestsByUrl();
+	double rateLimit = GetRateLimit();
+	double rateLimitBurst = GetRateLimitBurst() > 0 ? GetRateLimitBurst() : std::max(1.0, std::ceil(rateLimit));
+
+	std::vector<std::pair<String, uint_fast32_t>> urlBudgets;
+
+	if (maxConcurrentRequestsByUrl) {
+		ObjectLock olock(maxConcurrentRequestsByUrl);
+
+		for (const Dictionary::Pair& kv : maxConcurrentRequestsByUrl) {
+			double budget = kv.second;
+
+			if (budget >= 1 && Utility::Match(kv.first, path))
+				urlBudgets.emplace_back(kv.first, budget);
+		}
+	}
+
+	std::unique_lock<std::mutex> lock (m_RequestsMutex);
+
+	m_Requests++;
+
+	if (rateLimit > 0) {
+		if (!m_RateLimitStarted) {
+			m_RateLimitTokens = rateLimitBurst;
+			m_RateLimitStarted = true;
+		} else if (now > m_RateLimitUpdated) {
+			m_RateLimitTokens += std::chrono::duration<double>(now - m_RateLimitUpdated).count() * rateLimit;
+		}
+
+		/* The burst may have been lowered since the last request. */
+		m_RateLimitTokens = std::min(m_RateLimitTokens, rateLimitBurst);
+		m_RateLimitUpdated = std::max(m_RateLimitUpdated, now);
+
+		if (m_RateLimitTokens < 1) {
+			m_RateLimitedRequests++;
+			retryAfter = (1 - m_RateLimitTokens) / rateLimit;
+			return ApiUserAdmission::RateLimited;
+		}
+	}
+
+	bool exhausted = maxConcurrentRequests > 0 && m_ConcurrentRequests >= (uint_fast32_t)maxConcurrentRequests;
+
+	for (auto& budget : urlBudgets) {
+		auto current (m_ConcurrentRequestsByUrl.find(budget.first));
+
+		if (current != m_ConcurrentRequestsByUrl.end() && current->second >= budget.second)
+			exhausted = true;
+	}
+
+	if (exhausted) {
+		m_ConcurrencyLimitedRequests++;
+		return ApiUserAdmission::ConcurrencyLimited;
+	}
+
+	if (rateLimit > 0)
+		m_RateLimitTokens -= 1;
+
+	m_ConcurrentRequests++;
+	m_ConcurrentRequestsHighWatermark = std::max(m_ConcurrentRequestsHighWatermark, m_ConcurrentRequests);
+
+	for (auto& budget : urlBudgets) {
+		m_ConcurrentRequestsByUrl[budget.first]++;
+		urlPatterns.emplace_back(std::move(budget.first));
+	}
+
+	return ApiUserAdmission::Admitted;
+}
+
+/**
+ * Returns the concurrency budgets taken by an admitted request.
+ *
+ * @param urlPatterns The patterns returned by AdmitRequest().
+ */
+void ApiUser::FinishRequest(const std::vector<String>& urlPatterns)
+{
+	std::unique_lock<std::mutex> lock (m_RequestsMutex);
+
+	if (m_ConcurrentRequests > 0)
+		m_ConcurrentRequests--;
+
+	for (auto& pattern : urlPatterns) {
+		auto current (m_ConcurrentRequestsByUrl.find(pattern));
+
+		if (current != m_ConcurrentRequestsByUrl.end() && --current->second == 0)
+			m_ConcurrentRequestsByUrl.erase(current);
+	}
+}
+
+Dictionary::Ptr ApiUser::GetRequestStats()
+{
+	std::unique_lock<std::mutex> lock (m_RequestsMutex);
+
+	DictionaryData concurrentRequestsByUrl;
+
+	for (auto& kv : m_ConcurrentRequestsByUrl)
+		concurrentRequestsByUrl.emplace_back(kv.first, kv.second);
+
+	return new Dictionary({
+		{ "requests", m_Requests },
+		{ "rate_limited", m_RateLimitedRequests },
+		{ "concurrency_limited", m_ConcurrencyLimitedRequests },
+		{ "concurrent_requests", m_ConcurrentRequests },
+		{ "concurrent_requests_high_watermark", m_ConcurrentRequestsHighWatermark },
+		{ "concurrent_requests_by_url", new Dictionary(std::move(concurrentRequestsByUrl)) }
+	});
+}
+
+void ApiUser::ValidateMaxConcurrentRequests(const Lazy<int>& lvalue, const ValidationUtils& utils)
+{
+	ObjectImpl<ApiUser>::ValidateMaxConcurrentRequests(lvalue, utils);
+
+	if (lvalue() < 0)
+		BOOST_THROW_EXCEPTION(ValidationError(this, { "max_concurrent_requests" }, "Value must not be negative."));
+}
+
+void ApiUser::ValidateMaxConcurrentRequestsByUrl(const Lazy<Dictionary::Ptr>& lvalue, const ValidationUtils& utils)
+{
+	ObjectImpl<ApiUser>::ValidateMaxConcurrentRequestsByUrl(lvalue, utils);
+
+	Dictionary::Ptr budgets = lvalue();
+
+	if (!budgets)
+		return;
+
+	ObjectLock olock(budgets);
+
+	for (const Dictionary::Pair& kv : budgets) {
+		if (kv.second < 0)
+			BOOST_THROW_EXCEPTION(ValidationError(this, { "max_concurrent_requests_by_url", kv.first }, "Value must not be negative."));
+	}
+}
+
+void ApiUser::ValidateRateLimit(const Lazy<double>& lvalue, const ValidationUtils& utils)
+{
+	ObjectImpl<ApiUser>::ValidateRateLimit(lvalue, utils);
+
+	if (lvalue() < 0)
+		BOOST_THROW_EXCEPTION(ValidationError(this, { "rate_limit" }, "Value must not be negative."));
+}
+
+void ApiUser::ValidateRateLimitBurst(const Lazy<int>& lvalue, const ValidationUtils& utils)
+{
+	ObjectImpl<ApiUser>::ValidateRateLimitBurst(lvalue, utils);
+
+	if (lvalue() < 0)
+		BOOST_THROW_EXCEPTION(ValidationError(this, { "rate_limit_burst" }, "Value must not be negative."));
+}
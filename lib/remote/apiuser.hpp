@@ -5,10 +5,27 @@
 
 #include "remote/i2-remote.hpp"
 #include "remote/apiuser-ti.hpp"
+#include <chrono>
+#include <cstdint>
+#include <map>
+#include <mutex>
+#include <vector>
 
 namespace icinga
 {
 
+/**
+ * The outcome of ApiUser::AdmitRequest().
+ *
+ * @ingroup remote
+ */
+enum class ApiUserAdmission
+{
+	Admitted,
+	RateLimited,
+	ConcurrencyLimited
+};
+
 /**
  * @ingroup remote
  */
@@ -20,6 +37,30 @@ public:
 
 	static ApiUser::Ptr GetByClientCN(const String& cn);
 	static ApiUser::Ptr GetByAuthHeader(const String& auth_header);
+
+	ApiUserAdmission AdmitRequest(const String& path, std::vector<String>& urlPatterns, double& retryAfter,
+		std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now());
+	void FinishRequest(const std::vector<String>& urlPatterns);
+
+	Dictionary::Ptr GetRequestStats();
+
+protected:
+	void ValidateMaxConcurrentRequests(const Lazy<int>& lvalue, const ValidationUtils& utils) override;
+	void ValidateMaxConcurrentRequestsByUrl(const Lazy<Dictionary::Ptr>& lvalue, const ValidationUtils& utils) override;
+	void ValidateRateLimit(const Lazy<double>& lvalue, const ValidationUtils& utils) override;
+	void ValidateRateLimitBurst(const Lazy<int>& lvalue, const ValidationUtils& utils) override;
+
+private:
+	std::mutex m_RequestsMutex;
+	uint_fast32_t m_ConcurrentRequests{0};
+	uint_fast32_t m_ConcurrentRequestsHighWatermark{0};
+	std::map<String, uint_fast32_t> m_ConcurrentRequestsByUrl;
+	double m_RateLimitTokens{0};
+	std::chrono::steady_clock::time_point m_RateLimitUpdated;
+	bool m_RateLimitStarted{false};
+	uint_fast64_t m_Requests{0};
+	uint_fast64_t m_RateLimitedRequests{0};
+	uint_fast64_t m_ConcurrencyLimitedRequests{0};
 };
 
 }
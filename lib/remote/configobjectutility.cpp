@@ -14,6 +14,9 @@
 #include <boost/filesystem.hpp>
 #include <boost/system/error_code.hpp>
 #include <fstream>
+#include <functional>
+#include <map>
+#include <set>
 #include <utility>
 
 using namespace icinga;
@@ -290,6 +293,191 @@ bool ConfigObjectUtility::CreateObject(const Type::Ptr& type, const String& full
 	return true;
 }
 
+/**
+ * Creates multiple objects of the same type with a single commit and activation.
+ *
+ * Each object's config is compiled separately, so errors are reported per
+ * object. If the commit fails, the objects which caused the errors are dropped
+ * and the remaining ones are committed again. Config files are only written
+ * for the objects which were committed successfully.
+ *
+ * @param type The objects' type.
+ * @param objects The objects' full names and config as returned by CreateObjectConfig().
+ * @param errors The errors per object.
+ * @param diagnosticInformation The diagnostic information per object (entries may be nullptr).
+ * @param cookie The origin which is forwarded to the activation.
+ * @returns Whether each object was created (or ignored due to 'ignore_on_error').
+ */
+std::vector<bool> ConfigObjectUtility::CreateObjects(const Type::Ptr& type, const std::vector<std::pair<String, String>>& objects,
+	const std::vector<Array::Ptr>& errors, const std::vector<Array::Ptr>& diagnosticInformation, const Value& cookie)
+{
+	std::vector<bool> created (objects.size(), false);
+
+	auto addError ([&errors, &diagnosticInformation](size_t i, const boost::exception_ptr& ex) {
+		errors[i]->Add(DiagnosticInformation(ex, false));
+
+		if (diagnosticInformation[i])
+			diagnosticInformation[i]->Add(DiagnosticInformation(ex));
+	});
+
+	CreateStorage();
+
+	auto *ctype = dynamic_cast<ConfigType *>(type.get());
+
+	std::vector<String> paths (objects.size());
+	std::map<String, size_t> pathIndex;
+	std::vector<size_t> pending;
+
+	for (size_t i = 0; i < objects.size(); i++) {
+		const String& fullName = objects[i].first;
+
+		if (ctype && ctype->GetObject(fullName)) {
+			errors[i]->Add("Object '" + fullName + "' already exists.");
+			continue;
+		}
+
+		try {
+			paths[i] = GetObjectConfigPath(type, fullName);
+		} catch (const std::exception& ex) {
+			errors[i]->Add("Config package broken: " + DiagnosticInformation(ex, false));
+			continue;
+		}
+
+		if (!pathIndex.emplace(paths[i], i).second) {
+			errors[i]->Add("Object '" + fullName + "' is specified multiple times.");
+			continue;
+		}
+
+		pending.push_back(i);
+	}
+
+	std::vector<ConfigItem::Ptr> newItems;
+	std::vector<size_t> committed;
+	std::function<void (std::vector<size_t>)> commit;
+
+	commit = [&](std::vector<size_t> batch) {
+		while (!batch.empty()) {
+			ActivationScope ascope;
+			std::vector<size_t> evaluated;
+
+			for (size_t i : batch) {
+				try {
+					std::unique_ptr<Expression> expr = ConfigCompiler::CompileText(paths[i], objects[i].second, String(), "_api");
+					ScriptFrame frame(true);
+					expr->Evaluate(frame);
+				} catch (const std::exception&) {
+					addError(i, boost::current_exception());
+					continue;
+				}
+
+				evaluated.push_back(i);
+			}
+
+			WorkQueue upq;
+			upq.SetName("ConfigObjectUtility::CreateObjects");
+
+			std::vector<ConfigItem::Ptr> batchItems;
+
+			if (ConfigItem::CommitItems(ascope.GetContext(), upq, batchItems, true)) {
+				newItems.insert(newItems.end(), batchItems.begin(), batchItems.end());
+				committed.insert(committed.end(), evaluated.begin(), evaluated.end());
+				return;
+			}
+
+			std::set<size_t> failed;
+			std::vector<boost::exception_ptr> unattributed;
+
+			for (const boost::exception_ptr& ex : upq.GetExceptions()) {
+				String path;
+
+				try {
+					boost::rethrow_exception(ex);
+				} catch (const ValidationError& vex) {
+					if (vex.GetObject())
+						path = vex.GetObject()->GetDebugInfo().Path;
+				} catch (const ScriptError& sex) {
+					path = sex.GetDebugInfo().Path;
+				} catch (...) {
+				}
+
+				auto it (pathIndex.find(path));
+
+				if (it != pathIndex.end()) {
+					failed.insert(it->second);
+					addError(it->second, ex);
+				} else {
+					unattributed.push_back(ex);
+				}
+			}
+
+			/* CommitItems() unregistered all items and objects of the failed attempt,
+			 * including the ones generated by apply rules, so they don't collide with the next one. */
+			batch.clear();
+
+			for (size_t i : evaluated) {
+				if (failed.find(i) == failed.end())
+					batch.push_back(i);
+			}
+
+			/* Retry without the objects which caused the errors. */
+			if (!failed.empty())
+				continue;
+
+			if (batch.size() == 1u) {
+				for (const boost::exception_ptr& ex : unattributed)
+					addError(batch[0], ex);
+
+				return;
+			}
+
+			/* Errors in e.g. templates or apply rules don't point to the object, so narrow them down. */
+			auto middle (batch.begin() + batch.size() / 2);
+
+			commit(std::vector<size_t>(batch.begin(), middle));
+			commit(std::vector<size_t>(middle, batch.end()));
+			return;
+		}
+	};
+
+	commit(pending);
+	pending = std::move(committed);
+
+	if (pending.empty())
+		return created;
+
+	for (size_t i : pending) {
+		Utility::MkDirP(Utility::DirName(paths[i]), 0700);
+
+		std::ofstream fp(paths[i].CStr(), std::ofstream::out | std::ostream::trunc);
+		fp << objects[i].second;
+		fp.close();
+	}
+
+	try {
+		/* IMPORTANT: Forward the cookie aka origin in order to prevent sync loops in the same zone! */
+		if (!ConfigItem::ActivateItems(newItems, true, false, false, cookie))
+			BOOST_THROW_EXCEPTION(std::runtime_error("Could not activate objects."));
+	} catch (const std::exception&) {
+		for (size_t i : pending) {
+			Utility::Remove(paths[i]);
+			addError(i, boost::current_exception());
+		}
+
+		return created;
+	}
+
+	if (type->GetName() != "Comment" && type->GetName() != "Downtime")
+		ApiListener::UpdateObjectAuthority();
+
+	for (size_t i : pending)
+		created[i] = true;
+
+	Log(LogInformation, "ConfigObjectUtility")
+		<< "Created and activated " << pending.size() << " of " << objects.size() << " objects of type '" << type->GetName() << "'.";
+
+	return created;
+}
+
 bool ConfigObjectUtility::DeleteObjectHelper(const ConfigObject::Ptr& object, bool cascade,
 	const Array::Ptr& errors, const Array::Ptr& diagnosticInformation, const Value& cookie)
 {
@@ -8,6 +8,8 @@
 #include "base/configobject.hpp"
 #include "base/dictionary.hpp"
 #include "base/type.hpp"
+#include <utility>
+#include <vector>
 
 namespace icinga
 {
@@ -32,6 +34,9 @@ public:
 	static bool CreateObject(const Type::Ptr& type, const String& fullName,
 		const String& config, const Array::Ptr& errors, const Array::Ptr& diagnosticInformation, const Value& cookie = Empty);
 
+	static std::vector<bool> CreateObjects(const Type::Ptr& type, const std::vector<std::pair<String, String>>& objects,
+		const std::vector<Array::Ptr>& errors, const std::vector<Array::Ptr>& diagnosticInformation, const Value& cookie = Empty);
+
 	static bool DeleteObject(const ConfigObject::Ptr& object, bool cascade, const Array::Ptr& errors,
 		const Array::Ptr& diagnosticInformation, const Value& cookie = Empty);
 
@@ -2,14 +2,24 @@
 
 #include "remote/configpackageutility.hpp"
 #include "remote/apilistener.hpp"
+#include "config/configcompiler.hpp"
 #include "base/application.hpp"
+#include "base/configuration.hpp"
+#include "base/defer.hpp"
 #include "base/exception.hpp"
+#include "base/io-engine.hpp"
 #include "base/utility.hpp"
+#include "base/workqueue.hpp"
 #include <boost/algorithm/string.hpp>
+#include <boost/asio/deadline_timer.hpp>
+#include <boost/date_time/posix_time/posix_time_duration.hpp>
 #include <boost/regex.hpp>
 #include <algorithm>
 #include <cctype>
+#include <condition_variable>
 #include <fstream>
+#include <iterator>
+#include <mutex>
 
 using namespace icinga;
 
@@ -208,11 +218,191 @@ void ConfigPackageUtility::TryActivateStageCallback(const ProcessResult& pr, con
 	}
 }
 
-void ConfigPackageUtility::AsyncTryActivateStage(const String& packageName, const String& stageName, bool activate, bool reload,
-	const Shared<Defer>::Ptr& resetPackageUpdates)
+/**
+ * The work queue which parses the files of new stages. Its threads are
+ * started on first use and shared by all requests.
+ */
+static WorkQueue& GetSyntaxCheckQueue()
+{
+	static WorkQueue *queue = []() {
+		auto *queue = new WorkQueue(25000, Configuration::Concurrency);
+		queue->SetName("ConfigPackageUtility::CheckStageSyntax");
+		return queue;
+	}();
+
+	return *queue;
+}
+
+static String ReadStageFile(const String& path)
+{
+	std::ifstream fp (path.CStr(), std::ifstream::in | std::ifstream::binary);
+
+	if (!fp)
+		BOOST_THROW_EXCEPTION(posix_error()
+			<< boost::errinfo_api_function("std::ifstream::open")
+			<< boost::errinfo_errno(errno)
+			<< boost::errinfo_file_name(path));
+
+	return String((std::istreambuf_iterator<char>(fp)), std::istreambuf_iterator<char>());
+}
+
+/**
+ * Parses a config file of a new stage unless it's the same as in the active stage.
+ *
+ * @param path The file.
+ * @param activePath The same file in the active stage, empty if there's no active stage.
+ * @param packageName The package.
+ * @returns The error, empty if the file could be parsed.
+ */
+static String CheckStageFileSyntax(const String& path, const String& activePath, const String& packageName)
+{
+	try {
+		String text = ReadStageFile(path);
+
+		/* The active stage passed the validation, its unchanged files don't need to be parsed again. */
+		if (!activePath.IsEmpty() && Utility::PathExists(activePath) && ReadStageFile(activePath) == text)
+			return String();
+
+		std::unique_ptr<Expression> expr = ConfigCompiler::CompileText(path, text, String(), packageName);
+
+		/* Syntax errors are compiled into an expression which throws them, nothing else is evaluated. */
+		if (dynamic_cast<ThrowExpression *>(expr.get())) {
+			ScriptFrame frame (true);
+			expr->Evaluate(frame);
+		}
+	} catch (const std::exception& ex) {
+		return DiagnosticInformation(ex, false);
+	}
+
+	return String();
+}
+
+/**
+ * Parses the stage's config files in-process. Syntax errors are reported
+ * right away instead of after the validation process parsed the whole
+ * configuration. Files which didn't change since the active stage are
+ * skipped, so usually only a few files are parsed twice.
+ *
+ * @param packageName The package.
+ * @param stageName The stage.
+ * @param yc If called from an I/O thread, its coroutine. It yields while the files are parsed.
+ * @returns The errors, empty if all files could be parsed.
+ */
+std::vector<String> ConfigPackageUtility::CheckStageSyntax(const String& packageName, const String& stageName, boost::asio::yield_context *yc)
+{
+	String stageDir = GetPackageDir() + "/" + packageName + "/" + stageName;
+	String activeStage = GetActiveStage(packageName);
+	String activeDir;
+
+	if (!activeStage.IsEmpty() && activeStage != stageName)
+		activeDir = GetPackageDir() + "/" + packageName + "/" + activeStage;
+
+	std::vector<String> files;
+
+	for (auto& kv : GetFiles(packageName, stageName)) {
+		if (!kv.second && boost::algorithm::ends_with(kv.first, ".conf"))
+			files.push_back(kv.first);
+	}
+
+	std::vector<String> results (files.size());
+
+	auto check ([&files, &results, &stageDir, &activeDir, &packageName](size_t i) {
+		String activePath;
+
+		if (!activeDir.IsEmpty())
+			activePath = activeDir + files[i].SubStr(stageDir.GetLength());
+
+		results[i] = CheckStageFileSyntax(files[i], activePath, packageName);
+	});
+
+	WorkQueue& upq = GetSyntaxCheckQueue();
+
+	if (upq.IsWorkerThread() || (files.size() < 2 && !yc)) {
+		for (size_t i = 0; i < files.size(); i++)
+			check(i);
+	} else {
+		std::mutex mutex;
+		std::condition_variable cv;
+		size_t pending = files.size();
+
+		for (size_t i = 0; i < files.size(); i++) {
+			upq.Enqueue([&check, &mutex, &cv, &pending, i]() {
+				Defer done ([&mutex, &cv, &pending]() {
+					std::unique_lock<std::mutex> lock(mutex);
+
+					if (--pending == 0)
+						cv.notify_all();
+				});
+
+				check(i);
+			});
+		}
+
+		std::unique_lock<std::mutex> lock(mutex);
+
+		if (yc) {
+			/* Neither block the I/O thread nor its CPU-bound slot while the files are parsed. */
+			IoBoundWorkSlot dontLockTheIoThread (*yc);
+			boost::asio::deadline_timer timer (IoEngine::Get().GetIoContext());
+			boost::system::error_code ec;
+
+			while (pending) {
+				lock.unlock();
+
+				timer.expires_from_now(boost::posix_time::milliseconds(10));
+				timer.async_wait((*yc)[ec]);
+
+				lock.lock();
+			}
+		} else {
+			cv.wait(lock, [&pending]() { return pending == 0; });
+		}
+	}
+
+	std::vector<String> errors;
+
+	for (auto& result : results) {
+		if (!result.IsEmpty())
+			errors.emplace_back(std::move(result));
+	}
+
+	return errors;
+}
+
+/**
+ * Validates the stage and activates it on success. Syntax errors are
+ * checked in-process first, the validation process is only spawned for
+ * stages without them.
+ *
+ * @param yc If called from an I/O thread, its coroutine. It yields during the syntax check.
+ * @returns Whether the validation process was started.
+ */
+bool ConfigPackageUtility::AsyncTryActivateStage(const String& packageName, const String& stageName, bool activate, bool reload,
+	const Shared<Defer>::Ptr& resetPackageUpdates, const Array::Ptr& errors, boost::asio::yield_context *yc)
 {
 	VERIFY(Application::GetArgC() >= 1);
 
+	std::vector<String> syntaxErrors = CheckStageSyntax(packageName, stageName, yc);
+
+	if (!syntaxErrors.empty()) {
+		/* Same format as the validation process' output, clients parse the startup log. */
+		String now = Utility::FormatDateTime("%Y-%m-%d %H:%M:%S %z", Utility::GetTime());
+		ProcessResult pr { -1, Utility::GetTime(), Utility::GetTime(), 1, "" };
+
+		for (const String& error : syntaxErrors) {
+			pr.Output += "[" + now + "] critical/config: " + error + "\n";
+
+			if (errors)
+				errors->Add(error);
+		}
+
+		pr.Output += "[" + now + "] critical/cli: Config validation failed. Re-run with 'icinga2 daemon -C' after fixing the config.\n";
+
+		TryActivateStageCallback(pr, packageName, stageName, activate, reload, resetPackageUpdates);
+
+		return false;
+	}
+
 	// prepare arguments
 	Array::Ptr args = new Array({
 		Application::GetExePath(Application::GetArgV()[0]),
@@ -238,6 +428,8 @@ void ConfigPackageUtility::AsyncTryActivateStage(const String& packageName, cons
 	process->Run([packageName, stageName, activate, reload, resetPackageUpdates](const ProcessResult& pr) {
 		TryActivateStageCallback(pr, packageName, stageName, activate, reload, resetPackageUpdates);
 	});
+
+	return true;
 }
 
 void ConfigPackageUtility::DeleteStage(const String& packageName, const String& stageName)
@@ -5,11 +5,13 @@
 
 #include "remote/i2-remote.hpp"
 #include "base/application.hpp"
+#include "base/array.hpp"
 #include "base/dictionary.hpp"
 #include "base/process.hpp"
 #include "base/string.hpp"
 #include "base/defer.hpp"
 #include "base/shared.hpp"
+#include <boost/asio/spawn.hpp>
 #include <vector>
 
 namespace icinga
@@ -39,8 +41,9 @@ public:
 	static void SetActiveStage(const String& packageName, const String& stageName);
 	static void SetActiveStageToFile(const String& packageName, const String& stageName);
 	static void ActivateStage(const String& packageName, const String& stageName);
-	static void AsyncTryActivateStage(const String& packageName, const String& stageName, bool activate, bool reload,
-		const Shared<Defer>::Ptr& resetPackageUpdates);
+	static bool AsyncTryActivateStage(const String& packageName, const String& stageName, bool activate, bool reload,
+		const Shared<Defer>::Ptr& resetPackageUpdates, const Array::Ptr& errors = nullptr, boost::asio::yield_context *yc = nullptr);
+	static std::vector<String> CheckStageSyntax(const String& packageName, const String& stageName, boost::asio::yield_context *yc = nullptr);
 
 	static std::vector<std::pair<String, bool> > GetFiles(const String& packageName, const String& stageName);
 
@@ -33,7 +33,7 @@ bool ConfigStagesHandler::HandleRequest(
 	if (request.method() == http::verb::get)
 		HandleGet(user, request, url, response, params);
 	else if (request.method() == http::verb::post)
-		HandlePost(user, request, url, response, params);
+		HandlePost(user, request, url, response, params, yc);
 	else if (request.method() == http::verb::delete_)
 		HandleDelete(user, request, url, response, params);
 	else
@@ -95,7 +95,8 @@ void ConfigStagesHandler::HandlePost(
 	boost::beast::http::request<boost::beast::http::string_body>& request,
 	const Url::Ptr& url,
 	boost::beast::http::response<boost::beast::http::string_body>& response,
-	const Dictionary::Ptr& params
+	const Dictionary::Ptr& params,
+	boost::asio::yield_context& yc
 )
 {
 	namespace http = boost::beast::http;
@@ -123,6 +124,8 @@ void ConfigStagesHandler::HandlePost(
 	Dictionary::Ptr files = params->Get("files");
 
 	String stageName;
+	Array::Ptr errors = new Array();
+	bool validating;
 
 	try {
 		if (!files)
@@ -138,12 +141,17 @@ void ConfigStagesHandler::HandlePost(
 
 		auto resetPackageUpdates (Shared<Defer>::Make([]() { ConfigStagesHandler::m_RunningPackageUpdates.store(false); }));
 
-		std::unique_lock<std::mutex> lock(ConfigPackageUtility::GetStaticPackageMutex());
+		/* Only held while the stage is created, the syntax check of the validation yields.
+		 * Other stage updates are rejected until this one is done anyway.
+		 */
+		{
+			std::unique_lock<std::mutex> lock(ConfigPackageUtility::GetStaticPackageMutex());
 
-		stageName = ConfigPackageUtility::CreateStage(packageName, files);
+			stageName = ConfigPackageUtility::CreateStage(packageName, files);
+		}
 
 		/* validate the config. on success, activate stage and reload */
-		ConfigPackageUtility::AsyncTryActivateStage(packageName, stageName, activate, reload, resetPackageUpdates);
+		validating = ConfigPackageUtility::AsyncTryActivateStage(packageName, stageName, activate, reload, resetPackageUpdates, errors, &yc);
 	} catch (const std::exception& ex) {
 		return HttpUtility::SendJsonError(response, params, 500,
 			"Stage creation failed.",
@@ -153,7 +161,9 @@ void ConfigStagesHandler::HandlePost(
 
 	String responseStatus = "Created stage. ";
 
-	if (reload)
+	if (!validating)
+		responseStatus += "Config validation failed.";
+	else if (reload)
 		responseStatus += "Reload triggered.";
 	else
 		responseStatus += "Reload skipped.";
@@ -165,6 +175,9 @@ void ConfigStagesHandler::HandlePost(
 		{ "status", responseStatus }
 	});
 
+	if (!validating)
+		result1->Set("errors", errors);
+
 	Dictionary::Ptr result = new Dictionary({
 		{ "results", new Array({ result1 }) }
 	});
@@ -38,7 +38,8 @@ private:
 		boost::beast::http::request<boost::beast::http::string_body>& request,
 		const Url::Ptr& url,
 		boost::beast::http::response<boost::beast::http::string_body>& response,
-		const Dictionary::Ptr& params
+		const Dictionary::Ptr& params,
+		boost::asio::yield_context& yc
 	);
 	void HandleDelete(
 		const ApiUser::Ptr& user,
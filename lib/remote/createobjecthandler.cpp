@@ -14,6 +14,161 @@ using namespace icinga;
 
 REGISTER_URLHANDLER("/v1/objects", CreateObjectHandler);
 
+static void PrepareAttrs(Dictionary::Ptr& attrs)
+{
+	/* Put created objects into the local zone if not explicitly defined.
+	 * This allows additional zone members to sync the
+	 * configuration at some later point.
+	 */
+	Zone::Ptr localZone = Zone::GetLocalZone();
+
+	if (localZone) {
+		String localZoneName = localZone->GetName();
+
+		if (!attrs) {
+			attrs = new Dictionary({
+				{ "zone", localZoneName }
+			});
+		} else if (!attrs->Contains("zone")) {
+			attrs->Set("zone", localZoneName);
+		}
+	}
+
+	/* Sanity checks for unique groups array. */
+	if (attrs && attrs->Contains("groups")) {
+		Array::Ptr groups = attrs->Get("groups");
+
+		if (groups)
+			attrs->Set("groups", groups->Unique());
+	}
+}
+
+/**
+ * Creates the objects passed in the 'objects' array with a single commit,
+ * see ConfigObjectUtility::CreateObjects().
+ */
+static void CreateObjects(const Type::Ptr& type, boost::beast::http::response<boost::beast::http::string_body>& response,
+	const Dictionary::Ptr& params)
+{
+	namespace http = boost::beast::http;
+
+	Value rawObjects = params->Get("objects");
+
+	if (!rawObjects.IsObjectType<Array>()) {
+		HttpUtility::SendJsonError(response, params, 400, "Parameter 'objects' must be an array.");
+		return;
+	}
+
+	Array::Ptr objects = rawObjects;
+	bool ignoreOnError = HttpUtility::GetLastParameter(params, "ignore_on_error");
+	bool verbose = HttpUtility::GetLastParameter(params, "verbose");
+
+	std::vector<String> names;
+	std::vector<Array::Ptr> errors, diagnosticInformation;
+	std::vector<std::pair<String, String>> configs;
+	std::vector<size_t> configIndex;
+
+	{
+		ObjectLock olock(objects);
+
+		for (const Value& rawObject : objects) {
+			size_t index = names.size();
+			Array::Ptr objectErrors = new Array();
+			Array::Ptr objectDiagnosticInformation = new Array();
+
+			errors.push_back(objectErrors);
+			diagnosticInformation.push_back(objectDiagnosticInformation);
+
+			if (!rawObject.IsObjectType<Dictionary>()) {
+				names.emplace_back();
+				objectErrors->Add("Object must be a dictionary.");
+				continue;
+			}
+
+			Dictionary::Ptr object = rawObject;
+			names.emplace_back(object->Get("name"));
+
+			if (names.back().IsEmpty()) {
+				objectErrors->Add("Attribute 'name' is required.");
+				continue;
+			}
+
+			Dictionary::Ptr attrs = object->Get("attrs");
+
+			try {
+				PrepareAttrs(attrs);
+
+				configs.emplace_back(names.back(), ConfigObjectUtility::CreateObjectConfig(type, names.back(),
+					ignoreOnError, object->Get("templates"), attrs));
+			} catch (const std::exception& ex) {
+				objectErrors->Add(DiagnosticInformation(ex, false));
+				objectDiagnosticInformation->Add(DiagnosticInformation(ex));
+				continue;
+			}
+
+			configIndex.push_back(index);
+		}
+	}
+
+	std::vector<Array::Ptr> configErrors, configDiagnosticInformation;
+
+	for (size_t index : configIndex) {
+		configErrors.push_back(errors[index]);
+		configDiagnosticInformation.push_back(diagnosticInformation[index]);
+	}
+
+	std::vector<bool> created = ConfigObjectUtility::CreateObjects(type, configs, configErrors, configDiagnosticInformation);
+	std::vector<bool> success (names.size(), false);
+
+	for (size_t i = 0; i < configIndex.size(); i++)
+		success[configIndex[i]] = created[i];
+
+	auto *ctype = dynamic_cast<ConfigType *>(type.get());
+	ArrayData results;
+	bool allCreated = true;
+
+	for (size_t i = 0; i < names.size(); i++) {
+		int code;
+		String status;
+
+		if (!success[i]) {
+			code = 500;
+			status = "Object could not be created.";
+			allCreated = false;
+		} else if (ctype->GetObject(names[i])) {
+			code = 200;
+			status = "Object was created";
+		} else {
+			code = 200;
+			status = "Object was not created but 'ignore_on_error' was set to true";
+		}
+
+		Dictionary::Ptr result = new Dictionary({
+			{ "type", type->GetName() },
+			{ "name", names[i] },
+			{ "code", code },
+			{ "status", status },
+			{ "errors", errors[i] }
+		});
+
+		if (verbose)
+			result->Set("diagnostic_information", diagnosticInformation[i]);
+
+		results.push_back(result);
+	}
+
+	Dictionary::Ptr result = new Dictionary({
+		{ "results", new Array(std::move(results)) }
+	});
+
+	if (!allCreated)
+		response.result(http::status::internal_server_error);
+	else
+		response.result(http::status::ok);
+
+	HttpUtility::SendJsonBody(response, params, result);
+}
+
 bool CreateObjectHandler::HandleRequest(
 	AsioTlsStream& stream,
 	const ApiUser::Ptr& user,
@@ -27,7 +182,7 @@ bool CreateObjectHandler::HandleRequest(
 {
 	namespace http = boost::beast::http;
 
-	if (url->GetPath().size() != 4)
+	if (url->GetPath().size() < 3 || url->GetPath().size() > 4)
 		return false;
 
 	if (request.method() != http::verb::put)
@@ -42,36 +197,16 @@ bool CreateObjectHandler::HandleRequest(
 
 	FilterUtility::CheckPermission(user, "objects/create/" + type->GetName());
 
+	if (url->GetPath().size() == 3) {
+		CreateObjects(type, response, params);
+		return true;
+	}
+
 	String name = url->GetPath()[3];
 	Array::Ptr templates = params->Get("templates");
 	Dictionary::Ptr attrs = params->Get("attrs");
 
-	/* Put created objects into the local zone if not explicitly defined.
-	 * This allows additional zone members to sync the
-	 * configuration at some later point.
-	 */
-	Zone::Ptr localZone = Zone::GetLocalZone();
-	String localZoneName;
-
-	if (localZone) {
-		localZoneName = localZone->GetName();
-
-		if (!attrs) {
-			attrs = new Dictionary({
-				{ "zone", localZoneName }
-			});
-		} else if (!attrs->Contains("zone")) {
-			attrs->Set("zone", localZoneName);
-		}
-	}
-
-	/* Sanity checks for unique groups array. */
-	if (attrs->Contains("groups")) {
-		Array::Ptr groups = attrs->Get("groups");
-
-		if (groups)
-			attrs->Set("groups", groups->Unique());
-	}
+	PrepareAttrs(attrs);
 
 	Dictionary::Ptr result1 = new Dictionary();
 	String status;
@@ -9,6 +9,7 @@
 #include "base/utility.hpp"
 #include "base/exception.hpp"
 #include "base/convert.hpp"
+#include "base/initialize.hpp"
 
 using namespace icinga;
 
@@ -17,6 +18,26 @@ REGISTER_TYPE(Endpoint);
 boost::signals2::signal<void(const Endpoint::Ptr&, const JsonRpcConnection::Ptr&)> Endpoint::OnConnected;
 boost::signals2::signal<void(const Endpoint::Ptr&, const JsonRpcConnection::Ptr&)> Endpoint::OnDisconnected;
 
+INITIALIZE_ONCE([]() {
+	/* The connection state is a change, unlike the log positions and message rates which change continuously. */
+	auto updateChangeVersion ([](const Endpoint::Ptr& endpoint) {
+		if (endpoint->IsActive())
+			endpoint->UpdateChangeVersion();
+	});
+
+	for (auto *signal : { &Endpoint::OnConnected, &Endpoint::OnDisconnected }) {
+		signal->connect([updateChangeVersion](const Endpoint::Ptr& endpoint, const JsonRpcConnection::Ptr&) {
+			updateChangeVersion(endpoint);
+		});
+	}
+
+	for (auto *signal : { &Endpoint::OnConnectingChanged, &Endpoint::OnSyncingChanged }) {
+		signal->connect([updateChangeVersion](const Endpoint::Ptr& endpoint, const Value&) {
+			updateChangeVersion(endpoint);
+		});
+	}
+});
+
 void Endpoint::OnAllConfigLoaded()
 {
 	ObjectImpl<Endpoint>::OnAllConfigLoaded();
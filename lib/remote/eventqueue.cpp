@@ -1,5 +1,6 @@
 /* Icinga 2 | (c) 2012 Icinga GmbH | GPLv2+ */
 
+#include "config/bytecode.hpp"
 #include "config/configcompiler.hpp"
 #include "remote/eventqueue.hpp"
 #include "remote/filterutility.hpp"
@@ -7,10 +8,14 @@
 #include "base/singleton.hpp"
 #include "base/logger.hpp"
 #include "base/utility.hpp"
+#include "base/json.hpp"
+#include <boost/algorithm/string/replace.hpp>
 #include <boost/asio/spawn.hpp>
 #include <boost/date_time/posix_time/posix_time_duration.hpp>
 #include <boost/date_time/posix_time/ptime.hpp>
+#include <boost/optional.hpp>
 #include <boost/system/error_code.hpp>
+#include <algorithm>
 #include <chrono>
 #include <utility>
 
@@ -150,8 +155,13 @@ std::map<String, EventsInbox::Filter> EventsInbox::m_Filters ({{"", EventsInbox:
 
 EventsRouter EventsRouter::m_Instance;
 
-EventsInbox::EventsInbox(String filter, const String& filterSource)
-	: m_Timer(IoEngine::Get().GetIoContext())
+/**
+ * @param name The name of the inbox, e.g. of the event stream's queue.
+ * @param maxDepth The maximum number of queued events, SIZE_MAX for unlimited.
+ * @param overflow What to do with new events once maxDepth events are queued.
+ */
+EventsInbox::EventsInbox(String filter, const String& filterSource, String name, size_t maxDepth, EventsOverflow overflow)
+	: m_Timer(IoEngine::Get().GetIoContext()), m_Name(std::move(name)), m_MaxDepth(maxDepth), m_Overflow(overflow)
 {
 	std::unique_lock<std::mutex> lock (m_FiltersMutex);
 	m_Filter = m_Filters.find(filter);
@@ -159,7 +169,7 @@ EventsInbox::EventsInbox(String filter, const String& filterSource)
 	if (m_Filter == m_Filters.end()) {
 		lock.unlock();
 
-		auto expr (ConfigCompiler::CompileText(filterSource, filter));
+		auto expr (BytecodeExpression::Compile(ConfigCompiler::CompileText(filterSource, filter)));
 
 		lock.lock();
 
@@ -189,15 +199,62 @@ const Expression::Ptr& EventsInbox::GetFilter()
 	return m_Filter->second.Expr;
 }
 
-void EventsInbox::Push(Dictionary::Ptr event)
+void EventsInbox::Push(const EncodedEvent& event)
 {
 	std::unique_lock<std::mutex> lock (m_Mutex);
 
-	m_Queue.emplace(std::move(event));
+	if (m_Overflowed) {
+		++m_Dropped;
+		return;
+	}
+
+	if (m_Queue.size() >= m_MaxDepth) {
+		if (m_Overflow == EventsOverflow::Disconnect) {
+			/* The subscriber gives up on the queued events, too. It logs a warning once it does. */
+			m_Dropped += m_Queue.size() + 1u;
+			m_Queue.clear();
+			m_Overflowed = true;
+			m_Timer.expires_at(boost::posix_time::neg_infin);
+			return;
+		}
+
+		++m_Dropped;
+
+		if (m_Overflow == EventsOverflow::DropOldest) {
+			m_Queue.pop_front();
+			m_Queue.emplace_back(event);
+			m_Timer.expires_at(boost::posix_time::neg_infin);
+		}
+
+		/* Events are dropped in storms, so warn about the first one and then at most once a minute. */
+		double now = Utility::GetTime();
+
+		if (now - m_DropWarned >= 60) {
+			auto dropped (m_Dropped - m_DroppedWarned);
+
+			m_DropWarned = now;
+			m_DroppedWarned = m_Dropped;
+			lock.unlock();
+
+			Log(LogWarning, "EventsInbox")
+				<< "Dropped " << dropped << " events of event stream '" << m_Name
+				<< "' which doesn't keep up: " << m_MaxDepth << " events are queued.";
+		}
+
+		return;
+	}
+
+	m_Queue.emplace_back(event);
+	m_HighWatermark = std::max(m_HighWatermark, m_Queue.size());
 	m_Timer.expires_at(boost::posix_time::neg_infin);
 }
 
-Dictionary::Ptr EventsInbox::Shift(boost::asio::yield_context yc, double timeout)
+/**
+ * Waits for events up to the given timeout.
+ *
+ * @returns All events in the inbox, none if the timeout expired.
+ */
+std::vector<EncodedEvent> EventsInbox::Shift(boost::asio::yield_context yc, double timeout)
 {
 	std::unique_lock<std::mutex> lock (m_Mutex, std::defer_lock);
 
@@ -225,17 +282,121 @@ Dictionary::Ptr EventsInbox::Shift(boost::asio::yield_context yc, double timeout
 		}
 
 		if (m_Queue.empty()) {
-			return nullptr;
+			return {};
 		}
 	}
 
-	auto event (std::move(m_Queue.front()));
-	m_Queue.pop();
-	return event;
+	if (m_Queue.empty()) {
+		/* Overflowed. */
+		return {};
+	}
+
+	std::vector<EncodedEvent> events (m_Queue.begin(), m_Queue.end());
+	m_Queue.clear();
+
+	m_Shifted += events.size();
+	m_MaxLag = std::max(m_MaxLag, Utility::GetTime() - events.front().Routed);
+
+	return events;
+}
+
+const String& EventsInbox::GetName() const
+{
+	return m_Name;
+}
+
+/**
+ * @returns Whether the inbox overflowed with EventsOverflow::Disconnect, so its subscriber must give up.
+ */
+bool EventsInbox::HasOverflowed()
+{
+	std::unique_lock<std::mutex> lock (m_Mutex);
+	return m_Overflowed;
+}
+
+/**
+ * @returns The number of events taken out of the inbox.
+ */
+uint_fast64_t EventsInbox::GetShifted()
+{
+	std::unique_lock<std::mutex> lock (m_Mutex);
+	return m_Shifted;
+}
+
+/**
+ * @returns The number of events discarded because the inbox was full.
+ */
+uint_fast64_t EventsInbox::GetDropped()
+{
+	std::unique_lock<std::mutex> lock (m_Mutex);
+	return m_Dropped;
 }
 
-EventsSubscriber::EventsSubscriber(std::set<EventType> types, String filter, const String& filterSource)
-	: m_Types(std::move(types)), m_Inbox(new EventsInbox(std::move(filter), filterSource))
+/**
+ * @returns The number of events waiting in the inbox.
+ */
+size_t EventsInbox::GetDepth()
+{
+	std::unique_lock<std::mutex> lock (m_Mutex);
+	return m_Queue.size();
+}
+
+/**
+ * @returns The largest number of events which waited in the inbox at once.
+ */
+size_t EventsInbox::GetHighWatermark()
+{
+	std::unique_lock<std::mutex> lock (m_Mutex);
+	return m_HighWatermark;
+}
+
+/**
+ * @returns The longest time (in seconds) an event waited in the inbox.
+ */
+double EventsInbox::GetMaxLag()
+{
+	std::unique_lock<std::mutex> lock (m_Mutex);
+	return m_MaxLag;
+}
+
+Dictionary::Ptr EventsInbox::GetStatus()
+{
+	std::unique_lock<std::mutex> lock (m_Mutex);
+
+	return new Dictionary({
+		{ "name", m_Name },
+		{ "depth", m_Queue.size() },
+		{ "high_watermark", m_HighWatermark },
+		{ "max_depth", m_MaxDepth == SIZE_MAX ? 0 : m_MaxDepth },
+		{ "sent", m_Shifted },
+		{ "dropped", m_Dropped },
+		{ "max_lag", m_MaxLag }
+	});
+}
+
+/**
+ * @param name "drop-oldest", "drop-newest" or "disconnect"
+ *
+ * @returns Whether the name is valid.
+ */
+bool EventsInbox::ParseOverflow(const String& name, EventsOverflow& overflow)
+{
+	if (name == "drop-oldest") {
+		overflow = EventsOverflow::DropOldest;
+	} else if (name == "drop-newest") {
+		overflow = EventsOverflow::DropNewest;
+	} else if (name == "disconnect") {
+		overflow = EventsOverflow::Disconnect;
+	} else {
+		return false;
+	}
+
+	return true;
+}
+
+EventsSubscriber::EventsSubscriber(std::set<EventType> types, String filter, const String& filterSource,
+	String name, size_t maxDepth, EventsOverflow overflow)
+	: m_Types(std::move(types)), m_Inbox(new EventsInbox(std::move(filter), filterSource, std::move(name), maxDepth, overflow))
 {
 	EventsRouter::GetInstance().Subscribe(m_Types, m_Inbox);
 }
@@ -260,15 +421,34 @@ EventsFilter::operator bool()
 	return !m_Inboxes.empty();
 }
 
+/* Evaluating a filter only replaces the event in the frame and sandboxed filters can't assign anything,
+ * so all filters evaluated by a thread share the frame's namespace and locals.
+ */
+static thread_local Namespace::Ptr l_FilterSelf;
+static thread_local Dictionary::Ptr l_FilterLocals;
+
 void EventsFilter::Push(Dictionary::Ptr event)
 {
+	/* Only set up once an inbox has a filter. */
+	boost::optional<ScriptFrame> frame;
+
+	EncodedEvent encoded;
+
 	for (auto& perFilter : m_Inboxes) {
 		if (perFilter.first) {
-			ScriptFrame frame(true, new Namespace());
-			frame.Sandboxed = true;
+			if (!frame) {
+				if (!l_FilterSelf) {
+					l_FilterSelf = new Namespace();
+					l_FilterLocals = new Dictionary();
+				}
+
+				frame.emplace(false, l_FilterSelf);
+				frame->Locals = l_FilterLocals;
+				frame->Sandboxed = true;
+			}
 
 			try {
-				if (!FilterUtility::EvaluateFilter(frame, perFilter.first.get(), event, "event")) {
+				if (!FilterUtility::EvaluateFilter(*frame, perFilter.first.get(), event, "event")) {
 					continue;
 				}
 			} catch (const std::exception& ex) {
@@ -278,8 +458,19 @@ void EventsFilter::Push(Dictionary::Ptr event)
 			}
 		}
 
+		/* Encode the event once for all inboxes instead of once per subscriber. */
+		if (!encoded.Json) {
+			String json = JsonEncode(event);
+
+			boost::algorithm::replace_all(json, "\n", "");
+			json += "\n";
+
+			encoded.Json = std::make_shared<const String>(std::move(json));
+			encoded.Routed = Utility::GetTime();
+		}
+
 		for (auto& inbox : perFilter.second) {
-			inbox->Push(event);
+			inbox->Push(encoded);
 		}
 	}
 }
@@ -349,3 +540,20 @@ EventsFilter EventsRouter::GetInboxes(EventType type)
 
 	return EventsFilter(perType->second);
 }
+
+/**
+ * @returns The inboxes subscribed to any event type.
+ */
+std::set<EventsInbox::Ptr> EventsRouter::GetAllInboxes()
+{
+	std::set<EventsInbox::Ptr> inboxes;
+	std::unique_lock<std::mutex> lock (m_Mutex);
+
+	for (auto& perType : m_Subscribers) {
+		for (auto& perFilter : perType.second) {
+			inboxes.insert(perFilter.second.begin(), perFilter.second.end());
+		}
+	}
+
+	return inboxes;
+}
@@ -15,7 +15,9 @@
 #include <set>
 #include <map>
 #include <deque>
+#include <memory>
 #include <queue>
+#include <vector>
 
 namespace icinga
 {
@@ -86,12 +88,36 @@ enum class EventType : uint_fast8_t
 	ObjectModified
 };
 
+/**
+ * What an inbox does with a new event once it's full.
+ *
+ * @ingroup remote
+ */
+enum class EventsOverflow : uint_fast8_t
+{
+	DropOldest,
+	DropNewest,
+	Disconnect
+};
+
+/**
+ * An event encoded once for all of its subscribers.
+ *
+ * @ingroup remote
+ */
+struct EncodedEvent
+{
+	std::shared_ptr<const String> Json; /**< A line of JSON including the newline */
+	double Routed; /**< When the event was pushed into the inboxes */
+};
+
 class EventsInbox : public Object
 {
 public:
 	DECLARE_PTR_TYPEDEFS(EventsInbox);
 
-	EventsInbox(String filter, const String& filterSource);
+	EventsInbox(String filter, const String& filterSource, String name = String(),
+		size_t maxDepth = SIZE_MAX, EventsOverflow overflow = EventsOverflow::DropOldest);
 	EventsInbox(const EventsInbox&) = delete;
 	EventsInbox(EventsInbox&&) = delete;
 	EventsInbox& operator=(const EventsInbox&) = delete;
@@ -100,8 +126,19 @@ public:
 
 	const Expression::Ptr& GetFilter();
 
-	void Push(Dictionary::Ptr event);
-	Dictionary::Ptr Shift(boost::asio::yield_context yc, double timeout = 5);
+	void Push(const EncodedEvent& event);
+	std::vector<EncodedEvent> Shift(boost::asio::yield_context yc, double timeout = 5);
+
+	const String& GetName() const;
+	bool HasOverflowed();
+	uint_fast64_t GetShifted();
+	uint_fast64_t GetDropped();
+	size_t GetDepth();
+	size_t GetHighWatermark();
+	double GetMaxLag();
+	Dictionary::Ptr GetStatus();
+
+	static bool ParseOverflow(const String& name, EventsOverflow& overflow);
 
 private:
 	struct Filter
@@ -115,14 +152,25 @@ private:
 
 	std::mutex m_Mutex;
 	decltype(m_Filters.begin()) m_Filter;
-	std::queue<Dictionary::Ptr> m_Queue;
+	std::deque<EncodedEvent> m_Queue;
 	boost::asio::deadline_timer m_Timer;
+	String m_Name;
+	size_t m_MaxDepth;
+	EventsOverflow m_Overflow;
+	bool m_Overflowed = false;
+	uint_fast64_t m_Shifted = 0;
+	uint_fast64_t m_Dropped = 0;
+	uint_fast64_t m_DroppedWarned = 0;
+	double m_DropWarned = 0;
+	size_t m_HighWatermark = 0;
+	double m_MaxLag = 0;
 };
 
 class EventsSubscriber
 {
 public:
-	EventsSubscriber(std::set<EventType> types, String filter, const String& filterSource);
+	EventsSubscriber(std::set<EventType> types, String filter, const String& filterSource, String name = String(),
+		size_t maxDepth = SIZE_MAX, EventsOverflow overflow = EventsOverflow::DropOldest);
 	EventsSubscriber(const EventsSubscriber&) = delete;
 	EventsSubscriber(EventsSubscriber&&) = delete;
 	EventsSubscriber& operator=(const EventsSubscriber&) = delete;
@@ -157,6 +205,7 @@ public:
 	void Subscribe(const std::set<EventType>& types, const EventsInbox::Ptr& inbox);
 	void Unsubscribe(const std::set<EventType>& types, const EventsInbox::Ptr& inbox);
 	EventsFilter GetInboxes(EventType type);
+	std::set<EventsInbox::Ptr> GetAllInboxes();
 
 private:
 	static EventsRouter m_Instance;
@@ -1,6 +1,7 @@
 /* Icinga 2 | (c) 2012 Icinga GmbH | GPLv2+ */
 
 #include "remote/eventshandler.hpp"
+#include "remote/apilistener.hpp"
 #include "remote/httputility.hpp"
 #include "remote/filterutility.hpp"
 #include "config/configcompiler.hpp"
@@ -8,12 +9,14 @@
 #include "base/defer.hpp"
 #include "base/io-engine.hpp"
 #include "base/objectlock.hpp"
-#include "base/json.hpp"
+#include "base/logger.hpp"
+#include "base/utility.hpp"
 #include <boost/asio/buffer.hpp>
 #include <boost/asio/write.hpp>
-#include <boost/algorithm/string/replace.hpp>
+#include <algorithm>
 #include <map>
 #include <set>
+#include <vector>
 
 using namespace icinga;
 
@@ -39,6 +42,12 @@ const std::map<String, EventType> l_EventTypes ({
 
 const String l_ApiQuery ("<API query>");
 
+/* Events are sent at the latest this many seconds after they've been written into the stream's buffer... */
+static const double l_FlushDelay = 0.05;
+
+/* ... or once the buffer holds this many bytes. */
+static const size_t l_FlushSize = 64 * 1024;
+
 bool EventsHandler::HandleRequest(
 	AsioTlsStream& stream,
 	const ApiUser::Ptr& user,
@@ -98,7 +107,36 @@ bool EventsHandler::HandleRequest(
 		}
 	}
 
-	EventsSubscriber subscriber (std::move(eventTypes), HttpUtility::GetLastParameter(params, "filter"), l_ApiQuery);
+	/* Unlimited unless configured otherwise. */
+	size_t maxDepth = SIZE_MAX;
+	String overflowName = "drop-oldest";
+	ApiListener::Ptr listener = ApiListener::GetInstance();
+
+	if (listener) {
+		if (listener->GetEventsQueueSize() > 0)
+			maxDepth = listener->GetEventsQueueSize();
+
+		overflowName = listener->GetEventsOverflow();
+	}
+
+	/* Clients may choose a smaller queue than the configured one. */
+	double queueSize = HttpUtility::GetLastParameter(params, "queue_size");
+
+	if (queueSize >= 1 && queueSize < maxDepth)
+		maxDepth = queueSize;
+
+	if (params->Contains("overflow"))
+		overflowName = HttpUtility::GetLastParameter(params, "overflow");
+
+	EventsOverflow overflow;
+
+	if (!EventsInbox::ParseOverflow(overflowName, overflow)) {
+		HttpUtility::SendJsonError(response, params, 400, "'overflow' must be one of 'drop-oldest', 'drop-newest' or 'disconnect'.");
+		return true;
+	}
+
+	EventsSubscriber subscriber (std::move(eventTypes), HttpUtility::GetLastParameter(params, "filter"), l_ApiQuery,
+		queueName, maxDepth, overflow);
 
 	server.StartStreaming();
 
@@ -110,26 +148,54 @@ bool EventsHandler::HandleRequest(
 	http::async_write(stream, response, yc);
 	stream.async_flush(yc);
 
-	asio::const_buffer newLine ("\n", 1);
+	auto& inbox (subscriber.GetInbox());
 
-	for (;;) {
-		auto event (subscriber.GetInbox()->Shift(yc));
+	Defer logStats ([&inbox, &user, &queueName]() {
+		Log(LogInformation, "EventsHandler")
+			<< "Event stream '" << queueName << "' of API user '" << user->GetName() << "' ended: "
+			<< inbox->GetShifted() << " events sent, " << inbox->GetDropped() + inbox->GetDepth() << " dropped, max. lag "
+			<< Utility::FormatDuration(inbox->GetMaxLag());
+	});
 
-		if (event) {
-			CpuBoundWork buildingResponse (yc);
+	/* Events are written into the stream's buffer as they arrive and sent once it has
+	 * l_FlushSize bytes or l_FlushDelay after the first of them, so bursts share a flush.
+	 */
+	size_t unflushed = 0;
+	double flushAt = 0;
 
-			String body = JsonEncode(event);
+	for (;;) {
+		double timeout = unflushed ? std::max(0.0, flushAt - Utility::GetTime()) : 5;
+		auto events (inbox->Shift(yc, timeout));
 
-			boost::algorithm::replace_all(body, "\n", "");
+		if (inbox->HasOverflowed()) {
+			Log(LogWarning, "EventsHandler")
+				<< "Closing event stream '" << queueName << "' of API user '" << user->GetName()
+				<< "': More than " << maxDepth << " events are queued.";
 
-			asio::const_buffer payload (body.CStr(), body.GetLength());
+			return true;
+		}
 
-			buildingResponse.Done();
+		if (!events.empty()) {
+			std::vector<asio::const_buffer> payload;
+			payload.reserve(events.size());
+
+			for (auto& event : events) {
+				payload.emplace_back(event.Json->CStr(), event.Json->GetLength());
+				unflushed += event.Json->GetLength();
+			}
 
 			asio::async_write(stream, payload, yc);
-			asio::async_write(stream, newLine, yc);
+
+			if (!flushAt)
+				flushAt = Utility::GetTime() + l_FlushDelay;
+		}
+
+		if (unflushed && (unflushed >= l_FlushSize || Utility::GetTime() >= flushAt)) {
 			stream.async_flush(yc);
-		} else if (server.Disconnected()) {
+
+			unflushed = 0;
+			flushAt = 0;
+		} else if (events.empty() && !unflushed && server.Disconnected()) {
 			return true;
 		}
 	}
@@ -2,17 +2,47 @@
 
 #include "remote/filterutility.hpp"
 #include "remote/httputility.hpp"
+#include "config/bytecode.hpp"
 #include "config/configcompiler.hpp"
 #include "config/expression.hpp"
 #include "base/namespace.hpp"
+#include "base/scriptglobal.hpp"
 #include "base/json.hpp"
 #include "base/configtype.hpp"
 #include "base/logger.hpp"
 #include "base/utility.hpp"
 #include <boost/algorithm/string/case_conv.hpp>
+#include <algorithm>
+#include <map>
+#include <mutex>
+#include <unordered_set>
 
 using namespace icinga;
 
+static std::mutex l_FilterIndexesMutex;
+static std::map<String, FilterIndex> l_FilterIndexes;
+
+namespace
+{
+
+/**
+ * What the filter planner knows about a query.
+ */
+struct FilterPlanContext
+{
+	Type::Ptr TargetType;
+	String VariableName;
+	std::set<String> PathVariables;
+	Dictionary::Ptr FilterVars;
+};
+
+}
+
+static String GetFilterIndexKey(const String& type, const String& path, FilterIndexKind kind)
+{
+	return type + " " + path + (kind == FilterIndexKind::Equal ? " ==" : " in");
+}
+
 Type::Ptr FilterUtility::TypeFromPluralName(const String& pluralName)
 {
 	String uname = pluralName;
@@ -114,6 +144,294 @@ bool FilterUtility::EvaluateFilter(ScriptFrame& frame, Expression *filter,
 	return Convert::ToBool(filter->Evaluate(frame));
 }
 
+/**
+ * Registers an index which the filter planner uses to narrow down the objects
+ * a filter is evaluated for, e.g. for the type "Service", the path "host.name"
+ * and FilterIndexKind::Equal one which returns the services of a host.
+ *
+ * The index must return all objects of the type which can satisfy the predicate.
+ *
+ * @param type The name of the target type.
+ * @param path The variable and attribute, e.g. "host.name" or "service.groups".
+ * @param kind The predicate.
+ * @param index The index.
+ */
+void FilterUtility::RegisterIndex(const String& type, const String& path, FilterIndexKind kind, const FilterIndex& index)
+{
+	std::unique_lock<std::mutex> lock (l_FilterIndexesMutex);
+	l_FilterIndexes[GetFilterIndexKey(type, path, kind)] = index;
+}
+
+/**
+ * If the given expression is like host.name (the target's or a joined object's attribute),
+ * set path to e.g. "host.name".
+ */
+static bool GetFilterPlanPath(const FilterPlanContext& context, Expression *exp, String& path)
+{
+	auto ixr (dynamic_cast<IndexerExpression*>(exp));
+
+	if (!ixr)
+		return false;
+
+	auto var (dynamic_cast<VariableExpression*>(ixr->GetOperand1().get()));
+	auto attr (dynamic_cast<LiteralExpression*>(ixr->GetOperand2().get()));
+
+	if (!var || !attr || !attr->GetValue().IsString()
+		|| context.PathVariables.find(var->GetVariable()) == context.PathVariables.end())
+		return false;
+
+	String name = var->GetVariable() == "obj" ? context.VariableName : var->GetVariable();
+	path = name + "." + attr->GetValue().Get<String>();
+	return true;
+}
+
+/**
+ * If the given expression is a string literal or refers to a string in filter_vars, set value to it.
+ */
+static bool GetFilterPlanValue(const FilterPlanContext& context, Expression *exp, String& value)
+{
+	auto lit (dynamic_cast<LiteralExpression*>(exp));
+
+	if (lit) {
+		if (!lit->GetValue().IsString())
+			return false;
+
+		value = lit->GetValue();
+		return true;
+	}
+
+	auto var (dynamic_cast<VariableExpression*>(exp));
+
+	/* The target and the joined objects shadow filter_vars of the same name. */
+	if (!var || !context.FilterVars || context.PathVariables.find(var->GetVariable()) != context.PathVariables.end())
+		return false;
+
+	Value fvar;
+
+	if (!context.FilterVars->Get(var->GetVariable(), &fvar) || !fvar.IsString())
+		return false;
+
+	value = fvar;
+	return true;
+}
+
+/**
+ * Adds the objects of the target type whose name (or short name) satisfies the predicate to the candidates.
+ */
+static void ScanFilterPlanNames(const FilterPlanContext& context, bool shortName, bool prefix,
+	const String& value, std::vector<ConfigObject::Ptr>& candidates)
+{
+	auto *ctype = dynamic_cast<ConfigType *>(context.TargetType.get());
+
+	for (const ConfigObject::Ptr& object : ctype->GetObjects()) {
+		String name = shortName ? object->GetShortName() : object->GetName();
+
+		if (prefix) {
+			/* match() is case-insensitive. */
+			if (name.GetLength() >= value.GetLength() && name.SubStr(0, value.GetLength()).ToLower() == value)
+				candidates.emplace_back(object);
+		} else if (name == value) {
+			candidates.emplace_back(object);
+		}
+	}
+}
+
+/**
+ * Looks up the objects of the target type which can satisfy the given predicate.
+ *
+ * @param prefix Whether the predicate is match("V*", $path$) rather than $path$ == "V".
+ * @returns Whether there's an index for the predicate.
+ */
+static bool LookupFilterPlanCandidates(const FilterPlanContext& context, const String& path, bool prefix,
+	FilterIndexKind kind, const String& value, std::vector<ConfigObject::Ptr>& candidates)
+{
+	if (kind == FilterIndexKind::Equal) {
+		bool fullName = path == context.VariableName + ".__name";
+
+		if (fullName || path == context.VariableName + ".name") {
+			/* Objects like services have a short name which is part of their full name. */
+			bool shortName = !fullName && dynamic_cast<NameComposer *>(context.TargetType.get());
+
+			if (prefix || shortName) {
+				ScanFilterPlanNames(context, shortName, prefix, value, candidates);
+			} else {
+				ConfigObject::Ptr object = ConfigObject::GetObject(context.TargetType->GetName(), value);
+
+				if (object)
+					candidates.emplace_back(std::move(object));
+			}
+
+			return true;
+		}
+	}
+
+	if (prefix)
+		return false;
+
+	FilterIndex index;
+
+	{
+		std::unique_lock<std::mutex> lock (l_FilterIndexesMutex);
+		auto it (l_FilterIndexes.find(GetFilterIndexKey(context.TargetType->GetName(), path, kind)));
+
+		if (it == l_FilterIndexes.end())
+			return false;
+
+		index = it->second;
+	}
+
+	auto objects (index(value));
+	candidates.insert(candidates.end(), objects.begin(), objects.end());
+	return true;
+}
+
+static void UniqueFilterPlanCandidates(std::vector<ConfigObject::Ptr>& candidates)
+{
+	std::unordered_set<ConfigObject*> seen;
+
+	candidates.erase(std::remove_if(candidates.begin(), candidates.end(), [&seen](const ConfigObject::Ptr& object) {
+		return !seen.insert(object.get()).second;
+	}), candidates.end());
+}
+
+/**
+ * If the given filter can only be true for some objects which an index can look up, set candidates to them:
+ *
+ * - $path$ == "V" and $path$ in [ "V", "v" ... ] for the target's name or registered indexes
+ * - "V" in $path$ for registered indexes, e.g. "V" in host.groups
+ * - match("V*", $path$) for the target's name
+ * - A && B uses the index of A or B which yields fewer candidates
+ * - A || B uses both indexes, both must have one
+ *
+ * $path$ is like host.name, "V" is a string literal or a string in filter_vars.
+ *
+ * @param index Set to a description of the used indexes.
+ * @returns Whether an index was used.
+ */
+static bool PlanFilter(const FilterPlanContext& context, Expression *filter, std::vector<ConfigObject::Ptr>& candidates, String& index)
+{
+	auto lor (dynamic_cast<LogicalOrExpression*>(filter));
+
+	if (lor) {
+		String index1, index2;
+
+		if (!PlanFilter(context, lor->GetOperand1().get(), candidates, index1)
+			|| !PlanFilter(context, lor->GetOperand2().get(), candidates, index2))
+			return false;
+
+		UniqueFilterPlanCandidates(candidates);
+		index = "(" + index1 + " || " + index2 + ")";
+		return true;
+	}
+
+	auto land (dynamic_cast<LogicalAndExpression*>(filter));
+
+	if (land) {
+		std::vector<ConfigObject::Ptr> candidates1, candidates2;
+		String index1, index2;
+		bool planned1 = PlanFilter(context, land->GetOperand1().get(), candidates1, index1);
+		bool planned2 = PlanFilter(context, land->GetOperand2().get(), candidates2, index2);
+
+		if (!planned1 && !planned2)
+			return false;
+
+		if (planned1 && (!planned2 || candidates1.size() <= candidates2.size())) {
+			candidates.insert(candidates.end(), candidates1.begin(), candidates1.end());
+			index = index1;
+		} else {
+			candidates.insert(candidates.end(), candidates2.begin(), candidates2.end());
+			index = index2;
+		}
+
+		return true;
+	}
+
+	String path, value;
+
+	auto eq (dynamic_cast<EqualExpression*>(filter));
+
+	if (eq) {
+		auto op1 (eq->GetOperand1().get());
+		auto op2 (eq->GetOperand2().get());
+
+		if (!GetFilterPlanPath(context, op1, path)) {
+			std::swap(op1, op2);
+
+			if (!GetFilterPlanPath(context, op1, path))
+				return false;
+		}
+
+		if (!GetFilterPlanValue(context, op2, value)
+			|| !LookupFilterPlanCandidates(context, path, false, FilterIndexKind::Equal, value, candidates))
+			return false;
+
+		index = path + " == " + JsonEncode(value);
+		return true;
+	}
+
+	auto in (dynamic_cast<InExpression*>(filter));
+
+	if (in) {
+		auto op1 (in->GetOperand1().get());
+		auto op2 (in->GetOperand2().get());
+
+		if (GetFilterPlanPath(context, op2, path)) {
+			if (!GetFilterPlanValue(context, op1, value)
+				|| !LookupFilterPlanCandidates(context, path, false, FilterIndexKind::Contains, value, candidates))
+				return false;
+
+			index = JsonEncode(value) + " in " + path;
+			return true;
+		}
+
+		auto arr (dynamic_cast<ArrayExpression*>(op2));
+
+		if (!arr || !GetFilterPlanPath(context, op1, path))
+			return false;
+
+		Array::Ptr values = new Array();
+
+		for (auto& item : arr->GetExpressions()) {
+			if (!GetFilterPlanValue(context, item.get(), value)
+				|| !LookupFilterPlanCandidates(context, path, false, FilterIndexKind::Equal, value, candidates))
+				return false;
+
+			values->Add(value);
+		}
+
+		UniqueFilterPlanCandidates(candidates);
+		index = path + " in " + JsonEncode(values);
+		return true;
+	}
+
+	auto call (dynamic_cast<FunctionCallExpression*>(filter));
+
+	if (call) {
+		auto fname (dynamic_cast<VariableExpression*>(call->m_FName.get()));
+
+		/* A global variable or one in filter_vars named "match" shadows the match() function. */
+		if (!fname || fname->GetVariable() != "match" || call->m_Args.size() != 2u
+			|| ScriptGlobal::GetGlobals()->Contains("match") || (context.FilterVars && context.FilterVars->Contains("match")))
+			return false;
+
+		if (!GetFilterPlanValue(context, call->m_Args[0].get(), value)
+			|| !GetFilterPlanPath(context, call->m_Args[1].get(), path))
+			return false;
+
+		/* These start a wildcard or an escape sequence. */
+		String prefix = value.SubStr(0, value.FindFirstOf("*?\\")).ToLower();
+
+		if (prefix.IsEmpty()
+			|| !LookupFilterPlanCandidates(context, path, true, FilterIndexKind::Equal, prefix, candidates))
+			return false;
+
+		index = "match(" + JsonEncode(value) + ", " + path + ")";
+		return true;
+	}
+
+	return false;
+}
+
 static void FilteredAddTarget(ScriptFrame& permissionFrame, Expression *permissionFilter,
 	ScriptFrame& frame, Expression *ufilter, std::vector<Value>& result, const String& variableName, const Object::Ptr& target)
 {
@@ -198,7 +516,16 @@ void FilterUtility::CheckPermission(const ApiUser::Ptr& user, const String& perm
 	}
 }
 
-std::vector<Value> FilterUtility::GetFilterTargets(const QueryDescription& qd, const Dictionary::Ptr& query, const ApiUser::Ptr& user, const String& variableName)
+/**
+ * Returns the targets selected by the given query.
+ *
+ * Filters which can only be true for objects an index can look up (see PlanFilter())
+ * are evaluated for those objects only.
+ *
+ * @param plan If not nullptr, set to how the filter was evaluated (if any).
+ */
+std::vector<Value> FilterUtility::GetFilterTargets(const QueryDescription& qd, const Dictionary::Ptr& query, const ApiUser::Ptr& user,
+	const String& variableName, Dictionary::Ptr *plan)
 {
 	std::vector<Value> result;
 
@@ -279,9 +606,53 @@ std::vector<Value> FilterUtility::GetFilterTargets(const QueryDescription& qd, c
 				}
 			}
 
-			provider->FindTargets(type, [&permissionFrame, permissionFilter, &frame, &ufilter, &result, variableName](const Object::Ptr& target) {
-				FilteredAddTarget(permissionFrame, permissionFilter, frame, &*ufilter, result, variableName, target);
-			});
+			std::vector<ConfigObject::Ptr> candidates;
+			String index;
+			bool planned = false;
+
+			/* Other providers' targets can't be looked up by the indexes. */
+			if (dynamic_cast<ConfigObjectTargetProvider *>(provider.get()) && variableName.IsEmpty()) {
+				Type::Ptr ptype = Type::GetByName(type);
+				FilterPlanContext context { ptype, ptype->GetName().ToLower(), { "obj" }, filter_vars };
+
+				context.PathVariables.insert(context.VariableName);
+
+				for (int fid = 0; fid < ptype->GetFieldCount(); fid++) {
+					Field field = ptype->GetFieldInfo(fid);
+
+					if (field.Attributes & FANavigation)
+						context.PathVariables.insert(field.NavigationName ? field.NavigationName : field.Name);
+				}
+
+				/* The filter is compiled like a config file, i.e. as a list of expressions. */
+				Expression *root = ufilter.get();
+				auto dict (dynamic_cast<DictExpression*>(root));
+
+				if (dict && dict->IsInline() && dict->GetExpressions().size() == 1u)
+					root = dict->GetExpressions().front().get();
+
+				planned = PlanFilter(context, root, candidates, index);
+			}
+
+			std::unique_ptr<Expression> compiledFilter = BytecodeExpression::Compile(std::move(ufilter));
+
+			if (planned) {
+				for (const ConfigObject::Ptr& target : candidates) {
+					FilteredAddTarget(permissionFrame, permissionFilter, frame, &*compiledFilter, result, variableName, target);
+				}
+			} else {
+				provider->FindTargets(type, [&permissionFrame, permissionFilter, &frame, &compiledFilter, &result, variableName](const Object::Ptr& target) {
+					FilteredAddTarget(permissionFrame, permissionFilter, frame, &*compiledFilter, result, variableName, target);
+				});
+			}
+
+			if (plan) {
+				*plan = new Dictionary({
+					{ "index", planned ? Value(index) : Empty },
+					{ "candidates", planned ? Value(candidates.size()) : Empty },
+					{ "results", result.size() }
+				});
+			}
 		} else {
 			/* Ensure to pass a nullptr as filter expression.
 			 * GCC 8.1.1 on F28 causes problems, see GH #6533.
@@ -8,7 +8,9 @@
 #include "config/expression.hpp"
 #include "base/dictionary.hpp"
 #include "base/configobject.hpp"
+#include <functional>
 #include <set>
+#include <vector>
 
 namespace icinga
 {
@@ -35,6 +37,23 @@ public:
 	String GetPluralName(const String& type) const override;
 };
 
+/**
+ * The kind of filter predicate a registered index answers.
+ *
+ * @ingroup remote
+ */
+enum class FilterIndexKind
+{
+	Equal, /**< $path$ == "V" */
+	Contains /**< "V" in $path$ */
+};
+
+/**
+ * Returns the objects which may satisfy a filter predicate for the given value,
+ * e.g. the services of host "V" for service filters like host.name == "V".
+ */
+typedef std::function<std::vector<ConfigObject::Ptr> (const String& value)> FilterIndex;
+
 struct QueryDescription
 {
 	std::set<String> Types;
@@ -54,9 +73,11 @@ public:
 	static void CheckPermission(const ApiUser::Ptr& user, const String& permission, Expression **filter = nullptr);
 	static bool HasPermission(const ApiUser::Ptr& user, const String& permission, Expression **permissionFilter = nullptr);
 	static std::vector<Value> GetFilterTargets(const QueryDescription& qd, const Dictionary::Ptr& query,
-		const ApiUser::Ptr& user, const String& variableName = String());
+		const ApiUser::Ptr& user, const String& variableName = String(), Dictionary::Ptr *plan = nullptr);
 	static bool EvaluateFilter(ScriptFrame& frame, Expression *filter,
 		const Object::Ptr& target, const String& variableName = String());
+
+	static void RegisterIndex(const String& type, const String& path, FilterIndexKind kind, const FilterIndex& index);
 };
 
 }
@@ -18,9 +18,12 @@
 #include "base/timer.hpp"
 #include "base/tlsstream.hpp"
 #include "base/utility.hpp"
+#include <algorithm>
+#include <cmath>
 #include <limits>
 #include <memory>
 #include <stdexcept>
+#include <vector>
 #include <boost/asio/error.hpp>
 #include <boost/asio/io_context.hpp>
 #include <boost/asio/spawn.hpp>
@@ -41,7 +44,7 @@ HttpServerConnection::HttpServerConnection(const String& identity, bool authenti
 
 HttpServerConnection::HttpServerConnection(const String& identity, bool authenticated, const Shared<AsioTlsStream>::Ptr& stream, boost::asio::io_context& io)
 	: m_Stream(stream), m_Seen(Utility::GetTime()), m_IoStrand(io), m_ShuttingDown(false), m_HasStartedStreaming(false),
-	m_CheckLivenessTimer(io)
+	m_HasStartedChunkedResponse(false), m_CheckLivenessTimer(io)
 {
 	if (authenticated) {
 		m_ApiUser = ApiUser::GetByClientCN(identity);
@@ -132,6 +135,15 @@ void HttpServerConnection::StartStreaming()
 	});
 }
 
+/**
+ * Tells the connection that the handler writes the response itself in chunks.
+ * The connection is kept alive only if the handler completes the response.
+ */
+void HttpServerConnection::StartChunkedResponse()
+{
+	m_HasStartedChunkedResponse = true;
+}
+
 bool HttpServerConnection::Disconnected()
 {
 	return m_ShuttingDown;
@@ -437,6 +449,50 @@ bool EnsureValidBody(
 	return true;
 }
 
+static inline
+bool EnsureAdmittedRequest(
+	AsioTlsStream& stream,
+	boost::beast::http::request<boost::beast::http::string_body>& request,
+	ApiUser::Ptr& authenticatedUser,
+	std::vector<String>& urlPatterns,
+	boost::beast::http::response<boost::beast::http::string_body>& response,
+	boost::asio::yield_context& yc
+)
+{
+	namespace http = boost::beast::http;
+
+	String path (request.target().to_string());
+	auto query (path.Find("?"));
+
+	if (query != String::NPos) {
+		path = path.SubStr(0, query);
+	}
+
+	double retryAfter;
+	auto admission (authenticatedUser->AdmitRequest(path, urlPatterns, retryAfter));
+
+	if (admission == ApiUserAdmission::Admitted) {
+		return true;
+	}
+
+	if (admission == ApiUserAdmission::RateLimited) {
+		response.set(http::field::retry_after, Convert::ToString(std::max(1.0, std::ceil(retryAfter))));
+
+		HttpUtility::SendJsonError(response, nullptr, 429,
+			"Too many requests. The rate limit of API user '" + authenticatedUser->GetName() + "' is exceeded.");
+	} else {
+		HttpUtility::SendJsonError(response, nullptr, 429,
+			"Too many concurrent requests. The concurrency limit of API user '" + authenticatedUser->GetName() + "' is exhausted.");
+	}
+
+	boost::system::error_code ec;
+
+	http::async_write(stream, response, yc[ec]);
+	stream.async_flush(yc[ec]);
+
+	return false;
+}
+
 static inline
 bool ProcessRequest(
 	AsioTlsStream& stream,
@@ -445,6 +501,7 @@ bool ProcessRequest(
 	boost::beast::http::response<boost::beast::http::string_body>& response,
 	HttpServerConnection& server,
 	bool& hasStartedStreaming,
+	bool& hasStartedChunkedResponse,
 	boost::asio::yield_context& yc
 )
 {
@@ -455,7 +512,8 @@ bool ProcessRequest(
 
 		HttpHandler::ProcessRequest(stream, authenticatedUser, request, response, yc, server);
 	} catch (const std::exception& ex) {
-		if (hasStartedStreaming) {
+		if (hasStartedStreaming || hasStartedChunkedResponse) {
+			/* The response can't be completed anymore. */
 			return false;
 		}
 
@@ -481,6 +539,11 @@ bool ProcessRequest(
 		return false;
 	}
 
+	if (hasStartedChunkedResponse) {
+		hasStartedChunkedResponse = false;
+		return true;
+	}
+
 	boost::system::error_code ec;
 
 	http::async_write(stream, response, yc[ec]);
@@ -566,9 +629,23 @@ void HttpServerConnection::ProcessMessages(boost::asio::yield_context yc)
 				break;
 			}
 
+			std::vector<String> urlPatterns;
+
+			if (!EnsureAdmittedRequest(*m_Stream, request, authenticatedUser, urlPatterns, response, yc)) {
+				if (request.version() != 11 || request[http::field::connection] == "close") {
+					break;
+				}
+
+				continue;
+			}
+
+			Defer finishRequest ([&authenticatedUser, &urlPatterns]() {
+				authenticatedUser->FinishRequest(urlPatterns);
+			});
+
 			m_Seen = std::numeric_limits<decltype(m_Seen)>::max();
 
-			if (!ProcessRequest(*m_Stream, request, authenticatedUser, response, *this, m_HasStartedStreaming, yc)) {
+			if (!ProcessRequest(*m_Stream, request, authenticatedUser, response, *this, m_HasStartedStreaming, m_HasStartedChunkedResponse, yc)) {
 				break;
 			}
 
@@ -6,7 +6,18 @@
 #include "base/serializer.hpp"
 #include "base/dependencygraph.hpp"
 #include "base/configtype.hpp"
+#include "base/io-engine.hpp"
+#include "base/json.hpp"
+#include "base/convert.hpp"
 #include <boost/algorithm/string/case_conv.hpp>
+#include <boost/algorithm/string/predicate.hpp>
+#include <boost/functional/hash.hpp>
+#include <boost/lexical_cast.hpp>
+#include <boost/asio/buffer.hpp>
+#include <boost/asio/write.hpp>
+#include <algorithm>
+#include <cmath>
+#include <map>
 #include <set>
 #include <unordered_map>
 
@@ -14,6 +25,9 @@ using namespace icinga;
 
 REGISTER_URLHANDLER("/v1/objects", ObjectQueryHandler);
 
+/* Results with more objects are streamed in batches of this size. */
+static const size_t l_StreamingBatchSize = 500;
+
 Dictionary::Ptr ObjectQueryHandler::SerializeObjectAttrs(const Object::Ptr& object,
 	const String& attrPrefix, const Array::Ptr& attrs, bool isJoin, bool allAttrs)
 {
@@ -88,6 +102,66 @@ Dictionary::Ptr ObjectQueryHandler::SerializeObjectAttrs(const Object::Ptr& obje
 	return new Dictionary(std::move(resultAttrs));
 }
 
+/**
+ * Parses the changed_since parameter, a non-negative integer as a number or a string.
+ *
+ * @returns Whether the value is a valid version.
+ */
+static bool ParseChangeVersion(const Value& value, uint_fast64_t& version)
+{
+	if (value.IsNumber()) {
+		double number = value;
+
+		if (number < 0 || number != std::floor(number) || number >= 18446744073709551616.0)
+			return false;
+
+		version = number;
+		return true;
+	}
+
+	if (!value.IsString())
+		return false;
+
+	String text = value;
+
+	if (text.IsEmpty() || !std::all_of(text.Begin(), text.End(), [](char ch) { return ch >= '0' && ch <= '9'; }))
+		return false;
+
+	try {
+		version = boost::lexical_cast<uint_fast64_t>(text.GetData());
+	} catch (const boost::bad_lexical_cast&) {
+		return false;
+	}
+
+	return true;
+}
+
+/**
+ * @returns Whether the request's If-None-Match header contains the ETag.
+ */
+static bool IfNoneMatch(const boost::beast::http::request<boost::beast::http::string_body>& request, const String& etag)
+{
+	auto header (request[boost::beast::http::field::if_none_match]);
+
+	if (header.empty())
+		return false;
+
+	std::vector<String> tags = String(header.data(), header.data() + header.size()).Split(",");
+
+	for (String& tag : tags) {
+		tag = tag.Trim();
+
+		/* Weak comparison, the results are always serialized the same way. */
+		if (boost::algorithm::starts_with(tag, "W/"))
+			tag = tag.SubStr(2);
+
+		if (tag == etag || tag == "*")
+			return true;
+	}
+
+	return false;
+}
+
 bool ObjectQueryHandler::HandleRequest(
 	AsioTlsStream& stream,
 	const ApiUser::Ptr& user,
@@ -99,6 +173,7 @@ bool ObjectQueryHandler::HandleRequest(
 	HttpServerConnection& server
 )
 {
+	namespace asio = boost::asio;
 	namespace http = boost::beast::http;
 
 	if (url->GetPath().size() < 3 || url->GetPath().size() > 4)
@@ -154,10 +229,39 @@ bool ObjectQueryHandler::HandleRequest(
 		params->Set(attr, url->GetPath()[3]);
 	}
 
+	bool explain = HttpUtility::GetLastParameter(params, "explain");
+	Dictionary::Ptr plan;
 	std::vector<Value> objs;
 
+	bool delta = params->Contains("changed_since");
+	uint_fast64_t changedSince = 0;
+	Array::Ptr removed;
+
+	if (delta) {
+		if (!ParseChangeVersion(HttpUtility::GetLastParameter(params, "changed_since"), changedSince)) {
+			HttpUtility::SendJsonError(response, params, 400,
+				"Invalid value for 'changed_since' specified. A version returned by a previous query is required.");
+			return true;
+		}
+
+		auto *ctype = dynamic_cast<ConfigType *>(type.get());
+		std::vector<String> removedNames;
+
+		/* Versions from the future are from another instance or before a restart, too. */
+		if (!ctype || changedSince > ConfigObject::GetCurrentChangeVersion() || !ctype->GetRemovedObjects(changedSince, removedNames)) {
+			HttpUtility::SendJsonError(response, params, 410,
+				"Changes since version " + Convert::ToString(changedSince) + " are not known anymore, query all objects.");
+			return true;
+		}
+
+		removed = Array::FromVector(removedNames);
+	}
+
+	/* Changes after this version may or may not be included in the results, but are reported by the next delta query. */
+	uint_fast64_t version = ConfigObject::GetCurrentChangeVersion();
+
 	try {
-		objs = FilterUtility::GetFilterTargets(qd, params, user);
+		objs = FilterUtility::GetFilterTargets(qd, params, user, String(), explain ? &plan : nullptr);
 	} catch (const std::exception& ex) {
 		HttpUtility::SendJsonError(response, params, 404,
 			"No objects found.",
@@ -165,9 +269,6 @@ bool ObjectQueryHandler::HandleRequest(
 		return true;
 	}
 
-	ArrayData results;
-	results.reserve(objs.size());
-
 	std::set<String> joinAttrs;
 	std::set<String> userJoinAttrs;
 
@@ -190,10 +291,54 @@ bool ObjectQueryHandler::HandleRequest(
 		joinAttrs.insert(field.Name);
 	}
 
+	/* Joined objects are part of the results, so their changes count as well. */
+	auto objectVersion ([&type, &joinAttrs](const ConfigObject::Ptr& obj) {
+		uint_fast64_t objVersion = obj->GetChangeVersion();
+
+		for (const String& joinAttr : joinAttrs) {
+			auto joinedObj (dynamic_pointer_cast<ConfigObject>(obj->NavigateField(type->GetFieldId(joinAttr))));
+
+			if (joinedObj)
+				objVersion = std::max(objVersion, joinedObj->GetChangeVersion());
+		}
+
+		return objVersion;
+	});
+
+	if (delta) {
+		objs.erase(std::remove_if(objs.begin(), objs.end(), [&objectVersion, changedSince](const ConfigObject::Ptr& obj) {
+			return objectVersion(obj) <= changedSince;
+		}), objs.end());
+	}
+
+	/* The results only change if the matching objects or their versions do. */
+	size_t etagHash = std::hash<String>()(user->GetName() + "\n" + JsonEncode(params));
+
+	for (const ConfigObject::Ptr& obj : objs)
+		boost::hash_combine(etagHash, objectVersion(obj));
+
+	boost::hash_combine(etagHash, objs.size());
+
+	String etag = "\"" + Convert::ToString(etagHash) + "\"";
+
+	response.set(http::field::etag, etag);
+
+	if (IfNoneMatch(request, etag)) {
+		response.result(http::status::not_modified);
+		return true;
+	}
+
 	std::unordered_map<Type*, std::pair<bool, Expression::Ptr>> typePermissions;
 	std::unordered_map<Object*, bool> objectAccessAllowed;
 
-	for (const ConfigObject::Ptr& obj : objs) {
+	/* Many objects share the same joined object, e.g. the services of a host, so serialize it only once
+	 * per batch of results. The map holds a reference to the joined object so its address can't be reused
+	 * for another one.
+	 */
+	std::map<std::pair<int, Object*>, std::pair<Object::Ptr, Dictionary::Ptr>> joinedObjectAttrs;
+
+	/* Throws a ScriptError for invalid attributes, joins and meta fields. */
+	auto serializeObject ([&](const ConfigObject::Ptr& obj) -> Dictionary::Ptr {
 		DictionaryData result1{
 			{ "name", obj->GetName() },
 			{ "type", obj->GetReflectionType()->GetName() }
@@ -223,20 +368,14 @@ bool ObjectQueryHandler::HandleRequest(
 				} else if (meta == "location") {
 					metaAttrs.emplace_back("location", obj->GetSourceLocation());
 				} else {
-					HttpUtility::SendJsonError(response, params, 400, "Invalid field specified for meta: " + meta);
-					return true;
+					BOOST_THROW_EXCEPTION(ScriptError("Invalid field specified for meta: " + meta));
 				}
 			}
 		}
 
 		result1.emplace_back("meta", new Dictionary(std::move(metaAttrs)));
 
-		try {
-			result1.emplace_back("attrs", SerializeObjectAttrs(obj, String(), uattrs, false, false));
-		} catch (const ScriptError& ex) {
-			HttpUtility::SendJsonError(response, params, 400, ex.what());
-			return true;
-		}
+		result1.emplace_back("attrs", SerializeObjectAttrs(obj, String(), uattrs, false, false));
 
 		DictionaryData joins;
 
@@ -245,15 +384,13 @@ bool ObjectQueryHandler::HandleRequest(
 			int fid = type->GetFieldId(joinAttr);
 
 			if (fid < 0) {
-				HttpUtility::SendJsonError(response, params, 400, "Invalid field specified for join: " + joinAttr);
-				return true;
+				BOOST_THROW_EXCEPTION(ScriptError("Invalid field specified for join: " + joinAttr));
 			}
 
 			Field field = type->GetFieldInfo(fid);
 
 			if (!(field.Attributes & FANavigation)) {
-				HttpUtility::SendJsonError(response, params, 400, "Not a joinable field: " + joinAttr);
-				return true;
+				BOOST_THROW_EXCEPTION(ScriptError("Not a joinable field: " + joinAttr));
 			}
 
 			joinedObj = obj->NavigateField(fid);
@@ -308,25 +445,118 @@ bool ObjectQueryHandler::HandleRequest(
 
 			String prefix = field.NavigationName;
 
-			try {
-				joins.emplace_back(prefix, SerializeObjectAttrs(joinedObj, prefix, ujoins, true, allJoins));
-			} catch (const ScriptError& ex) {
-				HttpUtility::SendJsonError(response, params, 400, ex.what());
-				return true;
-			}
+			auto& joinedAttrs (joinedObjectAttrs[std::make_pair(fid, joinedObj.get())]);
+
+			if (!joinedAttrs.second)
+				joinedAttrs = std::make_pair(joinedObj, SerializeObjectAttrs(joinedObj, prefix, ujoins, true, allJoins));
+
+			joins.emplace_back(prefix, joinedAttrs.second);
 		}
 
 		result1.emplace_back("joins", new Dictionary(std::move(joins)));
 
-		results.push_back(new Dictionary(std::move(result1)));
+		return new Dictionary(std::move(result1));
+	});
+
+	ArrayData results;
+	size_t next = 0;
+
+	try {
+		for (; next < objs.size() && next < l_StreamingBatchSize; next++)
+			results.push_back(serializeObject(objs[next]));
+
+		/* Small results, HTTP/1.0 clients and pretty-printed JSON get a regular response. */
+		if (next == objs.size() || request.version() != 11 || HttpUtility::GetLastParameter(params, "pretty")) {
+			for (; next < objs.size(); next++)
+				results.push_back(serializeObject(objs[next]));
+
+			Dictionary::Ptr result = new Dictionary({
+				{ "results", new Array(std::move(results)) }
+			});
+
+			result->Set("version", version);
+
+			if (delta)
+				result->Set("removed", removed);
+
+			if (explain)
+				result->Set("plan", plan);
+
+			response.result(http::status::ok);
+			HttpUtility::SendJsonBody(response, params, result);
+
+			return true;
+		}
+	} catch (const ScriptError& ex) {
+		HttpUtility::SendJsonError(response, params, 400, ex.what());
+		return true;
 	}
 
-	Dictionary::Ptr result = new Dictionary({
-		{ "results", new Array(std::move(results)) }
-	});
+	/* Stream the remaining results in batches, so only one batch is held in memory at a time. */
+	server.StartChunkedResponse();
 
 	response.result(http::status::ok);
-	HttpUtility::SendJsonBody(response, params, result);
+	response.set(http::field::content_type, "application/json");
+	response.chunked(true);
+
+	bool first = true;
+	String chunk = "{\"results\":[";
+
+	auto encodeResults ([&results, &first, &chunk]() {
+		for (auto& result : results) {
+			if (!first)
+				chunk += ",";
+
+			first = false;
+			chunk += JsonEncode(result);
+		}
+
+		results.clear();
+	});
+
+	encodeResults();
+
+	IoBoundWorkSlot dontLockTheIoThread (yc);
+
+	http::response_serializer<http::string_body> serializer (response);
+	http::async_write_header(stream, serializer, yc);
+
+	for (;;) {
+		bool last = next == objs.size();
+
+		if (last) {
+			chunk += "],\"version\":" + JsonEncode(version);
+
+			if (delta)
+				chunk += ",\"removed\":" + JsonEncode(removed);
+
+			if (explain)
+				chunk += ",\"plan\":" + JsonEncode(plan);
+
+			chunk += "}";
+		}
+
+		asio::async_write(stream, http::make_chunk(asio::buffer(chunk.CStr(), chunk.GetLength())), yc);
+
+		if (last)
+			break;
+
+		chunk.Clear();
+
+		/* Like the results, the joined objects are only held in memory for one batch. */
+		joinedObjectAttrs.clear();
+		objectAccessAllowed.clear();
+
+		CpuBoundWork serializingBatch (yc);
+
+		for (size_t end = std::min(objs.size(), next + l_StreamingBatchSize); next < end; next++)
+			results.push_back(serializeObject(objs[next]));
+
+		encodeResults();
+	}
+
+	asio::async_write(stream, http::make_chunk_last(), yc);
+	stream.async_flush(yc);
 
 	return true;
 }
@@ -0,0 +1,76 @@
+/* Icinga 2 | (c) 2012 Icinga GmbH | GPLv2+ */
+
+#include "base/deadlinescheduler.hpp"
+#include "base/utility.hpp"
+#include <BoostTestTargetConfig.h>
+#include <mutex>
+#include <vector>
+
+using namespace icinga;
+
+BOOST_AUTO_TEST_SUITE(base_deadlinescheduler)
+
+BOOST_AUTO_TEST_CASE(order)
+{
+	std::mutex mutex;
+	std::vector<Object::Ptr> fired;
+
+	DeadlineScheduler::Ptr scheduler = new DeadlineScheduler("test_order", [&mutex, &fired](const Object::Ptr& object) {
+		std::unique_lock<std::mutex> lock(mutex);
+		fired.push_back(object);
+	});
+
+	Object::Ptr first = new Object();
+	Object::Ptr second = new Object();
+	Object::Ptr cancelled = new Object();
+
+	double now = Utility::GetTime();
+
+	scheduler->Schedule(second, now + 1);
+	scheduler->Schedule(first, now + 0.5);
+	scheduler->Schedule(cancelled, now + 0.7);
+	scheduler->Cancel(cancelled);
+
+	BOOST_CHECK(scheduler->GetPending() == 2);
+
+	Utility::Sleep(2);
+
+	std::unique_lock<std::mutex> lock(mutex);
+	BOOST_REQUIRE(fired.size() == 2);
+	BOOST_CHECK(fired[0] == first);
+	BOOST_CHECK(fired[1] == second);
+	BOOST_CHECK(scheduler->GetPending() == 0);
+	BOOST_CHECK(scheduler->GetMaxLag() < 1);
+}
+
+BOOST_AUTO_TEST_CASE(reschedule)
+{
+	std::mutex mutex;
+	int counter = 0;
+
+	DeadlineScheduler::Ptr scheduler = new DeadlineScheduler("test_reschedule", [&mutex, &counter](const Object::Ptr&) {
+		std::unique_lock<std::mutex> lock(mutex);
+		counter++;
+	});
+
+	Object::Ptr object = new Object();
+
+	scheduler->Schedule(object, Utility::GetTime() + 0.5);
+	scheduler->Schedule(object, Utility::GetTime() + 1.5);
+
+	BOOST_CHECK(scheduler->GetPending() == 1);
+
+	Utility::Sleep(1);
+
+	{
+		std::unique_lock<std::mutex> lock(mutex);
+		BOOST_CHECK(counter == 0);
+	}
+
+	Utility::Sleep(1.5);
+
+	std::unique_lock<std::mutex> lock(mutex);
+	BOOST_CHECK(counter == 1);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -58,4 +58,23 @@ BOOST_AUTO_TEST_CASE(scope)
 	BOOST_CHECK(counter >= 4 && counter <= 6);
 }
 
+BOOST_AUTO_TEST_CASE(reschedule_from_callback)
+{
+	Timer::Ptr timer = new Timer();
+	timer->OnTimerExpired.connect([](const Timer * const& self) {
+		counter++;
+
+		if (counter < 3)
+			const_cast<Timer *>(self)->Reschedule(Utility::GetTime() + 0.5);
+	});
+
+	counter = 0;
+	timer->Start();
+	timer->Reschedule(Utility::GetTime() + 0.5);
+	Utility::Sleep(3);
+	timer->Stop();
+
+	BOOST_CHECK(counter == 3);
+}
+
 BOOST_AUTO_TEST_SUITE_END()
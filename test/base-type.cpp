@@ -5,6 +5,8 @@
 #include "base/objectlock.hpp"
 #include "base/application.hpp"
 #include "base/type.hpp"
+#include "base/utility.hpp"
+#include "base/configtype.hpp"
 #include <BoostTestTargetConfig.h>
 
 using namespace icinga;
@@ -44,4 +46,50 @@ BOOST_AUTO_TEST_CASE(instantiate)
 	BOOST_CHECK(p);
 }
 
+BOOST_AUTO_TEST_CASE(changeversions)
+{
+	Type::Ptr type = Type::GetByName("FileLogger");
+	auto *ctype = dynamic_cast<ConfigType *>(type.get());
+
+	ConfigObject::Ptr object = static_pointer_cast<ConfigObject>(type->Instantiate(std::vector<Value>()));
+	object->SetName("changeversions");
+	object->Register();
+
+	uint_fast64_t before = ConfigObject::GetCurrentChangeVersion();
+
+	object->UpdateChangeVersion();
+	BOOST_CHECK(object->GetChangeVersion() > before);
+	BOOST_CHECK(object->GetChangeVersion() == ConfigObject::GetCurrentChangeVersion());
+
+	/* Attributes of an active object are updated without a new version, only the change they belong to gets one. */
+	object->SetActive(true, true);
+	uint_fast64_t version = object->GetChangeVersion();
+
+	object->SetPaused(true);
+	BOOST_CHECK(object->GetChangeVersion() == version);
+
+	ConfigObject::OnStateChanged(object);
+	BOOST_CHECK(object->GetChangeVersion() > version);
+
+	version = object->GetChangeVersion();
+	object->SetVersion(Utility::GetTime());
+	BOOST_CHECK(object->GetChangeVersion() > version);
+
+	object->SetActive(false, true);
+
+	uint_fast64_t registered = ConfigObject::GetCurrentChangeVersion();
+	object->Unregister();
+
+	std::vector<String> names;
+	BOOST_CHECK(ctype->GetRemovedObjects(registered, names));
+	BOOST_CHECK(names == std::vector<String>({ "changeversions" }));
+
+	names.clear();
+	BOOST_CHECK(ctype->GetRemovedObjects(ConfigObject::GetCurrentChangeVersion(), names));
+	BOOST_CHECK(names.empty());
+
+	/* Removals before the process started aren't known. */
+	BOOST_CHECK(!ctype->GetRemovedObjects(ConfigObject::GetInitialChangeVersion() - 1, names));
+}
+
 BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,72 @@
+/* Icinga 2 | (c) 2012 Icinga GmbH | GPLv2+ */
+
+#include "checker/checkercomponent.hpp"
+#include <BoostTestTargetConfig.h>
+
+using namespace icinga;
+
+BOOST_AUTO_TEST_SUITE(checker_checkercomponent)
+
+BOOST_AUTO_TEST_CASE(controller_ramp_up)
+{
+	/* Slow start at 1/16 of the maximum. */
+	double limit = CheckerComponent::UpdateConcurrencyLimit(0, 512, false);
+	BOOST_CHECK_EQUAL(limit, 32);
+
+	/* Raised by 1/50 of the maximum per step while not overloaded. */
+	limit = CheckerComponent::UpdateConcurrencyLimit(limit, 512, false);
+	BOOST_CHECK_CLOSE(limit, 32 + 10.24, 0.001);
+
+	int steps = 1;
+
+	while (limit < 512) {
+		limit = CheckerComponent::UpdateConcurrencyLimit(limit, 512, false);
+		steps++;
+	}
+
+	BOOST_CHECK_EQUAL(limit, 512);
+	BOOST_CHECK_EQUAL(steps, 47);
+
+	/* Being overloaded right away still starts low. */
+	BOOST_CHECK_EQUAL(CheckerComponent::UpdateConcurrencyLimit(0, 512, true), 32);
+
+	/* Small maximums are raised by at least one. */
+	BOOST_CHECK_EQUAL(CheckerComponent::UpdateConcurrencyLimit(2, 20, false), 3);
+}
+
+BOOST_AUTO_TEST_CASE(controller_back_off)
+{
+	double limit = 512;
+
+	limit = CheckerComponent::UpdateConcurrencyLimit(limit, 512, true);
+	BOOST_CHECK_EQUAL(limit, 384);
+
+	limit = CheckerComponent::UpdateConcurrencyLimit(limit, 512, true);
+	BOOST_CHECK_EQUAL(limit, 288);
+
+	for (int i = 0; i < 100; i++)
+		limit = CheckerComponent::UpdateConcurrencyLimit(limit, 512, true);
+
+	BOOST_CHECK_EQUAL(limit, 32);
+
+	/* Recovers additively once the overload is gone. */
+	limit = CheckerComponent::UpdateConcurrencyLimit(limit, 512, false);
+	BOOST_CHECK_CLOSE(limit, 42.24, 0.001);
+}
+
+BOOST_AUTO_TEST_CASE(controller_bounds)
+{
+	/* A single check at a time can't be lowered or raised. */
+	BOOST_CHECK_EQUAL(CheckerComponent::UpdateConcurrencyLimit(0, 1, false), 1);
+	BOOST_CHECK_EQUAL(CheckerComponent::UpdateConcurrencyLimit(1, 1, true), 1);
+	BOOST_CHECK_EQUAL(CheckerComponent::UpdateConcurrencyLimit(1, 1, false), 1);
+
+	/* The minimum is rounded up. */
+	BOOST_CHECK_EQUAL(CheckerComponent::UpdateConcurrencyLimit(1, 20, true), 2);
+
+	/* A lowered maximum takes effect immediately. */
+	BOOST_CHECK_EQUAL(CheckerComponent::UpdateConcurrencyLimit(512, 100, false), 100);
+	BOOST_CHECK_EQUAL(CheckerComponent::UpdateConcurrencyLimit(512, 100, true), 100);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
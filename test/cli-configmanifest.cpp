@@ -0,0 +1,117 @@
+/* Icinga 2 | (c) 2012 Icinga GmbH | GPLv2+ */
+
+#include "cli/configmanifest.hpp"
+#include "base/array.hpp"
+#include "base/json.hpp"
+#include <BoostTestTargetConfig.h>
+#include <sstream>
+
+using namespace icinga;
+
+BOOST_AUTO_TEST_SUITE(cli_configmanifest)
+
+static Dictionary::Ptr MakeManifest(const Dictionary::Ptr& files, const Dictionary::Ptr& objects)
+{
+	return new Dictionary({
+		{ "key", "key" },
+		{ "files", files },
+		{ "dirs", new Dictionary() },
+		{ "objects", objects }
+	});
+}
+
+static Array::Ptr MakeObject(const String& hash, const String& path)
+{
+	return new Array({ hash, path });
+}
+
+BOOST_AUTO_TEST_CASE(diff)
+{
+	Dictionary::Ptr running = MakeManifest(
+		new Dictionary({
+			{ "/etc/icinga2/a.conf", "a1" },
+			{ "/etc/icinga2/b.conf", "b1" },
+			{ "/etc/icinga2/c.conf", "c1" }
+		}),
+		new Dictionary({
+			{ "Host", new Dictionary({
+				{ "h1", MakeObject("h1", "/etc/icinga2/a.conf") },
+				{ "h2", MakeObject("h2", "/etc/icinga2/a.conf") },
+				{ "h3", MakeObject("h3", "/etc/icinga2/b.conf") }
+			}) },
+			{ "Service", new Dictionary({
+				{ "h3!ping", MakeObject("s1", "/etc/icinga2/c.conf") }
+			}) }
+		})
+	);
+
+	Dictionary::Ptr planned = MakeManifest(
+		new Dictionary({
+			{ "/etc/icinga2/a.conf", "a1" },
+			{ "/etc/icinga2/b.conf", "b2" },
+			{ "/etc/icinga2/d.conf", "d1" }
+		}),
+		new Dictionary({
+			{ "Host", new Dictionary({
+				{ "h1", MakeObject("h1", "/etc/icinga2/a.conf") },
+				{ "h2", MakeObject("h2-changed", "/etc/icinga2/b.conf") },
+				{ "h4", MakeObject("h4", "/etc/icinga2/d.conf") }
+			}) }
+		})
+	);
+
+	Dictionary::Ptr diff = ConfigManifest::Diff(running, planned);
+	Dictionary::Ptr files = diff->Get("files");
+	Dictionary::Ptr objects = diff->Get("objects");
+
+	BOOST_CHECK_EQUAL(JsonEncode(files->Get("added")), "[\"/etc/icinga2/d.conf\"]");
+	BOOST_CHECK_EQUAL(JsonEncode(files->Get("modified")), "[\"/etc/icinga2/b.conf\"]");
+	BOOST_CHECK_EQUAL(JsonEncode(files->Get("removed")), "[\"/etc/icinga2/c.conf\"]");
+
+	BOOST_CHECK_EQUAL(JsonEncode(objects->Get("create")), "[[\"Host\",\"h4\",\"/etc/icinga2/d.conf\"]]");
+	BOOST_CHECK_EQUAL(JsonEncode(objects->Get("modify")), "[[\"Host\",\"h2\",\"/etc/icinga2/b.conf\"]]");
+	BOOST_CHECK_EQUAL(JsonEncode(objects->Get("delete")),
+		"[[\"Host\",\"h3\",\"/etc/icinga2/b.conf\"],[\"Service\",\"h3!ping\",\"/etc/icinga2/c.conf\"]]");
+	BOOST_CHECK_EQUAL(objects->Get("unchanged"), 1);
+
+	/* An unchanged configuration has no differences. */
+	diff = ConfigManifest::Diff(planned, planned);
+	files = diff->Get("files");
+	objects = diff->Get("objects");
+
+	for (auto& change : { "added", "modified", "removed" })
+		BOOST_CHECK_EQUAL(Array::Ptr(files->Get(change))->GetLength(), 0);
+
+	for (auto& action : { "create", "modify", "delete" })
+		BOOST_CHECK_EQUAL(Array::Ptr(objects->Get(action))->GetLength(), 0);
+
+	BOOST_CHECK_EQUAL(objects->Get("unchanged"), 3);
+}
+
+BOOST_AUTO_TEST_CASE(diff_without_running)
+{
+	Dictionary::Ptr planned = MakeManifest(
+		new Dictionary({ { "/etc/icinga2/a.conf", "a1" } }),
+		new Dictionary({
+			{ "Host", new Dictionary({
+				{ "h1", MakeObject("h1", "/etc/icinga2/a.conf") },
+				{ "h2", MakeObject("h2", "") }
+			}) }
+		})
+	);
+
+	Dictionary::Ptr objects = ConfigManifest::Diff(nullptr, planned)->Get("objects");
+
+	BOOST_CHECK_EQUAL(Array::Ptr(objects->Get("create"))->GetLength(), 2);
+	BOOST_CHECK_EQUAL(objects->Get("unchanged"), 0);
+
+	std::ostringstream plan;
+	ConfigManifest::PrintPlan(plan, nullptr, planned);
+
+	BOOST_CHECK(plan.str().find("  added    /etc/icinga2/a.conf\n") != std::string::npos);
+	BOOST_CHECK(plan.str().find("  create Host 'h1' (/etc/icinga2/a.conf)\n") != std::string::npos);
+	BOOST_CHECK(plan.str().find("  create Host 'h2'\n") != std::string::npos);
+	BOOST_CHECK(plan.str().find("Objects to create: 2, modify: 0, delete: 0, unchanged: 0\n") != std::string::npos);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,70 @@
+/* Icinga 2 | (c) 2012 Icinga GmbH | GPLv2+ */
+
+#include "config/applyrule.hpp"
+#include "config/configcompiler.hpp"
+#include <BoostTestTargetConfig.h>
+
+using namespace icinga;
+
+BOOST_AUTO_TEST_SUITE(config_applyrule)
+
+static std::vector<String> GetCandidateNames(const Dictionary::Ptr& host)
+{
+	std::vector<String> names;
+
+	for (auto& rule : ApplyRule::GetRules(Type::GetByName("TimePeriod"), Type::GetByName("Host"), new Dictionary({ { "host", host } }))) {
+		names.emplace_back(rule->GetName());
+	}
+
+	return names;
+}
+
+BOOST_AUTO_TEST_CASE(predicate_index)
+{
+	std::vector<std::pair<String, String>> filters {
+		{ "os", "host.vars.os == \"Linux\"" },
+		{ "group", "\"db\" in host.groups" },
+		{ "prefix", "match(\"web-*\", host.name)" },
+		{ "env", "host.vars.env in [ \"prod\", \"staging\" ] && host.address != \"\"" },
+		{ "unindexed", "host.address != \"\"" },
+		{ "either", "host.vars.os == \"Windows\" || match(\"WIN*\", host.name)" }
+	};
+
+	ApplyRule::RegisterType("TimePeriod", { "Host" });
+
+	for (auto& filter : filters) {
+		ScriptFrame frame(true);
+		std::unique_ptr<Expression> expr = ConfigCompiler::CompileText("<test>",
+			"apply TimePeriod \"" + filter.first + "\" to Host { assign where " + filter.second + " }");
+
+		expr->Evaluate(frame);
+	}
+
+	BOOST_CHECK_EQUAL(ApplyRule::GetRules(Type::GetByName("TimePeriod"), Type::GetByName("Host")).size(), 6u);
+
+	Dictionary::Ptr linux = new Dictionary({
+		{ "name", "web-01" },
+		{ "address", "192.0.2.1" },
+		{ "groups", new Array({ "db" }) },
+		{ "vars", new Dictionary({ { "os", "Linux" }, { "env", "dev" } }) }
+	});
+
+	BOOST_CHECK((GetCandidateNames(linux) == std::vector<String>{ "os", "group", "prefix", "unindexed" }));
+
+	Dictionary::Ptr windows = new Dictionary({
+		{ "name", "win-02" },
+		{ "vars", new Dictionary({ { "os", "Windows" }, { "env", "prod" } }) }
+	});
+
+	BOOST_CHECK((GetCandidateNames(windows) == std::vector<String>{ "env", "unindexed", "either" }));
+
+	/* 'in' on a non-array raises an error, which is left to the filter. */
+	Dictionary::Ptr broken = new Dictionary({
+		{ "name", "other" },
+		{ "groups", "db" }
+	});
+
+	BOOST_CHECK((GetCandidateNames(broken) == std::vector<String>{ "group", "unindexed" }));
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,67 @@
+/* Icinga 2 | (c) 2012 Icinga GmbH | GPLv2+ */
+
+#include "config/bytecode.hpp"
+#include "config/configcompiler.hpp"
+#include "base/exception.hpp"
+#include <BoostTestTargetConfig.h>
+
+using namespace icinga;
+
+BOOST_AUTO_TEST_SUITE(config_bytecode)
+
+static Value Evaluate(const Expression::Ptr& expr)
+{
+	ScriptFrame frame(true);
+	frame.Locals->Set("host", new Dictionary({
+		{ "name", "web-01" },
+		{ "groups", new Array({ "linux", "web" }) },
+		{ "vars", new Dictionary({ { "os", "Linux" }, { "cores", 8 } }) }
+	}));
+
+	return expr->Evaluate(frame).GetValue();
+}
+
+BOOST_AUTO_TEST_CASE(equivalence)
+{
+	std::vector<String> sources {
+		"host.vars.os == \"Linux\"",
+		"host.vars.os != \"Linux\" || host.name",
+		"\"web\" in host.groups && !(\"db\" in host.groups)",
+		"host.vars.disks in host.groups",
+		"\"web\" !in host.vars.missing",
+		"host.vars[\"co\" + \"res\"] * 2 - 1 >= 15 && host.vars.cores % 3 < 3",
+		"host.vars.cores / 2 <= 4 && 3 > 2",
+		"match(\"web-*\", host.name) && host.vars.os",
+		"var x = host.vars.cores; x + 1",
+		"{{{foo}}} + host.name",
+		"false && host.vars.missing.field",
+		""
+	};
+
+	for (auto& source : sources) {
+		Expression::Ptr tree = ConfigCompiler::CompileText("<test>", source).release();
+		Expression::Ptr bytecode = BytecodeExpression::Compile(tree);
+
+		BOOST_CHECK_MESSAGE(Evaluate(tree) == Evaluate(bytecode), source);
+	}
+}
+
+BOOST_AUTO_TEST_CASE(errors)
+{
+	Expression::Ptr bytecode = BytecodeExpression::Compile(Expression::Ptr(ConfigCompiler::CompileText("<test>",
+		"(host.name == \"web-01\" &&\n\"web\" in host.name)").release()));
+
+	try {
+		Evaluate(bytecode);
+		BOOST_FAIL("Expected a ScriptError.");
+	} catch (const ScriptError& ex) {
+		BOOST_CHECK(String(ex.what()).Contains("Invalid right side argument for 'in' operator"));
+		BOOST_CHECK_EQUAL(ex.GetDebugInfo().FirstLine, 2);
+	}
+
+	bytecode = BytecodeExpression::Compile(Expression::Ptr(ConfigCompiler::CompileText("<test>", "host.vars.os < 3").release()));
+
+	BOOST_CHECK_THROW(Evaluate(bytecode), ScriptError);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
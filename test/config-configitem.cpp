@@ -0,0 +1,114 @@
+/* Icinga 2 | (c) 2012 Icinga GmbH | GPLv2+ */
+
+#include "config/configcompiler.hpp"
+#include "config/configitem.hpp"
+#include "base/exception.hpp"
+#include "remote/apiuser.hpp"
+#include <BoostTestTargetConfig.h>
+#include <atomic>
+#include <thread>
+
+using namespace icinga;
+
+BOOST_AUTO_TEST_SUITE(config_configitem)
+
+static bool LoadConfig(const String& config, String *error = nullptr)
+{
+	std::unique_ptr<Expression> expr = ConfigCompiler::CompileText("<test>", config);
+
+	ActivationScope ascope;
+
+	ScriptFrame frame(true);
+	expr->Evaluate(frame);
+
+	WorkQueue upq;
+	std::vector<ConfigItem::Ptr> newItems;
+
+	if (!ConfigItem::CommitItems(ascope.GetContext(), upq, newItems, true)) {
+		if (error && upq.HasExceptions())
+			*error = DiagnosticInformation(upq.GetExceptions().front(), false);
+
+		return false;
+	}
+
+	return ConfigItem::ActivateItems(newItems, true);
+}
+
+static Expression::Ptr GetExpression(const String& name)
+{
+	ConfigItem::Ptr item = ConfigItem::GetByTypeAndName(ApiUser::TypeInstance, name);
+
+	BOOST_REQUIRE(item);
+
+	return item->GetExpression();
+}
+
+BOOST_AUTO_TEST_CASE(release_committed_items)
+{
+	BOOST_REQUIRE(LoadConfig(
+		"template ApiUser \"compact-template\" { permissions = [ \"*\" ] }\n"
+		"object ApiUser \"compact-imported\" { import \"compact-template\"; client_cn = \"imported\" }\n"
+		"object ApiUser \"compact-importing\" { import \"compact-imported\" }\n"
+		"object ApiUser \"compact-plain\" { client_cn = \"plain\" }\n"
+	));
+
+	BOOST_CHECK(ConfigItem::ReleaseCommittedItems() >= 2);
+
+	BOOST_CHECK(GetExpression("compact-template"));
+	BOOST_CHECK(GetExpression("compact-imported"));
+	BOOST_CHECK(!GetExpression("compact-importing"));
+	BOOST_CHECK(!GetExpression("compact-plain"));
+
+	/* The released objects keep working. */
+	BOOST_CHECK_EQUAL(ApiUser::GetByName("compact-importing")->GetClientCN(), "imported");
+
+	/* Templates and imported objects can still be imported at runtime, other objects are rejected. */
+	BOOST_CHECK(LoadConfig("object ApiUser \"compact-runtime1\" { import \"compact-template\" }"));
+	BOOST_CHECK(LoadConfig("object ApiUser \"compact-runtime2\" { import \"compact-imported\" }"));
+	BOOST_CHECK_EQUAL(ApiUser::GetByName("compact-runtime2")->GetClientCN(), "imported");
+
+	String error;
+	BOOST_CHECK(!LoadConfig("object ApiUser \"compact-runtime3\" { import \"compact-plain\" }", &error));
+	BOOST_CHECK(!ApiUser::GetByName("compact-runtime3"));
+	BOOST_CHECK(error.Find("configuration was released after activation") != String::NPos);
+}
+
+BOOST_AUTO_TEST_CASE(release_concurrently)
+{
+	String config;
+	std::vector<ConfigItem::Ptr> items;
+
+	for (int i = 0; i < 200; i++)
+		config += "object ApiUser \"concurrent-" + std::to_string(i) + "\" { client_cn = \"cn\" }\n";
+
+	BOOST_REQUIRE(LoadConfig(config));
+
+	for (int i = 0; i < 200; i++)
+		items.emplace_back(ConfigItem::GetByTypeAndName(ApiUser::TypeInstance, "concurrent-" + std::to_string(i)));
+
+	/* Readers keep the expression they got alive while it's being released. */
+	std::atomic<int> seen (0);
+
+	std::thread reader ([&items, &seen]() {
+		for (int round = 0; round < 50; round++) {
+			for (const ConfigItem::Ptr& item : items) {
+				Expression::Ptr expression = item->GetExpression();
+
+				if (expression) {
+					expression->GetDebugInfo();
+					seen++;
+				}
+			}
+		}
+	});
+
+	ConfigItem::ReleaseCommittedItems();
+	reader.join();
+
+	BOOST_CHECK(seen.load() <= 50 * 200);
+
+	for (const ConfigItem::Ptr& item : items)
+		BOOST_CHECK(!item->GetExpression());
+}
+
+BOOST_AUTO_TEST_SUITE_END()
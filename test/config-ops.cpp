@@ -2,6 +2,9 @@
 
 #include "config/configcompiler.hpp"
 #include "base/exception.hpp"
+#include "base/utility.hpp"
+#include <boost/filesystem.hpp>
+#include <fstream>
 #include <BoostTestTargetConfig.h>
 
 using namespace icinga;
@@ -243,4 +246,83 @@ BOOST_AUTO_TEST_CASE(advanced)
 	BOOST_CHECK(func->Invoke() == 3);
 }
 
+BOOST_AUTO_TEST_CASE(files)
+{
+	ScriptFrame frame(true);
+
+	/* Around the page size, where the lexer's terminator falls into the next page. */
+	for (size_t size : { 4094, 4095, 4096, 4097, 8192 }) {
+		for (bool heredoc : { false, true }) {
+			String literal (size - (heredoc ? 6 : 2), 'x');
+			String text = heredoc ? "{{{" + literal + "}}}" : "\"" + literal + "\"";
+
+			std::fstream fp;
+			String path = Utility::CreateTempFile((boost::filesystem::temp_directory_path() / "icinga2-config-ops.XXXXXX").string(), 0600, fp);
+			fp << text;
+			fp.close();
+
+			std::unique_ptr<Expression> expr = ConfigCompiler::CompileFile(path);
+			boost::filesystem::remove(path.GetData());
+
+			BOOST_CHECK_MESSAGE(expr->Evaluate(frame).GetValue() == literal, size);
+		}
+	}
+}
+
+BOOST_AUTO_TEST_CASE(files_tokens)
+{
+	ScriptFrame frame(true);
+
+	std::fstream fp;
+	String path = Utility::CreateTempFile((boost::filesystem::temp_directory_path() / "icinga2-config-ops.XXXXXX").string(), 0600, fp);
+	fp << "var plain = \"plain\"\n"
+		<< "var escaped = \"a\\tb\\\"c\\101\"\n"
+		<< "var heredoc = {{{x}\ny}}}\n"
+		<< "var @for = plain + escaped + heredoc\n"
+		<< "@for + missing";
+	fp.close();
+
+	std::unique_ptr<Expression> expr = ConfigCompiler::CompileFile(path);
+	boost::filesystem::remove(path.GetData());
+
+	/* The tokens stay valid after the file is unmapped, the error is reported on the right line. */
+	try {
+		expr->Evaluate(frame);
+		BOOST_FAIL("Expected a ScriptError");
+	} catch (const ScriptError& ex) {
+		BOOST_CHECK_EQUAL(ex.GetDebugInfo().FirstLine, 6);
+	}
+
+	BOOST_CHECK(frame.Locals->Get("plain") == "plain");
+	BOOST_CHECK(frame.Locals->Get("escaped") == "a\tb\"cA");
+	BOOST_CHECK(frame.Locals->Get("heredoc") == "x}\ny");
+	BOOST_CHECK(frame.Locals->Get("for") == "plaina\tb\"cAx}\ny");
+}
+
+BOOST_AUTO_TEST_CASE(compiled_paths)
+{
+	std::fstream fp;
+	String path = Utility::CreateTempFile((boost::filesystem::temp_directory_path() / "icinga2-config-ops.XXXXXX").string(), 0600, fp);
+	fp << "1";
+	fp.close();
+
+	ConfigCompiler::CompileFile(path);
+
+	{
+		ConfigPathRecorder recorder;
+		BOOST_CHECK(recorder.GetPaths().empty());
+
+		ConfigCompiler::CompileFile(path);
+		ConfigCompiler::CompileFile(path);
+		BOOST_CHECK(recorder.GetPaths() == std::set<String>({ path }));
+	}
+
+	ConfigPathRecorder recorder;
+	ConfigCompiler::CompileText("<test>", "2");
+	boost::filesystem::remove(path.GetData());
+
+	/* Only the files compiled while the recorder exists count. */
+	BOOST_CHECK(recorder.GetPaths().empty());
+}
+
 BOOST_AUTO_TEST_SUITE_END()
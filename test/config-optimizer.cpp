@@ -0,0 +1,98 @@
+/* Icinga 2 | (c) 2012 Icinga GmbH | GPLv2+ */
+
+#include "config/optimizer.hpp"
+#include "config/configcompiler.hpp"
+#include <BoostTestTargetConfig.h>
+
+using namespace icinga;
+
+BOOST_AUTO_TEST_SUITE(config_optimizer)
+
+static Expression *GetStatement(const std::unique_ptr<Expression>& expr)
+{
+	auto dict (dynamic_cast<DictExpression*>(expr.get()));
+
+	BOOST_REQUIRE(dict && dict->GetExpressions().size() == 1u);
+
+	return dict->GetExpressions().front().get();
+}
+
+static Value Evaluate(const std::unique_ptr<Expression>& expr)
+{
+	ScriptFrame frame(true);
+	return expr->Evaluate(frame).GetValue();
+}
+
+BOOST_AUTO_TEST_CASE(fold)
+{
+	std::vector<std::pair<String, Value>> sources {
+		{ "1 + 2 * 3", 7 },
+		{ "\"check_\" + \"ping\"", "check_ping" },
+		{ "!(3 > 2) || 5 == 5", true },
+		{ "false && x", false },
+		{ "true && 4 - 1", 3 },
+		{ "if (2 < 1) { 1 } else if (\"a\" == \"a\") { 2 } else { 3 }", 2 },
+		{ "(1 << 4) | 1 ? \"yes\" : \"no\"", "yes" }
+	};
+
+	for (auto& source : sources) {
+		std::unique_ptr<Expression> expr = ConfigCompiler::CompileText("<test>", source.first);
+		Expression *stmt = GetStatement(expr);
+
+		if (auto dict = dynamic_cast<DictExpression*>(stmt))
+			stmt = dict->GetExpressions().front().get();
+
+		auto lit (dynamic_cast<LiteralExpression*>(stmt));
+
+		BOOST_CHECK_MESSAGE(lit && lit->GetValue() == source.second, source.first);
+	}
+
+	/* Errors are raised at runtime. */
+	std::unique_ptr<Expression> expr = ConfigCompiler::CompileText("<test>", "1 / 0");
+	BOOST_CHECK(!dynamic_cast<LiteralExpression*>(GetStatement(expr)));
+	BOOST_CHECK_THROW(Evaluate(expr), ScriptError);
+
+	expr = ConfigCompiler::CompileText("<test>", "x + 1");
+	BOOST_CHECK(!dynamic_cast<LiteralExpression*>(GetStatement(expr)));
+}
+
+BOOST_AUTO_TEST_CASE(constants)
+{
+	Evaluate(ConfigCompiler::CompileText("<test>", "const OptimizerTestConst = 42"));
+
+	std::unique_ptr<Expression> expr = ConfigCompiler::CompileText("<test>", "OptimizerTestConst + 1");
+	BOOST_CHECK(!dynamic_cast<LiteralExpression*>(GetStatement(expr)));
+
+	BOOST_CHECK_EQUAL(ExpressionOptimizer::Optimize(expr, true), 2u);
+
+	auto lit (dynamic_cast<LiteralExpression*>(GetStatement(expr)));
+	BOOST_CHECK(lit && lit->GetValue() == 43);
+	BOOST_CHECK(ExpressionOptimizer::IsResolvedConstant("OptimizerTestConst"));
+
+	/* Variables which the config may declare aren't resolved. */
+	expr = ConfigCompiler::CompileText("<test>", "var OptimizerTestConst = 1; OptimizerTestConst");
+	ExpressionOptimizer::Optimize(expr, true);
+	BOOST_CHECK_EQUAL(Evaluate(expr), 1);
+
+	expr = ConfigCompiler::CompileText("<test>", "(function(OptimizerTestConst) { return OptimizerTestConst })(5)");
+	ExpressionOptimizer::Optimize(expr, true);
+	BOOST_CHECK_EQUAL(Evaluate(expr), 5);
+}
+
+BOOST_AUTO_TEST_CASE(imports)
+{
+	std::vector<std::pair<String, Value>> sources {
+		{ "len(\"abc\")", 3 },
+		{ "match(\"a*\", \"abc\")", true },
+		{ "var len = 5; len", 5 },
+		{ "{ len = 2; x = len }.x", 2 },
+		{ "globals.OptimizerTestGlobal = 1; OptimizerTestGlobal + 1", 2 },
+		{ "typeof(String) == Type", true }
+	};
+
+	for (auto& source : sources) {
+		BOOST_CHECK_MESSAGE(Evaluate(ConfigCompiler::CompileText("<test>", source.first)) == source.second, source.first);
+	}
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,110 @@
+/* Icinga 2 | (c) 2012 Icinga GmbH | GPLv2+ */
+
+#include "config/configprofiler.hpp"
+#include "config/configcompiler.hpp"
+#include "base/utility.hpp"
+#include <boost/filesystem.hpp>
+#include <BoostTestTargetConfig.h>
+#include <fstream>
+#include <map>
+#include <sstream>
+
+using namespace icinga;
+
+BOOST_AUTO_TEST_SUITE(config_profiler)
+
+struct ReportEntry
+{
+	double Total;
+	double Self;
+	long Count;
+};
+
+/* Parses the report into its frames, regardless of how the columns are aligned. */
+static std::map<String, ReportEntry> ParseReport()
+{
+	std::ostringstream report;
+	ConfigProfiler::WriteReport(report);
+
+	std::istringstream lines (report.str());
+	std::string line;
+	std::map<String, ReportEntry> entries;
+
+	/* Skip the header. */
+	std::getline(lines, line);
+
+	while (std::getline(lines, line)) {
+		std::istringstream fields (line);
+		ReportEntry entry;
+		std::string label;
+
+		fields >> entry.Total >> entry.Self >> entry.Count >> std::ws;
+		std::getline(fields, label);
+
+		BOOST_CHECK_MESSAGE(fields.eof() && !label.empty(), "Invalid report line: " << line);
+
+		entries[label] = entry;
+	}
+
+	return entries;
+}
+
+BOOST_AUTO_TEST_CASE(frames)
+{
+	ConfigProfiler::Enable();
+
+	{
+		ConfigProfiler::Frame pframe ([]() { return String("file test.conf"); });
+
+		ScriptFrame frame(true);
+		std::unique_ptr<Expression> expr = ConfigCompiler::CompileText("<test>",
+			"function fib(n) { if (n < 2) { return n }; return fib(n - 1) + fib(n - 2) }; fib(5)");
+
+		BOOST_CHECK(expr->Evaluate(frame).GetValue() == 5);
+	}
+
+	auto entries (ParseReport());
+
+	BOOST_REQUIRE(entries.find("file test.conf") != entries.end());
+	BOOST_CHECK_EQUAL(entries["file test.conf"].Count, 1);
+
+	/* fib(5) calls itself 14 times. */
+	auto fib (entries.find("function fib in <test>: 1:17-1:75"));
+
+	BOOST_REQUIRE(fib != entries.end());
+	BOOST_CHECK_EQUAL(fib->second.Count, 15);
+	BOOST_CHECK(fib->second.Self <= fib->second.Total);
+	BOOST_CHECK(entries["file test.conf"].Total >= fib->second.Total);
+
+	std::ostringstream folded;
+	ConfigProfiler::WriteFoldedStacks(folded);
+
+	BOOST_CHECK(folded.str().find("file test.conf;function fib in <test>: 1:17-1:75;function fib in <test>: 1:17-1:75 ") != std::string::npos);
+}
+
+BOOST_AUTO_TEST_CASE(files)
+{
+	ConfigProfiler::Enable();
+
+	std::fstream fp;
+	String path = Utility::CreateTempFile((boost::filesystem::temp_directory_path() / "icinga2-config-profiler.XXXXXX").string(), 0600, fp);
+	fp << "var x = 1 + 2";
+	fp.close();
+
+	std::unique_ptr<Expression> expr = ConfigCompiler::CompileFile(path);
+	boost::filesystem::remove(path.GetData());
+
+	ScriptFrame frame(true);
+	expr->Evaluate(frame);
+
+	/* Parsing and evaluating a file are reported separately. */
+	auto entries (ParseReport());
+
+	BOOST_REQUIRE(entries.find("parse " + path) != entries.end());
+	BOOST_CHECK_EQUAL(entries["parse " + path].Count, 1);
+
+	BOOST_REQUIRE(entries.find("eval " + path) != entries.end());
+	BOOST_CHECK_EQUAL(entries["eval " + path].Count, 1);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,127 @@
+/* Icinga 2 | (c) 2012 Icinga GmbH | GPLv2+ */
+
+#include "icinga/apiactions.hpp"
+#include "icinga/host.hpp"
+#include "remote/actionshandler.hpp"
+#include "remote/apiuser.hpp"
+#include "base/convert.hpp"
+#include "base/defer.hpp"
+#include <BoostTestTargetConfig.h>
+
+using namespace icinga;
+
+static Host::Ptr CreateHost(const String& name, bool passive = true)
+{
+	Host::Ptr host = new Host();
+	host->SetName(name);
+	host->SetShortName(name);
+	host->SetEnablePassiveChecks(passive);
+	host->Register();
+	host->SetActive(true);
+	host->Activate();
+	host->SetAuthority(true);
+
+	return host;
+}
+
+static Dictionary::Ptr ProcessCheckResults(const Array::Ptr& results)
+{
+	ApiUser::Ptr user = new ApiUser();
+	user->SetPermissions(new Array({ "*" }));
+
+	ActionsHandler::AuthenticatedApiUser = user;
+	Defer resetUser ([]() { ActionsHandler::AuthenticatedApiUser = nullptr; });
+
+	return ApiActions::ProcessCheckResults(nullptr, new Dictionary({ { "results", results } }));
+}
+
+static std::vector<int> GetCodes(const Dictionary::Ptr& response)
+{
+	std::vector<int> codes;
+	Array::Ptr results = response->Get("results");
+
+	ObjectLock olock(results);
+
+	for (const Dictionary::Ptr& result : results)
+		codes.emplace_back(result->Get("code"));
+
+	return codes;
+}
+
+BOOST_AUTO_TEST_SUITE(icinga_apiactions)
+
+BOOST_AUTO_TEST_CASE(process_check_results_mixed)
+{
+	Host::Ptr host = CreateHost("batch-ok");
+	CreateHost("batch-passive-disabled", false);
+
+	Dictionary::Ptr response = ProcessCheckResults(new Array({
+		new Dictionary({ { "host", "batch-ok" }, { "exit_status", 1 }, { "plugin_output", "first" } }),
+		new Dictionary({ { "host", "batch-missing" }, { "exit_status", 0 }, { "plugin_output", "missing" } }),
+		new Dictionary({ { "host", "batch-ok" }, { "plugin_output", "no exit status" } }),
+		new Dictionary({ { "host", "batch-passive-disabled" }, { "exit_status", 0 }, { "plugin_output", "disabled" } }),
+		"not an object",
+		new Dictionary({ { "host", "batch-ok" }, { "exit_status", 0 }, { "plugin_output", "last" } })
+	}));
+
+	BOOST_CHECK(GetCodes(response) == std::vector<int>({ 200, 404, 400, 403, 400, 200 }));
+	BOOST_CHECK_EQUAL(response->Get("code"), 500);
+	BOOST_CHECK_EQUAL(response->Get("status"), "Processed 6 check results, 4 failed.");
+
+	/* Results for the same object are processed in the order they were passed. */
+	BOOST_REQUIRE(host->GetLastCheckResult());
+	BOOST_CHECK_EQUAL(host->GetLastCheckResult()->GetOutput(), "last");
+}
+
+BOOST_AUTO_TEST_CASE(process_check_results_codes)
+{
+	CreateHost("codes-ok1");
+	CreateHost("codes-ok2");
+
+	Dictionary::Ptr response = ProcessCheckResults(new Array({
+		new Dictionary({ { "host", "codes-ok1" }, { "exit_status", 0 }, { "plugin_output", "OK" } }),
+		new Dictionary({ { "host", "codes-ok2" }, { "exit_status", 0 }, { "plugin_output", "OK" } })
+	}));
+
+	BOOST_CHECK(GetCodes(response) == std::vector<int>({ 200, 200 }));
+	BOOST_CHECK_EQUAL(response->Get("code"), 200);
+
+	/* A failure code shared by all results is passed on. */
+	response = ProcessCheckResults(new Array({
+		new Dictionary({ { "host", "codes-missing1" }, { "exit_status", 0 }, { "plugin_output", "OK" } }),
+		new Dictionary({ { "host", "codes-missing2" }, { "exit_status", 0 }, { "plugin_output", "OK" } })
+	}));
+
+	BOOST_CHECK(GetCodes(response) == std::vector<int>({ 404, 404 }));
+	BOOST_CHECK_EQUAL(response->Get("code"), 404);
+
+	/* Different failure codes result in 500. */
+	response = ProcessCheckResults(new Array({
+		new Dictionary({ { "host", "codes-missing1" }, { "exit_status", 0 }, { "plugin_output", "OK" } }),
+		new Dictionary({ { "host", "codes-ok1" }, { "plugin_output", "no exit status" } })
+	}));
+
+	BOOST_CHECK(GetCodes(response) == std::vector<int>({ 404, 400 }));
+	BOOST_CHECK_EQUAL(response->Get("code"), 500);
+
+	/* Large batches are processed in several chunks. */
+	ArrayData batch;
+
+	for (int i = 0; i < 250; i++)
+		batch.emplace_back(new Dictionary({ { "host", "codes-ok1" }, { "exit_status", 0 }, { "plugin_output", "OK " + Convert::ToString(i) } }));
+
+	response = ProcessCheckResults(new Array(std::move(batch)));
+
+	BOOST_CHECK(GetCodes(response) == std::vector<int>(250, 200));
+	BOOST_CHECK_EQUAL(response->Get("code"), 200);
+	BOOST_CHECK_EQUAL(Host::GetByName("codes-ok1")->GetLastCheckResult()->GetOutput(), "OK 249");
+
+	response = ProcessCheckResults(new Array());
+
+	BOOST_CHECK(GetCodes(response).empty());
+	BOOST_CHECK_EQUAL(response->Get("code"), 200);
+
+	BOOST_CHECK_EQUAL(ApiActions::ProcessCheckResults(nullptr, new Dictionary())->Get("code"), 400);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,203 @@
+/* Icinga 2 | (c) 2012 Icinga GmbH | GPLv2+ */
+
+#include "icinga/cib.hpp"
+#include "icinga/host.hpp"
+#include "icinga/service.hpp"
+#include "base/configtype.hpp"
+#include <BoostTestTargetConfig.h>
+#include <algorithm>
+
+using namespace icinga;
+
+BOOST_AUTO_TEST_SUITE(icinga_cib)
+
+static CheckResult::Ptr MakeCheckResult(ServiceState state, double latency)
+{
+	CheckResult::Ptr cr = new CheckResult();
+
+	cr->SetState(state);
+
+	double now = Utility::GetTime();
+	cr->SetScheduleStart(now - latency - 1);
+	cr->SetScheduleEnd(now);
+	cr->SetExecutionStart(now - 1);
+	cr->SetExecutionEnd(now);
+
+	return cr;
+}
+
+template<typename T>
+static T MakeCheckable(const String& name)
+{
+	T checkable = new typename T::element_type();
+	checkable->SetName(name);
+	checkable->SetMaxCheckAttempts(1);
+	checkable->Register();
+	checkable->SetActive(true);
+	checkable->Activate();
+	checkable->SetAuthority(true);
+
+	return checkable;
+}
+
+/* Counts the statistics by iterating all objects, like CIB did before it maintained them incrementally. */
+static HostStatistics RecountHostStats(CheckableCheckStatistics& ccs)
+{
+	HostStatistics hs = {};
+	std::vector<double> latencies;
+
+	for (const Host::Ptr& host : ConfigType::GetObjectsByType<Host>()) {
+		if (host->IsReachable()) {
+			if (host->GetState() == HostUp)
+				hs.hosts_up++;
+			if (host->GetState() == HostDown)
+				hs.hosts_down++;
+		} else
+			hs.hosts_unreachable++;
+
+		if (host->GetLastCheckResult())
+			latencies.push_back(host->GetLastCheckResult()->CalculateLatency());
+		else
+			hs.hosts_pending++;
+
+		if (host->IsAcknowledged())
+			hs.hosts_acknowledged++;
+		if (host->GetProblem())
+			hs.hosts_problem++;
+		if (host->GetHandled())
+			hs.hosts_handled++;
+	}
+
+	ccs = {};
+
+	if (!latencies.empty()) {
+		ccs.min_latency = *std::min_element(latencies.begin(), latencies.end());
+		ccs.max_latency = *std::max_element(latencies.begin(), latencies.end());
+	}
+
+	return hs;
+}
+
+static ServiceStatistics RecountServiceStats()
+{
+	ServiceStatistics ss = {};
+
+	for (const Service::Ptr& service : ConfigType::GetObjectsByType<Service>()) {
+		if (service->GetState() == ServiceOK)
+			ss.services_ok++;
+		if (service->GetState() == ServiceWarning)
+			ss.services_warning++;
+		if (service->GetState() == ServiceCritical)
+			ss.services_critical++;
+		if (service->GetState() == ServiceUnknown)
+			ss.services_unknown++;
+		if (!service->GetLastCheckResult())
+			ss.services_pending++;
+		if (service->IsAcknowledged())
+			ss.services_acknowledged++;
+		if (service->GetProblem())
+			ss.services_problem++;
+		if (service->GetHandled())
+			ss.services_handled++;
+	}
+
+	return ss;
+}
+
+static void CheckStatistics()
+{
+	CheckableCheckStatistics expectedChecks;
+	HostStatistics expectedHosts = RecountHostStats(expectedChecks);
+	HostStatistics hs = CIB::CalculateHostStats();
+
+	BOOST_CHECK_EQUAL(hs.hosts_up, expectedHosts.hosts_up);
+	BOOST_CHECK_EQUAL(hs.hosts_down, expectedHosts.hosts_down);
+	BOOST_CHECK_EQUAL(hs.hosts_unreachable, expectedHosts.hosts_unreachable);
+	BOOST_CHECK_EQUAL(hs.hosts_pending, expectedHosts.hosts_pending);
+	BOOST_CHECK_EQUAL(hs.hosts_acknowledged, expectedHosts.hosts_acknowledged);
+	BOOST_CHECK_EQUAL(hs.hosts_problem, expectedHosts.hosts_problem);
+	BOOST_CHECK_EQUAL(hs.hosts_handled, expectedHosts.hosts_handled);
+
+	CheckableCheckStatistics ccs = CIB::CalculateHostCheckStats();
+
+	BOOST_CHECK_CLOSE(ccs.min_latency + 1, expectedChecks.min_latency + 1, 0.001);
+	BOOST_CHECK_CLOSE(ccs.max_latency + 1, expectedChecks.max_latency + 1, 0.001);
+
+	ServiceStatistics expectedServices = RecountServiceStats();
+	ServiceStatistics ss = CIB::CalculateServiceStats();
+
+	BOOST_CHECK_EQUAL(ss.services_ok, expectedServices.services_ok);
+	BOOST_CHECK_EQUAL(ss.services_warning, expectedServices.services_warning);
+	BOOST_CHECK_EQUAL(ss.services_critical, expectedServices.services_critical);
+	BOOST_CHECK_EQUAL(ss.services_unknown, expectedServices.services_unknown);
+	BOOST_CHECK_EQUAL(ss.services_pending, expectedServices.services_pending);
+	BOOST_CHECK_EQUAL(ss.services_acknowledged, expectedServices.services_acknowledged);
+	BOOST_CHECK_EQUAL(ss.services_problem, expectedServices.services_problem);
+	BOOST_CHECK_EQUAL(ss.services_handled, expectedServices.services_handled);
+}
+
+BOOST_AUTO_TEST_CASE(incremental_statistics)
+{
+	std::vector<Host::Ptr> hosts;
+	std::vector<Service::Ptr> services;
+
+	for (int i = 0; i < 4; i++)
+		hosts.emplace_back(MakeCheckable<Host::Ptr>("cib-host-" + std::to_string(i)));
+
+	for (int i = 0; i < 8; i++)
+		services.emplace_back(MakeCheckable<Service::Ptr>("cib-service-" + std::to_string(i)));
+
+	CheckStatistics();
+	BOOST_CHECK_EQUAL(CIB::CalculateHostStats().hosts_pending, 4);
+	BOOST_CHECK_EQUAL(CIB::CalculateServiceStats().services_pending, 8);
+
+	hosts[0]->ProcessCheckResult(MakeCheckResult(ServiceOK, 0.5));
+	hosts[1]->ProcessCheckResult(MakeCheckResult(ServiceCritical, 2));
+	hosts[2]->ProcessCheckResult(MakeCheckResult(ServiceOK, 1));
+
+	for (int i = 0; i < 8; i++)
+		services[i]->ProcessCheckResult(MakeCheckResult(ServiceState(i % 4), i));
+
+	CheckStatistics();
+	BOOST_CHECK_EQUAL(CIB::CalculateHostStats().hosts_down, 2);
+	BOOST_CHECK_EQUAL(CIB::CalculateServiceStats().services_critical, 2);
+
+	/* State changes and acknowledgements */
+	hosts[1]->ProcessCheckResult(MakeCheckResult(ServiceOK, 3));
+	services[2]->ProcessCheckResult(MakeCheckResult(ServiceOK, 0));
+	services[3]->AcknowledgeProblem("test", "test", AcknowledgementNormal);
+
+	CheckStatistics();
+	BOOST_CHECK_EQUAL(CIB::CalculateServiceStats().services_acknowledged, 1);
+
+	/* Added and removed objects */
+	hosts.emplace_back(MakeCheckable<Host::Ptr>("cib-host-new"));
+	hosts.back()->ProcessCheckResult(MakeCheckResult(ServiceCritical, 5));
+	services.emplace_back(MakeCheckable<Service::Ptr>("cib-service-new"));
+
+	CheckStatistics();
+
+	for (auto& checkable : std::vector<Checkable::Ptr>({ hosts[1], services[3], services[6] })) {
+		checkable->Deactivate();
+		checkable->Unregister();
+	}
+
+	CheckStatistics();
+	BOOST_CHECK_EQUAL(CIB::CalculateHostStats().hosts_up, 2);
+	BOOST_CHECK_EQUAL(CIB::CalculateServiceStats().services_acknowledged, 0);
+
+	/* Changes which aren't signalled are caught up by the reconciliation. */
+	hosts[0]->SetStateRaw(ServiceCritical);
+	services[0]->SetStateRaw(ServiceUnknown);
+	services[1]->SetLastCheckResult(nullptr);
+
+	BOOST_CHECK_EQUAL(CIB::CalculateServiceStats().services_unknown, 2);
+
+	CIB::ReconcileStatistics();
+
+	CheckStatistics();
+	BOOST_CHECK_EQUAL(CIB::CalculateServiceStats().services_unknown, 3);
+	BOOST_CHECK_EQUAL(CIB::CalculateServiceStats().services_pending, 2);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -1,5 +1,7 @@
 /* Icinga 2 | (c) 2012 Icinga GmbH | GPLv2+ */
 
+#include "base/json.hpp"
+#include "base/objectlock.hpp"
 #include "base/utility.hpp"
 #include "icinga/legacytimeperiod.hpp"
 #include <boost/date_time/posix_time/posix_time.hpp>
@@ -8,6 +10,7 @@
 #include <boost/date_time/gregorian/conversion.hpp>
 #include <boost/date_time/date.hpp>
 #include <boost/optional.hpp>
+#include <chrono>
 #include <iomanip>
 #include <BoostTestTargetConfig.h>
 
@@ -691,4 +694,163 @@ BOOST_AUTO_TEST_CASE(dst_isinside)
 	}
 }
 
+BOOST_AUTO_TEST_CASE(segment_index)
+{
+	/* Overlapping and nested segments, deliberately not sorted. */
+	std::vector<std::pair<double, double>> raw {
+		{100, 200}, {50, 80}, {150, 400}, {160, 170}, {500, 600}, {590, 700}, {800, 810}, {0, 10},
+	};
+
+	TimePeriod::Ptr p = new TimePeriod();
+	p->SetValidBegin(0, true);
+	p->SetValidEnd(1000, true);
+
+	ArrayData segments;
+	for (auto& segment : raw)
+		segments.emplace_back(new Dictionary({{"begin", segment.first}, {"end", segment.second}}));
+
+	p->SetSegments(new Array(std::move(segments)), true);
+
+	for (double t = 0; t <= 1000; t += 5) {
+		bool inside = false;
+		double transition = -1;
+
+		for (auto& segment : raw) {
+			if (t > segment.first && t < segment.second)
+				inside = true;
+
+			if (segment.first > t && (segment.first < transition || transition == -1))
+				transition = segment.first;
+
+			if (segment.second > t && (segment.second < transition || transition == -1))
+				transition = segment.second;
+		}
+
+		BOOST_CHECK_MESSAGE(p->IsInside(t) == inside, "IsInside(" << t << ") should be " << inside);
+		BOOST_CHECK_MESSAGE(p->FindNextTransition(t) == transition, "FindNextTransition(" << t << ") should be " << transition);
+	}
+
+	/* Replacing the segments must not use the stale index. */
+	p->SetSegments(new Array({new Dictionary({{"begin", 300}, {"end", 310}})}), true);
+
+	BOOST_CHECK(!p->IsInside(150));
+	BOOST_CHECK(p->IsInside(305));
+	BOOST_CHECK_EQUAL(p->FindNextTransition(0), 300);
+}
+
+/* Evaluates the ranges like LegacyTimePeriod::ScriptFunc(), but parses them again for every day. */
+static Array::Ptr EvaluateUncached(const Dictionary::Ptr& ranges, time_t begin, time_t end)
+{
+	Array::Ptr segments = new Array();
+	tm reference = Utility::LocalTime(begin);
+
+	reference.tm_hour = 0;
+	reference.tm_min = 0;
+	reference.tm_sec = 0;
+	reference.tm_isdst = -1;
+
+	for (;;) {
+		tm day = reference;
+
+		if (mktime(&day) > end)
+			break;
+
+		ObjectLock olock(ranges);
+
+		for (const Dictionary::Pair& kv : ranges) {
+			if (LegacyTimePeriod::IsInDayDefinition(kv.first, &reference))
+				LegacyTimePeriod::ProcessTimeRanges(kv.second, &reference, segments);
+		}
+
+		reference.tm_mday++;
+		reference.tm_isdst = -1;
+		mktime(&reference);
+		reference.tm_isdst = -1;
+	}
+
+	return segments;
+}
+
+static Dictionary::Ptr MakeRanges(int i)
+{
+	return new Dictionary({
+		{ "monday - friday", String("0" + std::to_string(i % 10) + ":00-17:00") },
+		{ "saturday", String("10:00-12:00,14:00-" + std::to_string(15 + i % 5) + ":30") },
+		{ "day " + std::to_string(1 + i % 28), "00:00-24:00" },
+		{ "day -1", "20:00-22:00" },
+		{ "2021-12-24", "10:00-12:00" },
+		{ "monday 1 december", "06:00-07:00" }
+	});
+}
+
+BOOST_AUTO_TEST_CASE(ranges_cache)
+{
+	time_t begin = 1635724800; /* 2021-11-01 00:00:00 UTC */
+	time_t end = begin + 61 * 86400;
+
+	TimePeriod::Ptr tp = new TimePeriod();
+	tp->SetRanges(MakeRanges(3), true);
+
+	Array::Ptr cached = LegacyTimePeriod::ScriptFunc(tp, begin, end);
+	Object::Ptr compiled = tp->GetCompiledRanges();
+
+	BOOST_CHECK(compiled);
+	BOOST_CHECK(cached->GetLength() > 0);
+	BOOST_CHECK_EQUAL(JsonEncode(cached), JsonEncode(EvaluateUncached(tp->GetRanges(), begin, end)));
+
+	/* Evaluating again reuses the parsed ranges. */
+	BOOST_CHECK_EQUAL(JsonEncode(LegacyTimePeriod::ScriptFunc(tp, begin, end)), JsonEncode(cached));
+	BOOST_CHECK(tp->GetCompiledRanges() == compiled);
+
+	/* Replacing the ranges invalidates them. */
+	tp->SetRanges(new Dictionary({ { "sunday", "01:00-02:00" } }), true);
+
+	Array::Ptr changed = LegacyTimePeriod::ScriptFunc(tp, begin, end);
+
+	BOOST_CHECK(tp->GetCompiledRanges() != compiled);
+	BOOST_CHECK_EQUAL(changed->GetLength(), 8);
+	BOOST_CHECK_EQUAL(JsonEncode(changed), JsonEncode(EvaluateUncached(tp->GetRanges(), begin, end)));
+}
+
+BOOST_AUTO_TEST_CASE(ranges_cache_many_timeperiods)
+{
+	time_t begin = 1635724800; /* 2021-11-01 00:00:00 UTC */
+	time_t end = begin + 7 * 86400;
+
+	std::vector<TimePeriod::Ptr> timeperiods;
+
+	for (int i = 0; i < 5000; i++) {
+		TimePeriod::Ptr tp = new TimePeriod();
+		tp->SetRanges(MakeRanges(i), true);
+		timeperiods.emplace_back(std::move(tp));
+	}
+
+	std::vector<Array::Ptr> expected;
+	auto start (std::chrono::steady_clock::now());
+
+	for (auto& tp : timeperiods)
+		expected.emplace_back(EvaluateUncached(tp->GetRanges(), begin, end));
+
+	auto uncachedTime (std::chrono::steady_clock::now() - start);
+
+	/* The first evaluation parses the ranges, the timed second one reuses them. */
+	for (auto& tp : timeperiods)
+		LegacyTimePeriod::ScriptFunc(tp, begin, end);
+
+	std::vector<Array::Ptr> results;
+	start = std::chrono::steady_clock::now();
+
+	for (auto& tp : timeperiods)
+		results.emplace_back(LegacyTimePeriod::ScriptFunc(tp, begin, end));
+
+	auto cachedTime (std::chrono::steady_clock::now() - start);
+
+	BOOST_TEST_MESSAGE("Evaluated " << timeperiods.size() << " time periods for a week: "
+		<< std::chrono::duration<double>(uncachedTime).count() << "s parsing the ranges every day, "
+		<< std::chrono::duration<double>(cachedTime).count() << "s with the parsed ranges.");
+
+	for (size_t i = 0; i < timeperiods.size(); i++)
+		BOOST_CHECK_EQUAL(JsonEncode(results[i]), JsonEncode(expected[i]));
+}
+
 BOOST_AUTO_TEST_SUITE_END()
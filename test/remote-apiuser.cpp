@@ -0,0 +1,81 @@
+/* Icinga 2 | (c) 2012 Icinga GmbH | GPLv2+ */
+
+#include "remote/apiuser.hpp"
+#include <BoostTestTargetConfig.h>
+
+using namespace icinga;
+
+BOOST_AUTO_TEST_SUITE(remote_apiuser)
+
+BOOST_AUTO_TEST_CASE(rate_limit)
+{
+	ApiUser::Ptr user = new ApiUser();
+	user->SetRateLimit(2);
+	user->SetRateLimitBurst(3);
+
+	std::vector<String> patterns;
+	double retryAfter;
+	auto now (std::chrono::steady_clock::now());
+
+	for (int i = 0; i < 3; i++)
+		BOOST_CHECK(user->AdmitRequest("/v1/status", patterns, retryAfter, now) == ApiUserAdmission::Admitted);
+
+	BOOST_CHECK(user->AdmitRequest("/v1/status", patterns, retryAfter, now) == ApiUserAdmission::RateLimited);
+	BOOST_CHECK_CLOSE(retryAfter, 0.5, 0.001);
+
+	/* One token is added every 500ms. */
+	now += std::chrono::milliseconds(500);
+	BOOST_CHECK(user->AdmitRequest("/v1/status", patterns, retryAfter, now) == ApiUserAdmission::Admitted);
+	BOOST_CHECK(user->AdmitRequest("/v1/status", patterns, retryAfter, now) == ApiUserAdmission::RateLimited);
+
+	/* The bucket doesn't hold more than the burst. */
+	now += std::chrono::seconds(60);
+
+	for (int i = 0; i < 3; i++)
+		BOOST_CHECK(user->AdmitRequest("/v1/status", patterns, retryAfter, now) == ApiUserAdmission::Admitted);
+
+	BOOST_CHECK(user->AdmitRequest("/v1/status", patterns, retryAfter, now) == ApiUserAdmission::RateLimited);
+
+	Dictionary::Ptr stats = user->GetRequestStats();
+	BOOST_CHECK(stats->Get("requests") == 10);
+	BOOST_CHECK(stats->Get("rate_limited") == 3);
+	BOOST_CHECK(stats->Get("concurrent_requests") == 7);
+}
+
+BOOST_AUTO_TEST_CASE(concurrency)
+{
+	ApiUser::Ptr user = new ApiUser();
+	user->SetMaxConcurrentRequests(3);
+	user->SetMaxConcurrentRequestsByUrl(new Dictionary({ { "/v1/objects/*", 1 } }));
+
+	std::vector<String> query, status1, status2, rejected;
+	double retryAfter;
+
+	BOOST_CHECK(user->AdmitRequest("/v1/objects/hosts", query, retryAfter) == ApiUserAdmission::Admitted);
+	BOOST_CHECK(query == std::vector<String>({ "/v1/objects/*" }));
+
+	BOOST_CHECK(user->AdmitRequest("/v1/objects/services", rejected, retryAfter) == ApiUserAdmission::ConcurrencyLimited);
+
+	BOOST_CHECK(user->AdmitRequest("/v1/status", status1, retryAfter) == ApiUserAdmission::Admitted);
+	BOOST_CHECK(status1.empty());
+	BOOST_CHECK(user->AdmitRequest("/v1/status", status2, retryAfter) == ApiUserAdmission::Admitted);
+	BOOST_CHECK(user->AdmitRequest("/v1/status", rejected, retryAfter) == ApiUserAdmission::ConcurrencyLimited);
+
+	user->FinishRequest(query);
+	BOOST_CHECK(user->AdmitRequest("/v1/objects/services", query, retryAfter) == ApiUserAdmission::Admitted);
+
+	Dictionary::Ptr stats = user->GetRequestStats();
+	BOOST_CHECK(stats->Get("concurrency_limited") == 2);
+	BOOST_CHECK(stats->Get("concurrent_requests_high_watermark") == 3);
+	BOOST_CHECK(Dictionary::Ptr(stats->Get("concurrent_requests_by_url"))->Get("/v1/objects/*") == 1);
+
+	user->FinishRequest(query);
+	user->FinishRequest(status1);
+	user->FinishRequest(status2);
+
+	stats = user->GetRequestStats();
+	BOOST_CHECK(stats->Get("concurrent_requests") == 0);
+	BOOST_CHECK(Dictionary::Ptr(stats->Get("concurrent_requests_by_url"))->GetLength() == 0);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
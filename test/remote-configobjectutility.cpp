@@ -0,0 +1,145 @@
+/* Icinga 2 | (c) 2012 Icinga GmbH | GPLv2+ */
+
+#include "remote/configobjectutility.hpp"
+#include "config/configcompiler.hpp"
+#include "config/configitem.hpp"
+#include "icinga/host.hpp"
+#include "icinga/service.hpp"
+#include "base/configuration.hpp"
+#include <boost/filesystem.hpp>
+#include <BoostTestTargetConfig.h>
+
+using namespace icinga;
+
+/* Runtime objects are written to the _api package, so it's kept in a temporary data directory. */
+struct ConfigObjectUtilityFixture
+{
+	ConfigObjectUtilityFixture()
+		: PreviousDataDir(Configuration::DataDir)
+	{
+		DataDir = boost::filesystem::temp_directory_path() / boost::filesystem::unique_path("icinga2-configobjectutility-%%%%%%");
+		boost::filesystem::create_directories(DataDir);
+		Configuration::DataDir = DataDir.string();
+
+		static bool loaded = false;
+
+		if (!loaded) {
+			std::unique_ptr<Expression> expr = ConfigCompiler::CompileText("<test>",
+				"object CheckCommand \"configobjectutility\" { execute = {{ }} }\n"
+				"apply Service \"applied\" {\n"
+				"  check_command = host.vars.service_command\n"
+				"  if (host.vars.fail) { throw \"apply rule failed\" }\n"
+				"  assign where host.vars.service_command\n"
+				"}\n"
+			);
+
+			ActivationScope ascope;
+
+			ScriptFrame frame(true);
+			expr->Evaluate(frame);
+
+			WorkQueue upq;
+			std::vector<ConfigItem::Ptr> newItems;
+
+			BOOST_REQUIRE(ConfigItem::CommitItems(ascope.GetContext(), upq, newItems, true));
+			BOOST_REQUIRE(ConfigItem::ActivateItems(newItems, true));
+
+			loaded = true;
+		}
+	}
+
+	~ConfigObjectUtilityFixture()
+	{
+		Configuration::DataDir = PreviousDataDir;
+		boost::filesystem::remove_all(DataDir);
+	}
+
+	String PreviousDataDir;
+	boost::filesystem::path DataDir;
+};
+
+static std::vector<bool> CreateHosts(const std::vector<std::pair<String, Dictionary::Ptr>>& hosts, std::vector<Array::Ptr>& errors)
+{
+	std::vector<std::pair<String, String>> objects;
+
+	for (auto& host : hosts) {
+		Dictionary::Ptr attrs = new Dictionary({ { "check_command", "configobjectutility" } });
+		host.second->CopyTo(attrs);
+
+		objects.emplace_back(host.first, ConfigObjectUtility::CreateObjectConfig(Host::TypeInstance, host.first, false, nullptr, attrs));
+	}
+
+	errors.clear();
+
+	for (size_t i = 0; i < hosts.size(); i++)
+		errors.emplace_back(new Array());
+
+	return ConfigObjectUtility::CreateObjects(Host::TypeInstance, objects, errors, std::vector<Array::Ptr>(hosts.size()));
+}
+
+BOOST_FIXTURE_TEST_SUITE(remote_configobjectutility, ConfigObjectUtilityFixture)
+
+BOOST_AUTO_TEST_CASE(create_objects_mixed)
+{
+	std::vector<Array::Ptr> errors;
+
+	std::vector<bool> created = CreateHosts({
+		{ "mixed-valid1", new Dictionary() },
+		{ "mixed-invalid", new Dictionary({ { "check_command", "missing" } }) },
+		{ "mixed-valid2", new Dictionary() }
+	}, errors);
+
+	BOOST_CHECK(created == std::vector<bool>({ true, false, true }));
+	BOOST_CHECK_EQUAL(errors[0]->GetLength(), 0);
+	BOOST_CHECK_EQUAL(errors[1]->GetLength(), 1);
+	BOOST_CHECK_EQUAL(errors[2]->GetLength(), 0);
+
+	BOOST_CHECK(Host::GetByName("mixed-valid1") && Host::GetByName("mixed-valid1")->IsActive());
+	BOOST_CHECK(Host::GetByName("mixed-valid2") && Host::GetByName("mixed-valid2")->IsActive());
+	BOOST_CHECK(!Host::GetByName("mixed-invalid"));
+	BOOST_CHECK(!ConfigItem::GetByTypeAndName(Host::TypeInstance, "mixed-invalid"));
+
+	/* Nothing of the failed object is left behind, so it can be created once it's fixed. */
+	created = CreateHosts({ { "mixed-invalid", new Dictionary() } }, errors);
+
+	BOOST_CHECK(created == std::vector<bool>({ true }));
+	BOOST_CHECK(Host::GetByName("mixed-invalid"));
+}
+
+BOOST_AUTO_TEST_CASE(create_objects_apply_failure)
+{
+	std::vector<Array::Ptr> errors;
+
+	std::vector<bool> created = CreateHosts({
+		{ "apply-valid1", new Dictionary({ { "vars", new Dictionary({ { "service_command", "configobjectutility" } }) } }) },
+		{ "apply-throwing", new Dictionary({ { "vars", new Dictionary({ { "service_command", "configobjectutility" }, { "fail", true } }) } }) },
+		{ "apply-invalid", new Dictionary({ { "vars", new Dictionary({ { "service_command", "missing" } }) } }) },
+		{ "apply-valid2", new Dictionary({ { "vars", new Dictionary({ { "service_command", "configobjectutility" } }) } }) }
+	}, errors);
+
+	/* Neither the apply rule's nor the generated service's error points to the host, the batch is split until it's found. */
+	BOOST_CHECK(created == std::vector<bool>({ true, false, false, true }));
+	BOOST_CHECK_EQUAL(errors[0]->GetLength(), 0);
+	BOOST_CHECK(errors[1]->GetLength() > 0);
+	BOOST_CHECK(errors[2]->GetLength() > 0);
+	BOOST_CHECK_EQUAL(errors[3]->GetLength(), 0);
+
+	BOOST_CHECK(Service::GetByNamePair("apply-valid1", "applied"));
+	BOOST_CHECK(Service::GetByNamePair("apply-valid2", "applied"));
+
+	for (auto name : { "apply-throwing", "apply-invalid" }) {
+		BOOST_CHECK(!Host::GetByName(name));
+		BOOST_CHECK(!Service::GetByNamePair(name, "applied"));
+	}
+
+	created = CreateHosts({
+		{ "apply-throwing", new Dictionary({ { "vars", new Dictionary({ { "service_command", "configobjectutility" } }) } }) },
+		{ "apply-invalid", new Dictionary({ { "vars", new Dictionary({ { "service_command", "configobjectutility" } }) } }) }
+	}, errors);
+
+	BOOST_CHECK(created == std::vector<bool>({ true, true }));
+	BOOST_CHECK(Service::GetByNamePair("apply-throwing", "applied"));
+	BOOST_CHECK(Service::GetByNamePair("apply-invalid", "applied"));
+}
+
+BOOST_AUTO_TEST_SUITE_END()
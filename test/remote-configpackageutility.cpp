@@ -1,6 +1,11 @@
 /* Icinga 2 | (c) 2021 Icinga GmbH | GPLv2+ */
 
 #include "remote/configpackageutility.hpp"
+#include "base/configuration.hpp"
+#include "base/io-engine.hpp"
+#include <boost/filesystem.hpp>
+#include <fstream>
+#include <future>
 #include <vector>
 #include <string>
 #include <BoostTestTargetConfig.h>
@@ -22,4 +27,51 @@ BOOST_AUTO_TEST_CASE(ValidateName)
 	}
 }
 
+static void WriteStageFile(const boost::filesystem::path& path, const String& text)
+{
+	boost::filesystem::create_directories(path.parent_path());
+	std::ofstream fp (path.string());
+	fp << text;
+}
+
+BOOST_AUTO_TEST_CASE(CheckStageSyntax)
+{
+	String previousDataDir = Configuration::DataDir;
+	boost::filesystem::path dataDir = boost::filesystem::temp_directory_path() / boost::filesystem::unique_path("icinga2-configpackageutility-%%%%%%");
+	Configuration::DataDir = dataDir.string();
+
+	boost::filesystem::path packageDir = dataDir / "api" / "packages" / "syntax";
+
+	WriteStageFile(packageDir / "active" / "conf.d" / "unchanged.conf", "object Host {");
+	WriteStageFile(packageDir / "active" / "conf.d" / "changed.conf", "object Host \"changed\" { }");
+
+	WriteStageFile(packageDir / "new" / "conf.d" / "unchanged.conf", "object Host {");
+	WriteStageFile(packageDir / "new" / "conf.d" / "changed.conf", "object Host \"changed\" {");
+	WriteStageFile(packageDir / "new" / "conf.d" / "added.conf", "object Host \"added\" { }");
+
+	/* Without an active stage, all files are parsed. */
+	BOOST_CHECK_EQUAL(ConfigPackageUtility::CheckStageSyntax("syntax", "new").size(), 2);
+
+	/* The files which didn't change since the active stage aren't parsed again. */
+	ConfigPackageUtility::SetActiveStageToFile("syntax", "active");
+
+	std::vector<String> errors = ConfigPackageUtility::CheckStageSyntax("syntax", "new");
+
+	BOOST_REQUIRE_EQUAL(errors.size(), 1);
+	BOOST_CHECK(errors[0].Find("changed.conf") != String::NPos);
+
+	/* API requests check the files while their coroutine yields. */
+	std::promise<std::vector<String>> checked;
+
+	IoEngine::SpawnCoroutine(IoEngine::Get().GetIoContext(), [&checked](boost::asio::yield_context yc) {
+		CpuBoundWork handlingRequest (yc);
+		checked.set_value(ConfigPackageUtility::CheckStageSyntax("syntax", "new", &yc));
+	});
+
+	BOOST_CHECK(checked.get_future().get() == errors);
+
+	Configuration::DataDir = previousDataDir;
+	boost::filesystem::remove_all(dataDir);
+}
+
 BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,160 @@
+/* Icinga 2 | (c) 2012 Icinga GmbH | GPLv2+ */
+
+#include "remote/eventqueue.hpp"
+#include "base/convert.hpp"
+#include "base/io-engine.hpp"
+#include "base/logger.hpp"
+#include "base/utility.hpp"
+#include <future>
+#include <BoostTestTargetConfig.h>
+
+using namespace icinga;
+
+static std::vector<EncodedEvent> Shift(const EventsInbox::Ptr& inbox)
+{
+	std::promise<std::vector<EncodedEvent>> shifted;
+
+	IoEngine::SpawnCoroutine(IoEngine::Get().GetIoContext(), [&inbox, &shifted](boost::asio::yield_context yc) {
+		shifted.set_value(inbox->Shift(yc, 0));
+	});
+
+	return shifted.get_future().get();
+}
+
+static void Push(const std::vector<EventsInbox::Ptr>& inboxes, int state)
+{
+	std::map<Expression::Ptr, std::set<EventsInbox::Ptr>> perFilter;
+
+	for (auto& inbox : inboxes)
+		perFilter[inbox->GetFilter()].emplace(inbox);
+
+	EventsFilter(std::move(perFilter)).Push(new Dictionary({ { "type", "StateChange" }, { "state", state } }));
+}
+
+static void Push(const EventsInbox::Ptr& inbox, int state)
+{
+	inbox->Push(EncodedEvent{ std::make_shared<const String>(Convert::ToString(state)), Utility::GetTime() });
+}
+
+static std::vector<String> ShiftStates(const EventsInbox::Ptr& inbox)
+{
+	std::vector<String> states;
+
+	for (auto& event : Shift(inbox))
+		states.emplace_back(*event.Json);
+
+	return states;
+}
+
+BOOST_AUTO_TEST_SUITE(remote_eventqueue)
+
+BOOST_AUTO_TEST_CASE(filter)
+{
+	EventsInbox::Ptr all = new EventsInbox("", "<test>");
+	EventsInbox::Ptr ok1 = new EventsInbox("event.state == 0", "<test>");
+	EventsInbox::Ptr ok2 = new EventsInbox("event.state == 0", "<test>");
+	EventsInbox::Ptr critical = new EventsInbox("event.state == 2", "<test>");
+
+	/* Inboxes with the same filter share it, so it's evaluated once per event. */
+	BOOST_CHECK(!all->GetFilter());
+	BOOST_CHECK(ok1->GetFilter() && ok1->GetFilter() == ok2->GetFilter());
+
+	Push({ all }, 0);
+	Push({ all, ok1, ok2, critical }, 0);
+	Push({ all, ok1, ok2, critical }, 2);
+	Push({ ok1, ok2, critical }, 0);
+
+	BOOST_CHECK_EQUAL(all->GetDepth(), 3);
+	BOOST_CHECK_EQUAL(ok1->GetDepth(), 2);
+	BOOST_CHECK_EQUAL(ok2->GetDepth(), 2);
+	BOOST_CHECK_EQUAL(critical->GetDepth(), 1);
+
+	/* The event is encoded once for all inboxes it's pushed into. */
+	auto allEvents (Shift(all));
+	auto okEvents (Shift(ok1));
+
+	BOOST_REQUIRE_EQUAL(allEvents.size(), 3);
+	BOOST_REQUIRE_EQUAL(okEvents.size(), 2);
+	BOOST_CHECK(allEvents[1].Json == okEvents[0].Json);
+	BOOST_CHECK_EQUAL(*allEvents[2].Json, "{\"state\":2,\"type\":\"StateChange\"}\n");
+
+	BOOST_CHECK_EQUAL(all->GetDepth(), 0);
+	BOOST_CHECK_EQUAL(all->GetShifted(), 3);
+}
+
+BOOST_AUTO_TEST_CASE(unlimited)
+{
+	EventsInbox::Ptr inbox = new EventsInbox("", "<test>");
+
+	for (int i = 0; i < 1000; i++)
+		Push(inbox, i);
+
+	BOOST_CHECK_EQUAL(inbox->GetDepth(), 1000);
+	BOOST_CHECK_EQUAL(inbox->GetHighWatermark(), 1000);
+	BOOST_CHECK_EQUAL(inbox->GetDropped(), 0);
+	BOOST_CHECK_EQUAL(inbox->GetStatus()->Get("max_depth"), 0);
+}
+
+BOOST_AUTO_TEST_CASE(drop_oldest)
+{
+	EventsInbox::Ptr inbox = new EventsInbox("", "<test>", "drop-oldest", 2, EventsOverflow::DropOldest);
+	LogRecorder warnings (LogWarning, LogHoldBackCurrentThread);
+
+	for (int i = 0; i < 5; i++)
+		Push(inbox, i);
+
+	BOOST_CHECK_EQUAL(inbox->GetDepth(), 2);
+	BOOST_CHECK_EQUAL(inbox->GetDropped(), 3);
+
+	/* Only the first drop is logged right away. */
+	BOOST_CHECK_EQUAL(warnings.GetEntries().size(), 1);
+	BOOST_CHECK(ShiftStates(inbox) == std::vector<String>({ "3", "4" }));
+
+	/* The high watermark remains after the events were sent. */
+	Push(inbox, 5);
+
+	BOOST_CHECK_EQUAL(inbox->GetDepth(), 1);
+	BOOST_CHECK_EQUAL(inbox->GetHighWatermark(), 2);
+	BOOST_CHECK_EQUAL(inbox->GetShifted(), 2);
+	BOOST_CHECK(!inbox->HasOverflowed());
+}
+
+BOOST_AUTO_TEST_CASE(drop_newest)
+{
+	EventsInbox::Ptr inbox = new EventsInbox("", "<test>", "drop-newest", 2, EventsOverflow::DropNewest);
+
+	for (int i = 0; i < 5; i++)
+		Push(inbox, i);
+
+	BOOST_CHECK_EQUAL(inbox->GetDepth(), 2);
+	BOOST_CHECK_EQUAL(inbox->GetHighWatermark(), 2);
+	BOOST_CHECK_EQUAL(inbox->GetDropped(), 3);
+	BOOST_CHECK(ShiftStates(inbox) == std::vector<String>({ "0", "1" }));
+	BOOST_CHECK(!inbox->HasOverflowed());
+}
+
+BOOST_AUTO_TEST_CASE(disconnect)
+{
+	EventsInbox::Ptr inbox = new EventsInbox("", "<test>", "disconnect", 2, EventsOverflow::Disconnect);
+
+	Push(inbox, 0);
+	Push(inbox, 1);
+
+	BOOST_CHECK(!inbox->HasOverflowed());
+
+	/* The queued events are given up along with the new one. */
+	Push(inbox, 2);
+
+	BOOST_CHECK(inbox->HasOverflowed());
+	BOOST_CHECK_EQUAL(inbox->GetDepth(), 0);
+	BOOST_CHECK_EQUAL(inbox->GetHighWatermark(), 2);
+	BOOST_CHECK_EQUAL(inbox->GetDropped(), 3);
+	BOOST_CHECK(Shift(inbox).empty());
+
+	Push(inbox, 3);
+
+	BOOST_CHECK_EQUAL(inbox->GetDepth(), 0);
+	BOOST_CHECK_EQUAL(inbox->GetDropped(), 4);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,70 @@
+/* Icinga 2 | (c) 2012 Icinga GmbH | GPLv2+ */
+
+#include "remote/filterutility.hpp"
+#include "icinga/host.hpp"
+#include <BoostTestTargetConfig.h>
+
+using namespace icinga;
+
+static std::set<String> QueryHosts(const String& filter, Dictionary::Ptr& plan)
+{
+	QueryDescription qd;
+	qd.Types.insert("Host");
+
+	Dictionary::Ptr query = new Dictionary({
+		{ "type", "Host" },
+		{ "filter", filter },
+		{ "filter_vars", new Dictionary({ { "prefix", "planner-a*" } }) }
+	});
+
+	std::set<String> names;
+
+	for (const ConfigObject::Ptr& host : FilterUtility::GetFilterTargets(qd, query, nullptr, String(), &plan))
+		names.insert(host->GetName());
+
+	return names;
+}
+
+BOOST_AUTO_TEST_SUITE(remote_filterutility)
+
+BOOST_AUTO_TEST_CASE(planner)
+{
+	std::vector<Host::Ptr> hosts;
+
+	for (auto name : { "planner-a1", "planner-a2", "planner-b1" }) {
+		Host::Ptr host = new Host();
+		host->SetName(name);
+		host->SetShortName(name);
+		host->Register();
+		hosts.emplace_back(host);
+	}
+
+	Dictionary::Ptr plan;
+
+	BOOST_CHECK(QueryHosts("host.name == \"planner-a1\"", plan) == std::set<String>({ "planner-a1" }));
+	BOOST_CHECK(plan->Get("index") == "host.name == \"planner-a1\"");
+	BOOST_CHECK(plan->Get("candidates") == 1);
+	BOOST_CHECK(plan->Get("results") == 1);
+
+	BOOST_CHECK(QueryHosts("match(prefix, host.name) && host.name != \"planner-a2\"", plan) == std::set<String>({ "planner-a1" }));
+	BOOST_CHECK(plan->Get("index") == "match(\"planner-a*\", host.name)");
+	BOOST_CHECK(plan->Get("candidates") == 2);
+	BOOST_CHECK(plan->Get("results") == 1);
+
+	BOOST_CHECK(QueryHosts("host.name in [ \"planner-a2\", \"planner-x\" ] || obj.name == \"planner-b1\"", plan)
+		== std::set<String>({ "planner-a2", "planner-b1" }));
+	BOOST_CHECK(plan->Get("candidates") == 2);
+
+	/* Unindexed filters are evaluated for all hosts and yield the same results. */
+	BOOST_CHECK(QueryHosts("!!match(prefix, host.name)", plan) == std::set<String>({ "planner-a1", "planner-a2" }));
+	BOOST_CHECK(plan->Get("index").IsEmpty());
+	BOOST_CHECK(plan->Get("candidates").IsEmpty());
+
+	BOOST_CHECK(QueryHosts("host.name == \"planner-a1\" || host.address == \"\"", plan).size() >= 3u);
+	BOOST_CHECK(plan->Get("index").IsEmpty());
+
+	for (auto& host : hosts)
+		host->Unregister();
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,346 @@
+/* Icinga 2 | (c) 2012 Icinga GmbH | GPLv2+ */
+
+#include "remote/objectqueryhandler.hpp"
+#include "remote/httpserverconnection.hpp"
+#include "remote/endpoint.hpp"
+#include "icinga/downtime.hpp"
+#include "icinga/host.hpp"
+#include "icinga/notification.hpp"
+#include "config/configcompiler.hpp"
+#include "config/configitem.hpp"
+#include "base/convert.hpp"
+#include "base/io-engine.hpp"
+#include "base/json.hpp"
+#include "base/tlsutility.hpp"
+#include "base/utility.hpp"
+#include <boost/asio/ip/tcp.hpp>
+#include <boost/asio/ssl/stream_base.hpp>
+#include <boost/beast/core/flat_buffer.hpp>
+#include <boost/beast/http.hpp>
+#include <boost/filesystem.hpp>
+#include <future>
+#include <BoostTestTargetConfig.h>
+
+using namespace icinga;
+
+namespace http = boost::beast::http;
+
+/* More services than fit into one streamed batch, sharing a few hosts to join, and objects which change without a check result. */
+struct ObjectQueryHandlerFixture
+{
+	ObjectQueryHandlerFixture()
+	{
+		static bool loaded = false;
+
+		if (loaded)
+			return;
+
+		String config = "object CheckCommand \"objectqueryhandler\" { execute = {{ }} }\n";
+
+		for (int i = 0; i < 3; i++)
+			config += "object Host \"objectqueryhandler-" + Convert::ToString(i) + "\" { check_command = \"objectqueryhandler\"; vars.index = " + Convert::ToString(i) + " }\n";
+
+		for (int i = 0; i < 1200; i++)
+			config += "object Service \"service-" + Convert::ToString(i) + "\" { host_name = \"objectqueryhandler-" + Convert::ToString(i % 3) + "\"; check_command = \"objectqueryhandler\" }\n";
+
+		config += "object NotificationCommand \"objectqueryhandler\" { execute = {{ }} }\n"
+			"object User \"objectqueryhandler\" { }\n"
+			"object Notification \"objectqueryhandler\" { host_name = \"objectqueryhandler-0\"; command = \"objectqueryhandler\"; users = [ \"objectqueryhandler\" ] }\n"
+			"object Downtime \"objectqueryhandler\" { host_name = \"objectqueryhandler-0\"; author = \"objectqueryhandler\"; comment = \"objectqueryhandler\";"
+			" start_time = get_time() - 60; end_time = get_time() + 3600; fixed = false; duration = 60 }\n"
+			"object Endpoint \"objectqueryhandler\" { }\n"
+			"object Zone \"objectqueryhandler\" { endpoints = [ \"objectqueryhandler\" ] }\n";
+
+		std::unique_ptr<Expression> expr = ConfigCompiler::CompileText("<test>", config);
+
+		ActivationScope ascope;
+
+		ScriptFrame frame(true);
+		expr->Evaluate(frame);
+
+		WorkQueue upq;
+		std::vector<ConfigItem::Ptr> newItems;
+
+		BOOST_REQUIRE(ConfigItem::CommitItems(ascope.GetContext(), upq, newItems, true));
+		BOOST_REQUIRE(ConfigItem::ActivateItems(newItems, true));
+
+		loaded = true;
+	}
+};
+
+static Shared<boost::asio::ssl::context>::Ptr GetServerSslContext()
+{
+	static Shared<boost::asio::ssl::context>::Ptr context;
+
+	if (!context) {
+		auto dir (boost::filesystem::temp_directory_path() / boost::filesystem::unique_path("icinga2-objectqueryhandler-%%%%%%"));
+		boost::filesystem::create_directories(dir);
+
+		String keyfile = (dir / "server.key").string();
+		String certfile = (dir / "server.crt").string();
+
+		MakeX509CSR("objectqueryhandler", keyfile, String(), certfile);
+		context = MakeAsioSslContext(certfile, keyfile);
+
+		boost::filesystem::remove_all(dir);
+	}
+
+	return context;
+}
+
+/**
+ * Passes a request to the handler and reads the response from the client's side of a local TLS connection,
+ * so streamed responses are received exactly like regular ones.
+ */
+static http::response<http::string_body> QueryObjects(const String& path, const Dictionary::Ptr& params, unsigned version = 11,
+	const String& ifNoneMatch = String())
+{
+	namespace asio = boost::asio;
+	namespace ssl = boost::asio::ssl;
+
+	auto& io (IoEngine::Get().GetIoContext());
+	auto clientContext (MakeAsioSslContext());
+	auto client (Shared<AsioTlsStream>::Make(io, *clientContext));
+	auto server (Shared<AsioTlsStream>::Make(io, *GetServerSslContext()));
+
+	asio::ip::tcp::acceptor acceptor (io, asio::ip::tcp::endpoint(asio::ip::address_v4::loopback(), 0));
+	client->lowest_layer().connect(acceptor.local_endpoint());
+	acceptor.accept(server->lowest_layer());
+
+	ApiUser::Ptr user = new ApiUser();
+	user->SetPermissions(new Array({ "*" }));
+
+	http::request<http::string_body> request (http::verb::get, path.GetData(), version);
+
+	if (!ifNoneMatch.IsEmpty())
+		request.set(http::field::if_none_match, ifNoneMatch.GetData());
+
+	std::promise<void> served;
+	std::promise<http::response<http::string_body>> received;
+
+	IoEngine::SpawnCoroutine(io, [&](asio::yield_context yc) {
+		try {
+			server->next_layer().async_handshake(ssl::stream_base::server, yc);
+
+			{
+				HttpServerConnection::Ptr connection = new HttpServerConnection(String(), false, server);
+				ObjectQueryHandler::Ptr handler = new ObjectQueryHandler();
+				http::response<http::string_body> response;
+
+				response.version(version);
+				handler->HandleRequest(*server, user, request, new Url(path), response, params, yc, *connection);
+
+				/* Regular responses are written by the connection. */
+				if (!response.chunked()) {
+					http::async_write(*server, response, yc);
+					server->async_flush(yc);
+				}
+			}
+
+			served.set_value();
+		} catch (const std::exception&) {
+			served.set_exception(std::current_exception());
+		}
+	});
+
+	IoEngine::SpawnCoroutine(io, [&](asio::yield_context yc) {
+		try {
+			client->next_layer().async_handshake(ssl::stream_base::client, yc);
+
+			boost::beast::flat_buffer buf;
+			http::response<http::string_body> response;
+
+			http::async_read(*client, buf, response, yc);
+			received.set_value(std::move(response));
+		} catch (const std::exception&) {
+			received.set_exception(std::current_exception());
+		}
+	});
+
+	served.get_future().get();
+	http::response<http::string_body> response = received.get_future().get();
+
+	client->lowest_layer().close();
+	server->lowest_layer().close();
+
+	return response;
+}
+
+BOOST_FIXTURE_TEST_SUITE(remote_objectqueryhandler, ObjectQueryHandlerFixture)
+
+BOOST_AUTO_TEST_CASE(chunked_joins)
+{
+	auto params ([]() -> Dictionary::Ptr {
+		return new Dictionary({
+			{ "attrs", new Array({ "host_name" }) },
+			{ "joins", new Array({ "host.name", "host.vars" }) }
+		});
+	});
+
+	http::response<http::string_body> chunked = QueryObjects("/v1/objects/services", params());
+	http::response<http::string_body> buffered = QueryObjects("/v1/objects/services", params(), 10);
+
+	BOOST_CHECK_EQUAL(chunked.result_int(), 200);
+	BOOST_CHECK_EQUAL(buffered.result_int(), 200);
+	BOOST_CHECK(chunked.chunked());
+	BOOST_CHECK(!buffered.chunked());
+
+	/* The batches of a streamed response are the same as a regular response. */
+	Dictionary::Ptr chunkedResult = JsonDecode(chunked.body());
+	Dictionary::Ptr bufferedResult = JsonDecode(buffered.body());
+
+	BOOST_CHECK_EQUAL(JsonEncode(chunkedResult), JsonEncode(bufferedResult));
+
+	Array::Ptr results = chunkedResult->Get("results");
+	BOOST_REQUIRE(results);
+	BOOST_CHECK_EQUAL(results->GetLength(), 1200);
+
+	/* Joined objects which are serialized only once per batch are joined to the right objects in every batch. */
+	ObjectLock olock(results);
+
+	for (const Dictionary::Ptr& result : results) {
+		Dictionary::Ptr attrs = result->Get("attrs");
+		Dictionary::Ptr host = Dictionary::Ptr(result->Get("joins"))->Get("host");
+
+		BOOST_REQUIRE(host);
+		BOOST_CHECK_EQUAL(host->Get("name"), attrs->Get("host_name"));
+		BOOST_CHECK_EQUAL(Dictionary::Ptr(host->Get("vars"))->Get("index"),
+			Convert::ToDouble(String(attrs->Get("host_name")).SubStr(String("objectqueryhandler-").GetLength())));
+	}
+}
+
+BOOST_AUTO_TEST_CASE(etag)
+{
+	auto params ([]() -> Dictionary::Ptr {
+		return new Dictionary({
+			{ "attrs", new Array({ "name" }) }
+		});
+	});
+
+	http::response<http::string_body> first = QueryObjects("/v1/objects/hosts", params());
+	String etag (first[http::field::etag].to_string());
+
+	BOOST_CHECK_EQUAL(first.result_int(), 200);
+	BOOST_REQUIRE(!etag.IsEmpty());
+
+	http::response<http::string_body> unchanged = QueryObjects("/v1/objects/hosts", params(), 11, etag);
+
+	BOOST_CHECK_EQUAL(unchanged.result_int(), 304);
+	BOOST_CHECK_EQUAL(String(unchanged[http::field::etag].to_string()), etag);
+	BOOST_CHECK(unchanged.body().empty());
+
+	Host::GetByName("objectqueryhandler-1")->UpdateChangeVersion();
+
+	http::response<http::string_body> changed = QueryObjects("/v1/objects/hosts", params(), 11, etag);
+
+	BOOST_CHECK_EQUAL(changed.result_int(), 200);
+	BOOST_CHECK_NE(String(changed[http::field::etag].to_string()), etag);
+}
+
+BOOST_AUTO_TEST_CASE(changed_since)
+{
+	auto query ([](const Value& changedSince) {
+		Dictionary::Ptr params = new Dictionary({
+			{ "attrs", new Array({ "host_name" }) },
+			{ "joins", new Array({ "host.name" }) }
+		});
+
+		if (!changedSince.IsEmpty())
+			params->Set("changed_since", changedSince);
+
+		return QueryObjects("/v1/objects/services", params);
+	});
+
+	http::response<http::string_body> all = query(Empty);
+	BOOST_REQUIRE_EQUAL(all.result_int(), 200);
+
+	Dictionary::Ptr allResult = JsonDecode(all.body());
+	auto version (static_cast<uint_fast64_t>(allResult->Get("version")));
+
+	BOOST_CHECK(!allResult->Contains("removed"));
+	BOOST_CHECK_EQUAL(Array::Ptr(allResult->Get("results"))->GetLength(), 1200);
+
+	/* Versions are accepted as strings, which don't lose precision in clients, and as numbers. */
+	for (const Value& since : { Value(String(std::to_string(version))), Value(static_cast<double>(version)) }) {
+		http::response<http::string_body> none = query(since);
+		BOOST_REQUIRE_EQUAL(none.result_int(), 200);
+
+		Dictionary::Ptr noneResult = JsonDecode(none.body());
+
+		BOOST_CHECK_EQUAL(Array::Ptr(noneResult->Get("results"))->GetLength(), 0);
+		BOOST_CHECK_EQUAL(Array::Ptr(noneResult->Get("removed"))->GetLength(), 0);
+		BOOST_CHECK(static_cast<uint_fast64_t>(noneResult->Get("version")) >= version);
+	}
+
+	/* A changed host changes the results its services are joined to. */
+	Host::GetByName("objectqueryhandler-2")->UpdateChangeVersion();
+
+	http::response<http::string_body> joined = query(String(std::to_string(version)));
+	BOOST_REQUIRE_EQUAL(joined.result_int(), 200);
+
+	Array::Ptr results = Dictionary::Ptr(JsonDecode(joined.body()))->Get("results");
+	BOOST_REQUIRE(results);
+	BOOST_CHECK_EQUAL(results->GetLength(), 400);
+
+	ObjectLock olock(results);
+
+	for (const Dictionary::Ptr& result : results)
+		BOOST_CHECK_EQUAL(Dictionary::Ptr(result->Get("attrs"))->Get("host_name"), "objectqueryhandler-2");
+}
+
+BOOST_AUTO_TEST_CASE(changed_since_invalid)
+{
+	auto query ([](const Value& changedSince) {
+		return QueryObjects("/v1/objects/hosts", new Dictionary({ { "changed_since", changedSince } })).result_int();
+	});
+
+	BOOST_CHECK_EQUAL(query("abc"), 400);
+	BOOST_CHECK_EQUAL(query(""), 400);
+	BOOST_CHECK_EQUAL(query("-1"), 400);
+	BOOST_CHECK_EQUAL(query(-1), 400);
+	BOOST_CHECK_EQUAL(query(1.5), 400);
+	BOOST_CHECK_EQUAL(query(new Array()), 400);
+
+	/* A version from another instance or before a restart isn't known, even if it looks recent. */
+	BOOST_CHECK_EQUAL(query(String(std::to_string(ConfigObject::GetCurrentChangeVersion() + 1000 * 1000))), 410);
+	BOOST_CHECK_EQUAL(query("0"), 410);
+}
+
+BOOST_AUTO_TEST_CASE(change_versions)
+{
+	Downtime::Ptr downtime = Downtime::GetByName("objectqueryhandler-0!objectqueryhandler");
+	Notification::Ptr notification = Notification::GetByName("objectqueryhandler-0!objectqueryhandler");
+	Endpoint::Ptr endpoint = Endpoint::GetByName("objectqueryhandler");
+
+	BOOST_REQUIRE(downtime);
+	BOOST_REQUIRE(notification);
+	BOOST_REQUIRE(endpoint);
+
+	auto version (downtime->GetChangeVersion());
+	downtime->TriggerDowntime(Utility::GetTime());
+
+	BOOST_CHECK(downtime->GetTriggerTime() > 0);
+	BOOST_CHECK(downtime->GetChangeVersion() > version);
+
+	version = notification->GetChangeVersion();
+	notification->SetNotificationNumber(notification->GetNotificationNumber() + 1);
+
+	BOOST_CHECK(notification->GetChangeVersion() > version);
+
+	version = notification->GetChangeVersion();
+	notification->SetLastNotification(Utility::GetTime());
+
+	BOOST_CHECK(notification->GetChangeVersion() > version);
+
+	version = endpoint->GetChangeVersion();
+	Endpoint::OnConnected(endpoint, nullptr);
+
+	BOOST_CHECK(endpoint->GetChangeVersion() > version);
+
+	version = endpoint->GetChangeVersion();
+	Endpoint::OnDisconnected(endpoint, nullptr);
+
+	BOOST_CHECK(endpoint->GetChangeVersion() > version);
+}
+
+BOOST_AUTO_TEST_SUITE_END()